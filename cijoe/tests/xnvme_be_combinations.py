@@ -112,6 +112,14 @@ def get_backend_configurations():
             "mem": ["posix", "hugepage"],
             "label": ["file"],
         },
+        {
+            "be": ["posix_file"],
+            "async": ["posix"],
+            "sync": ["psync"],
+            "admin": ["file_as_ns"],
+            "mem": ["posix", "hugepage"],
+            "label": ["file"],
+        },
         # User-space NVMe-driver
         {
             "be": ["libvfn"],
@@ -157,6 +165,14 @@ def get_backend_configurations():
             "mproc": True,
         },
         # Ramdisk
+        {
+            "be": ["ramdisk_native"],
+            "async": ["ramdisk"],
+            "sync": ["ramdisk"],
+            "admin": ["ramdisk"],
+            "mem": ["posix", "hugepage"],
+            "label": ["bdev", "ramdisk"],
+        },
         {
             "be": ["ramdisk_emu"],
             "async": ["emu"],
@@ -16,7 +16,7 @@ struct xnvme_be_attr {
 	const char *descr; ///< Human-readable description
 	uint32_t caps;     ///< Bitmask of xnvme_be_cap (0 = legacy/mixin-based)
 
-	uint8_t _rsvd[4];
+	uint32_t qdepth_max; ///< Maximum capacity of a ::xnvme_queue, 0 = 2048 (legacy default)
 };
 
 /**
@@ -137,6 +137,9 @@ struct xnvme_cli_args {
 	uint32_t poll_sq;
 	uint32_t register_files;
 	uint32_t register_buffers;
+	uint32_t sqpoll_pool;
+	const char *sqpoll_cpus;
+	uint32_t sqpoll_idle;
 
 	uint32_t truncate;
 	uint32_t rdonly;
@@ -373,7 +376,11 @@ enum xnvme_cli_opt {
 	XNVME_CLI_OPT_HOST_HEAP_SIZE   = 133, ///< XNVME_CLI_OPT_HOST_HEAP_SIZE
 	XNVME_CLI_OPT_DEVICE_HEAP_SIZE = 134, ///< XNVME_CLI_OPT_DEVICE_HEAP_SIZE
 
-	XNVME_CLI_OPT_END = 135, ///< XNVME_CLI_OPT_END
+	XNVME_CLI_OPT_SQPOLL_POOL = 135, ///< XNVME_CLI_OPT_SQPOLL_POOL
+	XNVME_CLI_OPT_SQPOLL_CPUS = 136, ///< XNVME_CLI_OPT_SQPOLL_CPUS
+	XNVME_CLI_OPT_SQPOLL_IDLE = 137, ///< XNVME_CLI_OPT_SQPOLL_IDLE
+
+	XNVME_CLI_OPT_END = 138, ///< XNVME_CLI_OPT_END
 };
 
 /**
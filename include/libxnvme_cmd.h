@@ -160,6 +160,11 @@ xnvme_cmd_pass_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cn
 /**
  * Pass a NVMe Admin Command through to the device with minimal intervention
  *
+ * With XNVME_CMD_ASYNC set in the command-options, the command is submitted via the queue of the
+ * command-context and completes like any other command on the queue. This requires backend
+ * support, e.g. the 'io_uring_cmd' async interface of the Linux NVMe driver or the 'spdk'
+ * backend, otherwise -ENOSYS is returned.
+ *
  * @param ctx Pointer to command context (::xnvme_cmd_ctx)
  * @param dbuf pointer to data-payload
  * @param dbuf_nbytes size of data-payload in bytes
@@ -11,6 +11,20 @@ struct xnvme_opts_css {
 	uint32_t given;
 };
 
+/**
+ * Sharing of SQ-poller threads among io_uring queues with SQPOLL enabled
+ *
+ * @see xnvme_opts
+ *
+ * @enum xnvme_opts_sqpoll_pool
+ */
+enum xnvme_opts_sqpoll_pool {
+	XNVME_OPTS_SQPOLL_POOL_PROCESS = 0x0, ///< One SQ-poller for all queues in the process
+	XNVME_OPTS_SQPOLL_POOL_NUMA    = 0x1, ///< One SQ-poller per NUMA node of the devices
+	XNVME_OPTS_SQPOLL_POOL_DEVICE  = 0x2, ///< One SQ-poller per device
+	XNVME_OPTS_SQPOLL_POOL_NONE    = 0x3, ///< One SQ-poller per queue
+};
+
 /**
  * xNVMe options
  *
@@ -35,7 +49,9 @@ struct xnvme_opts {
 	uint32_t create_mode;      ///< OS file creation-mode
 	uint8_t poll_io;           ///< io_uring: enable io-polling
 	uint8_t poll_sq;           ///< io_uring: enable sqthread-polling
-	uint8_t register_files;    ///< io_uring: enable file-regirations
+	uint8_t register_files;    ///< io_uring: enable file and ring-fd registrations; the
+				   ///< ring-fd is registered per-thread, thus, a queue must then
+				   ///< only be used by the thread which initialized it
 	uint8_t register_buffers;  ///< io_uring: enable buffer-registration
 	struct xnvme_opts_css css; ///< SPDK controller-setup: do command-set-selection
 	uint32_t use_cmb_sqs;      ///< SPDK controller-setup: use controller-memory-buffer for sq
@@ -54,6 +70,9 @@ struct xnvme_opts {
 	size_t device_heap_size; ///< upcie-cuda/upcie-hip: GPU device heap size in bytes (0 =
 				 ///< default 1 GiB)
 	uint32_t gpu_id;         ///< upcie-cuda/upcie-hip: GPU ordinal to use (default 0)
+	uint32_t sqpoll_pool;    ///< io_uring: SQ-poller sharing, see ::xnvme_opts_sqpoll_pool
+	const char *sqpoll_cpus; ///< io_uring: CPU-list to pin SQ-pollers to e.g. "0-3,8"
+	uint32_t sqpoll_idle;    ///< io_uring: SQ-poller idle-time in msec. (0 = kernel default)
 };
 
 /**
@@ -24,6 +24,8 @@ struct xnvme_queue;
 enum xnvme_queue_opts {
 	XNVME_QUEUE_IOPOLL = 0x1,      ///< XNVME_QUEUE_IOPOLL: queue. is polled for completions
 	XNVME_QUEUE_SQPOLL = 0x1 << 1, ///< XNVME_QUEUE_SQPOLL: queue. is polled for submissions
+	XNVME_QUEUE_MPSC   = 0x1 << 3, ///< XNVME_QUEUE_MPSC: queue. has many submitters
+	XNVME_QUEUE_TUNED  = 0x1 << 4, ///< XNVME_QUEUE_TUNED: queue. driven by its creating thread
 };
 
 /**
@@ -31,10 +33,24 @@ enum xnvme_queue_opts {
  *
  * @param dev Device handle (::xnvme_dev) obtained with xnvme_dev_open()
  * @param capacity Maximum number of outstanding commands on the initialized queue, note that it
- * must be a power of 2 within the range [1,4096]
+ * must be a power of 2 within the range [1,qdepth_max], where 'qdepth_max' is reported by the
+ * backend via ::xnvme_be_attr, defaulting to 2048
  * @param opts Queue options
  * @param queue Pointer-pointer to the ::xnvme_queue to initialize
  *
+ * With ::XNVME_QUEUE_MPSC, then xnvme_queue_get_cmd_ctx(), xnvme_queue_put_cmd_ctx() and
+ * xnvme_cmd_pass() / xnvme_cmd_pass_iov() may be called concurrently from any number of threads.
+ * Commands passed this way are staged on a lock-free ring and handed to the backend by the single
+ * thread calling xnvme_queue_poke(), xnvme_queue_reap() or xnvme_queue_drain(), which is also the
+ * thread invoking the command callbacks. Commands rejected by the backend are completed with
+ * status-code-type ::XNVME_STATUS_CODE_TYPE_VENDOR and the `errno` value as status-code.
+ *
+ * With ::XNVME_QUEUE_TUNED, then the backend may set up the queue for a single submitting thread,
+ * the thread calling xnvme_queue_init(); for io_uring this means deferred task-running and, with
+ * ::XNVME_QUEUE_IOPOLL, hybrid polling. Setup features not supported by the running kernel are
+ * dropped one by one, thus, the option never makes xnvme_queue_init() fail. It has no effect in
+ * combination with ::XNVME_QUEUE_MPSC.
+ *
  * @return On success, 0 is returned. On error, negative `errno` is returned.
  */
 int
@@ -86,9 +102,46 @@ xnvme_queue_term(struct xnvme_queue *queue);
 int
 xnvme_queue_poke(struct xnvme_queue *queue, uint32_t max);
 
+/**
+ * Submit the commands staged on the given ::xnvme_queue
+ *
+ * Rings the doorbell once for all commands staged since the last submission, that is, one
+ * io_uring_submit(), one io_submit() or one SQ tail-doorbell write. Commands are staged by
+ * xnvme_cmd_pass_batch() and, on backends which defer submission, by xnvme_cmd_pass(). On
+ * backends which submit every command as it is passed, this is a no-op.
+ *
+ * @param queue Pointer to the ::xnvme_queue to submit staged commands on
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_queue_submit(struct xnvme_queue *queue);
+
+/**
+ * Wait for, and process, at least 'min_completions' commands on the given ::xnvme_queue
+ *
+ * Unlike repeated calls to xnvme_queue_poke(), the calling thread blocks on backends providing a
+ * blocking wait, e.g. io_uring_wait_cqes(), io_getevents() or a condition variable for thrpool.
+ * Backends which are polled by nature fall back to bounded spinning which yields the CPU while no
+ * completions arrive. Completions are processed by invoking their callbacks.
+ *
+ * @param queue Pointer to the ::xnvme_queue to wait/process commands on
+ * @param min_completions Number of completions to wait for, 0 or more than the number of
+ * outstanding commands means all outstanding commands
+ * @param timeout_ns Maximum time to wait in nanoseconds, 0 means no timeout
+ *
+ * @return On success, number of commands processed, which is less than 'min_completions' when
+ * the timeout expired. On error, negative `errno` is returned.
+ */
+int
+xnvme_queue_wait_timeout(struct xnvme_queue *queue, uint32_t min_completions,
+			 uint64_t timeout_ns);
+
 /**
  * Process outstanding commands on the given ::xnvme_queue until it is empty
  *
+ * The calling thread blocks as described for xnvme_queue_wait_timeout().
+ *
  * @param queue Pointer to the ::xnvme_queue to wait/process commands on
  *
  * @return On success, number of commands processed, may be 0. On error, negative `errno` is
@@ -137,6 +190,47 @@ xnvme_queue_get_cmd_ctx(struct xnvme_queue *queue);
 int
 xnvme_queue_put_cmd_ctx(struct xnvme_queue *queue, struct xnvme_cmd_ctx *ctx);
 
+/**
+ * Reap completions of commands on the given ::xnvme_queue without invoking callbacks
+ *
+ * Where xnvme_queue_poke() invokes the callback of each completed command, this stores the
+ * command-contexts of up to 'max' completed commands in 'ctxs' and leaves their processing to the
+ * caller. The completion is available via the 'cpl' member of each command-context, and the
+ * caller is responsible for returning it to the queue, as the callback would otherwise be.
+ *
+ * @param queue Pointer to the ::xnvme_queue to reap completions on
+ * @param ctxs Array of at least 'max' entries to store completed command-contexts in
+ * @param max The max number of completions to reap, must be non-zero
+ *
+ * @return On success, number of command-contexts stored in 'ctxs', may be 0. On error, negative
+ * `errno` is returned, -ENOSYS when the backend does not support reaping.
+ */
+int
+xnvme_queue_reap(struct xnvme_queue *queue, struct xnvme_cmd_ctx **ctxs, uint32_t max);
+
+/**
+ * Pass a batch of NVMe IO Commands through to the device with a single submission
+ *
+ * The commands are staged in the given order and then submitted using xnvme_queue_submit(). All
+ * command-contexts must be retrieved from the same ::xnvme_queue, and the batch must fit within
+ * the remaining capacity of the queue.
+ *
+ * @param ctxs Array of pointers to command contexts (::xnvme_cmd_ctx)
+ * @param dbufs Array of pointers to data-payloads
+ * @param dbufs_nbytes Array of data-payload sizes in bytes
+ * @param mbufs Array of pointers to meta-payloads, may be NULL
+ * @param mbufs_nbytes Array of meta-payload sizes in bytes, may be NULL
+ * @param nctxs Number of commands in the batch
+ *
+ * @return On success, the number of commands passed is returned, this is less than `nctxs` when
+ * a command could not be passed; the commands following it are not passed. On error, negative
+ * `errno` is returned, in which case no commands were passed, or, the submission failed and the
+ * staged commands are submitted by the next xnvme_queue_submit() or xnvme_queue_poke().
+ */
+int
+xnvme_cmd_pass_batch(struct xnvme_cmd_ctx **ctxs, void **dbufs, size_t *dbufs_nbytes,
+		     void **mbufs, size_t *mbufs_nbytes, uint32_t nctxs);
+
 /**
  * Signature of function used with Command Queues for async. callback upon command-completion
  */
@@ -157,10 +251,118 @@ xnvme_queue_set_cb(struct xnvme_queue *queue, xnvme_queue_cb cb, void *cb_arg);
 /**
  * Get the completion event fd on the given ::xnvme_queue
  *
+ * With io_uring, libaio and posix, the fd is created on first call, which fails with -EBUSY
+ * while commands are outstanding. Creating it further disables submission batching with libaio,
+ * and with posix, adds a notification, delivered on a thread, to each submitted batch. With the
+ * ramdisk and a performance model, the fd is a timerfd(), expiring when the next command completes
+ * by the model; either way, it is readable when a poke has completions to process.
+ *
  * @param queue Pointer to the ::xnvme_queue to query for outstanding commands
  *
- * @return On success, an eventfd() file descriptor is returned. On error, negative `errno`
- * is returned.
+ * @return On success, an eventfd() or timerfd() file descriptor is returned. On error, negative
+ * `errno` is returned.
  */
 int
 xnvme_queue_get_completion_fd(struct xnvme_queue *queue);
+
+/**
+ * Opaque handle of a group of ::xnvme_queue, possibly on different devices and backends, which
+ * are serviced together by xnvme_queue_group_poke() and xnvme_queue_group_wait()
+ *
+ * @see xnvme_queue_group_init
+ * @see xnvme_queue_group_term
+ *
+ * @struct xnvme_queue_group
+ */
+struct xnvme_queue_group;
+
+/**
+ * Allocate an empty group of queues
+ *
+ * @param group Pointer-pointer to the ::xnvme_queue_group to initialize
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_queue_group_init(struct xnvme_queue_group **group);
+
+/**
+ * Tear down the given ::xnvme_queue_group, the queues in it are not torn down
+ *
+ * @param group Pointer to the ::xnvme_queue_group to tear down
+ */
+void
+xnvme_queue_group_term(struct xnvme_queue_group *group);
+
+/**
+ * Add the given queue to the given group
+ *
+ * The completion event fd of the queue, when the backend provides one, is obtained via
+ * xnvme_queue_get_completion_fd() and used by xnvme_queue_group_wait(). Adding a queue thus has
+ * the side effects of obtaining the fd: with libaio, submission batching is disabled for the rest
+ * of the lifetime of the queue, and with io_uring, libaio and posix, the fd is only obtained when
+ * the queue has no outstanding commands. Thus, add queues before submitting on them; a queue
+ * without an fd is still serviced, though xnvme_queue_group_wait() then spins instead of blocking.
+ *
+ * @param group Pointer to the ::xnvme_queue_group to add the queue to
+ * @param queue Pointer to the ::xnvme_queue to add
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_queue_group_add(struct xnvme_queue_group *group, struct xnvme_queue *queue);
+
+/**
+ * Remove the given queue from the given group
+ *
+ * @param group Pointer to the ::xnvme_queue_group to remove the queue from
+ * @param queue Pointer to the ::xnvme_queue to remove
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_queue_group_remove(struct xnvme_queue_group *group, struct xnvme_queue *queue);
+
+/**
+ * Get the sum of outstanding commands on the queues of the given group
+ *
+ * @param group Pointer to the ::xnvme_queue_group to query
+ *
+ * @return The number of outstanding commands
+ */
+uint32_t
+xnvme_queue_group_get_outstanding(struct xnvme_queue_group *group);
+
+/**
+ * Process completions on all the queues of the given group, skipping those without outstanding
+ * commands
+ *
+ * For fairness, each call starts with the queue following the one it started with on the
+ * previous call, thus the 'max' budget is not consumed by the same queue on every call.
+ *
+ * @param group Pointer to the ::xnvme_queue_group to poke for completions
+ * @param max The maximum number of completions to process across the group, 0 means no max
+ *
+ * @return On success, number of completions processed, may be 0. On error, negative `errno` is
+ * returned.
+ */
+int
+xnvme_queue_group_poke(struct xnvme_queue_group *group, uint32_t max);
+
+/**
+ * Wait for, and process, completions on the queues of the given group
+ *
+ * Returns as soon as at least one completion is processed, or the timeout expired. When all the
+ * queues with outstanding commands provide a completion event fd, then the calling thread blocks
+ * on an epoll set of the fds, and only the queues signaled ready are poked. When a single queue
+ * has outstanding commands, then this waits via xnvme_queue_wait_timeout(). Otherwise, the
+ * queues are poked with bounded spinning.
+ *
+ * @param group Pointer to the ::xnvme_queue_group to wait on
+ * @param timeout_ns Maximum time to wait in nanoseconds, 0 means no timeout
+ *
+ * @return On success, number of completions processed, 0 when nothing is outstanding or the
+ * timeout expired. On error, negative `errno` is returned.
+ */
+int
+xnvme_queue_group_wait(struct xnvme_queue_group *group, uint64_t timeout_ns);
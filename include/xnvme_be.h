@@ -11,7 +11,14 @@
 
 #define XNVME_BE_QUEUE_STATE_NBYTES 256
 
-#define XNVME_BE_ASYNC_NBYTES 64
+/**
+ * Queue capacity limit of backends not reporting 'qdepth_max' in their ::xnvme_be_attr, and the
+ * largest power-of-2 capacity which can be given to xnvme_queue_init()
+ */
+#define XNVME_BE_QUEUE_QDEPTH_MAX_DEFAULT 2048
+#define XNVME_BE_QUEUE_QDEPTH_MAX         32768
+
+#define XNVME_BE_ASYNC_NBYTES 88
 #define XNVME_BE_SYNC_NBYTES  24
 #define XNVME_BE_ADMIN_NBYTES 24
 #define XNVME_BE_DEV_NBYTES   40
@@ -32,11 +39,24 @@ struct xnvme_be_async {
 	// Submit a vectored async io command to be processed on the backend's io path
 	int (*cmd_iov)(struct xnvme_cmd_ctx *, struct iovec *, size_t, size_t, void *, size_t);
 
+	// Submit an async admin command, completing via the queue like io commands do, NULL when
+	// the backend only supports admin commands via the synchronous admin interface
+	int (*cmd_admin)(struct xnvme_cmd_ctx *, void *, size_t, void *, size_t);
+
 	// Non-blocking reaping of up to `max` io completions
 	int (*poke)(struct xnvme_queue *, uint32_t);
 
-	// Blocking reaping of all outstanding io completions
-	int (*wait)(struct xnvme_queue *);
+	// Ring the doorbell for staged commands, NULL when cmd_io/cmd_iov always submit
+	int (*submit)(struct xnvme_queue *);
+
+	// Non-blocking reaping of up to `max` io completions into the given array, without
+	// invoking callbacks, NULL when not supported by the backend
+	int (*reap)(struct xnvme_queue *, struct xnvme_cmd_ctx **, uint32_t);
+
+	// Block until at least `min` io completions are available, or `timeout_ns` has passed (0
+	// means no timeout), then process the available completions like poke; -ENOSYS makes the
+	// caller fall back to polling with poke
+	int (*wait)(struct xnvme_queue *, uint32_t, uint64_t);
 
 	// Do initialization of the underlying backend's io path
 	int (*init)(struct xnvme_queue *, int);
@@ -19,6 +19,68 @@ extern struct xnvme_be_async g_xnvme_be_cbi_async_thrpool;
 extern struct xnvme_be_mem g_xnvme_be_cbi_mem_posix;
 extern struct xnvme_be_sync g_xnvme_be_cbi_sync_psync;
 
+/**
+ * Create the completion event fd of a CBI async queue, unless 'efd' already refers to one; the
+ * fd is signaled whenever a poke of the queue has work to do
+ *
+ * @return On success, the event fd is returned. On error, negative `errno` is returned, -ENOSYS
+ * on platforms without eventfd.
+ */
+int
+xnvme_be_cbi_async_efd_init(int *efd);
+
+void
+xnvme_be_cbi_async_efd_term(int *efd);
+
+/**
+ * Signal the given completion event fd, does nothing when 'efd' is negative
+ */
+void
+xnvme_be_cbi_async_efd_signal(int efd);
+
+#define XNVME_BE_CBI_ASYNC_MERGE_NCMDS_MAX 64
+#define XNVME_BE_CBI_ASYNC_MERGE_NVECS_MAX 256
+
+/**
+ * A group of LBA-contiguous read or write commands, carried out by the emulated async interfaces
+ * as a single vectored command via the synchronous interface of the device
+ */
+struct xnvme_be_cbi_async_merge {
+	struct xnvme_cmd_ctx ctx; ///< The merged command, a copy of the first command of the group
+
+	struct xnvme_cmd_ctx *ctxs[XNVME_BE_CBI_ASYNC_MERGE_NCMDS_MAX];
+	size_t nbytes[XNVME_BE_CBI_ASYNC_MERGE_NCMDS_MAX]; ///< Payload size of each command
+	uint32_t nctxs;
+
+	struct iovec dvec[XNVME_BE_CBI_ASYNC_MERGE_NVECS_MAX]; ///< Payload of the merged command
+	uint32_t dvec_cnt;
+	size_t dvec_nbytes;
+
+	uint64_t slba_next; ///< The LBA following the last command of the group
+	size_t lba_nbytes;
+};
+
+/**
+ * Add the given command to the group; the first command added starts the group
+ *
+ * @return true when the command is added, false when it is not eligible for merging, does not
+ * continue the group, or when the group is full
+ */
+bool
+xnvme_be_cbi_async_merge_add(struct xnvme_be_cbi_async_merge *merge, struct xnvme_cmd_ctx *ctx,
+			     void *data, uint32_t data_vec_cnt, size_t data_nbytes, void *meta,
+			     size_t meta_nbytes, bool is_vectored);
+
+/**
+ * Carry out the group as a single command via be.sync.cmd_iov(), and on success, copy the
+ * completion onto each of the commands in the group. The group is emptied.
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned and the commands are
+ * left untouched for the caller to carry out one by one.
+ */
+int
+xnvme_be_cbi_async_merge_exec(struct xnvme_be_cbi_async_merge *merge);
+
 int
 xnvme_be_cbi_sync_psync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes,
 			       void *mbuf, size_t mbuf_nbytes);
@@ -13,6 +13,9 @@
 #define XNVME_LINUX_CTRLR_FMT _PATH_DEV "nvme%1u"
 #define XNVME_LINUX_NS_FMT    _PATH_DEV "nvme%1un%1u"
 
+#define XNVME_BE_LINUX_BUFREG_NSLOTS     256
+#define XNVME_BE_LINUX_BUFREG_NBYTES_MAX (1ULL << 30)
+
 /**
  * Internal representation of XNVME_BE_LINUX state
  *
@@ -24,14 +27,67 @@ struct xnvme_be_linux_state {
 	uint8_t pseudo;
 	uint8_t poll_io;
 	uint8_t poll_sq;
+	uint8_t register_files;
+
+	struct xnvme_be_linux_bufreg *bufreg; ///< Set when opts.register_buffers is given
+
+	int ctrlr_fd; ///< Controller char-device of a namespace char-device, -1 when unavailable
+
+	uint8_t iou_attr_pi; ///< io_uring read/write PI-attribute; 0: not probed, 1: yes, 2: no
 
-	uint8_t _rsvd[121];
+	uint8_t _rsvd[107];
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_be_linux_state) == XNVME_BE_STATE_NBYTES, "Incorrect size")
 
 int
 xnvme_file_opts_to_linux(struct xnvme_opts *opts);
 
+/**
+ * Wrap the memory-interface of the given device, such that the buffers it allocates and the
+ * regions it maps are kept in a registry of io_uring fixed-buffer candidates
+ */
+int
+xnvme_be_linux_bufreg_init(struct xnvme_dev *dev);
+
+void
+xnvme_be_linux_bufreg_term(struct xnvme_dev *dev);
+
+/**
+ * The slots of the buffer registry; the first 'nslots' are in use, the rest have a NULL 'iov_base'
+ *
+ * The tag of a slot is unique to the buffer assigned to it, thus, a slot which is released and
+ * re-assigned a buffer, e.g. at the same address, or moved to fill the slot of a removed buffer,
+ * is still told apart by its tag.
+ */
+struct xnvme_be_linux_bufreg_slots {
+	uint32_t nslots;
+	struct iovec slots[XNVME_BE_LINUX_BUFREG_NSLOTS];
+	uint64_t tags[XNVME_BE_LINUX_BUFREG_NSLOTS];
+	uint16_t order[XNVME_BE_LINUX_BUFREG_NSLOTS]; ///< Slots in use by ascending 'iov_base'
+};
+
+/**
+ * Returns the generation of the registry, which changes whenever a buffer is added or removed
+ */
+uint64_t
+xnvme_be_linux_bufreg_gen(struct xnvme_be_linux_bufreg *reg);
+
+/**
+ * Copy the slots of the registry into 'slots'
+ *
+ * @return The generation of the copied slots
+ */
+uint64_t
+xnvme_be_linux_bufreg_snapshot(struct xnvme_be_linux_bufreg *reg,
+			       struct xnvme_be_linux_bufreg_slots *slots);
+
+/**
+ * Returns the index of the slot containing the 'nbytes' at 'buf', or -1 when none does
+ */
+int
+xnvme_be_linux_bufreg_find(const struct xnvme_be_linux_bufreg_slots *slots, const void *buf,
+			   size_t nbytes);
+
 static inline uint64_t
 xnvme_lba2off(struct xnvme_dev *dev, uint64_t lba)
 {
@@ -13,9 +13,16 @@ struct xnvme_queue_libaio {
 	struct io_event *aio_events;
 
 	uint8_t poll_io;
-	int efd; // Completion event FD
+	uint8_t batching; ///< Stage commands until poke / wait / submit, instead of per command
+	int efd;          // Completion event FD
 
-	uint8_t rsvd[204];
+	struct iocb *iocbs;   ///< Staging area for io-control-blocks not yet submitted
+	struct iocb **iocbps; ///< Pointers into 'iocbs' as consumed by io_submit()
+	SLIST_HEAD(, xnvme_cmd_ctx_entry) rejected; ///< Rejected by io_submit(), to be completed
+	uint32_t nrejected;
+	uint32_t nstaged; ///< Number of io-control-blocks staged
+
+	uint8_t rsvd[176];
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue_libaio) == XNVME_BE_QUEUE_STATE_NBYTES,
 		    "Incorrect size")
@@ -6,7 +6,7 @@
 #define __INTERNAL_XNVME_BE_LINUX_LIBURING_H
 #include <liburing.h>
 
-#define XNVME_QUEUE_IOU_CQE_BATCH_MAX 8
+#define XNVME_QUEUE_IOU_CQE_BATCH_MAX 64
 #define XNVME_QUEUE_IOU_BIGSQE        (0x1 << 2)
 
 struct xnvme_queue_liburing {
@@ -17,13 +17,21 @@ struct xnvme_queue_liburing {
 	uint8_t poll_io;
 	uint8_t poll_sq;
 	uint8_t batching;
+	uint8_t fixed_file; // The device-fd is registered, at index 0
 	int efd; // Completion event FD
 
-	uint8_t _rsvd[5];
+	struct xnvme_queue_liburing_aux *aux; ///< Fixed-buffers and PI-attributes of the queue
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue_liburing) == XNVME_BE_QUEUE_STATE_NBYTES,
 		    "Incorrect size")
 
+/**
+ * Returns the index of the registered buffer containing the 'nbytes' at 'buf', or -1 when the
+ * queue has no registered buffers or none of them contains it
+ */
+int
+xnvme_be_linux_liburing_buf_index(struct xnvme_queue_liburing *queue, void *buf, size_t nbytes);
+
 int
 xnvme_be_linux_liburing_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes,
 			       void *mbuf, size_t mbuf_nbytes);
@@ -32,7 +40,20 @@ int
 xnvme_be_linux_liburing_poke(struct xnvme_queue *queue, uint32_t max);
 
 int
-xnvme_be_linux_liburing_wait(struct xnvme_queue *queue);
+xnvme_be_linux_liburing_submit(struct xnvme_queue *queue);
+
+int
+xnvme_be_linux_liburing_reap(struct xnvme_queue *queue, struct xnvme_cmd_ctx **ctxs, uint32_t max);
+
+/**
+ * Submit staged SQEs and block until at least 'min' CQEs are available, or 'timeout_ns' has
+ * passed, 0 meaning no timeout, without consuming the CQEs
+ */
+int
+xnvme_be_linux_liburing_wait_cqes(struct xnvme_queue *queue, uint32_t min, uint64_t timeout_ns);
+
+int
+xnvme_be_linux_liburing_wait(struct xnvme_queue *queue, uint32_t min, uint64_t timeout_ns);
 
 int
 xnvme_be_linux_liburing_init(struct xnvme_queue *queue, int opts);
@@ -17,6 +17,15 @@ xnvme_be_linux_nvme_cmd_admin(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf
 int
 xnvme_be_linux_nvme_dev_nsid(struct xnvme_dev *dev);
 
+/**
+ * Open the controller char-device, e.g. /dev/nvme0, of the namespace char-device, e.g. /dev/ng0n1,
+ * of the given device
+ *
+ * @return On success, the file-descriptor is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_be_linux_nvme_ctrlr_open(struct xnvme_dev *dev);
+
 int
 xnvme_be_linux_nvme_map_cpl(struct xnvme_cmd_ctx *ctx, unsigned long ioctl_req, int err);
 
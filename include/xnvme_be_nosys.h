@@ -36,7 +36,7 @@ int
 xnvme_be_nosys_queue_poke(struct xnvme_queue *queue, uint32_t max);
 
 int
-xnvme_be_nosys_queue_wait(struct xnvme_queue *queue);
+xnvme_be_nosys_queue_wait(struct xnvme_queue *queue, uint32_t min, uint64_t timeout_ns);
 
 int
 xnvme_be_nosys_queue_init(struct xnvme_queue *queue, int opts);
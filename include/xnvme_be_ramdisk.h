@@ -4,21 +4,268 @@
 
 #ifndef __INTERNAL_XNVME_BE_RAMDISK_H
 #define __INTERNAL_XNVME_BE_RAMDISK_H
+struct xnvme_be_ramdisk_znd;
+struct xnvme_be_ramdisk_model;
+struct xnvme_be_ramdisk_fdp;
+struct xnvme_be_ramdisk_kv;
+
 struct xnvme_be_ramdisk_state {
 	void *ramdisk;
+	size_t nbytes;   ///< Capacity of the ramdisk, as given by the URI, or its whole zones
+	size_t mapped;   ///< Length of the mapping of 'ramdisk', zero when it is allocated
+	int fd;          ///< Backing file or memfd, -1 when anonymous
+	uint32_t flags;  ///< Options given by the URI, see ::xnvme_be_ramdisk_flags
+
+	struct xnvme_be_ramdisk_znd *znd;     ///< Zone state, NULL unless the ramdisk is zoned
+	struct xnvme_be_ramdisk_model *model; ///< Performance model, NULL unless given
+	struct xnvme_be_ramdisk_fdp *fdp;     ///< Reclaim units, NULL unless FDP is enabled
+	struct xnvme_be_ramdisk_kv *kv;       ///< Key-Value index, NULL unless a KV namespace
+
+	uint8_t *meta;  ///< Metadata of the LBAs, following their data, NULL without metadata
+	uint32_t lbads; ///< Data bytes of an LBA
+	uint16_t ms;    ///< Metadata bytes of an LBA
+	uint8_t pit;    ///< Protection information type, zero when disabled
+	uint8_t pif;    ///< Protection information format, see ::xnvme_spec_nvm_ns_pif
 
-	uint8_t _rsvd[120];
+	uint8_t _rsvd[48];
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_be_ramdisk_state) == XNVME_BE_STATE_NBYTES,
 		    "Incorrect size");
 
+enum xnvme_be_ramdisk_flags {
+	XNVME_BE_RAMDISK_SPARSE = 0x1,    ///< Populated on first touch, memory is not reserved
+	XNVME_BE_RAMDISK_HUGEPAGE = 0x2,  ///< Backed by hugetlb pages via memfd
+	XNVME_BE_RAMDISK_FILE = 0x4,      ///< Backed by a shared mapping of a file
+	XNVME_BE_RAMDISK_ZONED = 0x8,     ///< Zoned Namespace, sequential write required zones
+	XNVME_BE_RAMDISK_MODEL = 0x10,    ///< Completions are timed by a performance model
+	XNVME_BE_RAMDISK_EXTENDED = 0x20, ///< Metadata is transferred interleaved with the data
+	XNVME_BE_RAMDISK_PI_FIRST = 0x40, ///< Protection information leads the metadata
+	XNVME_BE_RAMDISK_FDP = 0x80,      ///< Flexible Data Placement, with reclaim units
+	XNVME_BE_RAMDISK_KV = 0x100,      ///< Key-Value namespace instead of LBAs
+};
+
+#define XNVME_BE_RAMDISK_MEM_FLAGS \
+	(XNVME_BE_RAMDISK_SPARSE | XNVME_BE_RAMDISK_HUGEPAGE | XNVME_BE_RAMDISK_FILE)
+
+#define XNVME_BE_RAMDISK_LBA_NBYTES 512
+#define XNVME_BE_RAMDISK_ZSZE_NBYTES (16ULL << 20)
+#define XNVME_BE_RAMDISK_RUNS_NBYTES (32ULL << 20)
+#define XNVME_BE_RAMDISK_NRUH 8
+#define XNVME_BE_RAMDISK_NRUH_MAX 128
+#define XNVME_BE_RAMDISK_NRG_MAX 128
+#define XNVME_BE_RAMDISK_OP 7
+#define XNVME_BE_RAMDISK_KV_KML 16               ///< Key max length, as carried by a command
+#define XNVME_BE_RAMDISK_KV_VML (1U << 20)       ///< Value max length
+#define XNVME_BE_RAMDISK_KV_NBYTES 4096          ///< Capacity per key, by default
+#define XNVME_BE_RAMDISK_KV_NKEYS_MAX (1U << 30) ///< Max number of keys
+
+struct xnvme_be_ramdisk_params {
+	size_t nbytes;
+	uint32_t flags;
+	char path[XNVME_IDENT_URI_LEN];
+
+	size_t zsze;  ///< Zone size in bytes
+	size_t zcap;  ///< Zone capacity in bytes
+	uint32_t mor; ///< Maximum open zones, zero means no limit
+	uint32_t mar; ///< Maximum active zones, zero means no limit
+
+	uint32_t rlat; ///< Latency of reads in usec
+	uint32_t wlat; ///< Latency of writes in usec
+	uint32_t olat; ///< Latency of other commands in usec
+	size_t bw;     ///< Transfer bandwidth of a channel in bytes per second, zero means no cost
+	uint32_t nch;  ///< Number of channels
+	uint32_t waf;  ///< Write amplification in percent, once the capacity has been written
+
+	size_t lbads; ///< Data bytes of an LBA
+	uint32_t ms;  ///< Metadata bytes of an LBA
+	uint32_t pit; ///< Protection information type, zero when disabled
+	uint32_t pif; ///< Protection information format, see ::xnvme_spec_nvm_ns_pif
+
+	uint32_t nrg;  ///< Number of reclaim groups
+	uint32_t nruh; ///< Number of reclaim unit handles
+	size_t runs;   ///< Reclaim unit nominal size in bytes
+	uint32_t op;   ///< Reclaim units beyond the capacity, in percent of it
+
+	uint32_t nkeys; ///< Max number of keys of a KV namespace
+};
+
+/**
+ * Parse the URI of a ramdisk: "<size>[<unit>][,sparse][,hugepage][,file=<path>][,zoned]"
+ *
+ * The unit is one of B, K, KB, KiB, M, MB, MiB, G, GB, GiB, T, TB and TiB, all binary, or none
+ * for bytes, and the size must be a multiple of the LBA size; e.g. "1GB", "512MiB,hugepage",
+ * "4TB,sparse" and "8GB,file=/tmp/ramdisk.img"
+ *
+ * A zoned ramdisk takes the options "zsze=<size>", "zcap=<size>", "mor=<count>" and
+ * "mar=<count>"; e.g. "1GB,zoned,zsze=64MiB,mor=14,mar=14"
+ *
+ * The performance model is given by the options "rlat=<usec>", "wlat=<usec>", "olat=<usec>",
+ * "bw=<size>", "nch=<count>" and "waf=<percent>"; e.g. "1GB,rlat=80,wlat=20,bw=400MiB,nch=8"
+ *
+ * The LBA format is given by the options "lbads=<size>", "ms=<bytes>", "extended", "pi=<type>",
+ * "pif=<16|64>" and "pifirst"; e.g. "1GB,lbads=4KiB,ms=16,pi=1,pif=64"
+ *
+ * Flexible Data Placement is enabled by "fdp" and takes the options "nrg=<count>",
+ * "nruh=<count>", "runs=<size>" and "op=<percent>"; e.g. "1GB,fdp,nruh=4,runs=16MiB"
+ *
+ * A Key-Value namespace is given by "kv" and takes the option "nkeys=<count>"; the capacity then
+ * bounds the bytes of the keys and values stored; e.g. "1GB,kv,nkeys=1000000"
+ *
+ * @return On success, 0 is returned. On error, negative errno is returned.
+ */
+int
+xnvme_be_ramdisk_parse_uri(const char *uri, struct xnvme_be_ramdisk_params *params);
+
+/**
+ * Whether the platforms should classify the given URI as a ramdisk; that is, when it parses, and
+ * its size carries an explicit unit, e.g. "1GB" but not "512", which is left to other backends
+ * and is only taken as a ramdisk of bytes when the ramdisk backend is selected explicitly
+ */
+bool
+xnvme_be_ramdisk_classify_uri(const char *uri);
+
 int
 xnvme_be_ramdisk_supported(struct xnvme_dev *dev, uint32_t opts);
 
 size_t
 xnvme_be_ramdisk_dev_get_size(struct xnvme_dev *dev);
 
+int
+xnvme_be_ramdisk_model_init(struct xnvme_be_ramdisk_state *state,
+			    const struct xnvme_be_ramdisk_params *params);
+
+void
+xnvme_be_ramdisk_model_term(struct xnvme_be_ramdisk_state *state);
+
+/**
+ * Queue the command on the channel of the model which frees up first
+ *
+ * @return The time, in nanoseconds of the monotonic clock, at which the command completes
+ */
+uint64_t
+xnvme_be_ramdisk_model_deadline(struct xnvme_be_ramdisk_model *model,
+				const struct xnvme_cmd_ctx *ctx, size_t nbytes);
+
+/**
+ * Block the calling thread until the given deadline
+ */
+void
+xnvme_be_ramdisk_model_wait(uint64_t deadline);
+
+int
+xnvme_be_ramdisk_znd_init(struct xnvme_be_ramdisk_state *state,
+			  const struct xnvme_be_ramdisk_params *params);
+
+void
+xnvme_be_ramdisk_znd_term(struct xnvme_be_ramdisk_state *state);
+
+int
+xnvme_be_ramdisk_znd_idfy_ctrlr(struct xnvme_dev *dev, void *dbuf);
+
+int
+xnvme_be_ramdisk_znd_idfy_ns(struct xnvme_dev *dev, void *dbuf);
+
+/**
+ * Advance the write pointer of the zone written by 'nlb' LBAs at 'slba', opening the zone
+ * implicitly; on error the completion-status of 'ctx' is set and -EIO is returned
+ */
+int
+xnvme_be_ramdisk_znd_write(struct xnvme_cmd_ctx *ctx, uint64_t slba, uint64_t nlb);
+
+/**
+ * Reserve the LBAs of the Zone Append in 'ctx' and assign the first of them to ctx->cpl.result
+ */
+int
+xnvme_be_ramdisk_znd_append(struct xnvme_cmd_ctx *ctx);
+
+int
+xnvme_be_ramdisk_znd_mgmt_send(struct xnvme_cmd_ctx *ctx);
+
+int
+xnvme_be_ramdisk_znd_mgmt_recv(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes);
+
+int
+xnvme_be_ramdisk_fdp_init(struct xnvme_be_ramdisk_state *state,
+			  const struct xnvme_be_ramdisk_params *params);
+
+void
+xnvme_be_ramdisk_fdp_term(struct xnvme_be_ramdisk_state *state);
+
+/**
+ * Reserve room in the reclaim group of the LBAs written by the command in 'ctx', reclaiming units
+ * as needed; called ahead of moving the data, such that placing it cannot fail. When the group is
+ * full, the completion-status of 'ctx' is set to Capacity Exceeded and -EIO is returned.
+ */
+int
+xnvme_be_ramdisk_fdp_reserve(struct xnvme_cmd_ctx *ctx, const void *dbuf);
+
+/**
+ * Release the room reserved for a command which failed to move its data
+ */
+void
+xnvme_be_ramdisk_fdp_release(struct xnvme_cmd_ctx *ctx, const void *dbuf);
+
+/**
+ * Place the LBAs written by the command in 'ctx' in the reclaim unit referenced by its placement
+ * identifier, consuming its reservation, and invalidate those they overwrite or deallocate;
+ * called once the data is moved, on error the completion-status of 'ctx' is set and -EIO is
+ * returned
+ */
+int
+xnvme_be_ramdisk_fdp_io(struct xnvme_cmd_ctx *ctx, const void *dbuf);
+
+int
+xnvme_be_ramdisk_fdp_mgmt_recv(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes);
+
+int
+xnvme_be_ramdisk_fdp_mgmt_send(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes);
+
+int
+xnvme_be_ramdisk_fdp_log(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes);
+
+int
+xnvme_be_ramdisk_fdp_gfeat(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes);
+
+int
+xnvme_be_ramdisk_fdp_sfeat(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes);
+
+int
+xnvme_be_ramdisk_kv_init(struct xnvme_be_ramdisk_state *state,
+			 const struct xnvme_be_ramdisk_params *params);
+
+void
+xnvme_be_ramdisk_kv_term(struct xnvme_be_ramdisk_state *state);
+
+int
+xnvme_be_ramdisk_kv_idfy_ns(struct xnvme_dev *dev, void *dbuf);
+
+/**
+ * Carry out a store, retrieve, delete, exist or list on a Key-Value ramdisk; on a command error,
+ * e.g. a key which does not exist, the completion-status of 'ctx' is set and -EIO is returned
+ */
+int
+xnvme_be_ramdisk_kv_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes);
+
+/**
+ * Carry out a read, write, compare, write zeroes, copy or append on a ramdisk formatted with
+ * metadata; the metadata is moved along with the data, and protection information is checked and
+ * generated as given by the PRINFO of the command. On a protection information check error, the
+ * completion-status of 'ctx' is set and -EIO is returned
+ */
+int
+xnvme_be_ramdisk_meta_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+			 size_t mbuf_nbytes);
+
+int
+xnvme_be_ramdisk_sync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+			     size_t mbuf_nbytes);
+
+int
+xnvme_be_ramdisk_sync_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+			      size_t dvec_nbytes, void *mbuf, size_t mbuf_nbytes);
+
 extern struct xnvme_be_admin g_xnvme_be_ramdisk_admin;
+extern struct xnvme_be_async g_xnvme_be_ramdisk_async;
 extern struct xnvme_be_sync g_xnvme_be_ramdisk_sync;
 extern struct xnvme_be_mem g_xnvme_be_ramdisk_mem;
 extern struct xnvme_be_dev g_xnvme_be_ramdisk_dev;
@@ -63,6 +63,9 @@ extern const struct xnvme_be_config g_xnvme_be_linux_iou_file;
 #ifdef XNVME_BE_LINUX_LIBAIO_ENABLED
 extern const struct xnvme_be_config g_xnvme_be_linux_aio_file;
 #endif
+#ifdef XNVME_BE_CBI_ASYNC_POSIX_ENABLED
+extern const struct xnvme_be_config g_xnvme_be_linux_posix_file;
+#endif
 #endif /* XNVME_PLATFORM_LINUX_ENABLED */
 
 /* FreeBSD */
@@ -88,6 +91,7 @@ extern const struct xnvme_be_config g_xnvme_be_driverkit_emu;
 /* Ramdisk */
 #ifdef XNVME_BE_RAMDISK_ENABLED
 extern const struct xnvme_be_config g_xnvme_be_ramdisk_nil;
+extern const struct xnvme_be_config g_xnvme_be_ramdisk_native;
 extern const struct xnvme_be_config g_xnvme_be_ramdisk_thrpool;
 extern const struct xnvme_be_config g_xnvme_be_ramdisk_emu;
 #endif
@@ -11,8 +11,9 @@
 #include <xnvme_be.h>
 #include <xnvme_queue.h>
 
-#define XNVME_BE_SPDK_QPAIR_MAX 64
-#define XNVME_BE_SPDK_ALIGN     0x1000
+#define XNVME_BE_SPDK_QPAIR_MAX     64
+#define XNVME_BE_SPDK_ALIGN         0x1000
+#define XNVME_BE_SPDK_QUEUE_NADMIN  8 ///< Max. async admin-commands in-flight per queue
 
 struct xnvme_be_spdk_iov_payload {
 	struct iovec *iov;
@@ -21,6 +22,17 @@ struct xnvme_be_spdk_iov_payload {
 	size_t iov_offset;
 };
 
+/**
+ * An async admin-command in-flight on the controller admin queue; the admin queue is shared by all
+ * queues of the controller and SPDK invokes completion callbacks from whichever thread processes
+ * admin completions, thus, the callback only marks the slot 'done' and the owning queue delivers
+ * the completion on poke / reap
+ */
+struct xnvme_be_spdk_admin_slot {
+	struct xnvme_cmd_ctx *ctx;
+	_Atomic uint8_t done;
+};
+
 struct xnvme_queue_spdk {
 	struct xnvme_queue_base base;
 
@@ -28,7 +40,13 @@ struct xnvme_queue_spdk {
 
 	struct xnvme_be_spdk_iov_payload *iov_payloads;
 
-	uint8_t rsvd[216];
+	struct xnvme_cmd_ctx **reaped; ///< When set, completions are stored here by cmd_async_cb
+	uint32_t nreaped;
+
+	uint32_t nadmin; ///< Number of 'admin' slots in use
+	struct xnvme_be_spdk_admin_slot admin[XNVME_BE_SPDK_QUEUE_NADMIN];
+
+	uint8_t rsvd[72];
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue_spdk) == XNVME_BE_QUEUE_STATE_NBYTES,
 		    "Incorrect size")
@@ -16,6 +16,8 @@ enum xnvme_cmd_opts {
 
 	XNVME_CMD_UPLD_SGLD = 0x1 << 2, ///< XNVME_CMD_UPLD_SGLD: User-managed SGL data
 	XNVME_CMD_UPLD_SGLM = 0x1 << 3, ///< XNVME_CMD_UPLD_SGLM: User-managed SGL meta
+
+	XNVME_CMD_DEFER = 0x1 << 4, ///< XNVME_CMD_DEFER: Stage command, see xnvme_queue_submit()
 };
 
 #define XNVME_CMD_MASK_IOMD (XNVME_CMD_SYNC | XNVME_CMD_ASYNC)
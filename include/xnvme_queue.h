@@ -4,6 +4,7 @@
 
 #ifndef __INTERNAL_XNVME_QUEUE_H
 #define __INTERNAL_XNVME_QUEUE_H
+#include <stddef.h>
 #include <sys/queue.h>
 
 /**
@@ -40,13 +41,125 @@ struct xnvme_queue_base {
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue_base) == 24, "Incorrect size")
 
+#define XNVME_QUEUE_CACHELINE_NBYTES 64
+
+/**
+ * The command-context pool is allocated in chunks of 2^XNVME_QUEUE_POOL_CHUNK_NENTRIES_LOG2
+ * entries, that is, 2MB per chunk which is backed by a hugepage where the platform allows it
+ */
+#define XNVME_QUEUE_POOL_CHUNK_NENTRIES_LOG2 14
+#define XNVME_QUEUE_POOL_CHUNK_NENTRIES      (1 << XNVME_QUEUE_POOL_CHUNK_NENTRIES_LOG2)
+#define XNVME_QUEUE_POOL_CHUNK_NBYTES \
+	(XNVME_QUEUE_POOL_CHUNK_NENTRIES * sizeof(struct xnvme_cmd_ctx_entry))
+
+struct xnvme_queue_mpsc;
+
+/**
+ * The backend queue-state occupies the first XNVME_BE_QUEUE_STATE_NBYTES, library-managed state
+ * follows it, thus out of reach of the backend
+ */
 struct xnvme_queue {
 	struct xnvme_queue_base base;
 
 	uint8_t be_rsvd[232]; ///< Auxilary backend data
 
-	struct xnvme_cmd_ctx_entry pool_storage[];
+	struct xnvme_queue_mpsc *mpsc; ///< Multi-producer state; NULL unless XNVME_QUEUE_MPSC
+
+	struct xnvme_cmd_ctx_entry *pool_chunks[]; ///< Pool of command-contexts in chunks
 };
-XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue) == XNVME_BE_QUEUE_STATE_NBYTES, "Incorrect size")
+XNVME_STATIC_ASSERT(offsetof(struct xnvme_queue, mpsc) == XNVME_BE_QUEUE_STATE_NBYTES,
+		    "Incorrect size")
+
+/**
+ * Returns the command-context pool entry with the given id, in the range [0, capacity]
+ */
+static inline struct xnvme_cmd_ctx_entry *
+xnvme_queue_entry(struct xnvme_queue *queue, uint32_t id)
+{
+	return &queue->pool_chunks[id >> XNVME_QUEUE_POOL_CHUNK_NENTRIES_LOG2]
+				  [id & (XNVME_QUEUE_POOL_CHUNK_NENTRIES - 1)];
+}
+
+/**
+ * Yield the CPU of the calling thread, used when polling for completions without progress
+ */
+void
+xnvme_queue_yield(void);
+
+struct xnvme_queue_ring;
+
+/**
+ * Allocate a bounded lock-free ring of pointers, safe for any number of concurrent producers and
+ * consumers; 'nslots' must be a power of two. The ring is released with free().
+ */
+struct xnvme_queue_ring *
+xnvme_queue_ring_alloc(uint32_t nslots);
+
+/**
+ * @return On success, 0 is returned. When the ring is full, -EBUSY is returned.
+ */
+int
+xnvme_queue_ring_push(struct xnvme_queue_ring *ring, void *ptr);
+
+/**
+ * @return The oldest pointer on the ring, or NULL when the ring is empty
+ */
+void *
+xnvme_queue_ring_pop(struct xnvme_queue_ring *ring);
+
+/**
+ * Returns the number of pointers on the ring, a snapshot when producers / consumers are active
+ */
+uint32_t
+xnvme_queue_ring_count(struct xnvme_queue_ring *ring);
+
+/**
+ * Setup the multi-producer state of the given queue, that is, the lock-free command-context
+ * freelist populated with the queue's pool and the lock-free staging ring
+ */
+int
+xnvme_queue_mpsc_init(struct xnvme_queue *queue);
+
+void
+xnvme_queue_mpsc_term(struct xnvme_queue *queue);
+
+struct xnvme_cmd_ctx *
+xnvme_queue_mpsc_get_cmd_ctx(struct xnvme_queue *queue);
+
+int
+xnvme_queue_mpsc_put_cmd_ctx(struct xnvme_queue *queue, struct xnvme_cmd_ctx *ctx);
+
+/**
+ * Stage a command on the staging ring, safe to call from multiple threads. Either 'dbuf' or
+ * 'dvec' is given, the latter for a vectored command.
+ */
+int
+xnvme_queue_mpsc_stage(struct xnvme_cmd_ctx *ctx, void *dbuf, struct iovec *dvec, size_t dvec_cnt,
+		       size_t dbuf_nbytes, void *mbuf, size_t mbuf_nbytes);
+
+/**
+ * Pass staged commands on to the backend, as many as it has capacity for, and submit them. Must
+ * only be called by the thread processing completions on the queue.
+ *
+ * @return On success, 0 is returned. On error, negative `errno` is returned.
+ */
+int
+xnvme_queue_mpsc_flush(struct xnvme_queue *queue);
+
+/**
+ * Complete up to 'max' commands rejected by the backend during xnvme_queue_mpsc_flush(); with
+ * 'ctxs' given, the command-contexts are stored in it, otherwise their callbacks are invoked
+ *
+ * @return The number of commands completed
+ */
+int
+xnvme_queue_mpsc_complete_failed(struct xnvme_queue *queue, struct xnvme_cmd_ctx **ctxs,
+				 uint32_t max);
+
+/**
+ * Returns the number of commands staged, or rejected, but not yet completed by the backend
+ */
+uint32_t
+xnvme_queue_mpsc_nstaged(struct xnvme_queue *queue);
 
 #endif /* __INTERNAL_XNVME_QUEUE_H */
@@ -57,8 +57,12 @@ xnvme_be_upcie_queue_term(struct xnvme_queue *queue)
 	return 0;
 }
 
-int
-xnvme_be_upcie_queue_poke(struct xnvme_queue *queue, uint32_t max)
+/**
+ * Process up to 'max' completions; with 'ctxs' given, the completed command-contexts are stored
+ * in it, otherwise their callbacks are invoked
+ */
+static inline int
+_upcie_queue_complete(struct xnvme_queue *queue, struct xnvme_cmd_ctx **ctxs, uint32_t max)
 {
 	struct xnvme_queue_upcie *upcie_queue = (struct xnvme_queue_upcie *)queue;
 	struct nvme_qpair *qp = &upcie_queue->qpair;
@@ -105,7 +109,11 @@ xnvme_be_upcie_queue_poke(struct xnvme_queue *queue, uint32_t max)
 
 			queue->base.outstanding -= 1;
 
-			ctx->async.cb(ctx, ctx->async.cb_arg);
+			if (ctxs) {
+				ctxs[reaped - 1] = ctx;
+			} else {
+				ctx->async.cb(ctx, ctx->async.cb_arg);
+			}
 		}
 	} while (reaped < max);
 
@@ -116,6 +124,29 @@ xnvme_be_upcie_queue_poke(struct xnvme_queue *queue, uint32_t max)
 	return reaped;
 }
 
+int
+xnvme_be_upcie_queue_poke(struct xnvme_queue *queue, uint32_t max)
+{
+	return _upcie_queue_complete(queue, NULL, max);
+}
+
+int
+xnvme_be_upcie_queue_reap(struct xnvme_queue *queue, struct xnvme_cmd_ctx **ctxs, uint32_t max)
+{
+	return _upcie_queue_complete(queue, ctxs, max);
+}
+
+int
+xnvme_be_upcie_queue_submit(struct xnvme_queue *queue)
+{
+	struct xnvme_queue_upcie *upcie_queue = (struct xnvme_queue_upcie *)queue;
+
+	wmb();
+	nvme_qpair_sqdb_update(&upcie_queue->qpair);
+
+	return 0;
+}
+
 int
 xnvme_be_upcie_async_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
 			    size_t XNVME_UNUSED(mbuf_nbytes))
@@ -234,6 +265,8 @@ struct xnvme_be_async g_xnvme_be_upcie_async = {
 	.cmd_io = xnvme_be_upcie_async_cmd_io,
 	.cmd_iov = xnvme_be_upcie_async_cmd_iov,
 	.poke = xnvme_be_upcie_queue_poke,
+	.submit = xnvme_be_upcie_queue_submit,
+	.reap = xnvme_be_upcie_queue_reap,
 	.wait = xnvme_be_nosys_queue_wait,
 	.init = xnvme_be_upcie_queue_init,
 	.term = xnvme_be_upcie_queue_term,
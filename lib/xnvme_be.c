@@ -185,6 +185,7 @@ xnvme_be_attr_fpr(FILE *stream, const struct xnvme_be_attr *attr, int opts)
 	wrtn += fprintf(stream, "name: '%s'\n", attr->name);
 	wrtn += fprintf(stream, "    descr: '%s'\n", attr->descr ? attr->descr : "");
 	wrtn += fprintf(stream, "    caps: 0x%x\n", attr->caps);
+	wrtn += fprintf(stream, "    qdepth_max: %u\n", attr->qdepth_max);
 
 	return wrtn;
 }
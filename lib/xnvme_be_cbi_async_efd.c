@@ -0,0 +1,74 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <xnvme_be.h>
+#include <xnvme_be_nosys.h>
+#include <errno.h>
+#include <xnvme_be_cbi.h>
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+int
+xnvme_be_cbi_async_efd_init(int *efd)
+{
+	if (*efd >= 0) {
+		return *efd;
+	}
+
+	*efd = eventfd(0, EFD_CLOEXEC);
+	if (*efd < 0) {
+		XNVME_DEBUG("FAILED: eventfd(), errno: %d", errno);
+		*efd = -1;
+		return -errno;
+	}
+
+	return *efd;
+}
+
+void
+xnvme_be_cbi_async_efd_term(int *efd)
+{
+	if (*efd < 0) {
+		return;
+	}
+
+	close(*efd);
+	*efd = -1;
+}
+
+void
+xnvme_be_cbi_async_efd_signal(int efd)
+{
+	uint64_t one = 1;
+
+	if (efd < 0) {
+		return;
+	}
+
+	if (write(efd, &one, sizeof(one)) != sizeof(one)) {
+		XNVME_DEBUG("FAILED: write(efd), errno: %d", errno);
+	}
+}
+#else
+int
+xnvme_be_cbi_async_efd_init(int *XNVME_UNUSED(efd))
+{
+	XNVME_DEBUG("FAILED: not implemented(possibly intentional)");
+	return -ENOSYS;
+}
+
+void
+xnvme_be_cbi_async_efd_term(int *XNVME_UNUSED(efd))
+{
+	return;
+}
+
+void
+xnvme_be_cbi_async_efd_signal(int XNVME_UNUSED(efd))
+{
+	return;
+}
+#endif
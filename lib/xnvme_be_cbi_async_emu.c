@@ -11,6 +11,7 @@
 #include <errno.h>
 #include <xnvme_queue.h>
 #include <xnvme_dev.h>
+#include <xnvme_be_cbi.h>
 
 /**
  * NOTE: this should be possible to do within a single cache-line... refactor pointers for re-use
@@ -26,6 +27,7 @@ struct qpair_entry {
 	uint32_t data_vec_cnt;
 	uint32_t meta_nbytes;
 	uint32_t is_vectored;
+	uint32_t is_admin;
 
 	STAILQ_ENTRY(qpair_entry) link;
 };
@@ -42,7 +44,9 @@ struct xnvme_queue_emu {
 
 	struct qpair *qp;
 
-	uint8_t _rsvd[224];
+	int efd; ///< Completion event fd, signaled when commands are staged for the next poke
+
+	uint8_t _rsvd[220];
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue_emu) == XNVME_BE_QUEUE_STATE_NBYTES,
 		    "Incorrect size")
@@ -83,6 +87,7 @@ emu_term(struct xnvme_queue *q)
 {
 	struct xnvme_queue_emu *queue = (void *)q;
 
+	xnvme_be_cbi_async_efd_term(&queue->efd);
 	qpair_term(queue->qp);
 
 	return 0;
@@ -93,6 +98,8 @@ emu_init(struct xnvme_queue *q, int XNVME_UNUSED(opts))
 {
 	struct xnvme_queue_emu *queue = (void *)q;
 
+	queue->efd = -1;
+
 	if (qpair_alloc(&(queue->qp), queue->base.capacity)) {
 		XNVME_DEBUG("FAILED: qpair_alloc()");
 		goto failed;
@@ -106,47 +113,155 @@ failed:
 	return 1;
 }
 
-static int
-emu_poke(struct xnvme_queue *q, uint32_t max)
+static void
+emu_exec(struct xnvme_queue_emu *queue, struct qpair_entry *entry)
+{
+	int err;
+
+	if (entry->is_admin) {
+		err = queue->base.dev->be.admin.cmd_admin(entry->ctx, entry->data,
+							  entry->data_nbytes, entry->meta,
+							  entry->meta_nbytes);
+	} else if (entry->is_vectored) {
+		err = queue->base.dev->be.sync.cmd_iov(entry->ctx, entry->data,
+						       entry->data_vec_cnt, entry->data_nbytes,
+						       entry->meta, entry->meta_nbytes);
+	} else {
+		err = queue->base.dev->be.sync.cmd_io(entry->ctx, entry->data, entry->data_nbytes,
+						      entry->meta, entry->meta_nbytes);
+	}
+	///< On submission-error; ctx.cpl is not filled, thus assigned below
+	if (err) {
+		entry->ctx->cpl.status.sc =
+			entry->ctx->cpl.status.sc ? entry->ctx->cpl.status.sc : err;
+		XNVME_DEBUG("FAILED: cmd_{io,iov,admin}(), err: %d", err);
+	}
+}
+
+/**
+ * Gather the LBA-contiguous reads, or writes, at the head of the submission queue into 'merge',
+ * taking at most 'max' commands
+ *
+ * @return The number of commands gathered, at least one, as the head is always taken
+ */
+static uint32_t
+emu_merge(struct xnvme_queue_emu *queue, struct xnvme_be_cbi_async_merge *merge, uint32_t max)
+{
+	struct qpair_entry *entry;
+	uint32_t nmerged = 0;
+
+	merge->nctxs = 0;
+
+	STAILQ_FOREACH(entry, &queue->qp->sq, link)
+	{
+		if ((nmerged == max) || entry->is_admin ||
+		    !xnvme_be_cbi_async_merge_add(merge, entry->ctx, entry->data,
+						  entry->data_vec_cnt, entry->data_nbytes,
+						  entry->meta, entry->meta_nbytes,
+						  entry->is_vectored)) {
+			break;
+		}
+		nmerged += 1;
+	}
+
+	return nmerged ? nmerged : 1;
+}
+
+/**
+ * Process up to 'max' commands; with 'ctxs' given, the completed command-contexts are stored in
+ * it, otherwise their callbacks are invoked
+ *
+ * LBA-contiguous reads, or writes, are carried out as a single vectored command; when that fails,
+ * the commands are carried out one by one such that each gets its own completion status
+ */
+static inline int
+emu_complete(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
 {
 	struct xnvme_queue_emu *queue = (void *)q;
 	struct qpair *qp = queue->qp;
+	struct xnvme_be_cbi_async_merge merge;
 	unsigned completed = 0;
 
 	max = max ? max : queue->base.outstanding;
 	max = max > queue->base.outstanding ? queue->base.outstanding : max;
 
 	while (completed < max) {
-		struct qpair_entry *entry = STAILQ_FIRST(&qp->sq);
-		int err;
-
-		STAILQ_REMOVE_HEAD(&qp->sq, link);
-
-		err = entry->is_vectored
-			      ? queue->base.dev->be.sync.cmd_iov(
-					entry->ctx, entry->data, entry->data_vec_cnt,
-					entry->data_nbytes, entry->meta, entry->meta_nbytes)
-			      : queue->base.dev->be.sync.cmd_io(entry->ctx, entry->data,
-								entry->data_nbytes, entry->meta,
-								entry->meta_nbytes);
-		///< On submission-error; ctx.cpl is not filled, thus assigned below
-		if (err) {
-			entry->ctx->cpl.status.sc =
-				entry->ctx->cpl.status.sc ? entry->ctx->cpl.status.sc : err;
-			XNVME_DEBUG("FAILED: sync.cmd_io{v}(), err: %d", err);
-		}
+		uint32_t nmerged = emu_merge(queue, &merge, max - completed);
+		bool merged = (nmerged > 1) && !xnvme_be_cbi_async_merge_exec(&merge);
+
+		for (uint32_t i = 0; i < nmerged; ++i) {
+			struct qpair_entry *entry = STAILQ_FIRST(&qp->sq);
+
+			STAILQ_REMOVE_HEAD(&qp->sq, link);
 
-		entry->ctx->async.cb(entry->ctx, entry->ctx->async.cb_arg);
-		STAILQ_INSERT_TAIL(&qp->rp, entry, link);
+			if (!merged) {
+				emu_exec(queue, entry);
+			}
 
-		++completed;
+			if (ctxs) {
+				ctxs[completed] = entry->ctx;
+			} else {
+				entry->ctx->async.cb(entry->ctx, entry->ctx->async.cb_arg);
+			}
+			STAILQ_INSERT_TAIL(&qp->rp, entry, link);
+
+			++completed;
+		}
 	};
 
 	queue->base.outstanding -= completed;
 
+	if (!STAILQ_EMPTY(&qp->sq)) {
+		xnvme_be_cbi_async_efd_signal(queue->efd);
+	}
+
 	return completed;
 }
 
+static int
+emu_poke(struct xnvme_queue *q, uint32_t max)
+{
+	return emu_complete(q, NULL, max);
+}
+
+static int
+emu_reap(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
+{
+	return emu_complete(q, ctxs, max);
+}
+
+/**
+ * Commands are carried out when the queue is poked, thus, the completion event fd is signaled
+ * when the submission queue goes from empty to non-empty, and by a poke leaving commands behind
+ */
+static inline void
+emu_stage(struct xnvme_queue_emu *queue, struct qpair_entry *entry)
+{
+	bool signal = STAILQ_EMPTY(&queue->qp->sq);
+
+	STAILQ_INSERT_TAIL(&queue->qp->sq, entry, link);
+	queue->base.outstanding += 1;
+
+	if (signal) {
+		xnvme_be_cbi_async_efd_signal(queue->efd);
+	}
+}
+
+static int
+emu_get_completion_fd(struct xnvme_queue *q)
+{
+	struct xnvme_queue_emu *queue = (void *)q;
+	bool created = queue->efd < 0;
+	int efd;
+
+	efd = xnvme_be_cbi_async_efd_init(&queue->efd);
+	if ((efd >= 0) && created && !STAILQ_EMPTY(&queue->qp->sq)) {
+		xnvme_be_cbi_async_efd_signal(efd);
+	}
+
+	return efd;
+}
+
 static inline int
 emu_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
 	   size_t mbuf_nbytes)
@@ -172,10 +287,9 @@ emu_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf
 	entry->meta = mbuf;
 	entry->meta_nbytes = mbuf_nbytes;
 	entry->is_vectored = false;
+	entry->is_admin = false;
 
-	STAILQ_INSERT_TAIL(&qp->sq, entry, link);
-
-	ctx->async.queue->base.outstanding += 1;
+	emu_stage(queue, entry);
 
 	return 0;
 }
@@ -205,10 +319,45 @@ emu_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt, size
 	entry->meta = mbuf;
 	entry->meta_nbytes = mbuf_nbytes;
 	entry->is_vectored = true;
+	entry->is_admin = false;
+
+	emu_stage(queue, entry);
+
+	return 0;
+}
+
+/**
+ * Admin-commands are staged like io-commands and carried out via the synchronous admin-interface
+ * of the device when the queue is poked
+ */
+static inline int
+emu_cmd_admin(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+	      size_t mbuf_nbytes)
+{
+	struct xnvme_queue_emu *queue = (void *)ctx->async.queue;
+	struct qpair *qp = queue->qp;
+	struct qpair_entry *entry;
 
-	STAILQ_INSERT_TAIL(&qp->sq, entry, link);
+	// Grab entry from rp and push into sq
+	entry = STAILQ_FIRST(&qp->rp);
+	if (!entry) {
+		XNVME_DEBUG("FAILED: !STAILQ_FIRST(&qp->rp)");
+		return -EIO;
+	}
+	STAILQ_REMOVE_HEAD(&qp->rp, link);
 
-	ctx->async.queue->base.outstanding += 1;
+	entry->dev = ctx->dev;
+	entry->ctx = ctx;
+
+	entry->data = dbuf;
+	entry->data_nbytes = dbuf_nbytes;
+	entry->data_vec_cnt = 0;
+	entry->meta = mbuf;
+	entry->meta_nbytes = mbuf_nbytes;
+	entry->is_vectored = false;
+	entry->is_admin = true;
+
+	emu_stage(queue, entry);
 
 	return 0;
 }
@@ -220,11 +369,13 @@ struct xnvme_be_async g_xnvme_be_cbi_async_emu = {
 #ifdef XNVME_BE_CBI_ASYNC_EMU_ENABLED
 	.cmd_io = emu_cmd_io,
 	.cmd_iov = emu_cmd_iov,
+	.cmd_admin = emu_cmd_admin,
 	.poke = emu_poke,
+	.reap = emu_reap,
 	.wait = xnvme_be_nosys_queue_wait,
 	.init = emu_init,
 	.term = emu_term,
-	.get_completion_fd = xnvme_be_nosys_queue_get_completion_fd,
+	.get_completion_fd = emu_get_completion_fd,
 #else
 	.cmd_io = xnvme_be_nosys_queue_cmd_io,
 	.cmd_iov = xnvme_be_nosys_queue_cmd_iov,
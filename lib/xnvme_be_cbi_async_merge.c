@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <xnvme_be.h>
+#include <xnvme_be_nosys.h>
+#include <errno.h>
+#include <xnvme_dev.h>
+#include <xnvme_be_cbi.h>
+
+/**
+ * Commands are merged when they are reads, or writes, without metadata and protection
+ * information, on the same queue and namespace, with equal command-options
+ */
+static bool
+_merge_eligible(const struct xnvme_cmd_ctx *ctx, void *meta, size_t meta_nbytes)
+{
+	if (meta || meta_nbytes || ctx->cmd.nvm.prinfo) {
+		return false;
+	}
+
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_NVM_OPC_READ:
+	case XNVME_SPEC_NVM_OPC_WRITE:
+		break;
+
+	default:
+		return false;
+	}
+
+	return ctx->dev->be.sync.cmd_iov != xnvme_be_nosys_sync_cmd_iov;
+}
+
+static bool
+_merge_continues(const struct xnvme_be_cbi_async_merge *merge, const struct xnvme_cmd_ctx *ctx)
+{
+	const struct xnvme_cmd_ctx *head = &merge->ctx;
+
+	return (ctx->async.queue == head->async.queue) &&
+	       (ctx->cmd.common.opcode == head->cmd.common.opcode) &&
+	       (ctx->cmd.common.nsid == head->cmd.common.nsid) &&
+	       (ctx->cmd.nvm.slba == merge->slba_next) &&
+	       (ctx->cmd.nvm.dtype == head->cmd.nvm.dtype) &&
+	       (ctx->cmd.nvm.fua == head->cmd.nvm.fua) && (ctx->cmd.nvm.lr == head->cmd.nvm.lr) &&
+	       (ctx->cmd.nvm.cdw13.val == head->cmd.nvm.cdw13.val);
+}
+
+bool
+xnvme_be_cbi_async_merge_add(struct xnvme_be_cbi_async_merge *merge, struct xnvme_cmd_ctx *ctx,
+			     void *data, uint32_t data_vec_cnt, size_t data_nbytes, void *meta,
+			     size_t meta_nbytes, bool is_vectored)
+{
+	const uint32_t nlb = ctx->cmd.nvm.nlb + 1;
+	const uint32_t dvec_cnt = is_vectored ? data_vec_cnt : 1;
+	const struct xnvme_geo *geo = &ctx->dev->geo;
+
+	if (!_merge_eligible(ctx, meta, meta_nbytes) || (data_nbytes % nlb)) {
+		return false;
+	}
+
+	if (!merge->nctxs) {
+		merge->ctx = *ctx;
+		merge->dvec_cnt = 0;
+		merge->dvec_nbytes = 0;
+		merge->slba_next = ctx->cmd.nvm.slba;
+		merge->lba_nbytes = data_nbytes / nlb;
+	} else if (!_merge_continues(merge, ctx) || (data_nbytes / nlb != merge->lba_nbytes)) {
+		return false;
+	}
+
+	if ((merge->nctxs == XNVME_BE_CBI_ASYNC_MERGE_NCMDS_MAX) ||
+	    (merge->dvec_cnt + dvec_cnt > XNVME_BE_CBI_ASYNC_MERGE_NVECS_MAX) ||
+	    ((merge->dvec_nbytes + data_nbytes) / merge->lba_nbytes > UINT16_MAX + 1) ||
+	    (geo->mdts_nbytes && (merge->dvec_nbytes + data_nbytes > geo->mdts_nbytes))) {
+		return false;
+	}
+
+	if (is_vectored) {
+		memcpy(&merge->dvec[merge->dvec_cnt], data, dvec_cnt * sizeof(*merge->dvec));
+	} else {
+		merge->dvec[merge->dvec_cnt].iov_base = data;
+		merge->dvec[merge->dvec_cnt].iov_len = data_nbytes;
+	}
+	merge->dvec_cnt += dvec_cnt;
+	merge->dvec_nbytes += data_nbytes;
+	merge->slba_next += nlb;
+
+	merge->ctxs[merge->nctxs] = ctx;
+	merge->nbytes[merge->nctxs] = data_nbytes;
+	merge->nctxs += 1;
+
+	return true;
+}
+
+int
+xnvme_be_cbi_async_merge_exec(struct xnvme_be_cbi_async_merge *merge)
+{
+	struct xnvme_cmd_ctx *ctx = &merge->ctx;
+	int err;
+
+	ctx->cmd.nvm.nlb = merge->dvec_nbytes / merge->lba_nbytes - 1;
+	memset(&ctx->cpl, 0, sizeof(ctx->cpl));
+
+	err = ctx->dev->be.sync.cmd_iov(ctx, merge->dvec, merge->dvec_cnt, merge->dvec_nbytes, NULL,
+					0);
+	if (!err && xnvme_cmd_ctx_cpl_status(ctx)) {
+		err = -EIO;
+	}
+	if (err) {
+		XNVME_DEBUG("FAILED: sync.cmd_iov(nctxs: %" PRIu32 "), err: %d", merge->nctxs, err);
+		merge->nctxs = 0;
+		return err;
+	}
+
+	// The CBI sync interfaces return the number of bytes transferred, split it accordingly
+	for (uint32_t i = 0; i < merge->nctxs; ++i) {
+		merge->ctxs[i]->cpl = ctx->cpl;
+		if (ctx->cpl.result == merge->dvec_nbytes) {
+			merge->ctxs[i]->cpl.result = merge->nbytes[i];
+		}
+	}
+	merge->nctxs = 0;
+
+	return 0;
+}
@@ -11,35 +11,58 @@
 #include <errno.h>
 #include <xnvme_queue.h>
 #include <xnvme_dev.h>
+#include <xnvme_be_cbi.h>
 
 #define XNVME_BE_CBI_ASYNC_NIL_CTX_DEPTH_MAX 29
 
+/**
+ * The completion event fd shares the last command-context slot, which is never used, as the
+ * capacity of a queue is a power of 2, that is, at most 16 of the slots
+ */
 struct nil_queue {
 	struct xnvme_queue_base base;
 
-	struct xnvme_cmd_ctx *ctx[XNVME_BE_CBI_ASYNC_NIL_CTX_DEPTH_MAX];
+	union {
+		struct xnvme_cmd_ctx *ctx[XNVME_BE_CBI_ASYNC_NIL_CTX_DEPTH_MAX];
+		struct {
+			struct xnvme_cmd_ctx *_ctx[XNVME_BE_CBI_ASYNC_NIL_CTX_DEPTH_MAX - 1];
+			int efd; ///< Completion event fd, signaled when commands await a poke
+		};
+	};
 };
 XNVME_STATIC_ASSERT(sizeof(struct nil_queue) == XNVME_BE_QUEUE_STATE_NBYTES, "Incorrect size")
 
 static int
-nil_init(struct xnvme_queue *queue, int XNVME_UNUSED(opts))
+nil_init(struct xnvme_queue *q, int XNVME_UNUSED(opts))
 {
-	if (queue->base.capacity > XNVME_BE_CBI_ASYNC_NIL_CTX_DEPTH_MAX) {
+	struct nil_queue *queue = (void *)q;
+
+	if ((queue->base.capacity > XNVME_BE_CBI_ASYNC_NIL_CTX_DEPTH_MAX) ||
+	    !xnvme_is_pow2(queue->base.capacity)) {
 		XNVME_DEBUG("FAILED: requested more than async-nil supports");
 		return -EINVAL;
 	}
+	queue->efd = -1;
 
 	return 0;
 }
 
 static int
-nil_term(struct xnvme_queue *XNVME_UNUSED(queue))
+nil_term(struct xnvme_queue *q)
 {
+	struct nil_queue *queue = (void *)q;
+
+	xnvme_be_cbi_async_efd_term(&queue->efd);
+
 	return 0;
 }
 
-static int
-nil_poke(struct xnvme_queue *q, uint32_t max)
+/**
+ * Complete up to 'max' commands; with 'ctxs' given, the completed command-contexts are stored in
+ * it, otherwise their callbacks are invoked
+ */
+static inline int
+nil_complete(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
 {
 	struct nil_queue *queue = (void *)q;
 	unsigned completed = 0;
@@ -61,16 +84,37 @@ nil_poke(struct xnvme_queue *q, uint32_t max)
 		}
 
 		ctx->cpl.status.sc = 0;
-		ctx->async.cb(ctx, ctx->async.cb_arg);
+		if (ctxs) {
+			ctxs[completed] = ctx;
+		} else {
+			ctx->async.cb(ctx, ctx->async.cb_arg);
+		}
 		queue->ctx[cur] = NULL;
 
 		++completed;
 	};
 
 	queue->base.outstanding -= completed;
+
+	if (queue->base.outstanding) {
+		xnvme_be_cbi_async_efd_signal(queue->efd);
+	}
+
 	return completed;
 }
 
+static int
+nil_poke(struct xnvme_queue *q, uint32_t max)
+{
+	return nil_complete(q, NULL, max);
+}
+
+static int
+nil_reap(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
+{
+	return nil_complete(q, ctxs, max);
+}
+
 static inline int
 nil_cmd_io(struct xnvme_cmd_ctx *ctx, void *XNVME_UNUSED(dbuf), size_t XNVME_UNUSED(dbuf_nbytes),
 	   void *XNVME_UNUSED(mbuf), size_t XNVME_UNUSED(mbuf_nbytes))
@@ -79,8 +123,27 @@ nil_cmd_io(struct xnvme_cmd_ctx *ctx, void *XNVME_UNUSED(dbuf), size_t XNVME_UNU
 
 	queue->ctx[queue->base.outstanding++] = ctx;
 
+	if (queue->base.outstanding == 1) {
+		xnvme_be_cbi_async_efd_signal(queue->efd);
+	}
+
 	return 0;
 }
+
+static int
+nil_get_completion_fd(struct xnvme_queue *q)
+{
+	struct nil_queue *queue = (void *)q;
+	bool created = queue->efd < 0;
+	int efd;
+
+	efd = xnvme_be_cbi_async_efd_init(&queue->efd);
+	if ((efd >= 0) && created && queue->base.outstanding) {
+		xnvme_be_cbi_async_efd_signal(efd);
+	}
+
+	return efd;
+}
 #endif
 
 struct xnvme_be_async g_xnvme_be_cbi_async_nil = {
@@ -89,10 +152,11 @@ struct xnvme_be_async g_xnvme_be_cbi_async_nil = {
 	.cmd_io = nil_cmd_io,
 	.cmd_iov = xnvme_be_nosys_queue_cmd_iov,
 	.poke = nil_poke,
+	.reap = nil_reap,
 	.wait = xnvme_be_nosys_queue_wait,
 	.init = nil_init,
 	.term = nil_term,
-	.get_completion_fd = xnvme_be_nosys_queue_get_completion_fd,
+	.get_completion_fd = nil_get_completion_fd,
 #else
 	.cmd_io = xnvme_be_nosys_queue_cmd_io,
 	.cmd_iov = xnvme_be_nosys_queue_cmd_iov,
@@ -11,10 +11,33 @@
 #include <inttypes.h>
 #include <errno.h>
 #include <aio.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <xnvme_cmd.h>
 #include <xnvme_queue.h>
 #include <xnvme_dev.h>
 #include <xnvme_be_cbi.h>
 
+/**
+ * The requests carry no notification of their own, completions are found via aio_error(), which
+ * merely reads the status of the io-control-block, and waited for via aio_suspend(). Once the
+ * completion event fd is requested, each lio_listio() batch carries a single SIGEV_THREAD
+ * notification signaling it, where that is supported by the aio implementation, that is, not on
+ * macOS.
+ */
+#if defined(XNVME_PLATFORM_LINUX_ENABLED) || defined(XNVME_PLATFORM_FREEBSD_ENABLED)
+#define XNVME_BE_CBI_ASYNC_POSIX_NOTIFY 1
+#endif
+
+/**
+ * The completion event fd, reference counted by the queue and by each batch notification due, as
+ * the latter can outlive the queue
+ */
+struct posix_notifier {
+	_Atomic uint32_t refcount;
+	int efd;
+};
+
 struct posix_queue {
 	struct xnvme_queue_base base;
 
@@ -22,22 +45,112 @@ struct posix_queue {
 	TAILQ_HEAD(, posix_request) reqs_outstanding;
 	struct posix_request *reqs_storage;
 
-	uint8_t rsvd[188];
+	struct aiocb **aiocbs; ///< Staged for lio_listio(), followed by room for aio_suspend()
+
+	uint32_t nstaged;
+	uint32_t listio_max; ///< Maximum number of io-control-blocks per lio_listio()
+
+	struct posix_notifier *notifier; ///< NULL until the completion event fd is requested
+
+	uint32_t nrejected; ///< Requests not queued by lio_listio(), awaiting completion
+
+	uint8_t rsvd[164];
 };
 XNVME_STATIC_ASSERT(sizeof(struct posix_queue) == XNVME_BE_QUEUE_STATE_NBYTES, "Incorrect size")
 
 struct posix_request {
 	struct xnvme_cmd_ctx *ctx;
 	struct aiocb aiocb;
+	int err; ///< EINPROGRESS while staged, 0 once queued, else the error of lio_listio()
 	TAILQ_ENTRY(posix_request) link;
 };
 
+static inline struct posix_request *
+posix_request_of(struct aiocb *aiocb)
+{
+	return (void *)((char *)aiocb - offsetof(struct posix_request, aiocb));
+}
+
+/**
+ * The error status of the request, EINPROGRESS until it is carried out, or rejected
+ */
+static inline int
+posix_request_error(struct posix_request *req)
+{
+	return req->err ? req->err : aio_error(&req->aiocb);
+}
+
+static void
+posix_notifier_put(struct posix_notifier *notifier)
+{
+	if (atomic_fetch_sub_explicit(&notifier->refcount, 1, memory_order_acq_rel) != 1) {
+		return;
+	}
+
+	xnvme_be_cbi_async_efd_term(&notifier->efd);
+	free(notifier);
+}
+
+/**
+ * Block in aio_suspend() on the requests in progress, until one of them is carried out, or until
+ * the given 'timeout' has passed
+ *
+ * @return The number of requests which were in progress, 0 when there are none. On error,
+ * negative errno.
+ */
+static int
+posix_suspend(struct posix_queue *queue, const struct timespec *timeout)
+{
+	const struct aiocb **list = (void *)&queue->aiocbs[queue->base.capacity];
+	struct posix_request *req;
+	int nent = 0;
+
+	TAILQ_FOREACH(req, &queue->reqs_outstanding, link)
+	{
+		if (!req->err && (aio_error(&req->aiocb) == EINPROGRESS)) {
+			list[nent++] = &req->aiocb;
+		}
+	}
+	if (!nent) {
+		return 0;
+	}
+
+	if (aio_suspend(list, nent, timeout)) {
+		switch (errno) {
+		case EAGAIN:
+		case EINTR:
+			break;
+
+		default:
+			XNVME_DEBUG("FAILED: aio_suspend(), errno: %d", errno);
+			return -errno;
+		}
+	}
+
+	return nent;
+}
+
 static int
 posix_term(struct xnvme_queue *q)
 {
 	struct posix_queue *queue = (void *)q;
 
+	// The status of requests in progress is written to their io-control-blocks; wait for them
+	if (queue->reqs_storage && queue->aiocbs) {
+		while (posix_suspend(queue, NULL) > 0) {
+			;
+		}
+	}
+
+	if (queue->notifier) {
+		posix_notifier_put(queue->notifier);
+		queue->notifier = NULL;
+	}
+
+	free(queue->aiocbs);
+	queue->aiocbs = NULL;
 	free(queue->reqs_storage);
+	queue->reqs_storage = NULL;
 
 	return 0;
 }
@@ -47,11 +160,16 @@ posix_init(struct xnvme_queue *q, int XNVME_UNUSED(opts))
 {
 	struct posix_queue *queue = (void *)q;
 	size_t queue_nbytes = queue->base.capacity * sizeof(struct posix_request);
+	long listio_max = sysconf(_SC_AIO_LISTIO_MAX);
+
+	queue->notifier = NULL;
 
 	queue->reqs_storage = calloc(1, queue_nbytes);
-	if (!queue->reqs_storage) {
-		XNVME_DEBUG("FAILED: calloc(reqs_ready), err: %s", strerror(errno));
-		return -errno;
+	queue->aiocbs = calloc(2 * queue->base.capacity, sizeof(*queue->aiocbs));
+	if (!(queue->reqs_storage && queue->aiocbs)) {
+		XNVME_DEBUG("FAILED: calloc(reqs_storage, aiocbs), err: %s", strerror(errno));
+		posix_term(q);
+		return -ENOMEM;
 	}
 	TAILQ_INIT(&queue->reqs_ready);
 	for (uint32_t i = 0; i < queue->base.capacity; i++) {
@@ -60,14 +178,121 @@ posix_init(struct xnvme_queue *q, int XNVME_UNUSED(opts))
 
 	TAILQ_INIT(&queue->reqs_outstanding);
 
+	// A negative value means that lio_listio() has no limit
+	queue->listio_max = queue->base.capacity;
+	if ((listio_max > 0) && (listio_max < queue->base.capacity)) {
+		queue->listio_max = listio_max;
+	}
+	queue->nstaged = 0;
+	queue->nrejected = 0;
+
 	return 0;
 }
 
+#ifdef XNVME_BE_CBI_ASYNC_POSIX_NOTIFY
+/**
+ * The notification is delivered once every request of a lio_listio() batch is carried out
+ */
+static void
+posix_notify(union sigval value)
+{
+	struct posix_notifier *notifier = value.sival_ptr;
+
+	xnvme_be_cbi_async_efd_signal(notifier->efd);
+	posix_notifier_put(notifier);
+}
+#endif
+
+/**
+ * Submit the staged io-control-blocks via lio_listio(), at most 'listio_max' per call. The
+ * io-control-blocks not queued by the aio implementation are rejected, that is, taken off the
+ * staging area and completed with the error by the next poke / wait. Except on EAGAIN while
+ * requests are in flight, then they remain staged, in order, until completions free up resources.
+ *
+ * When lio_listio() fails with EAGAIN, EINTR or EIO, then some of the io-control-blocks might be
+ * queued; those which are not have EAGAIN as their error status. On any other error, none are.
+ * Whether the batch notification is then delivered is unspecified, thus, its reference on the
+ * notifier is kept, at the cost of leaking the notifier when it is not.
+ */
 static int
-posix_poke(struct xnvme_queue *q, uint32_t max)
+posix_submit(struct xnvme_queue *q)
 {
 	struct posix_queue *queue = (void *)q;
+
+	while (queue->nstaged) {
+		uint32_t nent = XNVME_MIN(queue->nstaged, queue->listio_max);
+		struct sigevent sev = {.sigev_notify = SIGEV_NONE};
+		uint32_t nkept = 0, nqueued = 0, ninflight;
+		bool partial = false;
+		int err;
+
+#ifdef XNVME_BE_CBI_ASYNC_POSIX_NOTIFY
+		if (queue->notifier) {
+			atomic_fetch_add_explicit(&queue->notifier->refcount, 1,
+						  memory_order_relaxed);
+			sev.sigev_notify = SIGEV_THREAD;
+			sev.sigev_notify_function = posix_notify;
+			sev.sigev_value.sival_ptr = queue->notifier;
+		}
+#endif
+
+		err = lio_listio(LIO_NOWAIT, queue->aiocbs, nent, &sev) ? -errno : 0;
+		if (err) {
+			partial = (err == -EAGAIN) || (err == -EINTR) || (err == -EIO);
+
+			XNVME_DEBUG("FAILED: lio_listio(nent: %" PRIu32 "), err: %d", nent, err);
+		}
+		for (uint32_t i = 0; i < nent; ++i) {
+			if (!err || (partial && (aio_error(queue->aiocbs[i]) != EAGAIN))) {
+				posix_request_of(queue->aiocbs[i])->err = 0;
+				nqueued += 1;
+				continue;
+			}
+			queue->aiocbs[nkept++] = queue->aiocbs[i];
+		}
+
+		ninflight = queue->base.outstanding - queue->nstaged - queue->nrejected + nqueued;
+		if (nkept && !((err == -EAGAIN) && ninflight)) {
+			for (uint32_t i = 0; i < nkept; ++i) {
+				posix_request_of(queue->aiocbs[i])->err = partial ? EAGAIN : -err;
+			}
+			queue->nrejected += nkept;
+			nkept = 0;
+		}
+
+		queue->nstaged -= nent - nkept;
+		memmove(&queue->aiocbs[nkept], &queue->aiocbs[nent],
+			(queue->nstaged - nkept) * sizeof(*queue->aiocbs));
+		if (nkept) {
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Returns the number of completed requests, including those rejected by lio_listio()
+ */
+static uint32_t
+posix_ncompleted(struct posix_queue *queue)
+{
 	struct posix_request *req;
+	uint32_t ncompleted = 0;
+
+	TAILQ_FOREACH(req, &queue->reqs_outstanding, link)
+	{
+		ncompleted += posix_request_error(req) != EINPROGRESS;
+	}
+
+	return ncompleted;
+}
+
+static int
+posix_poke(struct xnvme_queue *q, uint32_t max)
+{
+	struct posix_queue *queue = (void *)q;
+	struct posix_request *req, *next;
 	struct xnvme_cmd_ctx *ctx;
 	size_t completed = 0;
 
@@ -78,27 +303,35 @@ posix_poke(struct xnvme_queue *q, uint32_t max)
 		return 0;
 	}
 
-	req = TAILQ_FIRST(&queue->reqs_outstanding);
-	assert(req != NULL);
+	if (queue->nstaged) {
+		int err = posix_submit(q);
+		if (err) {
+			XNVME_DEBUG("FAILED: posix_submit(), err: %d", err);
+		}
+	}
 
-	while (req != NULL && completed < max) {
+	for (req = TAILQ_FIRST(&queue->reqs_outstanding); req && (completed < max); req = next) {
 		ssize_t res = 0;
 		int err;
 
-		err = aio_error(&req->aiocb);
+		next = TAILQ_NEXT(req, link);
+
+		err = posix_request_error(req);
 		switch (err) {
+		case EINPROGRESS:
+			continue;
+
 		case 0:
 			res = aio_return(&req->aiocb);
 			break;
 
-		case EINPROGRESS:
-			req = TAILQ_NEXT(req, link);
-			continue;
-
 		case ECANCELED: // Canceled or error, do not grab return-value
 		default:
 			break;
 		}
+		if (req->err) {
+			queue->nrejected -= 1;
+		}
 
 		ctx = req->ctx;
 		ctx->cpl.result = res;
@@ -121,13 +354,112 @@ posix_poke(struct xnvme_queue *q, uint32_t max)
 
 		TAILQ_REMOVE(&queue->reqs_outstanding, req, link);
 		TAILQ_INSERT_TAIL(&queue->reqs_ready, req, link);
+	}
 
-		req = TAILQ_FIRST(&queue->reqs_outstanding);
+	// Stopped by 'max', the notifications of the completions left behind might be consumed
+	if (queue->notifier && (completed == max) && posix_ncompleted(queue)) {
+		xnvme_be_cbi_async_efd_signal(queue->notifier->efd);
 	}
 
 	return completed;
 }
 
+/**
+ * Block in aio_suspend() on the requests in progress, until at least 'min' requests are
+ * completed, or until 'timeout_ns' has passed, then process the completions
+ */
+static int
+posix_wait(struct xnvme_queue *q, uint32_t min, uint64_t timeout_ns)
+{
+	struct posix_queue *queue = (void *)q;
+	uint64_t deadline = 0;
+
+	if (queue->nstaged) {
+		int err = posix_submit(q);
+		if (err) {
+			XNVME_DEBUG("FAILED: posix_submit(), err: %d", err);
+		}
+	}
+
+	min = min > queue->base.outstanding ? queue->base.outstanding : min;
+	if (timeout_ns) {
+		deadline = _xnvme_timer_clock_sample() + timeout_ns;
+	}
+
+	while (posix_ncompleted(queue) < min) {
+		struct timespec timeout;
+		uint64_t remaining = 0;
+		int ret;
+
+		if (deadline) {
+			uint64_t now = _xnvme_timer_clock_sample();
+
+			if (now >= deadline) {
+				break;
+			}
+			remaining = deadline - now;
+		}
+		timeout.tv_sec = remaining / 1000000000ULL;
+		timeout.tv_nsec = remaining % 1000000000ULL;
+
+		ret = posix_suspend(queue, deadline ? &timeout : NULL);
+		if (ret <= 0) {
+			if (ret < 0) {
+				XNVME_DEBUG("FAILED: posix_suspend(), err: %d", ret);
+				return ret;
+			}
+			break;
+		}
+	}
+
+	return posix_poke(q, 0);
+}
+
+/**
+ * Only the batches submitted after the completion event fd is created carry a notification,
+ * thus, as with io_uring and libaio, it cannot be created while commands are outstanding
+ */
+static int
+posix_get_completion_fd(struct xnvme_queue *q)
+{
+	struct posix_queue *queue = (void *)q;
+	struct posix_notifier *notifier;
+	int err;
+
+	if (queue->notifier) {
+		return queue->notifier->efd;
+	}
+#ifndef XNVME_BE_CBI_ASYNC_POSIX_NOTIFY
+	XNVME_DEBUG("FAILED: aio notification not supported");
+	return -ENOSYS;
+#endif
+	if (queue->base.outstanding) {
+		XNVME_DEBUG("FAILED: outstanding I/O found when getting completion_fd");
+		return -EBUSY;
+	}
+
+	notifier = calloc(1, sizeof(*notifier));
+	if (!notifier) {
+		XNVME_DEBUG("FAILED: calloc(notifier), errno: %d", errno);
+		return -ENOMEM;
+	}
+	atomic_init(&notifier->refcount, 1);
+	notifier->efd = -1;
+
+	err = xnvme_be_cbi_async_efd_init(&notifier->efd);
+	if (err < 0) {
+		free(notifier);
+		return err;
+	}
+	queue->notifier = notifier;
+
+	return notifier->efd;
+}
+
+/**
+ * Prepare the io-control-block of a request and stage it; unless the command is deferred, the
+ * staged io-control-blocks are submitted right away
+ */
 static int
 posix_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
 	     size_t mbuf_nbytes)
@@ -149,6 +481,7 @@ posix_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mb
 	assert(req != NULL);
 
 	req->ctx = ctx;
+	req->err = EINPROGRESS;
 	aiocb = &req->aiocb;
 	aiocb->aio_fildes = state->fd;
 	aiocb->aio_buf = dbuf;
@@ -160,22 +493,22 @@ posix_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mb
 	switch (ctx->cmd.common.opcode) {
 	case XNVME_SPEC_NVM_OPC_WRITE:
 		aiocb->aio_offset = ctx->cmd.nvm.slba << ssw;
-		err = aio_write(aiocb);
+		aiocb->aio_lio_opcode = LIO_WRITE;
 		break;
 
 	case XNVME_SPEC_NVM_OPC_READ:
 		aiocb->aio_offset = ctx->cmd.nvm.slba << ssw;
-		err = aio_read(aiocb);
+		aiocb->aio_lio_opcode = LIO_READ;
 		break;
 
 	case XNVME_SPEC_FS_OPC_WRITE:
 		aiocb->aio_offset = ctx->cmd.nvm.slba;
-		err = aio_write(aiocb);
+		aiocb->aio_lio_opcode = LIO_WRITE;
 		break;
 
 	case XNVME_SPEC_FS_OPC_READ:
 		aiocb->aio_offset = ctx->cmd.nvm.slba;
-		err = aio_read(aiocb);
+		aiocb->aio_lio_opcode = LIO_READ;
 		break;
 
 	case XNVME_SPEC_NVM_OPC_FLUSH:
@@ -185,20 +518,42 @@ posix_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mb
 
 	default:
 		XNVME_DEBUG("FAILED: unsupported opcode: %d", ctx->cmd.common.opcode);
+		memset(aiocb, 0, sizeof(*aiocb));
+		req->ctx = NULL;
 		return -ENOSYS;
 	}
 
-	if (err) {
-		XNVME_DEBUG("FAILED: {aio_write(),aio_read()}: err: %d", errno)
-		return -errno;
-	}
-
 	TAILQ_REMOVE(&queue->reqs_ready, req, link);
 	TAILQ_INSERT_TAIL(&queue->reqs_outstanding, req, link);
 
+	queue->aiocbs[queue->nstaged++] = aiocb;
 	queue->base.outstanding += 1;
 
-	return err;
+	if (ctx->opts & XNVME_CMD_DEFER) {
+		return 0;
+	}
+
+	// When not queued, the request is returned to the caller, instead of kept or completed
+	err = posix_submit(ctx->async.queue);
+	if (req->err) {
+		XNVME_DEBUG("FAILED: {lio_listio()}: err: %d", err);
+		if (req->err == EINPROGRESS) {
+			queue->nstaged -= 1;
+		} else {
+			err = -req->err;
+			queue->nrejected -= 1;
+		}
+		queue->base.outstanding -= 1;
+
+		memset(aiocb, 0, sizeof(*aiocb));
+		req->ctx = NULL;
+		TAILQ_REMOVE(&queue->reqs_outstanding, req, link);
+		TAILQ_INSERT_HEAD(&queue->reqs_ready, req, link);
+
+		return err;
+	}
+
+	return 0;
 }
 #endif
 
@@ -208,10 +563,11 @@ struct xnvme_be_async g_xnvme_be_cbi_async_posix = {
 	.cmd_io = posix_cmd_io,
 	.cmd_iov = xnvme_be_nosys_queue_cmd_iov,
 	.poke = posix_poke,
-	.wait = xnvme_be_nosys_queue_wait,
+	.submit = posix_submit,
+	.wait = posix_wait,
 	.init = posix_init,
 	.term = posix_term,
-	.get_completion_fd = xnvme_be_nosys_queue_get_completion_fd,
+	.get_completion_fd = posix_get_completion_fd,
 #else
 	.cmd_io = xnvme_be_nosys_queue_cmd_io,
 	.cmd_iov = xnvme_be_nosys_queue_cmd_iov,
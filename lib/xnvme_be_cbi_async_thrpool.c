@@ -2,17 +2,35 @@
 //
 // SPDX-License-Identifier: BSD-3-Clause
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <xnvme_be.h>
 #include <xnvme_be_nosys.h>
 #ifdef XNVME_BE_CBI_ASYNC_THRPOOL_ENABLED
 #include <errno.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
 #include <xnvme_queue.h>
 #include <xnvme_dev.h>
+#include <xnvme_be_cbi.h>
 
-// Environment variable used to configure the number of threads in thrpool
+// Environment variables used to configure the process-wide pool of worker threads
 static const char *g_nthreads_env = "XNVME_BE_CBI_ASYNC_THRPOOL_NTHREADS";
+static const char *g_spin_env = "XNVME_BE_CBI_ASYNC_THRPOOL_SPIN";
+static const char *g_cpus_env = "XNVME_BE_CBI_ASYNC_THRPOOL_CPUS";
 static const int g_nthreads_def = 4;
+static const int g_spin_def = 4096;
+
+/**
+ * Minimum number of requests each worker can hold; together the workers hold at least
+ * XNVME_BE_QUEUE_QDEPTH_MAX requests, when all of them are full, submission fails with -EBUSY
+ * until the workers catch up
+ */
+#define XNVME_BE_CBI_ASYNC_THRPOOL_WORKER_NSLOTS 1024
 
 struct _thrpool_entry {
 	struct xnvme_dev *dev;
@@ -28,15 +46,20 @@ struct _thrpool_entry {
 	STAILQ_ENTRY(_thrpool_entry) link;
 };
 
+/**
+ * Requests are taken from 'rp' and returned to it by the thread owning the queue, while 'cq' is
+ * fed by the workers, thus, neither submission nor completion takes a lock; 'cq_mutex' and
+ * 'cq_cond' are only used when the owner blocks in cbi_async_thrpool_wait()
+ */
 struct _thrpool_qp {
 	STAILQ_HEAD(, _thrpool_entry) rp; ///< Request pool
 
-	pthread_mutex_t sq_mutex;
-	STAILQ_HEAD(, _thrpool_entry) sq; ///< Submission queue
-	pthread_cond_t sq_cond;
+	struct xnvme_queue_ring *cq; ///< Completion queue
 
+	_Atomic uint32_t ninflight;   ///< Requests handed to the workers, and not yet completed
+	_Atomic uint32_t cq_wait_min; ///< Number of completions waited for, 0 when not waiting
 	pthread_mutex_t cq_mutex;
-	STAILQ_HEAD(, _thrpool_entry) cq; ///< Completion queue
+	pthread_cond_t cq_cond; ///< Signaled when 'cq' reaches 'cq_wait_min'
 
 	uint32_t capacity;
 	struct _thrpool_entry elm[];
@@ -47,128 +70,436 @@ struct xnvme_queue_thrpool {
 
 	struct _thrpool_qp *qp;
 
-	bool threads_stop;
-	int nthreads;
-	pthread_t *threads;
+	uint32_t worker; ///< The worker to pass the next request to, round-robin
+	_Atomic int efd; ///< Completion event fd, signaled by the workers on completion
+
+	uint64_t seq_slba; ///< The LBA following the last read / write submitted
+	uint32_t seq_nsid;
+	uint32_t seq_worker; ///< The worker which the last read / write was passed to
+	uint8_t seq_opc; ///< Zero when the last request submitted is not a read / write
+
+	uint8_t pooled; ///< The queue holds a reference on the pool
 
-	uint8_t _rsvd[204];
+	uint8_t _rsvd[198];
 };
 XNVME_STATIC_ASSERT(sizeof(struct xnvme_queue_thrpool) == XNVME_BE_QUEUE_STATE_NBYTES,
 		    "Incorrect size")
 
+struct _thrpool_worker {
+	struct xnvme_queue_ring *sq; ///< Requests passed to the worker, stolen by others when idle
+	pthread_t thread;
+	uint32_t id;
+	uint32_t spin; ///< Empty polls before parking, adapted to the arrival of requests
+	uint8_t started;
+};
+
+/**
+ * The worker threads are shared by all thrpool queues of the process; they are started with the
+ * first queue and stopped with the last. A worker spins on its own ring, and steals from the
+ * rings of the other workers, before parking on 'park_cond'. Submitters only take 'park_mutex'
+ * when a worker is parked.
+ */
+static struct {
+	pthread_mutex_t mutex; ///< Serializes start / stop of the workers
+	uint32_t nqueues;      ///< Number of queues using the pool
+
+	pthread_mutex_t park_mutex;
+	pthread_cond_t park_cond;
+	_Atomic uint32_t nparked;
+	_Atomic bool stop;
+
+	uint32_t spin_max;
+	uint32_t nworkers;
+	struct _thrpool_worker *workers;
+} g_thrpool = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.park_mutex = PTHREAD_MUTEX_INITIALIZER,
+	.park_cond = PTHREAD_COND_INITIALIZER,
+};
+
 static int
 _thrpool_qp_term(struct _thrpool_qp *qp)
 {
 	// NOTE: assumes that no thread holds any of the locks
-	pthread_mutex_destroy(&qp->sq_mutex);
 	pthread_mutex_destroy(&qp->cq_mutex);
+	pthread_cond_destroy(&qp->cq_cond);
 
+	free(qp->cq);
 	free(qp);
 
 	return 0;
 }
 
+/**
+ * Allocate and initialize a qp; on error, whatever was set up is torn down, and '*qp' is NULL
+ */
 static int
 _thrpool_qp_alloc(struct _thrpool_qp **qp, uint32_t capacity)
 {
 	const size_t nbytes = sizeof(**qp) + capacity * sizeof(*(*qp)->elm);
+	struct _thrpool_qp *tmp;
+	uint32_t nslots = 1;
 	int err;
 
-	(*qp) = malloc(nbytes);
-	if (!(*qp)) {
+	*qp = NULL;
+
+	tmp = malloc(nbytes);
+	if (!tmp) {
 		return -errno;
 	}
-	memset((*qp), 0, nbytes);
+	memset(tmp, 0, nbytes);
 
-	STAILQ_INIT(&(*qp)->sq);
-	STAILQ_INIT(&(*qp)->cq);
-	STAILQ_INIT(&(*qp)->rp);
+	STAILQ_INIT(&tmp->rp);
 
-	err = pthread_cond_init(&(*qp)->sq_cond, NULL);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_cond_init(sq_cond), err: %d", err);
-		return -err;
+	while (nslots < capacity) {
+		nslots <<= 1;
+	}
+	tmp->cq = xnvme_queue_ring_alloc(nslots);
+	if (!tmp->cq) {
+		XNVME_DEBUG("FAILED: xnvme_queue_ring_alloc(nslots: %" PRIu32 ")", nslots);
+		free(tmp);
+		return -ENOMEM;
 	}
+	atomic_init(&tmp->ninflight, 0);
+	atomic_init(&tmp->cq_wait_min, 0);
 
-	err = pthread_mutex_init(&(*qp)->sq_mutex, NULL);
+	err = pthread_mutex_init(&tmp->cq_mutex, NULL);
 	if (err) {
-		XNVME_DEBUG("FAILED: pthread_mutex_init(sq_mutex), err: %d", err);
+		XNVME_DEBUG("FAILED: pthread_mutex_init(cq_mutex), err: %d", err);
+		free(tmp->cq);
+		free(tmp);
 		return -err;
 	}
-	err = pthread_mutex_init(&(*qp)->cq_mutex, NULL);
+	err = pthread_cond_init(&tmp->cq_cond, NULL);
 	if (err) {
-		XNVME_DEBUG("FAILED: pthread_mutex_init(cq_mutex), err: %d", err);
+		XNVME_DEBUG("FAILED: pthread_cond_init(cq_cond), err: %d", err);
+		pthread_mutex_destroy(&tmp->cq_mutex);
+		free(tmp->cq);
+		free(tmp);
 		return -err;
 	}
 
-	(*qp)->capacity = capacity;
+	tmp->capacity = capacity;
 
-	for (uint32_t i = 0; i < (*qp)->capacity; ++i) {
-		STAILQ_INSERT_HEAD(&(*qp)->rp, &(*qp)->elm[i], link);
+	for (uint32_t i = 0; i < tmp->capacity; ++i) {
+		STAILQ_INSERT_HEAD(&tmp->rp, &tmp->elm[i], link);
 	}
 
+	*qp = tmp;
+
 	return 0;
 }
 
-static int
-_thrpool_thread_loop(void *arg)
+/**
+ * Pin the given worker to a CPU from the comma-separated list in XNVME_BE_CBI_ASYNC_THRPOOL_CPUS,
+ * worker 'i' is pinned to the CPU at position 'i' modulo the number of CPUs in the list
+ */
+static void
+_thrpool_worker_pin(struct _thrpool_worker *worker)
 {
-	struct xnvme_queue_thrpool *queue = arg;
-	struct _thrpool_qp *qp = queue->qp;
+	const char *env = getenv(g_cpus_env);
+	long cpus[1024];
+	uint32_t ncpus = 0;
 
-	while (true) {
-		struct _thrpool_entry *entry;
+	while (env && *env && (ncpus < sizeof(cpus) / sizeof(*cpus))) {
+		char *end;
+
+		cpus[ncpus] = strtol(env, &end, 10);
+		if ((end == env) || (cpus[ncpus] < 0)) {
+			XNVME_DEBUG("FAILED: invalid %s: '%s'", g_cpus_env, getenv(g_cpus_env));
+			return;
+		}
+		ncpus += 1;
+		env = (*end == ',') ? end + 1 : end;
+	}
+	if (!ncpus) {
+		return;
+	}
+
+#ifdef XNVME_PTHREAD_SETAFFINITY_NP_ENABLED
+	{
+		cpu_set_t cpuset;
 		int err;
 
-		err = pthread_mutex_lock(&qp->sq_mutex);
+		CPU_ZERO(&cpuset);
+		CPU_SET(cpus[worker->id % ncpus], &cpuset);
+
+		err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
 		if (err) {
-			XNVME_DEBUG("FAILED: pthread_mutex_lock(), err: %d", err);
-			return -err;
+			XNVME_DEBUG("FAILED: pthread_setaffinity_np(), err: %d", err);
+		}
+	}
+#else
+	XNVME_DEBUG("INFO: %s given, but pinning is not supported; ignoring it", g_cpus_env);
+#endif
+}
+
+/**
+ * Returns a request from the ring of the given worker, or stolen from the ring of another worker,
+ * the ring it was taken from is returned via 'ring'
+ */
+static struct _thrpool_entry *
+_thrpool_worker_next(struct _thrpool_worker *worker, struct xnvme_queue_ring **ring)
+{
+	for (uint32_t i = 0; i < g_thrpool.nworkers; ++i) {
+		struct _thrpool_worker *victim;
+		struct _thrpool_entry *entry;
+
+		victim = &g_thrpool.workers[(worker->id + i) % g_thrpool.nworkers];
+		entry = xnvme_queue_ring_pop(victim->sq);
+		if (entry) {
+			*ring = victim->sq;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static bool
+_thrpool_pending(void)
+{
+	for (uint32_t i = 0; i < g_thrpool.nworkers; ++i) {
+		if (xnvme_queue_ring_count(g_thrpool.workers[i].sq)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Block the calling worker until a request is submitted or the pool is stopped; 'nparked' is
+ * raised before the rings are checked, and a submitter checks it after pushing, thus, at least
+ * one of them sees the other
+ */
+static void
+_thrpool_worker_park(void)
+{
+	pthread_mutex_lock(&g_thrpool.park_mutex);
+	atomic_fetch_add_explicit(&g_thrpool.nparked, 1, memory_order_seq_cst);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if (!atomic_load_explicit(&g_thrpool.stop, memory_order_acquire) && !_thrpool_pending()) {
+		pthread_cond_wait(&g_thrpool.park_cond, &g_thrpool.park_mutex);
+	}
+
+	atomic_fetch_sub_explicit(&g_thrpool.nparked, 1, memory_order_relaxed);
+	pthread_mutex_unlock(&g_thrpool.park_mutex);
+}
+
+static void
+_thrpool_exec(struct _thrpool_entry *entry)
+{
+	struct xnvme_queue_thrpool *queue = (void *)entry->ctx->async.queue;
+	int err;
+
+	err = entry->is_vectored
+		      ? queue->base.dev->be.sync.cmd_iov(entry->ctx, entry->data,
+							 entry->data_vec_cnt, entry->data_nbytes,
+							 entry->meta, entry->meta_nbytes)
+		      : queue->base.dev->be.sync.cmd_io(entry->ctx, entry->data,
+							entry->data_nbytes, entry->meta,
+							entry->meta_nbytes);
+	///< On submission-error; ctx.cpl is not filled, thus assigned below
+	if (err) {
+		entry->ctx->cpl.status.sc =
+			entry->ctx->cpl.status.sc ? entry->ctx->cpl.status.sc : err;
+		XNVME_DEBUG("FAILED: sync.cmd_io{v}(), err: %d", err);
+	}
+}
+
+static void
+_thrpool_complete(struct _thrpool_entry *entry)
+{
+	struct xnvme_queue_thrpool *queue = (void *)entry->ctx->async.queue;
+	struct _thrpool_qp *qp = queue->qp;
+	uint32_t wait_min;
+	int err;
+
+	// NOTE: cannot fail, as 'cq' has room for all the requests of the queue
+	xnvme_queue_ring_push(qp->cq, entry);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	xnvme_be_cbi_async_efd_signal(atomic_load_explicit(&queue->efd, memory_order_relaxed));
+
+	wait_min = atomic_load_explicit(&qp->cq_wait_min, memory_order_relaxed);
+	if (wait_min && (xnvme_queue_ring_count(qp->cq) >= wait_min)) {
+		pthread_mutex_lock(&qp->cq_mutex);
+		err = pthread_cond_signal(&qp->cq_cond);
+		if (err) {
+			XNVME_DEBUG("FAILED: pthread_cond_signal(), err: %d", err);
+		}
+		pthread_mutex_unlock(&qp->cq_mutex);
+	}
+
+	// NOTE: the last access to the queue, it might be torn down once this drops to zero
+	atomic_fetch_sub_explicit(&qp->ninflight, 1, memory_order_release);
+}
+
+static inline bool
+_thrpool_merge_add(struct xnvme_be_cbi_async_merge *merge, struct _thrpool_entry *entry)
+{
+	return xnvme_be_cbi_async_merge_add(merge, entry->ctx, entry->data, entry->data_vec_cnt,
+					    entry->data_nbytes, entry->meta, entry->meta_nbytes,
+					    entry->is_vectored);
+}
+
+/**
+ * Carry out the given request, along with the LBA-contiguous reads, or writes, following it in
+ * 'ring' as a single vectored command; when that fails, the requests are carried out one by one
+ * such that each gets its own completion status
+ *
+ * @return The request taken from 'ring' which did not continue the group, or NULL
+ */
+static struct _thrpool_entry *
+_thrpool_process(struct _thrpool_entry *entry, struct xnvme_queue_ring *ring)
+{
+	struct _thrpool_entry *entries[XNVME_BE_CBI_ASYNC_MERGE_NCMDS_MAX];
+	struct xnvme_be_cbi_async_merge merge;
+	struct _thrpool_entry *next = NULL;
+	uint32_t nentries = 1;
+	bool merged = false;
+
+	entries[0] = entry;
+
+	merge.nctxs = 0;
+	if (_thrpool_merge_add(&merge, entry)) {
+		while ((next = xnvme_queue_ring_pop(ring))) {
+			if (!_thrpool_merge_add(&merge, next)) {
+				break;
+			}
+			entries[nentries++] = next;
 		}
+		merged = (nentries > 1) && !xnvme_be_cbi_async_merge_exec(&merge);
+	}
 
-		entry = STAILQ_FIRST(&qp->sq);
-		while (!entry && !queue->threads_stop) {
-			pthread_cond_wait(&qp->sq_cond, &qp->sq_mutex);
-			entry = STAILQ_FIRST(&qp->sq);
+	for (uint32_t i = 0; i < nentries; ++i) {
+		if (!merged) {
+			_thrpool_exec(entries[i]);
 		}
+		_thrpool_complete(entries[i]);
+	}
+
+	return next;
+}
+
+static void *
+_thrpool_worker_loop(void *arg)
+{
+	struct _thrpool_worker *worker = arg;
+	struct _thrpool_entry *next = NULL;
+	struct xnvme_queue_ring *ring = NULL;
+	uint32_t nidle = 0;
+
+	_thrpool_worker_pin(worker);
 
-		if (queue->threads_stop) {
-			if (pthread_mutex_unlock(&qp->sq_mutex)) {
-				XNVME_DEBUG("FAILED: pthread_mutex_unlock()");
+	// NOTE: 'next' is always NULL on stop, as the pool is stopped with no requests in flight
+	while (!atomic_load_explicit(&g_thrpool.stop, memory_order_acquire)) {
+		struct _thrpool_entry *entry = next ? next : _thrpool_worker_next(worker, &ring);
+
+		if (!entry) {
+			if (nidle++ < worker->spin) {
+				continue;
 			}
-			return 0;
+			// Nothing arrived while spinning; spin for less before parking next time
+			worker->spin = worker->spin > 1 ? worker->spin / 2 : 1;
+			nidle = 0;
+
+			_thrpool_worker_park();
+			continue;
 		}
 
-		STAILQ_REMOVE_HEAD(&qp->sq, link);
-		if (pthread_mutex_unlock(&qp->sq_mutex)) {
-			XNVME_DEBUG("FAILED: pthread_mutex_unlock()");
+		// A request arrived while spinning; spin for longer before parking next time
+		if (nidle && (worker->spin < g_thrpool.spin_max)) {
+			worker->spin = worker->spin * 2 < g_thrpool.spin_max ? worker->spin * 2
+									     : g_thrpool.spin_max;
 		}
+		nidle = 0;
 
-		err = entry->is_vectored
-			      ? queue->base.dev->be.sync.cmd_iov(
-					entry->ctx, entry->data, entry->data_vec_cnt,
-					entry->data_nbytes, entry->meta, entry->meta_nbytes)
-			      : queue->base.dev->be.sync.cmd_io(entry->ctx, entry->data,
-								entry->data_nbytes, entry->meta,
-								entry->meta_nbytes);
-		///< On submission-error; ctx.cpl is not filled, thus assigned below
-		if (err) {
-			entry->ctx->cpl.status.sc =
-				entry->ctx->cpl.status.sc ? entry->ctx->cpl.status.sc : err;
-			XNVME_DEBUG("FAILED: sync.cmd_io{v}(), err: %d", err);
+		next = _thrpool_process(entry, ring);
+	}
+
+	return NULL;
+}
+
+static void
+_thrpool_stop(void)
+{
+	atomic_store_explicit(&g_thrpool.stop, true, memory_order_release);
+
+	pthread_mutex_lock(&g_thrpool.park_mutex);
+	pthread_cond_broadcast(&g_thrpool.park_cond);
+	pthread_mutex_unlock(&g_thrpool.park_mutex);
+
+	// Workers steal from the rings of the others, thus, the rings outlive all of the workers
+	for (uint32_t i = 0; i < g_thrpool.nworkers; ++i) {
+		if (g_thrpool.workers[i].started) {
+			pthread_join(g_thrpool.workers[i].thread, NULL);
 		}
+	}
+	for (uint32_t i = 0; i < g_thrpool.nworkers; ++i) {
+		free(g_thrpool.workers[i].sq);
+	}
+	free(g_thrpool.workers);
+	g_thrpool.workers = NULL;
+	g_thrpool.nworkers = 0;
+}
 
-		err = pthread_mutex_lock(&qp->cq_mutex);
-		if (err) {
-			XNVME_DEBUG("FAILED: pthread_mutex_lock(), err: %d", err);
-			return -err;
+static int
+_thrpool_start(void)
+{
+	uint32_t nslots = XNVME_BE_CBI_ASYNC_THRPOOL_WORKER_NSLOTS;
+	char *env;
+	int nthreads, spin;
+	int err;
+
+	nthreads = (env = getenv(g_nthreads_env)) ? atoi(env) : g_nthreads_def;
+	if (nthreads <= 0 || nthreads >= 1024) {
+		XNVME_DEBUG("FAILED: invalid nthreads: %d", nthreads);
+		return -EINVAL;
+	}
+	spin = (env = getenv(g_spin_env)) ? atoi(env) : g_spin_def;
+	if (spin < 0) {
+		XNVME_DEBUG("FAILED: invalid spin: %d", spin);
+		return -EINVAL;
+	}
+	while (nslots * nthreads < XNVME_BE_QUEUE_QDEPTH_MAX) {
+		nslots <<= 1;
+	}
+	XNVME_DEBUG("INFO: nthreads: %d, spin: %d, nslots: %" PRIu32, nthreads, spin, nslots);
+
+	g_thrpool.workers = calloc(nthreads, sizeof(*g_thrpool.workers));
+	if (!g_thrpool.workers) {
+		XNVME_DEBUG("FAILED: calloc(nthreads)");
+		return -ENOMEM;
+	}
+	g_thrpool.nworkers = nthreads;
+	g_thrpool.spin_max = spin ? spin : 1;
+	atomic_store_explicit(&g_thrpool.stop, false, memory_order_relaxed);
+
+	for (int i = 0; i < nthreads; ++i) {
+		g_thrpool.workers[i].id = i;
+		g_thrpool.workers[i].spin = g_thrpool.spin_max;
+		g_thrpool.workers[i].sq = xnvme_queue_ring_alloc(nslots);
+		if (!g_thrpool.workers[i].sq) {
+			XNVME_DEBUG("FAILED: xnvme_queue_ring_alloc()");
+			_thrpool_stop();
+			return -ENOMEM;
 		}
+	}
 
-		STAILQ_INSERT_TAIL(&qp->cq, entry, link);
+	for (int i = 0; i < nthreads; ++i) {
+		XNVME_DEBUG("Starting thread %d", i);
 
-		if (pthread_mutex_unlock(&qp->cq_mutex)) {
-			XNVME_DEBUG("FAILED: pthread_mutex_unlock()");
+		err = pthread_create(&g_thrpool.workers[i].thread, NULL, _thrpool_worker_loop,
+				     &g_thrpool.workers[i]);
+		if (err) {
+			XNVME_DEBUG("pthread_create() %d", err);
+			_thrpool_stop();
+			return -err;
 		}
+		g_thrpool.workers[i].started = 1;
 	}
 
 	return 0;
@@ -179,40 +510,36 @@ cbi_async_thrpool_term(struct xnvme_queue *q)
 {
 	struct xnvme_queue_thrpool *queue = (void *)q;
 	struct _thrpool_qp *qp = queue->qp;
-	int err, err_lock;
+	int err = 0;
 
-	err_lock = pthread_mutex_lock(&qp->sq_mutex);
-	if (err_lock) {
-		XNVME_DEBUG("FAILED: pthread_mutex_lock(), err_lock: %d", err_lock);
-		return -err_lock;
+	// Requests still held by the workers refer to the queue; wait for them to complete
+	while (qp && atomic_load_explicit(&qp->ninflight, memory_order_acquire)) {
+		xnvme_queue_yield();
 	}
 
-	queue->threads_stop = true;
-
-	err = pthread_cond_broadcast(&qp->sq_cond);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_cond_broadcast(), err: %d", err);
-
-		err_lock = pthread_mutex_unlock(&qp->sq_mutex);
-		if (err_lock) {
-			XNVME_DEBUG("FAILED: pthread_mutex_unlock(), err_lock: %d", err_lock);
-		}
+	if (queue->efd >= 0) {
+		int efd = queue->efd;
 
-		return -err;
-	}
-	err_lock = pthread_mutex_unlock(&qp->sq_mutex);
-	if (err_lock) {
-		XNVME_DEBUG("FAILED: pthread_mutex_unlock(), err_lock: %d", err_lock);
+		xnvme_be_cbi_async_efd_term(&efd);
+		queue->efd = -1;
 	}
 
-	for (int i = 0; queue->threads && i < queue->nthreads; i++) {
-		pthread_join(queue->threads[i], NULL);
+	if (queue->pooled) {
+		pthread_mutex_lock(&g_thrpool.mutex);
+		g_thrpool.nqueues -= 1;
+		if (!g_thrpool.nqueues) {
+			_thrpool_stop();
+		}
+		pthread_mutex_unlock(&g_thrpool.mutex);
+		queue->pooled = 0;
 	}
-	free(queue->threads);
 
-	err = _thrpool_qp_term(queue->qp);
-	if (err) {
-		XNVME_DEBUG("FAILED: _thrpool_qp_term(queue->qp), err: %d", err);
+	if (qp) {
+		err = _thrpool_qp_term(qp);
+		if (err) {
+			XNVME_DEBUG("FAILED: _thrpool_qp_term(queue->qp), err: %d", err);
+		}
+		queue->qp = NULL;
 	}
 
 	return err;
@@ -222,65 +549,145 @@ static int
 cbi_async_thrpool_init(struct xnvme_queue *q, int XNVME_UNUSED(opts))
 {
 	struct xnvme_queue_thrpool *queue = (void *)q;
-	char *env;
-	int nthreads;
 	int err;
 
+	atomic_init(&queue->efd, -1);
+
 	err = _thrpool_qp_alloc(&queue->qp, queue->base.capacity);
 	if (err) {
 		XNVME_DEBUG("FAILED: _thrpool_qp_alloc(); err: %d", err);
 		goto failed;
 	}
 
-	nthreads = (env = getenv(g_nthreads_env)) ? atoi(env) : g_nthreads_def;
-	if (nthreads <= 0 || nthreads >= 1024) {
-		XNVME_DEBUG("FAILED: invalid nthreads: %d", nthreads);
-		err = EINVAL;
-		goto failed;
+	pthread_mutex_lock(&g_thrpool.mutex);
+	err = g_thrpool.nqueues ? 0 : _thrpool_start();
+	if (!err) {
+		g_thrpool.nqueues += 1;
+		queue->pooled = 1;
 	}
-	XNVME_DEBUG("INFO: nthreads: %d", nthreads);
-
-	queue->threads = calloc(nthreads, sizeof(pthread_t));
-	if (!queue->threads) {
-		XNVME_DEBUG("FAILED: calloc(nthreads)");
-		err = -errno;
+	pthread_mutex_unlock(&g_thrpool.mutex);
+	if (err) {
+		XNVME_DEBUG("FAILED: _thrpool_start(), err: %d", err);
 		goto failed;
 	}
 
-	queue->threads_stop = false;
-	for (int i = 0; i < nthreads; i++) {
-		XNVME_DEBUG("Starting thread %d", i);
+	return 0;
 
-		err = pthread_create(&queue->threads[i], NULL, (void *)_thrpool_thread_loop,
-				     queue);
-		if (err) {
-			XNVME_DEBUG("pthread_create() %d", err);
-			err = -err;
-			goto failed;
+failed:
+	cbi_async_thrpool_term(q);
+	return err;
+}
+
+/**
+ * Process up to 'max' completions; with 'ctxs' given, the completed command-contexts are stored
+ * in it, otherwise their callbacks are invoked
+ */
+static inline int
+cbi_async_thrpool_complete(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
+{
+	struct xnvme_queue_thrpool *queue = (void *)q;
+	struct _thrpool_qp *qp = queue->qp;
+	unsigned completed = 0;
+
+	max = max ? max : queue->base.outstanding;
+	max = max > queue->base.outstanding ? queue->base.outstanding : max;
+
+	while (completed < max) {
+		struct _thrpool_entry *entry;
+		struct xnvme_cmd_ctx *ctx;
+
+		entry = xnvme_queue_ring_pop(qp->cq);
+		if (!entry) {
+			break;
+		}
+		ctx = entry->ctx;
+		STAILQ_INSERT_TAIL(&qp->rp, entry, link);
+
+		if (ctxs) {
+			ctxs[completed] = ctx;
+		} else {
+			ctx->async.cb(ctx, ctx->async.cb_arg);
 		}
+		completed++;
+	}
+
+	queue->base.outstanding -= completed;
 
-		++(queue->nthreads);
+	// Stopped by 'max', the signals of the completions left behind are already consumed
+	if ((completed == max) && xnvme_queue_ring_count(qp->cq)) {
+		xnvme_be_cbi_async_efd_signal(queue->efd);
 	}
 
-	return 0;
+	return completed;
+}
 
-failed:
-	cbi_async_thrpool_term(q);
-	return err;
+/**
+ * The workers signal the event fd once they see it, thus, completions pushed before that are
+ * covered by signaling it on creation
+ */
+static int
+cbi_async_thrpool_get_completion_fd(struct xnvme_queue *q)
+{
+	struct xnvme_queue_thrpool *queue = (void *)q;
+	int efd = queue->efd;
+
+	if (efd >= 0) {
+		return efd;
+	}
+
+	efd = xnvme_be_cbi_async_efd_init(&efd);
+	if (efd < 0) {
+		return efd;
+	}
+	atomic_store_explicit(&queue->efd, efd, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if (queue->base.outstanding) {
+		xnvme_be_cbi_async_efd_signal(efd);
+	}
+
+	return efd;
 }
 
 static int
 cbi_async_thrpool_poke(struct xnvme_queue *q, uint32_t max)
+{
+	return cbi_async_thrpool_complete(q, NULL, max);
+}
+
+static int
+cbi_async_thrpool_reap(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
+{
+	return cbi_async_thrpool_complete(q, ctxs, max);
+}
+
+/**
+ * Block on the completion-queue condition variable until at least 'min' commands are completed
+ * by the worker threads, or until 'timeout_ns' has passed, then process the completions
+ */
+static int
+cbi_async_thrpool_wait(struct xnvme_queue *q, uint32_t min, uint64_t timeout_ns)
 {
 	struct xnvme_queue_thrpool *queue = (void *)q;
 	struct _thrpool_qp *qp = queue->qp;
-	unsigned completed = 0;
+	struct timespec abstime = {0};
 	int err;
 
-	max = max ? max : queue->base.outstanding;
-	max = max > queue->base.outstanding ? queue->base.outstanding : max;
+	min = min > queue->base.outstanding ? queue->base.outstanding : min;
+
+	if (xnvme_queue_ring_count(qp->cq) >= min) {
+		return cbi_async_thrpool_complete(q, NULL, 0);
+	}
 
-	struct _thrpool_entry *entries[max];
+	if (timeout_ns) {
+		clock_gettime(CLOCK_REALTIME, &abstime);
+		abstime.tv_sec += timeout_ns / 1000000000ULL;
+		abstime.tv_nsec += timeout_ns % 1000000000ULL;
+		if (abstime.tv_nsec >= 1000000000L) {
+			abstime.tv_sec += 1;
+			abstime.tv_nsec -= 1000000000L;
+		}
+	}
 
 	err = pthread_mutex_lock(&qp->cq_mutex);
 	if (err) {
@@ -288,32 +695,85 @@ cbi_async_thrpool_poke(struct xnvme_queue *q, uint32_t max)
 		return -err;
 	}
 
-	while (completed < max) {
-		struct _thrpool_entry *entry;
-
-		entry = STAILQ_FIRST(&qp->cq);
-		if (entry == NULL) {
+	atomic_store_explicit(&qp->cq_wait_min, min, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	while (xnvme_queue_ring_count(qp->cq) < min) {
+		err = timeout_ns ? pthread_cond_timedwait(&qp->cq_cond, &qp->cq_mutex, &abstime)
+				 : pthread_cond_wait(&qp->cq_cond, &qp->cq_mutex);
+		if (err) {
+			if (err != ETIMEDOUT) {
+				XNVME_DEBUG("FAILED: pthread_cond_{timed}wait(), err: %d", err);
+			}
 			break;
 		}
-		STAILQ_REMOVE_HEAD(&qp->cq, link);
-		entries[completed] = entry;
-		completed++;
-	};
+	}
+	atomic_store_explicit(&qp->cq_wait_min, 0, memory_order_relaxed);
 
 	err = pthread_mutex_unlock(&qp->cq_mutex);
 	if (err) {
 		XNVME_DEBUG("FAILED: pthread_mutex_unlock(), err: %d", err);
 	}
 
-	for (unsigned i = 0; i < completed; i++) {
-		struct _thrpool_entry *entry = entries[i];
-		entry->ctx->async.cb(entry->ctx, entry->ctx->async.cb_arg);
-		STAILQ_INSERT_TAIL(&qp->rp, entry, link);
+	return cbi_async_thrpool_complete(q, NULL, 0);
+}
+
+/**
+ * Pass the request to a worker, round-robin, skipping workers whose ring is full, and wake a
+ * parked worker if any. A read / write continuing the previous one is passed to the same worker,
+ * such that the worker can merge them.
+ */
+static int
+_thrpool_submit(struct xnvme_queue_thrpool *queue, struct _thrpool_entry *entry)
+{
+	struct xnvme_spec_cmd *cmd = &entry->ctx->cmd;
+	struct _thrpool_qp *qp = queue->qp;
+	uint32_t first = queue->worker;
+	uint32_t i;
+
+	if (queue->seq_opc && (cmd->common.opcode == queue->seq_opc) &&
+	    (cmd->common.nsid == queue->seq_nsid) && (cmd->nvm.slba == queue->seq_slba)) {
+		first = queue->seq_worker;
 	}
 
-	queue->base.outstanding -= completed;
+	atomic_fetch_add_explicit(&qp->ninflight, 1, memory_order_relaxed);
 
-	return completed;
+	for (i = 0; i < g_thrpool.nworkers; ++i) {
+		uint32_t id = (first + i) % g_thrpool.nworkers;
+
+		if (!xnvme_queue_ring_push(g_thrpool.workers[id].sq, entry)) {
+			queue->worker = id + 1;
+			break;
+		}
+	}
+	if (i == g_thrpool.nworkers) {
+		atomic_fetch_sub_explicit(&qp->ninflight, 1, memory_order_relaxed);
+		STAILQ_INSERT_HEAD(&qp->rp, entry, link);
+		return -EBUSY;
+	}
+	queue->base.outstanding += 1;
+
+	switch (cmd->common.opcode) {
+	case XNVME_SPEC_NVM_OPC_READ:
+	case XNVME_SPEC_NVM_OPC_WRITE:
+		queue->seq_slba = cmd->nvm.slba + cmd->nvm.nlb + 1;
+		queue->seq_nsid = cmd->common.nsid;
+		queue->seq_worker = queue->worker - 1;
+		queue->seq_opc = cmd->common.opcode;
+		break;
+
+	default:
+		queue->seq_opc = 0;
+		break;
+	}
+
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&g_thrpool.nparked, memory_order_relaxed)) {
+		pthread_mutex_lock(&g_thrpool.park_mutex);
+		pthread_cond_signal(&g_thrpool.park_cond);
+		pthread_mutex_unlock(&g_thrpool.park_mutex);
+	}
+
+	return 0;
 }
 
 static inline int
@@ -323,7 +783,6 @@ cbi_async_thrpool_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbyt
 	struct xnvme_queue_thrpool *queue = (void *)ctx->async.queue;
 	struct _thrpool_qp *qp = queue->qp;
 	struct _thrpool_entry *entry = NULL;
-	int err;
 
 	entry = STAILQ_FIRST(&qp->rp);
 	if (!entry) {
@@ -341,27 +800,7 @@ cbi_async_thrpool_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbyt
 	entry->meta_nbytes = mbuf_nbytes;
 	entry->is_vectored = false;
 
-	err = pthread_mutex_lock(&qp->sq_mutex);
-	if (err) {
-		STAILQ_INSERT_TAIL(&qp->rp, entry, link);
-		XNVME_DEBUG("FAILED: pthread_mutex_lock(), err: %d", err);
-		return -err;
-	}
-
-	STAILQ_INSERT_TAIL(&qp->sq, entry, link);
-	ctx->async.queue->base.outstanding += 1;
-
-	err = pthread_mutex_unlock(&qp->sq_mutex);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_mutex_unlock(), err: %d", err);
-	}
-	err = pthread_cond_signal(&qp->sq_cond);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_cond_signal(), err: %d", err);
-		return -err;
-	}
-
-	return 0;
+	return _thrpool_submit(queue, entry);
 }
 
 static inline int
@@ -371,7 +810,6 @@ cbi_async_thrpool_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t
 	struct xnvme_queue_thrpool *queue = (void *)ctx->async.queue;
 	struct _thrpool_qp *qp = queue->qp;
 	struct _thrpool_entry *entry = NULL;
-	int err;
 
 	entry = STAILQ_FIRST(&qp->rp);
 	if (!entry) {
@@ -389,27 +827,7 @@ cbi_async_thrpool_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t
 	entry->meta_nbytes = mbuf_nbytes;
 	entry->is_vectored = true;
 
-	err = pthread_mutex_lock(&qp->sq_mutex);
-	if (err) {
-		STAILQ_INSERT_TAIL(&qp->rp, entry, link);
-		XNVME_DEBUG("FAILED: pthread_mutex_lock(), err: %d", err);
-		return -err;
-	}
-
-	STAILQ_INSERT_TAIL(&qp->sq, entry, link);
-	ctx->async.queue->base.outstanding += 1;
-
-	err = pthread_mutex_unlock(&qp->sq_mutex);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_mutex_unlock(), err: %d", err);
-	}
-	err = pthread_cond_signal(&qp->sq_cond);
-	if (err) {
-		XNVME_DEBUG("FAILED: pthread_cond_signal(), err: %d", err);
-		return -err;
-	}
-
-	return 0;
+	return _thrpool_submit(queue, entry);
 }
 
 #endif // XNVME_BE_CBI_ASYNC_THRPOOL_ENABLED
@@ -420,10 +838,11 @@ struct xnvme_be_async g_xnvme_be_cbi_async_thrpool = {
 	.cmd_io = cbi_async_thrpool_cmd_io,
 	.cmd_iov = cbi_async_thrpool_cmd_iov,
 	.poke = cbi_async_thrpool_poke,
-	.wait = xnvme_be_nosys_queue_wait,
+	.reap = cbi_async_thrpool_reap,
+	.wait = cbi_async_thrpool_wait,
 	.init = cbi_async_thrpool_init,
 	.term = cbi_async_thrpool_term,
-	.get_completion_fd = xnvme_be_nosys_queue_get_completion_fd,
+	.get_completion_fd = cbi_async_thrpool_get_completion_fd,
 #else
 	.cmd_io = xnvme_be_nosys_queue_cmd_io,
 	.cmd_iov = xnvme_be_nosys_queue_cmd_iov,
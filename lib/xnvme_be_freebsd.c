@@ -35,6 +35,7 @@ const struct xnvme_be_config g_xnvme_be_freebsd_emu_file = {
 			.name = "emu_file",
 			.descr = "Emulated async with file I/O",
 			.caps = XNVME_BE_CAP_FILE,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -63,6 +64,7 @@ const struct xnvme_be_config g_xnvme_be_freebsd_posix_nvme = {
 			.name = "posix",
 			.descr = "POSIX aio with NVMe ioctl",
 			.caps = XNVME_BE_CAP_NVME_CDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -77,6 +79,7 @@ const struct xnvme_be_config g_xnvme_be_freebsd_thrpool_nvme = {
 			.name = "thrpool",
 			.descr = "Thread pool with NVMe ioctl",
 			.caps = XNVME_BE_CAP_NVME_CDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -91,6 +94,7 @@ const struct xnvme_be_config g_xnvme_be_freebsd_emu_nvme = {
 			.name = "emu",
 			.descr = "Emulated async with NVMe ioctl",
 			.caps = XNVME_BE_CAP_NVME_CDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
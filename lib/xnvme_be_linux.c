@@ -74,6 +74,7 @@ const struct xnvme_be_config g_xnvme_be_linux_emu_nvme = {
 			.name = "emu",
 			.descr = "Emulated async with NVMe ioctl",
 			.caps = XNVME_BE_CAP_NVME_CDEV | XNVME_BE_CAP_NVME_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -94,6 +95,7 @@ const struct xnvme_be_config g_xnvme_be_linux_emu_block = {
 			.name = "emu_bdev",
 			.descr = "Emulated async with block layer",
 			.caps = XNVME_BE_CAP_NVME_BDEV | XNVME_BE_CAP_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 #endif
@@ -115,6 +117,7 @@ const struct xnvme_be_config g_xnvme_be_linux_ucmd_nvme = {
 			.name = "io_uring_cmd",
 			.descr = "io_uring passthru with NVMe ioctl",
 			.caps = XNVME_BE_CAP_NVME_CDEV | XNVME_BE_CAP_NVME_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -134,6 +137,7 @@ const struct xnvme_be_config g_xnvme_be_linux_iou_nvme = {
 			.name = "io_uring",
 			.descr = "io_uring with NVMe ioctl",
 			.caps = XNVME_BE_CAP_NVME_CDEV | XNVME_BE_CAP_NVME_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 #endif /* XNVME_BE_LINUX_LIBURING_ENABLED */
@@ -155,6 +159,7 @@ const struct xnvme_be_config g_xnvme_be_linux_iou_block = {
 			.name = "io_uring_bdev",
 			.descr = "io_uring with block layer",
 			.caps = XNVME_BE_CAP_NVME_BDEV | XNVME_BE_CAP_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 #endif
@@ -176,6 +181,7 @@ const struct xnvme_be_config g_xnvme_be_linux_aio_nvme = {
 			.name = "libaio",
 			.descr = "libaio with NVMe ioctl",
 			.caps = XNVME_BE_CAP_NVME_CDEV | XNVME_BE_CAP_NVME_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 #endif
@@ -197,6 +203,7 @@ const struct xnvme_be_config g_xnvme_be_linux_aio_block = {
 			.name = "libaio_bdev",
 			.descr = "libaio with block layer",
 			.caps = XNVME_BE_CAP_NVME_BDEV | XNVME_BE_CAP_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 #endif
@@ -218,6 +225,7 @@ const struct xnvme_be_config g_xnvme_be_linux_posix_nvme = {
 			.name = "posix",
 			.descr = "POSIX aio with NVMe ioctl",
 			.caps = XNVME_BE_CAP_NVME_CDEV | XNVME_BE_CAP_NVME_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 #endif
@@ -238,6 +246,7 @@ const struct xnvme_be_config g_xnvme_be_linux_thrpool_nvme = {
 			.name = "thrpool",
 			.descr = "Thread pool with NVMe ioctl",
 			.caps = XNVME_BE_CAP_NVME_CDEV | XNVME_BE_CAP_NVME_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -258,6 +267,7 @@ const struct xnvme_be_config g_xnvme_be_linux_thrpool_block = {
 			.name = "thrpool_bdev",
 			.descr = "Thread pool with block layer",
 			.caps = XNVME_BE_CAP_NVME_BDEV | XNVME_BE_CAP_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 #endif
@@ -297,6 +307,7 @@ const struct xnvme_be_config g_xnvme_be_linux_emu_file = {
 			.name = "emu_file",
 			.descr = "Emulated async with file I/O",
 			.caps = XNVME_BE_CAP_FILE,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -316,6 +327,7 @@ const struct xnvme_be_config g_xnvme_be_linux_thrpool_file = {
 			.name = "thrpool_file",
 			.descr = "Thread pool with file I/O",
 			.caps = XNVME_BE_CAP_FILE,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -336,6 +348,7 @@ const struct xnvme_be_config g_xnvme_be_linux_iou_file = {
 			.name = "io_uring_file",
 			.descr = "io_uring with file I/O",
 			.caps = XNVME_BE_CAP_FILE,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 #endif
@@ -357,6 +370,29 @@ const struct xnvme_be_config g_xnvme_be_linux_aio_file = {
 			.name = "libaio_file",
 			.descr = "libaio with file I/O",
 			.caps = XNVME_BE_CAP_FILE,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
+		},
+};
+#endif
+
+#ifdef XNVME_BE_CBI_ASYNC_POSIX_ENABLED
+const struct xnvme_be_config g_xnvme_be_linux_posix_file = {
+	.async = &g_xnvme_be_cbi_async_posix,
+	.sync = &g_xnvme_be_cbi_sync_psync,
+	.admin = &g_xnvme_be_cbi_admin_shim,
+	.dev = &g_xnvme_be_dev_linux,
+	.mem = &g_xnvme_be_cbi_mem_posix,
+	.mem_overrides =
+		(const struct xnvme_be_mem *const[]){
+			&g_xnvme_be_linux_mem_hugepage,
+			NULL,
+		},
+	.attr =
+		{
+			.name = "posix_file",
+			.descr = "POSIX aio with file I/O",
+			.caps = XNVME_BE_CAP_FILE,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 #endif
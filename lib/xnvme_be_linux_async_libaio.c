@@ -12,8 +12,10 @@
 #include <errno.h>
 #include <libaio.h>
 #include <stdatomic.h>
+#include <stdlib.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
+#include <xnvme_cmd.h>
 #include <xnvme_queue.h>
 #include <xnvme_be_linux.h>
 #include <xnvme_be_linux_libaio.h>
@@ -52,6 +54,8 @@ _linux_libaio_term(struct xnvme_queue *q)
 
 	io_destroy(queue->aio_ctx);
 	free(queue->aio_events);
+	free(queue->iocbps);
+	free(queue->iocbs);
 
 	return 0;
 }
@@ -66,62 +70,162 @@ _linux_libaio_init(struct xnvme_queue *q, int opts)
 	queue->poll_io = (opts & XNVME_QUEUE_IOPOLL) || state->poll_io;
 
 	queue->aio_ctx = 0;
-	queue->aio_events = calloc(queue->base.capacity, sizeof(struct io_event));
-
 	queue->efd = -1;
 
+	queue->batching = 1;
+	if (getenv("XNVME_QUEUE_BATCHING_OFF")) {
+		queue->batching = 0;
+	}
+
+	SLIST_INIT(&queue->rejected);
+	queue->nrejected = 0;
+
+	queue->nstaged = 0;
+	queue->aio_events = calloc(queue->base.capacity, sizeof(*queue->aio_events));
+	queue->iocbs = calloc(queue->base.capacity, sizeof(*queue->iocbs));
+	queue->iocbps = calloc(queue->base.capacity, sizeof(*queue->iocbps));
+	if (!(queue->aio_events && queue->iocbs && queue->iocbps)) {
+		XNVME_DEBUG("FAILED: calloc(aio_events, iocbs)");
+		err = -ENOMEM;
+		goto failed;
+	}
+	for (uint32_t i = 0; i < queue->base.capacity; ++i) {
+		queue->iocbps[i] = &queue->iocbs[i];
+	}
+
 	err = io_queue_init(queue->base.capacity, &queue->aio_ctx);
 	if (err) {
 		XNVME_DEBUG("FAILED: io_queue_init(), err: %d", err);
-		return err;
+		goto failed;
 	}
 
 	return 0;
+
+failed:
+	free(queue->aio_events);
+	free(queue->iocbps);
+	free(queue->iocbs);
+	queue->aio_events = NULL;
+	queue->iocbps = NULL;
+	queue->iocbs = NULL;
+
+	return err;
 }
 
+/**
+ * Submit the staged io-control-blocks, using a single io_submit() unless the kernel accepts
+ * fewer than given. An io-control-block rejected by the kernel is taken off the staging area, and
+ * its command is completed with the error by the next poke / wait. Except for -EAGAIN while
+ * commands are in flight, then the rest remain staged, and -EAGAIN is returned, until completions
+ * free up resources in the kernel.
+ */
 static int
-_linux_libaio_poke(struct xnvme_queue *q, uint32_t max)
+_linux_libaio_submit(struct xnvme_queue *q)
 {
 	struct xnvme_queue_libaio *queue = (void *)q;
-	struct timespec timeout;
-	int min, completed;
-	max = max ? max : queue->base.outstanding;
-	max = max > queue->base.outstanding ? queue->base.outstanding : max;
+	uint32_t nsubmitted = 0;
+	int err = 0;
 
-	struct xnvme_aio_ring *ring = (struct xnvme_aio_ring *)queue->aio_ctx;
+	while (nsubmitted < queue->nstaged) {
+		uint32_t nremaining = queue->nstaged - nsubmitted;
+		struct xnvme_cmd_ctx *ctx;
+		int ret;
 
-	/* If ring is incompatible use io_getevents */
-	if (ring->magic != XNVME_AIO_RING_MAGIC || ring->incompat_features != 0) {
-		timeout.tv_sec = 0;
-		timeout.tv_nsec = 100000;
-		min = queue->poll_io ? 0 : 1;
-		completed = io_getevents(queue->aio_ctx, min, max, queue->aio_events, &timeout);
-		if (completed < 0) {
-			XNVME_DEBUG("FAILED: completed: %d, errno: %d", completed, errno);
-			return completed;
+		ret = io_submit(queue->aio_ctx, nremaining, &queue->iocbps[nsubmitted]);
+		if (ret > 0) {
+			nsubmitted += ret;
+			continue;
 		}
+		ret = ret ? ret : -EAGAIN;
+		XNVME_DEBUG("FAILED: io_submit(), err: %d", ret);
 
-		/* Otherwise copy events from memory */
-	} else {
-		uint32_t current = ring->head;
+		if ((ret == -EAGAIN) &&
+		    (queue->base.outstanding > nremaining + queue->nrejected)) {
+			err = ret;
+			break;
+		}
 
-		// Casting max to int is safe here because
-		// max <= queue->base.outstanding < 4096
-		for (completed = 0; completed < (int)max; completed++) {
-			if (current == ring->tail) {
-				break;
-			}
+		ctx = (struct xnvme_cmd_ctx *)queue->iocbs[nsubmitted].data;
+		ctx->cpl.result = 0;
+		ctx->cpl.status.sc = -ret;
+		ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_VENDOR;
+		SLIST_INSERT_HEAD(&queue->rejected, (struct xnvme_cmd_ctx_entry *)ctx, link);
+		queue->nrejected += 1;
+		nsubmitted += 1;
+	}
 
-			queue->aio_events[completed] = ring->events[current];
+	queue->nstaged -= nsubmitted;
+	if (queue->nstaged && nsubmitted) {
+		memmove(queue->iocbs, &queue->iocbs[nsubmitted],
+			queue->nstaged * sizeof(*queue->iocbs));
+	}
 
-			current = (current + 1) % ring->nr;
+	return err;
+}
+
+/**
+ * Account for the io-control-block prepared at 'iocbs[nstaged]' and submit it, unless the queue
+ * is batching or the command is deferred, then it is left for _linux_libaio_submit() which is
+ * invoked by poke / wait, such that a single io_submit() carries all commands staged in between
+ */
+static int
+_linux_libaio_stage(struct xnvme_queue_libaio *queue, struct xnvme_cmd_ctx *ctx)
+{
+	int err;
+
+	queue->nstaged += 1;
+	queue->base.outstanding += 1;
+
+	if (queue->batching || (ctx->opts & XNVME_CMD_DEFER)) {
+		return 0;
+	}
+
+	// Nothing else is staged, thus, a rejection is returned to the caller instead of completed
+	if (queue->nstaged == 1) {
+		err = io_submit(queue->aio_ctx, 1, queue->iocbps);
+		queue->nstaged = 0;
+		if (err != 1) {
+			XNVME_DEBUG("FAILED: io_submit(), err: %d", err);
+			queue->base.outstanding -= 1;
+			return err ? err : -EAGAIN;
 		}
+		return 0;
+	}
 
-		/* update head */
-		atomic_store_explicit((_Atomic typeof(*(&ring->head)) *)(&ring->head), current,
-				      memory_order_release);
+	_linux_libaio_submit((struct xnvme_queue *)queue);
+
+	return 0;
+}
+
+/**
+ * Complete up to 'max' of the commands rejected by io_submit(), 0 means no max, by invoking their
+ * callbacks, as xnvme_queue_mpsc_complete_failed() does for commands rejected by the backend
+ */
+static int
+_linux_libaio_complete_rejected(struct xnvme_queue_libaio *queue, uint32_t max)
+{
+	uint32_t completed = 0;
+
+	while (queue->nrejected && (!max || completed < max)) {
+		struct xnvme_cmd_ctx *ctx = (void *)SLIST_FIRST(&queue->rejected);
+
+		SLIST_REMOVE_HEAD(&queue->rejected, link);
+		queue->nrejected -= 1;
+		queue->base.outstanding -= 1;
+
+		ctx->async.cb(ctx, ctx->async.cb_arg);
+		completed += 1;
 	}
 
+	return completed;
+}
+
+/**
+ * Process the first 'completed' events in 'queue->aio_events' by invoking their callbacks
+ */
+static int
+_linux_libaio_complete(struct xnvme_queue_libaio *queue, int completed)
+{
 	for (int event = 0; event < completed; event++) {
 		struct io_event *ev = &queue->aio_events[event];
 		struct xnvme_cmd_ctx *ctx = (struct xnvme_cmd_ctx *)(uintptr_t)ev->data;
@@ -152,6 +256,114 @@ _linux_libaio_poke(struct xnvme_queue *q, uint32_t max)
 	return completed;
 }
 
+static int
+_linux_libaio_wait(struct xnvme_queue *q, uint32_t min, uint64_t timeout_ns)
+{
+	struct xnvme_queue_libaio *queue = (void *)q;
+	struct timespec timeout = {
+		.tv_sec = timeout_ns / 1000000000ULL,
+		.tv_nsec = timeout_ns % 1000000000ULL,
+	};
+	uint32_t ninflight;
+	int completed, nrejected;
+
+	if (queue->nstaged) {
+		int err = _linux_libaio_submit(q);
+		if (err) {
+			XNVME_DEBUG("FAILED: _linux_libaio_submit(), err: %d", err);
+		}
+	}
+
+	nrejected = _linux_libaio_complete_rejected(queue, 0);
+
+	ninflight = queue->base.outstanding - queue->nstaged - queue->nrejected;
+	if (!ninflight) {
+		return nrejected;
+	}
+	min = min > (uint32_t)nrejected ? min - nrejected : 0;
+	min = min > ninflight ? ninflight : min;
+
+	completed = io_getevents(queue->aio_ctx, min, ninflight, queue->aio_events,
+				 timeout_ns ? &timeout : NULL);
+	if (completed == -EINTR) {
+		return nrejected;
+	}
+	if (completed < 0) {
+		XNVME_DEBUG("FAILED: io_getevents(), completed: %d", completed);
+		return completed;
+	}
+
+	completed = _linux_libaio_complete(queue, completed);
+
+	return completed < 0 ? completed : completed + nrejected;
+}
+
+static int
+_linux_libaio_poke(struct xnvme_queue *q, uint32_t max)
+{
+	struct xnvme_queue_libaio *queue = (void *)q;
+	struct timespec timeout;
+	uint32_t ninflight;
+	int min, completed, nrejected;
+
+	if (queue->nstaged) {
+		int err = _linux_libaio_submit(q);
+		if (err) {
+			XNVME_DEBUG("FAILED: _linux_libaio_submit(), err: %d", err);
+		}
+	}
+
+	nrejected = _linux_libaio_complete_rejected(queue, max);
+	if (max && (uint32_t)nrejected == max) {
+		return nrejected;
+	}
+
+	ninflight = queue->base.outstanding - queue->nstaged - queue->nrejected;
+	if (!ninflight) {
+		return nrejected;
+	}
+	max = max ? max - nrejected : ninflight;
+	max = max > ninflight ? ninflight : max;
+
+	struct xnvme_aio_ring *ring = (struct xnvme_aio_ring *)queue->aio_ctx;
+
+	/* If ring is incompatible use io_getevents */
+	if (ring->magic != XNVME_AIO_RING_MAGIC || ring->incompat_features != 0) {
+		timeout.tv_sec = 0;
+		timeout.tv_nsec = 100000;
+		min = queue->poll_io ? 0 : 1;
+		completed = io_getevents(queue->aio_ctx, min, max, queue->aio_events, &timeout);
+		if (completed < 0) {
+			XNVME_DEBUG("FAILED: completed: %d, errno: %d", completed, errno);
+			return completed;
+		}
+
+		/* Otherwise copy events from memory */
+	} else {
+		uint32_t current = ring->head;
+
+		// Casting max to int is safe here because
+		// max <= ninflight <= XNVME_BE_QUEUE_QDEPTH_MAX
+		for (completed = 0; completed < (int)max; completed++) {
+			if (current == ring->tail) {
+				break;
+			}
+
+			queue->aio_events[completed] = ring->events[current];
+
+			current = (current + 1) % ring->nr;
+		}
+
+		/* update head */
+		atomic_store_explicit((_Atomic typeof(*(&ring->head)) *)(&ring->head), current,
+				      memory_order_release);
+	}
+
+	completed = _linux_libaio_complete(queue, completed);
+
+	return completed < 0 ? completed : completed + nrejected;
+}
+
 static int
 _linux_libaio_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
 		     size_t mbuf_nbytes)
@@ -159,10 +371,7 @@ _linux_libaio_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes,
 	struct xnvme_queue_libaio *queue = (void *)ctx->async.queue;
 	struct xnvme_be_linux_state *state = (void *)queue->base.dev->be.state;
 	const uint64_t ssw = queue->base.dev->geo.ssw;
-
-	struct iocb iocb;
-	struct iocb *iocbs[] = {&iocb};
-	int err;
+	struct iocb *iocb = &queue->iocbs[queue->nstaged];
 
 	if (mbuf || mbuf_nbytes) {
 		XNVME_DEBUG("FAILED: mbuf or mbuf_nbytes provided");
@@ -173,43 +382,40 @@ _linux_libaio_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes,
 	///< NOTE: opcode-dispatch (io)
 	switch (ctx->cmd.common.opcode) {
 	case XNVME_SPEC_NVM_OPC_WRITE:
-		io_prep_pwrite(&iocb, state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba << ssw);
+		io_prep_pwrite(iocb, state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba << ssw);
 		break;
 
 	case XNVME_SPEC_NVM_OPC_READ:
-		io_prep_pread(&iocb, state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba << ssw);
+		io_prep_pread(iocb, state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba << ssw);
 		break;
 
 	case XNVME_SPEC_FS_OPC_WRITE:
-		io_prep_pwrite(&iocb, state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba);
+		io_prep_pwrite(iocb, state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba);
 		break;
 
 	case XNVME_SPEC_FS_OPC_READ:
-		io_prep_pread(&iocb, state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba);
+		io_prep_pread(iocb, state->fd, dbuf, dbuf_nbytes, ctx->cmd.nvm.slba);
 		break;
 
-		// TODO: determine how to handle fsync
+	// NOTE: IOCB_CMD_FSYNC requires Linux v4.18, the aio interface has no equivalent of
+	// write-zeroes / deallocate, thus, these remain unsupported
+	case XNVME_SPEC_NVM_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FLUSH:
+		io_prep_fsync(iocb, state->fd);
+		break;
 
 	default:
 		XNVME_DEBUG("FAILED: unsupported opcode: %d", ctx->cmd.common.opcode);
 		return -ENOSYS;
 	}
 
-	iocb.data = (unsigned long *)ctx;
+	iocb->data = (unsigned long *)ctx;
 
 	if (queue->efd != -1) {
-		io_set_eventfd(&iocb, queue->efd);
+		io_set_eventfd(iocb, queue->efd);
 	}
 
-	err = io_submit(queue->aio_ctx, 1, iocbs);
-	if (err == 1) {
-		ctx->async.queue->base.outstanding += 1;
-		return 0;
-	}
-
-	XNVME_DEBUG("FAILED: io_submit(), err: %d", err);
-
-	return err;
+	return _linux_libaio_stage(queue, ctx);
 }
 
 static int
@@ -219,10 +425,7 @@ _linux_libaio_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec
 	struct xnvme_queue_libaio *queue = (void *)ctx->async.queue;
 	struct xnvme_be_linux_state *state = (void *)queue->base.dev->be.state;
 	const uint64_t ssw = queue->base.dev->geo.ssw;
-
-	struct iocb iocb;
-	struct iocb *iocbs[] = {&iocb};
-	int err;
+	struct iocb *iocb = &queue->iocbs[queue->nstaged];
 
 	if (queue->base.outstanding == queue->base.capacity) {
 		XNVME_DEBUG("FAILED: queue is full");
@@ -237,22 +440,25 @@ _linux_libaio_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec
 	///< NOTE: opcode-dispatch (io)
 	switch (ctx->cmd.common.opcode) {
 	case XNVME_SPEC_NVM_OPC_WRITE:
-		io_prep_pwritev(&iocb, state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba << ssw);
+		io_prep_pwritev(iocb, state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba << ssw);
 		break;
 
 	case XNVME_SPEC_NVM_OPC_READ:
-		io_prep_preadv(&iocb, state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba << ssw);
+		io_prep_preadv(iocb, state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba << ssw);
 		break;
 
 	case XNVME_SPEC_FS_OPC_WRITE:
-		io_prep_pwritev(&iocb, state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba);
+		io_prep_pwritev(iocb, state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba);
 		break;
 
 	case XNVME_SPEC_FS_OPC_READ:
-		io_prep_preadv(&iocb, state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba);
+		io_prep_preadv(iocb, state->fd, dvec, dvec_cnt, ctx->cmd.nvm.slba);
 		break;
 
-		// TODO: determine how to handle fsync
+	case XNVME_SPEC_NVM_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FLUSH:
+		io_prep_fsync(iocb, state->fd);
+		break;
 
 	default:
 		XNVME_DEBUG("FAILED: unsupported opcode: %d", ctx->cmd.common.opcode);
@@ -260,23 +466,20 @@ _linux_libaio_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec
 	}
 
 	if (queue->efd != -1) {
-		io_set_eventfd(&iocb, queue->efd);
+		io_set_eventfd(iocb, queue->efd);
 	}
 
-	iocb.data = (unsigned long *)ctx;
+	iocb->data = (unsigned long *)ctx;
 
-	err = io_submit(queue->aio_ctx, 1, iocbs);
-	if (err == 1) {
-		ctx->async.queue->base.outstanding += 1;
-		return 0;
-	}
-
-	XNVME_DEBUG("FAILED: io_submit(), err: %d", err);
-
-	return err;
+	return _linux_libaio_stage(queue, ctx);
 }
 
-int
+/**
+ * The eventfd is attached, via IOCB_FLAG_RESFD, to the io-control-blocks prepared after it is
+ * created, thus, it is refused while commands are outstanding. A queue driven by an event-loop is
+ * not poked until the eventfd signals, thus, batching is disabled.
+ */
+static int
 _linux_libaio_get_completion_fd(struct xnvme_queue *queue)
 {
 	struct xnvme_queue_libaio *q = (struct xnvme_queue_libaio *)queue;
@@ -286,6 +489,11 @@ _linux_libaio_get_completion_fd(struct xnvme_queue *queue)
 		return q->efd;
 	}
 
+	if (q->base.outstanding) {
+		XNVME_DEBUG("FAILED: outstanding I/O found when getting completion_fd");
+		return -EBUSY;
+	}
+
 	efd = eventfd(0, EFD_CLOEXEC);
 	if (efd < 0) {
 		XNVME_DEBUG("FAILED: failed to create eventfd");
@@ -294,6 +502,9 @@ _linux_libaio_get_completion_fd(struct xnvme_queue *queue)
 
 	q->efd = efd;
 
+	q->batching = 0;
+	XNVME_DEBUG("Completion FD enabled, submission on poke (batching) disabled");
+
 	return efd;
 }
 
@@ -305,10 +516,11 @@ struct xnvme_be_async g_xnvme_be_linux_async_libaio = {
 	.cmd_io = _linux_libaio_cmd_io,
 	.cmd_iov = _linux_libaio_cmd_iov,
 	.poke = _linux_libaio_poke,
-	.wait = _linux_libaio_get_completion_fd,
+	.submit = _linux_libaio_submit,
+	.wait = _linux_libaio_wait,
 	.init = _linux_libaio_init,
 	.term = _linux_libaio_term,
-	.get_completion_fd = xnvme_be_nosys_queue_get_completion_fd,
+	.get_completion_fd = _linux_libaio_get_completion_fd,
 #else
 	.cmd_io = xnvme_be_nosys_queue_cmd_io,
 	.cmd_iov = xnvme_be_nosys_queue_cmd_iov,
@@ -10,52 +10,662 @@
 #include <xnvme_be_nosys.h>
 #ifdef XNVME_BE_LINUX_LIBURING_ENABLED
 #include <pthread.h>
+#include <sched.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <liburing.h>
 #include <sys/eventfd.h>
+#include <sys/queue.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <unistd.h>
+#include <xnvme_cmd.h>
 #include <xnvme_queue.h>
 #include <xnvme_dev.h>
 #include <xnvme_be_linux_liburing.h>
 #include <xnvme_be_linux.h>
 
+#ifndef IORING_SETUP_SUBMIT_ALL
+#define IORING_SETUP_SUBMIT_ALL (1U << 7)
+#endif
+#ifndef IORING_SETUP_COOP_TASKRUN
+#define IORING_SETUP_COOP_TASKRUN (1U << 8)
+#endif
+#ifndef IORING_SETUP_TASKRUN_FLAG
+#define IORING_SETUP_TASKRUN_FLAG (1U << 9)
+#endif
 #ifndef IORING_SETUP_SINGLE_ISSUER
 #define IORING_SETUP_SINGLE_ISSUER (1U << 12)
 #endif
+#ifndef IORING_SETUP_DEFER_TASKRUN
+#define IORING_SETUP_DEFER_TASKRUN (1U << 13)
+#endif
+#ifndef IORING_SETUP_HYBRID_IOPOLL
+#define IORING_SETUP_HYBRID_IOPOLL (1U << 17)
+#endif
+#ifndef IORING_RW_ATTR_FLAG_PI
+#define IORING_RW_ATTR_FLAG_PI (1U << 0)
+#endif
+#ifndef IO_INTEGRITY_CHK_GUARD
+#define IO_INTEGRITY_CHK_GUARD (1U << 0)
+#endif
+#ifndef IO_INTEGRITY_CHK_REFTAG
+#define IO_INTEGRITY_CHK_REFTAG (1U << 1)
+#endif
+#ifndef IO_INTEGRITY_CHK_APPTAG
+#define IO_INTEGRITY_CHK_APPTAG (1U << 2)
+#endif
 
-static struct sqpoll_wq {
-	pthread_mutex_t mutex;
+/**
+ * Offset of the read/write attribute fields 'attr_ptr' and 'attr_type_mask', they overlay 'addr3'
+ * and '__pad2[0]', and are written by offset as the io_uring.h in use might predate them
+ */
+#define XNVME_BE_LINUX_IOU_SQE_ATTR_OFS 48
+
+/**
+ * Protection Information attribute of a read/write SQE, mirrors 'struct io_uring_attr_pi' of the
+ * kernel ABI; it must stay valid until the kernel has consumed the SQE
+ */
+struct xnvme_be_linux_iou_attr_pi {
+	uint16_t flags;   ///< IO_INTEGRITY_CHK_* checks for the kernel to perform
+	uint16_t app_tag; ///< Logical Block Application Tag
+	uint32_t len;     ///< Length of the metadata buffer in bytes
+	uint64_t addr;    ///< Address of the metadata buffer
+	uint64_t seed;    ///< Seed of the reference tag
+	uint64_t rsvd;
+};
+XNVME_STATIC_ASSERT(sizeof(struct xnvme_be_linux_iou_attr_pi) == 32, "Incorrect size")
+
+/**
+ * The registered buffers of a queue mirror the slots of the device buffer-registry, they are
+ * re-synchronized by the submitting thread whenever the generation of the registry changes
+ */
+struct xnvme_queue_liburing_bufs {
+	uint64_t gen;
+	struct xnvme_be_linux_bufreg_slots slots;
+};
+
+/**
+ * Queue-state which does not fit in 'struct xnvme_queue_liburing'
+ */
+struct xnvme_queue_liburing_aux {
+	struct xnvme_queue_liburing_bufs *bufs; ///< Mirror of the device buffer-registry
+	struct xnvme_be_linux_iou_attr_pi *pi;  ///< One per command-context, indexed by its id
+};
+
+static void
+_liburing_bufs_term(struct xnvme_queue_liburing *queue)
+{
+	if (!queue->aux->bufs) {
+		return;
+	}
+
+	io_uring_unregister_buffers(&queue->ring);
+	free(queue->aux->bufs);
+	queue->aux->bufs = NULL;
+}
+
+static int
+_liburing_bufs_init(struct xnvme_queue_liburing *queue, struct xnvme_be_linux_bufreg *reg)
+{
+	struct xnvme_queue_liburing_bufs *bufs;
+	int err;
+
+	bufs = calloc(1, sizeof(*bufs));
+	if (!bufs) {
+		XNVME_DEBUG("FAILED: calloc(bufs), errno: %d", errno);
+		return -ENOMEM;
+	}
+	bufs->gen = xnvme_be_linux_bufreg_snapshot(reg, &bufs->slots);
+
+	err = io_uring_register_buffers(&queue->ring, bufs->slots.slots,
+					XNVME_BE_LINUX_BUFREG_NSLOTS);
+	if (err) {
+		XNVME_DEBUG("FAILED: io_uring_register_buffers(), err: %d", err);
+		free(bufs);
+		return err;
+	}
+	queue->aux->bufs = bufs;
+
+	return 0;
+}
+
+/**
+ * Update the slots which changed since the last synchronization; staged SQEs are submitted first
+ * as they might refer to a slot about to be replaced
+ */
+static int
+_liburing_bufs_sync(struct xnvme_queue_liburing *queue, struct xnvme_be_linux_bufreg *reg)
+{
+	struct xnvme_queue_liburing_bufs *bufs = queue->aux->bufs;
+	struct xnvme_be_linux_bufreg_slots slots;
+	uint64_t gen;
+	int err;
+
+	if (io_uring_sq_ready(&queue->ring)) {
+		err = io_uring_submit(&queue->ring);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: io_uring_submit(), err: %d", err);
+			return err;
+		}
+	}
+
+	gen = xnvme_be_linux_bufreg_snapshot(reg, &slots);
+
+	for (uint32_t i = 0; (i < slots.nslots) || (i < bufs->slots.nslots); ++i) {
+		if (slots.tags[i] == bufs->slots.tags[i]) {
+			continue;
+		}
+
+		err = io_uring_register_buffers_update_tag(&queue->ring, i, &slots.slots[i], NULL,
+							   1);
+		if (err < 0) {
+			XNVME_DEBUG("FAILED: io_uring_register_buffers_update_tag(), err: %d",
+				    err);
+			return err;
+		}
+	}
+	bufs->slots = slots;
+	bufs->gen = gen;
+
+	return 0;
+}
+
+int
+xnvme_be_linux_liburing_buf_index(struct xnvme_queue_liburing *queue, void *buf, size_t nbytes)
+{
+	struct xnvme_be_linux_state *state = (void *)queue->base.dev->be.state;
+	struct xnvme_queue_liburing_bufs *bufs = queue->aux->bufs;
+
+	if (!(bufs && buf)) {
+		return -1;
+	}
+
+	if (bufs->gen != xnvme_be_linux_bufreg_gen(state->bufreg)) {
+		if (_liburing_bufs_sync(queue, state->bufreg)) {
+			XNVME_DEBUG("INFO: fixed-buffers disabled due to failed synchronization");
+			_liburing_bufs_term(queue);
+			return -1;
+		}
+	}
+
+	return xnvme_be_linux_bufreg_find(&bufs->slots, buf, nbytes);
+}
+
+static inline void
+_liburing_sqe_set_attr(struct io_uring_sqe *sqe, uint64_t type_mask, void *attr)
+{
+	uint64_t *fields = (void *)((uint8_t *)sqe + XNVME_BE_LINUX_IOU_SQE_ATTR_OFS);
+
+	fields[0] = (uintptr_t)attr;
+	fields[1] = type_mask;
+}
+
+/**
+ * Probe whether the kernel carries the PI-attribute of read/write SQEs; a kernel which knows the
+ * attributes rejects an unknown attribute-type with -EINVAL, whereas a kernel predating them
+ * ignores the field, thus, a zero-length read with an unknown attribute-type tells them apart
+ *
+ * @return 1 when supported, 0 when not
+ */
+static int
+_liburing_attr_pi_probe(struct xnvme_be_linux_state *state)
+{
+	struct io_uring_cqe *cqe = NULL;
+	struct io_uring_sqe *sqe;
 	struct io_uring ring;
-	bool is_initialized;
-	int refcount;
-} g_sqpoll_wq = {
-	.mutex = PTHREAD_MUTEX_INITIALIZER,
-	.ring = {0},
-	.is_initialized = false,
-	.refcount = 0,
+	int supported = 0;
+	int err;
+
+	err = io_uring_queue_init(1, &ring, 0);
+	if (err) {
+		XNVME_DEBUG("FAILED: io_uring_queue_init(), err: %d", err);
+		return 0;
+	}
+
+	sqe = io_uring_get_sqe(&ring);
+	io_uring_prep_read(sqe, state->fd, NULL, 0, 0);
+	_liburing_sqe_set_attr(sqe, 1ULL << 63, NULL);
+
+	err = io_uring_submit_and_wait(&ring, 1);
+	if ((err == 1) && !io_uring_peek_cqe(&ring, &cqe) && cqe) {
+		supported = cqe->res == -EINVAL;
+		io_uring_cqe_seen(&ring, cqe);
+	}
+	io_uring_queue_exit(&ring);
+
+	XNVME_DEBUG("INFO: io_uring PI-attribute supported: %d", supported);
+
+	return supported;
+}
+
+/**
+ * Fill the PI-attribute of the given command-context, the checks to perform are those requested
+ * by the PRINFO field of the command, and the reference tag is seeded with its ILBRT
+ */
+static int
+_liburing_attr_pi(struct xnvme_queue_liburing *queue, struct xnvme_cmd_ctx *ctx, void *mbuf,
+		  size_t mbuf_nbytes, struct xnvme_be_linux_iou_attr_pi **attr)
+{
+	struct xnvme_cmd_ctx_entry *entry = (void *)ctx;
+	struct xnvme_be_linux_iou_attr_pi *pi;
+	uint32_t cdw12 = ctx->cmd.common.cdw12;
+
+	if (!queue->aux->pi) {
+		XNVME_DEBUG("FAILED: mbuf provided; PI-attribute is not supported");
+		return -ENOTSUP;
+	}
+
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_NVM_OPC_WRITE:
+	case XNVME_SPEC_NVM_OPC_READ:
+		break;
+
+	default:
+		XNVME_DEBUG("FAILED: mbuf provided for opcode: %d", ctx->cmd.common.opcode);
+		return -ENOTSUP;
+	}
+
+	if (!(mbuf && mbuf_nbytes) || (mbuf_nbytes > UINT32_MAX)) {
+		XNVME_DEBUG("FAILED: mbuf: %p, mbuf_nbytes: %zu", mbuf, mbuf_nbytes);
+		return -EINVAL;
+	}
+	if ((entry->id > queue->base.capacity) ||
+	    (xnvme_queue_entry((void *)queue, entry->id) != entry)) {
+		XNVME_DEBUG("FAILED: ctx not retrieved via xnvme_queue_get_cmd_ctx()");
+		return -EINVAL;
+	}
+
+	pi = &queue->aux->pi[entry->id];
+	pi->flags = 0;
+	if (cdw12 & XNVME_SPEC_FLAG_PRINFO_PRCHK_GUARD) {
+		pi->flags |= IO_INTEGRITY_CHK_GUARD;
+	}
+	if (cdw12 & XNVME_SPEC_FLAG_PRINFO_PRCHK_REF) {
+		pi->flags |= IO_INTEGRITY_CHK_REFTAG;
+	}
+	if (cdw12 & XNVME_SPEC_FLAG_PRINFO_PRCHK_APP) {
+		pi->flags |= IO_INTEGRITY_CHK_APPTAG;
+	}
+	pi->app_tag = ctx->cmd.nvm.lbat;
+	pi->len = mbuf_nbytes;
+	pi->addr = (uintptr_t)mbuf;
+	pi->seed = ctx->cmd.nvm.ilbrt;
+	pi->rsvd = 0;
+
+	*attr = pi;
+
+	return 0;
+}
+
+/**
+ * Ring-setup flags which are replaced, in order, when the kernel rejects the setup; 'drop' is
+ * replaced by 'add', the entry only applies when any of the flags in 'drop' are set
+ */
+static const struct {
+	unsigned drop;
+	unsigned add;
+	const char *descr;
+} g_init_fallback[] = {
+	{IORING_SETUP_HYBRID_IOPOLL, 0, "!HYBRID_IOPOLL"},
+	{IORING_SETUP_DEFER_TASKRUN, IORING_SETUP_COOP_TASKRUN, "DEFER_TASKRUN->COOP_TASKRUN"},
+	{IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG, 0, "!COOP_TASKRUN"},
+	{IORING_SETUP_SUBMIT_ALL, 0, "!SUBMIT_ALL"},
+	{IORING_SETUP_SINGLE_ISSUER, 0, "!SINGLE_ISSUER"},
 };
+static const int g_init_nfallback = sizeof g_init_fallback / sizeof(*g_init_fallback);
 
 static int
 _init_retry(unsigned entries, struct io_uring *ring, struct io_uring_params *p)
 {
 	int err;
 
-retry:
-	err = io_uring_queue_init_params(entries, ring, p);
-	if (err) {
-		if (err == -EINVAL && p->flags & IORING_SETUP_SINGLE_ISSUER) {
-			p->flags &= ~IORING_SETUP_SINGLE_ISSUER;
-			XNVME_DEBUG("FAILED: io_uring_queue_init_params(), retry(!SINGLE_ISSUER)");
-			goto retry;
+	for (int i = 0;; ++i) {
+		err = io_uring_queue_init_params(entries, ring, p);
+		if (err != -EINVAL) {
+			break;
 		}
 
+		while ((i < g_init_nfallback) && !(p->flags & g_init_fallback[i].drop)) {
+			++i;
+		}
+		if (i == g_init_nfallback) {
+			break;
+		}
+
+		p->flags = (p->flags & ~g_init_fallback[i].drop) | g_init_fallback[i].add;
+		XNVME_DEBUG("FAILED: io_uring_queue_init_params(), retry(%s)",
+			    g_init_fallback[i].descr);
+	}
+	if (err) {
 		XNVME_DEBUG("FAILED: io_uring_queue_init(), err: %d", err);
 		return err;
 	}
+	XNVME_DEBUG("INFO: ring-setup flags: 0x%x", p->flags);
+
+	return 0;
+}
+
+/**
+ * A pool is a ring whose SQ-poller thread is shared, via IORING_SETUP_ATTACH_WQ, by the SQPOLL
+ * queues mapped to it by opts.sqpoll_pool; the ring itself is never used for submission
+ */
+struct sqpoll_pool {
+	SLIST_ENTRY(sqpoll_pool) link;
+	char key[XNVME_IDENT_URI_LEN + 8];
+	struct io_uring ring;
+	int refcount;
+};
+
+struct sqpoll_attachment {
+	SLIST_ENTRY(sqpoll_attachment) link;
+	struct xnvme_queue *queue;
+	struct sqpoll_pool *pool; ///< NULL when the queue has an SQ-poller of its own
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	SLIST_HEAD(, sqpoll_pool) pools;
+	SLIST_HEAD(, sqpoll_attachment) attachments;
+	uint32_t npools; ///< Number of SQ-pollers alive, used to spread them over the CPU-list
+} g_sqpoll = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.pools = SLIST_HEAD_INITIALIZER(g_sqpoll.pools),
+	.attachments = SLIST_HEAD_INITIALIZER(g_sqpoll.attachments),
+	.npools = 0,
+};
+
+/**
+ * Parse a CPU-list such as "0-3,8" into 'set'
+ *
+ * @return On success, the number of CPUs in the list is returned. On error, negative errno.
+ */
+static int
+_cpulist_parse(const char *list, cpu_set_t *set)
+{
+	const char *cur = list;
+
+	CPU_ZERO(set);
+
+	while (*cur && (*cur != '\n')) {
+		unsigned long first, last;
+		char *end;
+
+		first = strtoul(cur, &end, 10);
+		if (end == cur) {
+			return -EINVAL;
+		}
+		last = first;
+		if (*end == '-') {
+			cur = end + 1;
+			last = strtoul(cur, &end, 10);
+			if ((end == cur) || (last < first)) {
+				return -EINVAL;
+			}
+		}
+		if (last >= CPU_SETSIZE) {
+			return -EINVAL;
+		}
+		for (unsigned long cpu = first; cpu <= last; ++cpu) {
+			CPU_SET(cpu, set);
+		}
+
+		cur = end;
+		if (*cur == ',') {
+			++cur;
+		}
+	}
+
+	return CPU_COUNT(set) ? CPU_COUNT(set) : -EINVAL;
+}
+
+/**
+ * Returns the NUMA node of the device, by the sysfs 'numa_node' attribute of the device backing
+ * the device file, or of the filesystem for a regular file, or -1 when it cannot be determined
+ */
+static int
+_sqpoll_dev_numa_node(struct xnvme_queue_liburing *queue)
+{
+	struct xnvme_be_linux_state *state = (void *)queue->base.dev->be.state;
+	const char *fmts[] = {
+		"/sys/dev/%s/%u:%u/device/numa_node",
+		"/sys/dev/%s/%u:%u/device/device/numa_node",
+	};
+	struct stat st;
+	dev_t devno;
+	int node = -1;
+
+	if (fstat(state->fd, &st)) {
+		return -1;
+	}
+	devno = (S_ISBLK(st.st_mode) || S_ISCHR(st.st_mode)) ? st.st_rdev : st.st_dev;
+
+	for (size_t i = 0; (node < 0) && (i < sizeof(fmts) / sizeof(*fmts)); ++i) {
+		char path[128];
+		FILE *fp;
+
+		snprintf(path, sizeof(path), fmts[i], S_ISCHR(st.st_mode) ? "char" : "block",
+			 major(devno), minor(devno));
+
+		fp = fopen(path, "r");
+		if (!fp) {
+			continue;
+		}
+		if (fscanf(fp, "%d", &node) != 1) {
+			node = -1;
+		}
+		fclose(fp);
+	}
+
+	return node;
+}
+
+/**
+ * Pin the SQ-poller of the ring set up with 'params' to a CPU of the opts.sqpoll_cpus list,
+ * preferring those on the given NUMA node, and picking the 'nth' of them round-robin
+ */
+static void
+_sqpoll_params_cpu(struct xnvme_queue_liburing *queue, struct io_uring_params *params, int node,
+		   uint32_t nth)
+{
+	const char *cpus = queue->base.dev->opts.sqpoll_cpus;
+	cpu_set_t set, nodeset;
+	int ncpus;
+
+	if (!cpus) {
+		cpus = getenv("XNVME_QUEUE_SQPOLL_CPU");
+	}
+	if (!cpus) {
+		return;
+	}
+
+	ncpus = _cpulist_parse(cpus, &set);
+	if (ncpus < 0) {
+		XNVME_DEBUG("FAILED: _cpulist_parse('%s'); SQ-poller not pinned", cpus);
+		return;
+	}
+
+	if (node >= 0) {
+		char path[64], buf[1024] = {0};
+		FILE *fp;
+
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+		fp = fopen(path, "r");
+		if (fp) {
+			if (fgets(buf, sizeof(buf), fp) && (_cpulist_parse(buf, &nodeset) > 0)) {
+				CPU_AND(&nodeset, &nodeset, &set);
+				if (CPU_COUNT(&nodeset)) {
+					set = nodeset;
+					ncpus = CPU_COUNT(&set);
+				}
+			}
+			fclose(fp);
+		}
+	}
+
+	nth %= ncpus;
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (!CPU_ISSET(cpu, &set)) {
+			continue;
+		}
+		if (nth--) {
+			continue;
+		}
+
+		params->flags |= IORING_SETUP_SQ_AFF;
+		params->sq_thread_cpu = cpu;
+		XNVME_DEBUG("INFO: SQ-poller pinned to cpu: %d", cpu);
+		break;
+	}
+}
+
+/**
+ * Setup 'params' for the SQPOLL ring of the given queue; attaching it to the pool the queue maps
+ * to, creating the pool when needed. Must be called with g_sqpoll.mutex held.
+ */
+static int
+_sqpoll_attach(struct xnvme_queue_liburing *queue, struct io_uring_params *params)
+{
+	const struct xnvme_opts *opts = &queue->base.dev->opts;
+	struct sqpoll_attachment *attachment;
+	struct sqpoll_pool *pool;
+	uint32_t mode = opts->sqpoll_pool;
+	char key[sizeof(pool->key)];
+	char *env;
+	int node = -1;
+	int err;
+
+	params->flags |= IORING_SETUP_SQPOLL;
+	params->flags |= IORING_SETUP_SINGLE_ISSUER;
+
+	if ((mode == XNVME_OPTS_SQPOLL_POOL_PROCESS) && (env = getenv("XNVME_QUEUE_SQPOLL_AWQ")) &&
+	    (atoi(env) == 0)) {
+		mode = XNVME_OPTS_SQPOLL_POOL_NONE;
+	}
+
+	switch (mode) {
+	case XNVME_OPTS_SQPOLL_POOL_PROCESS:
+		snprintf(key, sizeof(key), "process");
+		break;
+	case XNVME_OPTS_SQPOLL_POOL_NUMA:
+		node = _sqpoll_dev_numa_node(queue);
+		snprintf(key, sizeof(key), "numa:%d", node);
+		break;
+	case XNVME_OPTS_SQPOLL_POOL_DEVICE:
+		snprintf(key, sizeof(key), "dev:%s", queue->base.dev->ident.uri);
+		break;
+	case XNVME_OPTS_SQPOLL_POOL_NONE:
+		attachment = calloc(1, sizeof(*attachment));
+		if (!attachment) {
+			XNVME_DEBUG("FAILED: calloc(attachment), errno: %d", errno);
+			return -ENOMEM;
+		}
+		attachment->queue = (struct xnvme_queue *)queue;
+		SLIST_INSERT_HEAD(&g_sqpoll.attachments, attachment, link);
+
+		params->sq_thread_idle = opts->sqpoll_idle;
+		_sqpoll_params_cpu(queue, params, -1, g_sqpoll.npools++);
+		return 0;
+	default:
+		XNVME_DEBUG("FAILED: invalid opts.sqpoll_pool: %" PRIu32, mode);
+		return -EINVAL;
+	}
+
+	SLIST_FOREACH(pool, &g_sqpoll.pools, link)
+	{
+		if (!strcmp(pool->key, key)) {
+			break;
+		}
+	}
+	if (!pool) {
+		struct io_uring_params pool_params = {0};
+
+		pool = calloc(1, sizeof(*pool));
+		if (!pool) {
+			XNVME_DEBUG("FAILED: calloc(pool), errno: %d", errno);
+			return -ENOMEM;
+		}
+		snprintf(pool->key, sizeof(pool->key), "%s", key);
+
+		pool_params.flags |= IORING_SETUP_SQPOLL;
+		pool_params.flags |= IORING_SETUP_SINGLE_ISSUER;
+		pool_params.sq_thread_idle = opts->sqpoll_idle;
+		_sqpoll_params_cpu(queue, &pool_params, node, g_sqpoll.npools);
+
+		err = _init_retry(queue->base.capacity, &pool->ring, &pool_params);
+		if (err) {
+			XNVME_DEBUG("FAILED: _init_retry(pool: '%s'), err: %d", key, err);
+			free(pool);
+			return err;
+		}
+		g_sqpoll.npools += 1;
+
+		SLIST_INSERT_HEAD(&g_sqpoll.pools, pool, link);
+		XNVME_DEBUG("INFO: created SQPOLL pool: '%s'", key);
+	}
+
+	attachment = calloc(1, sizeof(*attachment));
+	if (!attachment) {
+		XNVME_DEBUG("FAILED: calloc(attachment), errno: %d", errno);
+		if (!pool->refcount) {
+			SLIST_REMOVE(&g_sqpoll.pools, pool, sqpoll_pool, link);
+			io_uring_queue_exit(&pool->ring);
+			free(pool);
+		}
+		return -ENOMEM;
+	}
+	attachment->queue = (struct xnvme_queue *)queue;
+	attachment->pool = pool;
+	SLIST_INSERT_HEAD(&g_sqpoll.attachments, attachment, link);
+	pool->refcount += 1;
+
+	params->wq_fd = pool->ring.ring_fd;
+	params->flags |= IORING_SETUP_ATTACH_WQ;
 
 	return 0;
 }
 
+/**
+ * Release the pool of the given queue, if any, terminating the pool when it has no more queues
+ * attached. Must be called with g_sqpoll.mutex held.
+ */
+static void
+_sqpoll_detach(struct xnvme_queue_liburing *queue)
+{
+	struct sqpoll_attachment *attachment;
+	struct sqpoll_pool *pool;
+
+	SLIST_FOREACH(attachment, &g_sqpoll.attachments, link)
+	{
+		if (attachment->queue == (struct xnvme_queue *)queue) {
+			break;
+		}
+	}
+	if (!attachment) {
+		return;
+	}
+
+	pool = attachment->pool;
+	SLIST_REMOVE(&g_sqpoll.attachments, attachment, sqpoll_attachment, link);
+	free(attachment);
+
+	if (!pool) {
+		g_sqpoll.npools -= 1;
+		return;
+	}
+
+	pool->refcount -= 1;
+	if (pool->refcount) {
+		return;
+	}
+
+	XNVME_DEBUG("INFO: terminating SQPOLL pool: '%s'", pool->key);
+	SLIST_REMOVE(&g_sqpoll.pools, pool, sqpoll_pool, link);
+	io_uring_queue_exit(&pool->ring);
+	free(pool);
+	g_sqpoll.npools -= 1;
+}
+
 int
 xnvme_be_linux_liburing_init(struct xnvme_queue *q, int opts)
 {
@@ -74,9 +684,9 @@ xnvme_be_linux_liburing_init(struct xnvme_queue *q, int opts)
 	XNVME_DEBUG("queue->poll_sq: %d", queue->poll_sq);
 	XNVME_DEBUG("queue->poll_io: %d", queue->poll_io);
 
-	err = pthread_mutex_lock(&g_sqpoll_wq.mutex);
+	err = pthread_mutex_lock(&g_sqpoll.mutex);
 	if (err) {
-		XNVME_DEBUG("FAILED: lock(g_sqpoll_wq.mutex), err: %d", err);
+		XNVME_DEBUG("FAILED: lock(g_sqpoll.mutex), err: %d", err);
 		return -err;
 	}
 
@@ -91,45 +701,30 @@ xnvme_be_linux_liburing_init(struct xnvme_queue *q, int opts)
 	// Ring-initialization
 	//
 	if (queue->poll_sq) {
-		char *env;
-
-		if (!((env = getenv("XNVME_QUEUE_SQPOLL_AWQ")) && atoi(env) == 0)) {
-			if (!g_sqpoll_wq.is_initialized) {
-				struct io_uring_params sqpoll_wq_params = {0};
-
-				env = getenv("XNVME_QUEUE_SQPOLL_CPU");
-				if (env) {
-					sqpoll_wq_params.flags |= IORING_SETUP_SQ_AFF;
-					sqpoll_wq_params.sq_thread_cpu = atoi(env);
-				}
-				sqpoll_wq_params.flags |= IORING_SETUP_SQPOLL;
-				sqpoll_wq_params.flags |= IORING_SETUP_SINGLE_ISSUER;
-
-				err = _init_retry(queue->base.capacity, &g_sqpoll_wq.ring,
-						  &sqpoll_wq_params);
-				if (err) {
-					XNVME_DEBUG(
-						"FAILED: "
-						"io_uring_queue_init_params(g_sqpoll_wq.ring), "
-						"err: %d",
-						err);
-					goto exit;
-				}
-
-				g_sqpoll_wq.is_initialized = true;
-			}
-
-			g_sqpoll_wq.refcount += 1;
-			ring_params.wq_fd = g_sqpoll_wq.ring.ring_fd;
-			ring_params.flags |= IORING_SETUP_ATTACH_WQ;
+		err = _sqpoll_attach(queue, &ring_params);
+		if (err) {
+			XNVME_DEBUG("FAILED: _sqpoll_attach(), err: %d", err);
+			goto exit;
 		}
-		ring_params.flags |= IORING_SETUP_SQPOLL;
-		ring_params.flags |= IORING_SETUP_SINGLE_ISSUER;
 	}
 	if (queue->poll_io) {
 		ring_params.flags |= IORING_SETUP_IOPOLL;
 	}
 
+	// Tuned for a single submitting thread; completion task-work is deferred until the thread
+	// reaps, TASKRUN_FLAG lets liburing know when it must enter the kernel to run it
+	if ((opts & XNVME_QUEUE_TUNED) && !(opts & XNVME_QUEUE_MPSC)) {
+		ring_params.flags |= IORING_SETUP_SUBMIT_ALL;
+		ring_params.flags |= IORING_SETUP_SINGLE_ISSUER;
+		if (!queue->poll_sq) {
+			ring_params.flags |= IORING_SETUP_DEFER_TASKRUN;
+			ring_params.flags |= IORING_SETUP_TASKRUN_FLAG;
+		}
+		if (queue->poll_io) {
+			ring_params.flags |= IORING_SETUP_HYBRID_IOPOLL;
+		}
+	}
+
 	if (opts & XNVME_QUEUE_IOU_BIGSQE) {
 		ring_params.flags |= IORING_SETUP_SQE128;
 		ring_params.flags |= IORING_SETUP_CQE32;
@@ -141,21 +736,59 @@ xnvme_be_linux_liburing_init(struct xnvme_queue *q, int opts)
 		goto exit;
 	}
 
-	if (queue->poll_sq) {
+	// The device-fd is registered for every ring, saving the fdget/fdput per SQE, it is only
+	// mandatory with SQPOLL, thus, for other rings a failure falls back to the plain fd
+	if (queue->poll_sq || !getenv("XNVME_QUEUE_REGISTER_FILES_OFF") || state->register_files) {
 		err = io_uring_register_files(&queue->ring, &(state->fd), 1);
-		if (err) {
+		if (err && queue->poll_sq) {
 			XNVME_DEBUG("FAILED: io_uring_register_files, err: %d", err);
 			goto exit;
 		}
+		queue->fixed_file = err ? 0 : 1;
+		err = 0;
+	}
+	XNVME_DEBUG("queue->fixed_file: %d", queue->fixed_file);
+
+	// The registered ring-fd is only valid for the registering thread, thus, it is only done
+	// when asked for explicitly, and never for a queue with multiple submitters
+	if (state->register_files && !(opts & XNVME_QUEUE_MPSC)) {
+		int nregistered = io_uring_register_ring_fd(&queue->ring);
+		if (nregistered != 1) {
+			XNVME_DEBUG("INFO: io_uring_register_ring_fd(), err: %d", nregistered);
+		}
+	}
+
+	queue->aux = calloc(1, sizeof(*queue->aux));
+	if (!queue->aux) {
+		XNVME_DEBUG("FAILED: calloc(aux), errno: %d", errno);
+		io_uring_queue_exit(&queue->ring);
+		err = -ENOMEM;
+		goto exit;
 	}
 
+	if (state->bufreg && _liburing_bufs_init(queue, state->bufreg)) {
+		XNVME_DEBUG("INFO: fixed-buffers not available, using non-fixed commands");
+	}
+	XNVME_DEBUG("queue->aux->bufs: %p", (void *)queue->aux->bufs);
+
+	// Metadata is carried by the PI-attribute of read/write SQEs, big SQEs are for passthru,
+	// where the metadata is part of the command
+	if (queue->base.dev->geo.nbytes_oob && !(opts & XNVME_QUEUE_IOU_BIGSQE)) {
+		if (!state->iou_attr_pi) {
+			state->iou_attr_pi = _liburing_attr_pi_probe(state) ? 1 : 2;
+		}
+		if (state->iou_attr_pi == 1) {
+			queue->aux->pi = calloc(queue->base.capacity + 1, sizeof(*queue->aux->pi));
+		}
+	}
+	XNVME_DEBUG("queue->aux->pi: %p", (void *)queue->aux->pi);
+
 exit:
-	if (err && queue->poll_sq && g_sqpoll_wq.is_initialized && (!(--g_sqpoll_wq.refcount))) {
-		io_uring_queue_exit(&g_sqpoll_wq.ring);
-		g_sqpoll_wq.is_initialized = false;
+	if (err && queue->poll_sq) {
+		_sqpoll_detach(queue);
 	}
-	if (pthread_mutex_unlock(&g_sqpoll_wq.mutex)) {
-		XNVME_DEBUG("FAILED: unlock(g_sqpoll_wq.mutex)");
+	if (pthread_mutex_unlock(&g_sqpoll.mutex)) {
+		XNVME_DEBUG("FAILED: unlock(g_sqpoll.mutex)");
 	}
 
 	return err;
@@ -167,9 +800,9 @@ xnvme_be_linux_liburing_term(struct xnvme_queue *q)
 	struct xnvme_queue_liburing *queue = (void *)q;
 	int err;
 
-	err = pthread_mutex_lock(&g_sqpoll_wq.mutex);
+	err = pthread_mutex_lock(&g_sqpoll.mutex);
 	if (err) {
-		XNVME_DEBUG("FAILED: lock(g_sqpoll_wq.mutex), err: %d", err);
+		XNVME_DEBUG("FAILED: lock(g_sqpoll.mutex), err: %d", err);
 		return -err;
 	}
 
@@ -178,9 +811,15 @@ xnvme_be_linux_liburing_term(struct xnvme_queue *q)
 		err = -EINVAL;
 		goto exit;
 	}
-	if (queue->poll_sq) {
+	if (queue->fixed_file) {
 		io_uring_unregister_files(&queue->ring);
 	}
+	if (queue->aux) {
+		_liburing_bufs_term(queue);
+		free(queue->aux->pi);
+		free(queue->aux);
+		queue->aux = NULL;
+	}
 
 	if (queue->efd != -1) {
 		io_uring_unregister_eventfd(&queue->ring);
@@ -190,32 +829,35 @@ xnvme_be_linux_liburing_term(struct xnvme_queue *q)
 
 	io_uring_queue_exit(&queue->ring);
 
-	if (queue->poll_sq && g_sqpoll_wq.is_initialized && (!(--g_sqpoll_wq.refcount))) {
-		io_uring_queue_exit(&g_sqpoll_wq.ring);
-		g_sqpoll_wq.is_initialized = false;
+	if (queue->poll_sq) {
+		_sqpoll_detach(queue);
 	}
 
 exit:
-	if (pthread_mutex_unlock(&g_sqpoll_wq.mutex)) {
-		XNVME_DEBUG("FAILED: unlock(g_sqpoll_wq.mutex)");
+	if (pthread_mutex_unlock(&g_sqpoll.mutex)) {
+		XNVME_DEBUG("FAILED: unlock(g_sqpoll.mutex)");
 	}
 
 	return err;
 }
 
-int
-xnvme_be_linux_liburing_poke(struct xnvme_queue *q, uint32_t max)
+/**
+ * Process up to 'max' completions; with 'ctxs' given, the completed command-contexts are stored
+ * in it, otherwise their callbacks are invoked. CQEs are consumed in batches via
+ * io_uring_peek_batch_cqe() and retired with a single io_uring_cq_advance() per batch.
+ */
+static inline int
+_liburing_complete(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
 {
 	struct xnvme_queue_liburing *queue = (void *)q;
-	struct io_uring_cqe *cqe;
-	struct xnvme_cmd_ctx *ctx;
+	struct io_uring_cqe *cqes[XNVME_QUEUE_IOU_CQE_BATCH_MAX];
+	struct xnvme_cmd_ctx *batch[XNVME_QUEUE_IOU_CQE_BATCH_MAX];
 	unsigned completed;
-	int err;
 
 	max = max ? max : queue->base.outstanding;
 	max = max > queue->base.outstanding ? queue->base.outstanding : max;
 
-	if (queue->batching) {
+	if (io_uring_sq_ready(&queue->ring)) {
 		int err = io_uring_submit(&queue->ring);
 		if (err < 0) {
 			XNVME_DEBUG("io_uring_submit, err: %d", err);
@@ -224,41 +866,222 @@ xnvme_be_linux_liburing_poke(struct xnvme_queue *q, uint32_t max)
 	}
 
 	completed = 0;
-	for (uint32_t i = 0; i < max; i++) {
-		err = io_uring_peek_cqe(&queue->ring, &cqe);
-		if (err == -EAGAIN) {
-			return completed;
+	while (completed < max) {
+		struct xnvme_cmd_ctx **reaped = ctxs ? &ctxs[completed] : batch;
+		unsigned nwant = XNVME_MIN(max - completed, XNVME_QUEUE_IOU_CQE_BATCH_MAX);
+		unsigned nreaped = 0;
+		unsigned ncqes;
+
+		ncqes = io_uring_peek_batch_cqe(&queue->ring, cqes, nwant);
+		if (!ncqes) {
+			break;
 		}
 
-		ctx = io_uring_cqe_get_data(cqe);
+		for (unsigned i = 0; i < ncqes; ++i) {
+			struct io_uring_cqe *cqe = cqes[i];
+			struct xnvme_cmd_ctx *ctx = io_uring_cqe_get_data(cqe);
+
+			if (!ctx) {
+				// NOTE: a failed link of a chain, see _liburing_cmd_nodata(); the
+				// failure surfaces as -ECANCELED on the last SQE of the chain
+				XNVME_DEBUG("INFO: failed link, cqe->res: %d", cqe->res);
+				continue;
+			}
+
+			ctx->cpl.result = cqe->res;
+			if (cqe->res < 0) {
+				ctx->cpl.result = 0;
+				ctx->cpl.status.sc = -cqe->res;
+				ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_VENDOR;
+			}
 
-#ifdef XNVME_DEBUG_ENABLED
-		if (!ctx) {
-			XNVME_DEBUG("-{[THIS SHOULD NOT HAPPEN]}-");
-			XNVME_DEBUG("cqe->user_data is NULL! => NO REQ!");
-			XNVME_DEBUG("cqe->res: %d", cqe->res);
-			XNVME_DEBUG("cqe->flags: %u", cqe->flags);
-			return -EIO;
+			reaped[nreaped++] = ctx;
 		}
-#endif
 
-		ctx->cpl.result = cqe->res;
-		if (cqe->res < 0) {
-			ctx->cpl.result = 0;
-			ctx->cpl.status.sc = -cqe->res;
-			ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_VENDOR;
+		io_uring_cq_advance(&queue->ring, ncqes);
+		queue->base.outstanding -= nreaped;
+		completed += nreaped;
+
+		for (unsigned i = 0; !ctxs && i < nreaped; ++i) {
+			reaped[i]->async.cb(reaped[i], reaped[i]->async.cb_arg);
 		}
 
-		queue->base.outstanding--;
+		if (ncqes < nwant) {
+			break;
+		}
+	}
 
-		io_uring_cqe_seen(&queue->ring, cqe);
+	return completed;
+}
 
-		ctx->async.cb(ctx, ctx->async.cb_arg);
+int
+xnvme_be_linux_liburing_poke(struct xnvme_queue *q, uint32_t max)
+{
+	return _liburing_complete(q, NULL, max);
+}
 
-		completed++;
+int
+xnvme_be_linux_liburing_reap(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
+{
+	return _liburing_complete(q, ctxs, max);
+}
+
+int
+xnvme_be_linux_liburing_wait_cqes(struct xnvme_queue *q, uint32_t min, uint64_t timeout_ns)
+{
+	struct xnvme_queue_liburing *queue = (void *)q;
+	struct __kernel_timespec ts = {
+		.tv_sec = timeout_ns / 1000000000ULL,
+		.tv_nsec = timeout_ns % 1000000000ULL,
+	};
+	struct io_uring_cqe *cqe;
+	int err;
+
+	min = min > queue->base.outstanding ? queue->base.outstanding : min;
+
+	err = io_uring_submit_and_wait_timeout(&queue->ring, &cqe, min, timeout_ns ? &ts : NULL,
+					       NULL);
+	if ((err < 0) && (err != -ETIME) && (err != -EINTR)) {
+		XNVME_DEBUG("FAILED: io_uring_submit_and_wait_timeout(), err: %d", err);
+		return err;
 	}
 
-	return completed;
+	return 0;
+}
+
+int
+xnvme_be_linux_liburing_wait(struct xnvme_queue *q, uint32_t min, uint64_t timeout_ns)
+{
+	int err;
+
+	err = xnvme_be_linux_liburing_wait_cqes(q, min, timeout_ns);
+	if (err) {
+		return err;
+	}
+
+	return _liburing_complete(q, NULL, 0);
+}
+
+int
+xnvme_be_linux_liburing_submit(struct xnvme_queue *q)
+{
+	struct xnvme_queue_liburing *queue = (void *)q;
+	int err;
+
+	err = io_uring_submit(&queue->ring);
+	if (err < 0) {
+		XNVME_DEBUG("FAILED: io_uring_submit(), err: %d", err);
+		return err;
+	}
+
+	return 0;
+}
+
+/**
+ * Commands without a data-transfer; flush maps to IORING_OP_FSYNC, write-zeroes and the
+ * deallocate attribute of dataset-management map to IORING_OP_FALLOCATE, on a block device the
+ * latter are carried out by the kernel via Write Zeroes / Discard as supported by the device
+ *
+ * The ranges of a dataset-management command are expressed as a chain of linked SQEs of which only
+ * the last carries the command-context, the others are flagged IOSQE_CQE_SKIP_SUCCESS, thus, a
+ * command-context completes exactly once. A failing link cancels the remainder of the chain and
+ * is discarded on completion, thus, the failure surfaces as -ECANCELED. The chain must fit within
+ * the submission-ring, as a chain is severed when submitted in parts.
+ */
+static int
+_liburing_cmd_nodata(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes)
+{
+	struct xnvme_queue_liburing *queue = (void *)ctx->async.queue;
+	struct xnvme_be_linux_state *state = (void *)queue->base.dev->be.state;
+	const uint64_t ssw = queue->base.dev->geo.ssw;
+	const int sqe_flags = queue->fixed_file ? IOSQE_FIXED_FILE : 0;
+	// NOTE: we only ever register a single file, the raw device, so the
+	// provided index will always be 0
+	const int fd = queue->fixed_file ? 0 : state->fd;
+	struct xnvme_spec_dsm_range *ranges = dbuf;
+	struct io_uring_sqe *sqe = NULL;
+	uint32_t nranges = 1;
+	int mode;
+	int err;
+
+	if ((ctx->cmd.common.opcode == XNVME_SPEC_NVM_OPC_DATASET_MANAGEMENT) &&
+	    ctx->cmd.dsm.ad) {
+		nranges = ctx->cmd.dsm.nr + 1;
+		if (!dbuf || (dbuf_nbytes < nranges * sizeof(*ranges))) {
+			XNVME_DEBUG("FAILED: dbuf_nbytes: %zu; too small for nranges: %u",
+				    dbuf_nbytes, nranges);
+			return -EINVAL;
+		}
+		if (nranges > *queue->ring.sq.kring_entries) {
+			XNVME_DEBUG("FAILED: nranges: %u; exceeds ring_entries", nranges);
+			return -EINVAL;
+		}
+	}
+
+	if (io_uring_sq_space_left(&queue->ring) < nranges) {
+		return -EAGAIN;
+	}
+
+	///< NOTE: opcode-dispatch (io)
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_NVM_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FLUSH:
+		sqe = io_uring_get_sqe(&queue->ring);
+		io_uring_prep_fsync(sqe, fd, 0);
+		break;
+
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+		mode = FALLOC_FL_KEEP_SIZE;
+		mode |= ctx->cmd.write_zeroes.deac ? FALLOC_FL_PUNCH_HOLE : FALLOC_FL_ZERO_RANGE;
+
+		sqe = io_uring_get_sqe(&queue->ring);
+		io_uring_prep_fallocate(sqe, fd, mode, ctx->cmd.write_zeroes.slba << ssw,
+					((uint64_t)ctx->cmd.write_zeroes.nlb + 1) << ssw);
+		break;
+
+	case XNVME_SPEC_NVM_OPC_DATASET_MANAGEMENT:
+		if (!ctx->cmd.dsm.ad) { ///< The remaining attributes are hints, nothing to do
+			sqe = io_uring_get_sqe(&queue->ring);
+			io_uring_prep_nop(sqe);
+			break;
+		}
+		mode = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+
+		for (uint32_t i = 0; i < nranges; ++i) {
+			sqe = io_uring_get_sqe(&queue->ring);
+			io_uring_prep_fallocate(sqe, fd, mode, ranges[i].slba << ssw,
+						(uint64_t)ranges[i].llb << ssw);
+			if (i + 1 < nranges) {
+				io_uring_sqe_set_flags(sqe, sqe_flags | IOSQE_IO_LINK |
+								    IOSQE_CQE_SKIP_SUCCESS);
+				io_uring_sqe_set_data(sqe, NULL);
+			}
+		}
+		break;
+
+	default:
+		XNVME_DEBUG("FAILED: unsupported opcode: %d for async", ctx->cmd.common.opcode);
+		return -ENOSYS;
+	}
+
+	// NOTE: set after the io_uring_prep_*() helpers, as they reset the flags
+	io_uring_sqe_set_flags(sqe, sqe->opcode == IORING_OP_NOP ? 0 : sqe_flags);
+	io_uring_sqe_set_data(sqe, ctx);
+
+	if (queue->batching || (ctx->opts & XNVME_CMD_DEFER)) {
+		goto exit;
+	}
+
+	err = io_uring_submit(&queue->ring);
+	if (err < 0) {
+		XNVME_DEBUG("io_uring_submit(%d), err: %d", ctx->cmd.common.opcode, err);
+		return err;
+	}
+
+exit:
+	queue->base.outstanding += 1;
+
+	return 0;
 }
 
 int
@@ -267,15 +1090,19 @@ xnvme_be_linux_liburing_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbu
 {
 	struct xnvme_queue_liburing *queue = (void *)ctx->async.queue;
 	struct xnvme_be_linux_state *state = (void *)queue->base.dev->be.state;
+	struct xnvme_be_linux_iou_attr_pi *pi = NULL;
 	uint64_t ssw = 0;
 	struct io_uring_sqe *sqe = NULL;
 
 	int opcode = IORING_OP_NOP;
+	int buf_index = -1;
 	int err = 0;
 
 	if (mbuf || mbuf_nbytes) {
-		XNVME_DEBUG("FAILED: mbuf or mbuf_nbytes provided");
-		return -ENOTSUP;
+		err = _liburing_attr_pi(queue, ctx, mbuf, mbuf_nbytes, &pi);
+		if (err) {
+			return err;
+		}
 	}
 
 	///< NOTE: opcode-dispatch (io)
@@ -294,11 +1121,24 @@ xnvme_be_linux_liburing_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbu
 		opcode = IORING_OP_READ;
 		break;
 
+	case XNVME_SPEC_NVM_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FLUSH:
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+	case XNVME_SPEC_NVM_OPC_DATASET_MANAGEMENT:
+		return _liburing_cmd_nodata(ctx, dbuf, dbuf_nbytes);
+
 	default:
 		XNVME_DEBUG("FAILED: unsupported opcode: %d for async", ctx->cmd.common.opcode);
 		return -ENOSYS;
 	}
 
+	// NOTE: the lookup might synchronize the registered buffers, and thereby submit, thus it
+	// must be done before an SQE is obtained
+	buf_index = xnvme_be_linux_liburing_buf_index(queue, dbuf, dbuf_nbytes);
+	if (buf_index >= 0) {
+		opcode = (opcode == IORING_OP_READ) ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+	}
+
 	sqe = io_uring_get_sqe(&queue->ring);
 	if (!sqe) {
 		return -EAGAIN;
@@ -308,16 +1148,18 @@ xnvme_be_linux_liburing_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbu
 	sqe->addr = (unsigned long)dbuf;
 	sqe->len = dbuf_nbytes;
 	sqe->off = ctx->cmd.nvm.slba << ssw;
-	sqe->flags = queue->poll_sq ? IOSQE_FIXED_FILE : 0;
+	sqe->flags = queue->fixed_file ? IOSQE_FIXED_FILE : 0;
 	sqe->ioprio = 0;
 	// NOTE: we only ever register a single file, the raw device, so the
 	// provided index will always be 0
-	sqe->fd = queue->poll_sq ? 0 : state->fd;
+	sqe->fd = queue->fixed_file ? 0 : state->fd;
 	sqe->rw_flags = 0;
+	sqe->buf_index = (buf_index >= 0) ? buf_index : 0;
 	sqe->user_data = (unsigned long)ctx;
-	// sqe->__pad2[0] = sqe->__pad2[1] = sqe->__pad2[2] = 0;
+	// NOTE: always written, as the SQE might carry the attribute of a previous command
+	_liburing_sqe_set_attr(sqe, pi ? IORING_RW_ATTR_FLAG_PI : 0, pi);
 
-	if (queue->batching) {
+	if (queue->batching || (ctx->opts & XNVME_CMD_DEFER)) {
 		goto exit;
 	}
 
@@ -342,6 +1184,7 @@ xnvme_be_linux_liburing_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, s
 	uint64_t ssw = 0;
 	struct io_uring_sqe *sqe = NULL;
 
+	struct xnvme_be_linux_iou_attr_pi *pi = NULL;
 	int fd;
 	int err = 0;
 
@@ -351,8 +1194,10 @@ xnvme_be_linux_liburing_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, s
 	}
 
 	if (mbuf || mbuf_nbytes) {
-		XNVME_DEBUG("FAILED: mbuf or mbuf_nbytes provided");
-		return -ENOTSUP;
+		err = _liburing_attr_pi(queue, ctx, mbuf, mbuf_nbytes, &pi);
+		if (err) {
+			return err;
+		}
 	}
 
 	sqe = io_uring_get_sqe(&queue->ring);
@@ -360,11 +1205,9 @@ xnvme_be_linux_liburing_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, s
 		return -EAGAIN;
 	}
 
-	sqe->flags = queue->poll_sq ? IOSQE_FIXED_FILE : 0;
-
 	// NOTE: we only ever register a single file, the raw device, so the
 	// provided index will always be 0
-	fd = queue->poll_sq ? 0 : state->fd;
+	fd = queue->fixed_file ? 0 : state->fd;
 
 	switch (ctx->cmd.common.opcode) {
 	case XNVME_SPEC_NVM_OPC_WRITE:
@@ -386,9 +1229,12 @@ xnvme_be_linux_liburing_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, s
 		return -ENOSYS;
 	}
 
+	// NOTE: set after the io_uring_prep_*() helpers, as they reset the flags
+	io_uring_sqe_set_flags(sqe, queue->fixed_file ? IOSQE_FIXED_FILE : 0);
 	io_uring_sqe_set_data(sqe, ctx);
+	_liburing_sqe_set_attr(sqe, pi ? IORING_RW_ATTR_FLAG_PI : 0, pi);
 
-	if (queue->batching) {
+	if (queue->batching || (ctx->opts & XNVME_CMD_DEFER)) {
 		goto exit;
 	}
 
@@ -447,7 +1293,9 @@ struct xnvme_be_async g_xnvme_be_linux_async_liburing = {
 	.cmd_io = xnvme_be_linux_liburing_cmd_io,
 	.cmd_iov = xnvme_be_linux_liburing_cmd_iov,
 	.poke = xnvme_be_linux_liburing_poke,
-	.wait = xnvme_be_nosys_queue_wait,
+	.submit = xnvme_be_linux_liburing_submit,
+	.reap = xnvme_be_linux_liburing_reap,
+	.wait = xnvme_be_linux_liburing_wait,
 	.init = xnvme_be_linux_liburing_init,
 	.term = xnvme_be_linux_liburing_term,
 	.get_completion_fd = xnvme_be_linux_liburing_get_completion_fd,
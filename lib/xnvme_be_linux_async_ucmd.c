@@ -11,6 +11,7 @@
 #ifdef XNVME_BE_LINUX_LIBURING_ENABLED
 #include <errno.h>
 #include <liburing.h>
+#include <xnvme_cmd.h>
 #include <xnvme_queue.h>
 #include <xnvme_dev.h>
 #include <xnvme_be_linux_liburing.h>
@@ -18,6 +19,10 @@
 #include <xnvme_be_linux_nvme.h>
 #include <linux/nvme_ioctl.h>
 
+#ifndef IORING_URING_CMD_FIXED
+#define IORING_URING_CMD_FIXED (1U << 0)
+#endif
+
 static int g_linux_liburing_optional[] = {
 	IORING_OP_URING_CMD,
 };
@@ -61,19 +66,23 @@ xnvme_be_linux_ucmd_init(struct xnvme_queue *q, int opts)
 }
 
 #ifdef NVME_URING_CMD_IO
-int
-xnvme_be_linux_ucmd_poke(struct xnvme_queue *q, uint32_t max)
+/**
+ * Process up to 'max' completions; with 'ctxs' given, the completed command-contexts are stored
+ * in it, otherwise their callbacks are invoked
+ */
+static inline int
+_ucmd_complete(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
 {
 	struct xnvme_queue_liburing *queue = (void *)q;
-	struct io_uring_cqe *cqe;
-	struct xnvme_cmd_ctx *ctx;
+	struct io_uring_cqe *cqes[XNVME_QUEUE_IOU_CQE_BATCH_MAX];
+	struct xnvme_cmd_ctx *batch[XNVME_QUEUE_IOU_CQE_BATCH_MAX];
 	unsigned completed;
 	int err;
 
 	max = max ? max : queue->base.outstanding;
 	max = max > queue->base.outstanding ? queue->base.outstanding : max;
 
-	if (queue->batching) {
+	if (io_uring_sq_ready(&queue->ring)) {
 		int err = io_uring_submit(&queue->ring);
 		if (err < 0) {
 			XNVME_DEBUG("io_uring_submit, err: %d", err);
@@ -82,45 +91,83 @@ xnvme_be_linux_ucmd_poke(struct xnvme_queue *q, uint32_t max)
 	}
 
 	completed = 0;
-	for (uint32_t i = 0; i < max; i++) {
-		err = io_uring_peek_cqe(&queue->ring, &cqe);
-		if (err == -EAGAIN) {
-			return completed;
+	while (completed < max) {
+		struct xnvme_cmd_ctx **reaped = ctxs ? &ctxs[completed] : batch;
+		unsigned nwant = XNVME_MIN(max - completed, XNVME_QUEUE_IOU_CQE_BATCH_MAX);
+		unsigned ncqes;
+
+		ncqes = io_uring_peek_batch_cqe(&queue->ring, cqes, nwant);
+		if (!ncqes) {
+			break;
 		}
 
-		ctx = io_uring_cqe_get_data(cqe);
+		for (unsigned i = 0; i < ncqes; ++i) {
+			struct io_uring_cqe *cqe = cqes[i];
+			struct xnvme_cmd_ctx *ctx = io_uring_cqe_get_data(cqe);
 
 #ifdef XNVME_DEBUG_ENABLED
-		if (!ctx) {
-			XNVME_DEBUG("-{[THIS SHOULD NOT HAPPEN]}-");
-			XNVME_DEBUG("cqe->user_data is NULL! => NO REQ!");
-			XNVME_DEBUG("cqe->res: %d", cqe->res);
-			XNVME_DEBUG("cqe->flags: %u", cqe->flags);
-			return -EIO;
-		}
+			if (!ctx) {
+				XNVME_DEBUG("-{[THIS SHOULD NOT HAPPEN]}-");
+				XNVME_DEBUG("cqe->user_data is NULL! => NO REQ!");
+				XNVME_DEBUG("cqe->res: %d", cqe->res);
+				XNVME_DEBUG("cqe->flags: %u", cqe->flags);
+				return -EIO;
+			}
 #endif
 
-		ctx->cpl.result = cqe->big_cqe[0];
+			ctx->cpl.result = cqe->big_cqe[0];
 
-		/** IO64-quirky-handling: this is also for NVME_URING_CMD_IO_VEC */
-		err = xnvme_be_linux_nvme_map_cpl(ctx, NVME_URING_CMD_IO, cqe->res);
-		if (err) {
-			XNVME_DEBUG("FAILED: xnvme_be_linux_nvme_map_cpl(), err: %d", err);
-			return err;
-		}
+			/** IO64-quirky-handling: this is also for NVME_URING_CMD_IO_VEC */
+			err = xnvme_be_linux_nvme_map_cpl(ctx, NVME_URING_CMD_IO, cqe->res);
+			if (err) {
+				XNVME_DEBUG("FAILED: xnvme_be_linux_nvme_map_cpl(), err: %d", err);
+				return err;
+			}
 
-		queue->base.outstanding--;
+			reaped[i] = ctx;
+		}
 
-		io_uring_cqe_seen(&queue->ring, cqe);
+		io_uring_cq_advance(&queue->ring, ncqes);
+		queue->base.outstanding -= ncqes;
+		completed += ncqes;
 
-		ctx->async.cb(ctx, ctx->async.cb_arg);
+		for (unsigned i = 0; !ctxs && i < ncqes; ++i) {
+			reaped[i]->async.cb(reaped[i], reaped[i]->async.cb_arg);
+		}
 
-		completed++;
+		if (ncqes < nwant) {
+			break;
+		}
 	}
 
 	return completed;
 }
 
+int
+xnvme_be_linux_ucmd_poke(struct xnvme_queue *q, uint32_t max)
+{
+	return _ucmd_complete(q, NULL, max);
+}
+
+int
+xnvme_be_linux_ucmd_reap(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
+{
+	return _ucmd_complete(q, ctxs, max);
+}
+
+int
+xnvme_be_linux_ucmd_wait(struct xnvme_queue *q, uint32_t min, uint64_t timeout_ns)
+{
+	int err;
+
+	err = xnvme_be_linux_liburing_wait_cqes(q, min, timeout_ns);
+	if (err) {
+		return err;
+	}
+
+	return _ucmd_complete(q, NULL, 0);
+}
+
 #else
 int
 xnvme_be_linux_ucmd_poke(struct xnvme_queue *q, uint32_t max)
@@ -128,6 +175,21 @@ xnvme_be_linux_ucmd_poke(struct xnvme_queue *q, uint32_t max)
 	XNVME_DEBUG("FAILED: not supported, built on system without NVME_URING_CMD_IO");
 	return xnvme_be_nosys_queue_poke(q, max);
 }
+
+int
+xnvme_be_linux_ucmd_reap(struct xnvme_queue *XNVME_UNUSED(q),
+			 struct xnvme_cmd_ctx **XNVME_UNUSED(ctxs), uint32_t XNVME_UNUSED(max))
+{
+	XNVME_DEBUG("FAILED: not supported, built on system without NVME_URING_CMD_IO");
+	return -ENOSYS;
+}
+
+int
+xnvme_be_linux_ucmd_wait(struct xnvme_queue *q, uint32_t min, uint64_t timeout_ns)
+{
+	XNVME_DEBUG("FAILED: not supported, built on system without NVME_URING_CMD_IO");
+	return xnvme_be_nosys_queue_wait(q, min, timeout_ns);
+}
 #endif
 
 #ifdef NVME_URING_CMD_IO
@@ -138,8 +200,13 @@ xnvme_be_linux_ucmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes
 	struct xnvme_queue_liburing *queue = (void *)ctx->async.queue;
 	struct xnvme_be_linux_state *state = (void *)queue->base.dev->be.state;
 	struct io_uring_sqe *sqe = NULL;
+	int buf_index = -1;
 	int err = 0;
 
+	// NOTE: the lookup might synchronize the registered buffers, and thereby submit, thus it
+	// must be done before an SQE is obtained
+	buf_index = xnvme_be_linux_liburing_buf_index(queue, dbuf, dbuf_nbytes);
+
 	sqe = io_uring_get_sqe(&queue->ring);
 	if (!sqe) {
 		return -EAGAIN;
@@ -147,11 +214,14 @@ xnvme_be_linux_ucmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes
 
 	sqe->opcode = IORING_OP_URING_CMD;
 	sqe->off = NVME_URING_CMD_IO;
-	sqe->flags = queue->poll_sq ? IOSQE_FIXED_FILE : 0;
+	sqe->flags = queue->fixed_file ? IOSQE_FIXED_FILE : 0;
 	// NOTE: we only ever register a single file, the raw device, so the
 	// provided index will always be 0
-	sqe->fd = queue->poll_sq ? 0 : state->fd;
+	sqe->fd = queue->fixed_file ? 0 : state->fd;
 	sqe->user_data = (unsigned long)ctx;
+	// NOTE: 'uring_cmd_flags' shares its storage with 'rw_flags', which older headers lack
+	sqe->rw_flags = (buf_index >= 0) ? IORING_URING_CMD_FIXED : 0;
+	sqe->buf_index = (buf_index >= 0) ? buf_index : 0;
 
 	ctx->cmd.common.dptr.lnx_ioctl.data = (uint64_t)dbuf;
 	ctx->cmd.common.dptr.lnx_ioctl.data_len = dbuf_nbytes;
@@ -161,7 +231,7 @@ xnvme_be_linux_ucmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes
 
 	memcpy(&sqe->addr3, &ctx->cmd.common, 64);
 
-	if (queue->batching) {
+	if (queue->batching || (ctx->opts & XNVME_CMD_DEFER)) {
 		goto exit;
 	}
 
@@ -203,11 +273,12 @@ xnvme_be_linux_ucmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dv
 
 	sqe->opcode = IORING_OP_URING_CMD;
 	sqe->off = NVME_URING_CMD_IO_VEC;
-	sqe->flags = queue->poll_sq ? IOSQE_FIXED_FILE : 0;
+	sqe->flags = queue->fixed_file ? IOSQE_FIXED_FILE : 0;
 	// NOTE: we only ever register a single file, the raw device, so the
 	// provided index will always be 0
-	sqe->fd = queue->poll_sq ? 0 : state->fd;
+	sqe->fd = queue->fixed_file ? 0 : state->fd;
 	sqe->user_data = (unsigned long)ctx;
+	sqe->rw_flags = 0;
 
 	ctx->cmd.common.dptr.lnx_ioctl.data = (uint64_t)dvec;
 	ctx->cmd.common.dptr.lnx_ioctl.data_len = dvec_cnt;
@@ -217,7 +288,7 @@ xnvme_be_linux_ucmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dv
 
 	memcpy(&sqe->addr3, &ctx->cmd.common, 64);
 
-	if (queue->batching) {
+	if (queue->batching || (ctx->opts & XNVME_CMD_DEFER)) {
 		goto exit;
 	}
 
@@ -241,6 +312,73 @@ xnvme_be_linux_ucmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dv
 	return xnvme_be_nosys_queue_cmd_iov(ctx, dvec, dvec_cnt, dvec_nbytes, mbuf, mbuf_nbytes);
 }
 #endif
+
+#ifdef NVME_URING_CMD_ADMIN
+/**
+ * Admin-commands are passed via the controller char-device, which for a namespace char-device is
+ * opened alongside it, it is not a registered file, thus, it is used without IOSQE_FIXED_FILE
+ */
+int
+xnvme_be_linux_ucmd_admin(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+			  size_t mbuf_nbytes)
+{
+	struct xnvme_queue_liburing *queue = (void *)ctx->async.queue;
+	struct xnvme_be_linux_state *state = (void *)queue->base.dev->be.state;
+	const bool is_ctrlr = queue->base.dev->ident.dtype == XNVME_DEV_TYPE_NVME_CONTROLLER;
+	struct io_uring_sqe *sqe = NULL;
+	int err = 0;
+
+	if (!is_ctrlr && (state->ctrlr_fd < 0)) {
+		XNVME_DEBUG("FAILED: no controller char-device for async admin-commands");
+		return -ENOSYS;
+	}
+
+	sqe = io_uring_get_sqe(&queue->ring);
+	if (!sqe) {
+		return -EAGAIN;
+	}
+
+	sqe->opcode = IORING_OP_URING_CMD;
+	sqe->off = NVME_URING_CMD_ADMIN;
+	sqe->flags = (is_ctrlr && queue->fixed_file) ? IOSQE_FIXED_FILE : 0;
+	// NOTE: we only ever register a single file, the raw device, so the
+	// provided index will always be 0
+	sqe->fd = is_ctrlr ? (queue->fixed_file ? 0 : state->fd) : state->ctrlr_fd;
+	sqe->user_data = (unsigned long)ctx;
+	sqe->rw_flags = 0;
+
+	ctx->cmd.common.dptr.lnx_ioctl.data = (uint64_t)dbuf;
+	ctx->cmd.common.dptr.lnx_ioctl.data_len = dbuf_nbytes;
+
+	ctx->cmd.common.mptr = (uint64_t)mbuf;
+	ctx->cmd.common.dptr.lnx_ioctl.metadata_len = mbuf_nbytes;
+
+	memcpy(&sqe->addr3, &ctx->cmd.common, 64);
+
+	if (queue->batching || (ctx->opts & XNVME_CMD_DEFER)) {
+		goto exit;
+	}
+
+	err = io_uring_submit(&queue->ring);
+	if (err < 0) {
+		XNVME_DEBUG("io_uring_submit(%d), err: %d", ctx->cmd.common.opcode, err);
+		return err;
+	}
+
+exit:
+	queue->base.outstanding += 1;
+
+	return 0;
+}
+#else
+int
+xnvme_be_linux_ucmd_admin(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+			  size_t mbuf_nbytes)
+{
+	XNVME_DEBUG("FAILED: not supported, built on system without NVME_URING_CMD_ADMIN");
+	return xnvme_be_nosys_queue_cmd_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+}
+#endif
 #endif
 
 struct xnvme_be_async g_xnvme_be_linux_async_ucmd = {
@@ -248,8 +386,11 @@ struct xnvme_be_async g_xnvme_be_linux_async_ucmd = {
 #ifdef XNVME_BE_LINUX_LIBURING_ENABLED
 	.cmd_io = xnvme_be_linux_ucmd_io,
 	.cmd_iov = xnvme_be_linux_ucmd_iov,
+	.cmd_admin = xnvme_be_linux_ucmd_admin,
 	.poke = xnvme_be_linux_ucmd_poke,
-	.wait = xnvme_be_nosys_queue_wait,
+	.submit = xnvme_be_linux_liburing_submit,
+	.reap = xnvme_be_linux_ucmd_reap,
+	.wait = xnvme_be_linux_ucmd_wait,
 	.init = xnvme_be_linux_ucmd_init,
 	.term = xnvme_be_linux_liburing_term,
 	.get_completion_fd = xnvme_be_linux_liburing_get_completion_fd,
@@ -0,0 +1,287 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <libxnvme.h>
+#include <xnvme_be.h>
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <xnvme_dev.h>
+#include <xnvme_be_linux.h>
+
+/**
+ * Registry of the buffers allocated or mapped via a device, the io_uring queues of the device
+ * mirror the table of slots into their registered-buffers table such that the slot index of a
+ * buffer is usable as the 'buf_index' of a fixed-buffer command
+ *
+ * The slots are kept dense, a removed buffer has its slot filled by the one of the last slot, and
+ * are ordered by address, such that the slot of a buffer is found by binary search
+ *
+ * The registry wraps the memory-interface of the device, thus, it only knows about buffers
+ * allocated via xnvme_buf_alloc() / xnvme_buf_realloc() and regions mapped via xnvme_mem_map()
+ */
+struct xnvme_be_linux_bufreg {
+	pthread_mutex_t mutex;
+	_Atomic uint64_t gen; ///< Incremented on every change to 'slots'
+
+	struct xnvme_be_mem mem; ///< The wrapped memory-interface
+
+	struct xnvme_be_linux_bufreg_slots slots; ///< Tagged by the 'gen' at which assigned
+};
+
+static inline struct xnvme_be_linux_bufreg *
+_bufreg(const struct xnvme_dev *dev)
+{
+	return ((struct xnvme_be_linux_state *)dev->be.state)->bufreg;
+}
+
+/**
+ * Returns the position in 'order' of the first slot whose address is not below 'addr'
+ */
+static uint32_t
+_bufreg_lower_bound(const struct xnvme_be_linux_bufreg_slots *slots, uintptr_t addr)
+{
+	uint32_t lo = 0, hi = slots->nslots;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if ((uintptr_t)slots->slots[slots->order[mid]].iov_base < addr) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+static void
+_bufreg_add(struct xnvme_be_linux_bufreg *reg, void *buf, size_t nbytes)
+{
+	struct xnvme_be_linux_bufreg_slots *slots = &reg->slots;
+	uint32_t idx, pos;
+
+	if (nbytes > XNVME_BE_LINUX_BUFREG_NBYTES_MAX) {
+		XNVME_DEBUG("INFO: buf: %p, nbytes: %zu; exceeds max, not registered", buf, nbytes);
+		return;
+	}
+
+	pthread_mutex_lock(&reg->mutex);
+	if (slots->nslots == XNVME_BE_LINUX_BUFREG_NSLOTS) {
+		pthread_mutex_unlock(&reg->mutex);
+		XNVME_DEBUG("INFO: buf: %p; registry is full, not registered", buf);
+		return;
+	}
+
+	idx = slots->nslots;
+	pos = _bufreg_lower_bound(slots, (uintptr_t)buf);
+	memmove(&slots->order[pos + 1], &slots->order[pos],
+		(slots->nslots - pos) * sizeof(*slots->order));
+	slots->order[pos] = idx;
+
+	slots->slots[idx].iov_base = buf;
+	slots->slots[idx].iov_len = nbytes;
+	slots->tags[idx] = atomic_fetch_add_explicit(&reg->gen, 1, memory_order_release) + 1;
+	slots->nslots += 1;
+	pthread_mutex_unlock(&reg->mutex);
+}
+
+static void
+_bufreg_del(struct xnvme_be_linux_bufreg *reg, void *buf)
+{
+	struct xnvme_be_linux_bufreg_slots *slots = &reg->slots;
+	uint32_t idx, last, pos, moved;
+	uint64_t tag;
+
+	pthread_mutex_lock(&reg->mutex);
+	pos = _bufreg_lower_bound(slots, (uintptr_t)buf);
+	if ((pos == slots->nslots) || (slots->slots[slots->order[pos]].iov_base != buf)) {
+		pthread_mutex_unlock(&reg->mutex);
+		return;
+	}
+	idx = slots->order[pos];
+	last = slots->nslots - 1;
+
+	memmove(&slots->order[pos], &slots->order[pos + 1],
+		(slots->nslots - pos - 1) * sizeof(*slots->order));
+	slots->nslots -= 1;
+
+	tag = atomic_fetch_add_explicit(&reg->gen, 1, memory_order_release) + 1;
+	if (idx != last) {
+		moved = _bufreg_lower_bound(slots, (uintptr_t)slots->slots[last].iov_base);
+		while (slots->order[moved] != last) {
+			moved += 1;
+		}
+		slots->order[moved] = idx;
+		slots->slots[idx] = slots->slots[last];
+		slots->tags[idx] = tag;
+	}
+	slots->slots[last].iov_base = NULL;
+	slots->slots[last].iov_len = 0;
+	slots->tags[last] = 0;
+	pthread_mutex_unlock(&reg->mutex);
+}
+
+static void *
+_bufreg_buf_alloc(const struct xnvme_dev *dev, size_t nbytes, uint64_t *phys)
+{
+	struct xnvme_be_linux_bufreg *reg = _bufreg(dev);
+	void *buf;
+
+	buf = reg->mem.buf_alloc(dev, nbytes, phys);
+	if (buf) {
+		_bufreg_add(reg, buf, nbytes);
+	}
+
+	return buf;
+}
+
+static void *
+_bufreg_buf_realloc(const struct xnvme_dev *dev, void *buf, size_t nbytes, uint64_t *phys)
+{
+	struct xnvme_be_linux_bufreg *reg = _bufreg(dev);
+	void *rbuf;
+
+	rbuf = reg->mem.buf_realloc(dev, buf, nbytes, phys);
+	if (rbuf) {
+		_bufreg_del(reg, buf);
+		_bufreg_add(reg, rbuf, nbytes);
+	}
+
+	return rbuf;
+}
+
+static void
+_bufreg_buf_free(const struct xnvme_dev *dev, void *buf)
+{
+	struct xnvme_be_linux_bufreg *reg = _bufreg(dev);
+
+	_bufreg_del(reg, buf);
+	reg->mem.buf_free(dev, buf);
+}
+
+/**
+ * Regions of plain virtual memory need no mapping by the wrapped memory-interface, thus -ENOSYS
+ * from it is not treated as an error; the region is registered for use with io_uring regardless
+ */
+static int
+_bufreg_mem_map(const struct xnvme_dev *dev, void *vaddr, size_t nbytes, uint64_t *phys)
+{
+	struct xnvme_be_linux_bufreg *reg = _bufreg(dev);
+	int err;
+
+	err = reg->mem.mem_map ? reg->mem.mem_map(dev, vaddr, nbytes, phys) : -ENOSYS;
+	if (err && (err != -ENOSYS)) {
+		XNVME_DEBUG("FAILED: mem.mem_map(), err: %d", err);
+		return err;
+	}
+	_bufreg_add(reg, vaddr, nbytes);
+
+	return 0;
+}
+
+static int
+_bufreg_mem_unmap(const struct xnvme_dev *dev, void *buf)
+{
+	struct xnvme_be_linux_bufreg *reg = _bufreg(dev);
+	int err;
+
+	_bufreg_del(reg, buf);
+
+	err = reg->mem.mem_unmap ? reg->mem.mem_unmap(dev, buf) : -ENOSYS;
+
+	return (err == -ENOSYS) ? 0 : err;
+}
+
+int
+xnvme_be_linux_bufreg_init(struct xnvme_dev *dev)
+{
+	struct xnvme_be_linux_state *state = (void *)dev->be.state;
+	struct xnvme_be_linux_bufreg *reg;
+
+	reg = calloc(1, sizeof(*reg));
+	if (!reg) {
+		XNVME_DEBUG("FAILED: calloc(bufreg), errno: %d", errno);
+		return -ENOMEM;
+	}
+	pthread_mutex_init(&reg->mutex, NULL);
+	atomic_init(&reg->gen, 1);
+	reg->mem = dev->be.mem;
+
+	dev->be.mem.buf_alloc = _bufreg_buf_alloc;
+	dev->be.mem.buf_realloc = _bufreg_buf_realloc;
+	dev->be.mem.buf_free = _bufreg_buf_free;
+	dev->be.mem.mem_map = _bufreg_mem_map;
+	dev->be.mem.mem_unmap = _bufreg_mem_unmap;
+
+	state->bufreg = reg;
+
+	return 0;
+}
+
+void
+xnvme_be_linux_bufreg_term(struct xnvme_dev *dev)
+{
+	struct xnvme_be_linux_state *state = (void *)dev->be.state;
+	struct xnvme_be_linux_bufreg *reg = state->bufreg;
+
+	if (!reg) {
+		return;
+	}
+
+	dev->be.mem = reg->mem;
+	state->bufreg = NULL;
+
+	pthread_mutex_destroy(&reg->mutex);
+	free(reg);
+}
+
+uint64_t
+xnvme_be_linux_bufreg_gen(struct xnvme_be_linux_bufreg *reg)
+{
+	return atomic_load_explicit(&reg->gen, memory_order_acquire);
+}
+
+uint64_t
+xnvme_be_linux_bufreg_snapshot(struct xnvme_be_linux_bufreg *reg,
+			       struct xnvme_be_linux_bufreg_slots *slots)
+{
+	uint64_t gen;
+
+	pthread_mutex_lock(&reg->mutex);
+	*slots = reg->slots;
+	gen = atomic_load_explicit(&reg->gen, memory_order_relaxed);
+	pthread_mutex_unlock(&reg->mutex);
+
+	return gen;
+}
+
+int
+xnvme_be_linux_bufreg_find(const struct xnvme_be_linux_bufreg_slots *slots, const void *buf,
+			   size_t nbytes)
+{
+	// The slot with the highest address not above 'buf' is the only one which can contain it
+	uint32_t pos = _bufreg_lower_bound(slots, (uintptr_t)buf + 1);
+	const struct iovec *slot;
+
+	if (!pos) {
+		return -1;
+	}
+	slot = &slots->slots[slots->order[pos - 1]];
+
+	if ((uintptr_t)buf + nbytes > (uintptr_t)slot->iov_base + slot->iov_len) {
+		return -1;
+	}
+
+	return slots->order[pos - 1];
+}
+#endif
@@ -31,6 +31,11 @@ _be_linux_state_term(struct xnvme_be_linux_state *state)
 		return;
 	}
 
+	if (state->ctrlr_fd >= 0) {
+		close(state->ctrlr_fd);
+		state->ctrlr_fd = -1;
+	}
+
 	close(state->fd);
 	state->fd = 0;
 }
@@ -45,6 +50,8 @@ xnvme_be_linux_dev_open(struct xnvme_dev *dev)
 	int flags;
 	int err;
 
+	state->ctrlr_fd = -1;
+
 	flags = xnvme_file_opts_to_linux(opts);
 
 	XNVME_DEBUG("INFO: open() : flags: 0x%x, opts->create_mode: 0x%x", flags,
@@ -115,6 +122,13 @@ xnvme_be_linux_dev_open(struct xnvme_dev *dev)
 			dev->ident.dtype = XNVME_DEV_TYPE_NVME_NAMESPACE;
 			dev->ident.csi = XNVME_SPEC_CSI_NVM;
 			dev->ident.nsid = err;
+
+			///< For async admin-commands via io_uring_cmd; optional
+			if (!strcmp(dev->be.async.id, "io_uring_cmd")) {
+				err = xnvme_be_linux_nvme_ctrlr_open(dev);
+				XNVME_DEBUG("INFO: open() : ctrlr_fd: %d", err);
+				state->ctrlr_fd = err < 0 ? -1 : err;
+			}
 		}
 
 		break;
@@ -126,9 +140,21 @@ xnvme_be_linux_dev_open(struct xnvme_dev *dev)
 
 	state->poll_io = opts->poll_io;
 	state->poll_sq = opts->poll_sq;
+	state->register_files = opts->register_files;
 
 	XNVME_DEBUG("INFO: open() : dev->state.poll_io: %d", state->poll_io);
 	XNVME_DEBUG("INFO: open() : dev->state.poll_sq: %d", state->poll_sq);
+	XNVME_DEBUG("INFO: open() : dev->state.register_files: %d", state->register_files);
+
+	if (opts->register_buffers) {
+		err = xnvme_be_linux_bufreg_init(dev);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_be_linux_bufreg_init(), err: %d", err);
+			_be_linux_state_term(state);
+			return err;
+		}
+	}
+	XNVME_DEBUG("INFO: open() : dev->state.bufreg: %p", (void *)state->bufreg);
 
 	XNVME_DEBUG("INFO: --- open() : OK ---");
 
@@ -142,6 +168,7 @@ xnvme_be_linux_dev_close(struct xnvme_dev *dev)
 		return;
 	}
 
+	xnvme_be_linux_bufreg_term(dev);
 	_be_linux_state_term((void *)dev->be.state);
 	memset(&dev->be, 0, sizeof(dev->be));
 }
@@ -11,9 +11,12 @@
 #ifdef XNVME_PLATFORM_LINUX_ENABLED
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <linux/nvme_ioctl.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <unistd.h>
 #include <xnvme_be_linux.h>
 #include <xnvme_be_linux_nvme.h>
@@ -51,6 +54,10 @@ ioctl_request_to_str(unsigned long req)
 #ifdef NVME_URING_CMD_IO_VEC
 	case NVME_URING_CMD_IO_VEC:
 		return "NVME_URING_CMD_IO_VEC";
+#endif
+#ifdef NVME_URING_CMD_ADMIN
+	case NVME_URING_CMD_ADMIN:
+		return "NVME_URING_CMD_ADMIN";
 #endif
 	case NVME_IOCTL_RESET:
 		return "NVME_IOCTL_RESET";
@@ -114,6 +121,10 @@ xnvme_be_linux_nvme_map_cpl(struct xnvme_cmd_ctx *ctx, unsigned long ioctl_req,
 #ifdef NVME_URING_CMD_IO_VEC
 	case NVME_URING_CMD_IO_VEC:
 		break;
+#endif
+#ifdef NVME_URING_CMD_ADMIN
+	case NVME_URING_CMD_ADMIN:
+		break;
 #endif
 	default:
 		XNVME_DEBUG("FAILED: ioctl_req: %lu, res: %d", ioctl_req, res);
@@ -385,6 +396,45 @@ xnvme_be_linux_nvme_dev_nsid(struct xnvme_dev *dev)
 	return ioctl(state->fd, NVME_IOCTL_ID);
 }
 
+int
+xnvme_be_linux_nvme_ctrlr_open(struct xnvme_dev *dev)
+{
+	struct xnvme_be_linux_state *state = (void *)dev->be.state;
+	char path[PATH_MAX] = {0};
+	char link[PATH_MAX] = {0};
+	struct stat dev_stat;
+	const char *name;
+	int fd;
+
+	if (fstat(state->fd, &dev_stat)) {
+		XNVME_DEBUG("FAILED: fstat(), errno: %d", errno);
+		return -errno;
+	}
+
+	// NOTE: the parent of a namespace char-device is its controller, or, with native
+	// multipathing, the subsystem which has no char-device and thus fails to open below
+	snprintf(path, sizeof(path), "/sys/dev/char/%u:%u/device", major(dev_stat.st_rdev),
+		 minor(dev_stat.st_rdev));
+	if (!realpath(path, link)) {
+		XNVME_DEBUG("FAILED: realpath(%s), errno: %d", path, errno);
+		return -errno;
+	}
+	name = strrchr(link, '/');
+	name = name ? name + 1 : link;
+
+	if (snprintf(path, sizeof(path), "/dev/%s", name) >= (int)sizeof(path)) {
+		XNVME_DEBUG("FAILED: snprintf(/dev/%s), truncated", name);
+		return -ENAMETOOLONG;
+	}
+	fd = open(path, O_RDWR | O_CLOEXEC);
+	if (fd < 0) {
+		XNVME_DEBUG("FAILED: open(%s), errno: %d", path, errno);
+		return -errno;
+	}
+
+	return fd;
+}
+
 int
 xnvme_be_linux_nvme_supported(struct xnvme_dev *dev, uint32_t XNVME_UNUSED(opts))
 {
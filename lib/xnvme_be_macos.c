@@ -20,6 +20,7 @@ const struct xnvme_be_config g_xnvme_be_macos_emu = {
 			.name = "emu",
 			.descr = "Emulated async with macOS SMART",
 			.caps = XNVME_BE_CAP_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -34,6 +35,7 @@ const struct xnvme_be_config g_xnvme_be_macos_thrpool = {
 			.name = "thrpool",
 			.descr = "Thread pool with macOS SMART",
 			.caps = XNVME_BE_CAP_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -48,6 +50,7 @@ const struct xnvme_be_config g_xnvme_be_macos_posix = {
 			.name = "posix",
 			.descr = "POSIX aio with macOS SMART",
 			.caps = XNVME_BE_CAP_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
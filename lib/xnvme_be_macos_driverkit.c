@@ -32,6 +32,7 @@ const struct xnvme_be_config g_xnvme_be_driverkit_emu = {
 			.name = "driverkit_emu",
 			.descr = "DriverKit with emulated async",
 			.caps = XNVME_BE_CAP_NVME_PCIE,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -85,7 +85,8 @@ xnvme_be_nosys_queue_poke(struct xnvme_queue *XNVME_UNUSED(queue), uint32_t XNVM
 }
 
 int
-xnvme_be_nosys_queue_wait(struct xnvme_queue *XNVME_UNUSED(queue))
+xnvme_be_nosys_queue_wait(struct xnvme_queue *XNVME_UNUSED(queue), uint32_t XNVME_UNUSED(min),
+			  uint64_t XNVME_UNUSED(timeout_ns))
 {
 	XNVME_DEBUG("FAILED: not implemented(possibly intentional)");
 	return -ENOSYS;
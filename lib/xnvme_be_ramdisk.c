@@ -44,6 +44,21 @@ const struct xnvme_be_config g_xnvme_be_ramdisk_nil = {
 		},
 };
 
+const struct xnvme_be_config g_xnvme_be_ramdisk_native = {
+	.async = &g_xnvme_be_ramdisk_async,
+	.sync = &g_xnvme_be_ramdisk_sync,
+	.admin = &g_xnvme_be_ramdisk_admin,
+	.dev = &g_xnvme_be_ramdisk_dev,
+	.mem = XNVME_BE_RAMDISK_MEM,
+	XNVME_BE_RAMDISK_MEM_OVERRIDES.attr =
+		{
+			.name = "ramdisk_native",
+			.descr = "Ramdisk with native async",
+			.caps = XNVME_BE_CAP_RAMDISK,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
+		},
+};
+
 const struct xnvme_be_config g_xnvme_be_ramdisk_thrpool = {
 	.async = &g_xnvme_be_cbi_async_thrpool,
 	.sync = &g_xnvme_be_ramdisk_sync,
@@ -55,6 +70,7 @@ const struct xnvme_be_config g_xnvme_be_ramdisk_thrpool = {
 			.name = "ramdisk_thrpool",
 			.descr = "Ramdisk with thread pool",
 			.caps = XNVME_BE_CAP_RAMDISK,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -69,6 +85,7 @@ const struct xnvme_be_config g_xnvme_be_ramdisk_emu = {
 			.name = "ramdisk_emu",
 			.descr = "Ramdisk with emulated async",
 			.caps = XNVME_BE_CAP_RAMDISK,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
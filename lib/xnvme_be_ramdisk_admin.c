@@ -54,12 +54,15 @@ _idfy_ns_iocs_fs(struct xnvme_dev *dev, void *dbuf)
 }
 
 static int
-_idfy_ctrlr(struct xnvme_dev *XNVME_UNUSED(dev), void *dbuf)
+_idfy_ctrlr(struct xnvme_dev *dev, void *dbuf)
 {
+	struct xnvme_be_ramdisk_state *state = (void *)dev->be.state;
 	struct xnvme_spec_idfy_ctrlr *ctrlr = dbuf;
 	ctrlr->mdts = 0;
 	ctrlr->oncs.copy = 1;
 	ctrlr->oncs.write_zeroes = 1;
+	ctrlr->ctratt.extended_lba_formats = 1;
+	ctrlr->ctratt.flexible_data_placement = state->fdp ? 1 : 0;
 
 	ctrlr->cdfs.format0 = 1;
 	return 0;
@@ -68,9 +71,10 @@ _idfy_ctrlr(struct xnvme_dev *XNVME_UNUSED(dev), void *dbuf)
 static int
 _idfy_ns(struct xnvme_dev *dev, void *dbuf)
 {
+	struct xnvme_be_ramdisk_state *state = (void *)dev->be.state;
 	struct xnvme_spec_idfy_ns *ns = dbuf;
 	size_t ramdisk_size;
-	const size_t lba_size = 512;
+	const size_t lba_size = state->lbads;
 
 	ramdisk_size = xnvme_be_ramdisk_dev_get_size(dev);
 	if (!ramdisk_size) {
@@ -83,11 +87,27 @@ _idfy_ns(struct xnvme_dev *dev, void *dbuf)
 
 	ns->nlbaf = 0;        ///< This means that there is only one
 	ns->flbas.format = 0; ///< using the first one
+	ns->flbas.extended = (state->flags & XNVME_BE_RAMDISK_EXTENDED) ? 1 : 0;
 
-	ns->lbaf[0].ms = 0;
+	ns->lbaf[0].ms = state->ms;
 	ns->lbaf[0].ds = XNVME_ILOG2(lba_size);
 	ns->lbaf[0].rp = 0;
 
+	if (state->ms) {
+		ns->mc.extended = 1;
+		ns->mc.pointer = 1;
+	}
+	if (state->pit) {
+		ns->dpc.pit1 = 1;
+		ns->dpc.pit2 = 1;
+		ns->dpc.pit3 = 1;
+		ns->dpc.md_start = 1;
+		ns->dpc.md_end = 1;
+
+		ns->dps.pit = state->pit;
+		ns->dps.md_start = (state->flags & XNVME_BE_RAMDISK_PI_FIRST) ? 1 : 0;
+	}
+
 	ns->mcl = 128;
 	ns->mssrl = 128;
 	ns->msrc = 127;
@@ -95,9 +115,28 @@ _idfy_ns(struct xnvme_dev *dev, void *dbuf)
 	return 0;
 }
 
+static int
+_idfy_ns_iocs_nvm(struct xnvme_dev *dev, void *dbuf)
+{
+	struct xnvme_be_ramdisk_state *state = (void *)dev->be.state;
+	struct xnvme_spec_nvm_idfy_ns *ns = dbuf;
+
+	ns->elbaf[0].pif = state->pif;
+
+	return 0;
+}
+
+/**
+ * A ramdisk with metadata, or with FDP, identifies as an NVM namespace rather than a file, as the
+ * protection information format is given by the NVM command set specific identify namespace, and
+ * placement is a matter of the NVM command set; a Key-Value ramdisk identifies by the KV command
+ * set only
+ */
 static int
 _idfy(struct xnvme_cmd_ctx *ctx, void *dbuf)
 {
+	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
+
 	switch (ctx->cmd.idfy.cns) {
 	case XNVME_SPEC_IDFY_NS:
 		return _idfy_ns(ctx->dev, dbuf);
@@ -106,20 +145,50 @@ _idfy(struct xnvme_cmd_ctx *ctx, void *dbuf)
 		return _idfy_ctrlr(ctx->dev, dbuf);
 
 	case XNVME_SPEC_IDFY_NS_IOCS:
+		if (state->kv) {
+			if (ctx->cmd.idfy.csi != XNVME_SPEC_CSI_KV) {
+				break;
+			}
+			return xnvme_be_ramdisk_kv_idfy_ns(ctx->dev, dbuf);
+		}
 		switch (ctx->cmd.idfy.csi) {
 		case XNVME_SPEC_CSI_FS:
+			if (state->meta || state->fdp) {
+				break;
+			}
 			return _idfy_ns_iocs_fs(ctx->dev, dbuf);
 
+		case XNVME_SPEC_CSI_NVM:
+			return _idfy_ns_iocs_nvm(ctx->dev, dbuf);
+
+		case XNVME_SPEC_CSI_ZONED:
+			return xnvme_be_ramdisk_znd_idfy_ns(ctx->dev, dbuf);
+
 		default:
 			break;
 		}
 		break;
 
 	case XNVME_SPEC_IDFY_CTRLR_IOCS:
+		if (state->kv) {
+			if (ctx->cmd.idfy.csi != XNVME_SPEC_CSI_KV) {
+				break;
+			}
+			return 0;
+		}
 		switch (ctx->cmd.idfy.csi) {
 		case XNVME_SPEC_CSI_FS:
+			if (state->meta || state->fdp) {
+				break;
+			}
 			return _idfy_ctrlr_iocs_fs(ctx->dev, dbuf);
 
+		case XNVME_SPEC_CSI_NVM:
+			return 0;
+
+		case XNVME_SPEC_CSI_ZONED:
+			return xnvme_be_ramdisk_znd_idfy_ctrlr(ctx->dev, dbuf);
+
 		default:
 			break;
 		}
@@ -136,7 +205,7 @@ _idfy(struct xnvme_cmd_ctx *ctx, void *dbuf)
 }
 
 static int
-_ramdisk_gfeat(struct xnvme_cmd_ctx *ctx, void *XNVME_UNUSED(dbuf))
+_ramdisk_gfeat(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes)
 {
 	struct xnvme_spec_feat feat = {0};
 
@@ -147,6 +216,10 @@ _ramdisk_gfeat(struct xnvme_cmd_ctx *ctx, void *XNVME_UNUSED(dbuf))
 		ctx->cpl.cdw0 = feat.val;
 		break;
 
+	case XNVME_SPEC_FEAT_FDP_MODE:
+	case XNVME_SPEC_FEAT_FDP_EVENTS:
+		return xnvme_be_ramdisk_fdp_gfeat(ctx, dbuf, dbuf_nbytes);
+
 	default:
 		XNVME_DEBUG("FAILED: unsupported fid: %d", ctx->cmd.gfeat.cdw10.fid);
 		return -ENOSYS;
@@ -156,16 +229,35 @@ _ramdisk_gfeat(struct xnvme_cmd_ctx *ctx, void *XNVME_UNUSED(dbuf))
 }
 
 static int
-_xnvme_be_ramdisk_admin_cmd_admin(struct xnvme_cmd_ctx *ctx, void *dbuf,
-				  size_t XNVME_UNUSED(dbuf_nbytes), void *XNVME_UNUSED(mbuf),
-				  size_t XNVME_UNUSED(mbuf_nbytes))
+_ramdisk_sfeat(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes)
+{
+	switch (ctx->cmd.sfeat.cdw10.fid) {
+	case XNVME_SPEC_FEAT_FDP_MODE:
+	case XNVME_SPEC_FEAT_FDP_EVENTS:
+		return xnvme_be_ramdisk_fdp_sfeat(ctx, dbuf, dbuf_nbytes);
+
+	default:
+		XNVME_DEBUG("FAILED: unsupported fid: %d", ctx->cmd.sfeat.cdw10.fid);
+		return -ENOSYS;
+	}
+}
+
+static int
+_xnvme_be_ramdisk_admin_cmd_admin(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes,
+				  void *XNVME_UNUSED(mbuf), size_t XNVME_UNUSED(mbuf_nbytes))
 {
 	switch (ctx->cmd.common.opcode) {
 	case XNVME_SPEC_ADM_OPC_IDFY:
 		return _idfy(ctx, dbuf);
 
 	case XNVME_SPEC_ADM_OPC_GFEAT:
-		return _ramdisk_gfeat(ctx, dbuf);
+		return _ramdisk_gfeat(ctx, dbuf, dbuf_nbytes);
+
+	case XNVME_SPEC_ADM_OPC_SFEAT:
+		return _ramdisk_sfeat(ctx, dbuf, dbuf_nbytes);
+
+	case XNVME_SPEC_ADM_OPC_LOG:
+		return xnvme_be_ramdisk_fdp_log(ctx, dbuf, dbuf_nbytes);
 
 	default:
 		XNVME_DEBUG("FAILED: ENOSYS opcode: %d", ctx->cmd.common.opcode);
@@ -0,0 +1,835 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700
+#endif
+#include <libxnvme.h>
+#include <xnvme_be.h>
+#include <xnvme_be_nosys.h>
+#ifdef XNVME_BE_RAMDISK_ENABLED
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <xnvme_queue.h>
+#include <xnvme_dev.h>
+#include <xnvme_be_cbi.h>
+#include <xnvme_be_ramdisk.h>
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+#include <sys/timerfd.h>
+#endif
+
+// Environment variables used to configure the offload of large transfers to worker threads
+static const char *g_offload_nbytes_env = "XNVME_BE_RAMDISK_ASYNC_OFFLOAD_NBYTES";
+static const char *g_offload_nthreads_env = "XNVME_BE_RAMDISK_ASYNC_OFFLOAD_NTHREADS";
+static const size_t g_offload_nbytes_def = 128 * 1024;
+static const int g_offload_nthreads_def = 2;
+
+struct ramdisk_request {
+	struct xnvme_cmd_ctx *ctx;
+
+	void *data;
+	uint32_t data_nbytes;
+	uint32_t data_vec_cnt;
+	uint32_t is_vectored;
+
+	void *meta; ///< Separate metadata, only on a ramdisk with metadata
+	uint32_t meta_nbytes;
+};
+
+/**
+ * Reads and writes of at least 'nbytes' are handed to the worker threads, such that the memcpy()
+ * of large transfers is not carried out by the thread submitting them. The hand-off takes a
+ * mutex, which is cheap compared to the copy it carries.
+ */
+struct ramdisk_offload {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond; ///< Signaled when a request is added to 'reqs', or on stop
+	bool stop;
+
+	struct ramdisk_request *reqs; ///< Requests passed to the workers, a ring of 'mask + 1'
+	uint32_t head;
+	uint32_t tail;
+	uint32_t mask;
+
+	struct xnvme_queue_ring *cq; ///< Requests completed by the workers
+	_Atomic uint32_t ninflight; ///< Requests passed to the workers, and not yet completed
+
+	int nthreads;
+	int nstarted;
+	pthread_t threads[];
+};
+
+struct ramdisk_queue {
+	struct xnvme_queue_base base;
+
+	struct xnvme_cmd_ctx **cq; ///< Commands completed at submission, a ring of 'cq_mask + 1'
+	uint32_t cq_head;
+	uint32_t cq_tail;
+	uint32_t cq_mask;
+
+	_Atomic int efd;       ///< Completion event fd, or timer fd with a performance model
+	uint64_t efd_deadline; ///< The deadline the timer fd is armed at, zero when disarmed
+
+	struct ramdisk_offload *offload; ///< Started with the first large transfer
+	size_t offload_nbytes;		 ///< Parsed at init, SIZE_MAX when disabled
+
+	struct xnvme_cmd_ctx **timed; ///< With a performance model; a min-heap on the deadlines
+	uint32_t ntimed;
+
+	int offload_nthreads;
+
+	uint8_t _rsvd[168];
+};
+XNVME_STATIC_ASSERT(sizeof(struct ramdisk_queue) == XNVME_BE_QUEUE_STATE_NBYTES,
+		    "Incorrect size")
+
+/**
+ * With a performance model, the data is moved at submission, or by the offload workers, as
+ * without it, but the completion is held back until the deadline given by the model; the deadline
+ * is stored in the reserved bytes of the command-context, over the pool-link, which is unused
+ * while the command is in flight, as the entry-id before it is needed by e.g. the MPSC staging
+ */
+#define RAMDISK_DEADLINE_OFS \
+	(offsetof(struct xnvme_cmd_ctx_entry, link) - offsetof(struct xnvme_cmd_ctx, be_rsvd))
+XNVME_STATIC_ASSERT(RAMDISK_DEADLINE_OFS + sizeof(uint64_t) <=
+			    sizeof(((struct xnvme_cmd_ctx *)0)->be_rsvd),
+		    "The deadline must fit in the reserved bytes of the command-context")
+
+static inline void
+_ramdisk_deadline_set(struct xnvme_cmd_ctx *ctx, uint64_t deadline)
+{
+	memcpy(&ctx->be_rsvd[RAMDISK_DEADLINE_OFS], &deadline, sizeof(deadline));
+}
+
+static inline uint64_t
+_ramdisk_deadline(const struct xnvme_cmd_ctx *ctx)
+{
+	uint64_t deadline;
+
+	memcpy(&deadline, &ctx->be_rsvd[RAMDISK_DEADLINE_OFS], sizeof(deadline));
+
+	return deadline;
+}
+
+static void
+_ramdisk_timed_push(struct ramdisk_queue *queue, struct xnvme_cmd_ctx *ctx)
+{
+	struct xnvme_cmd_ctx **heap = queue->timed;
+	uint32_t i = queue->ntimed++;
+
+	while (i && (_ramdisk_deadline(heap[(i - 1) / 2]) > _ramdisk_deadline(ctx))) {
+		heap[i] = heap[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	heap[i] = ctx;
+}
+
+static struct xnvme_cmd_ctx *
+_ramdisk_timed_pop(struct ramdisk_queue *queue, uint64_t now)
+{
+	struct xnvme_cmd_ctx **heap = queue->timed;
+	struct xnvme_cmd_ctx *ctx, *last;
+	uint32_t i = 0;
+
+	if (!queue->ntimed || (_ramdisk_deadline(heap[0]) > now)) {
+		return NULL;
+	}
+	ctx = heap[0];
+	last = heap[--queue->ntimed];
+
+	for (;;) {
+		uint32_t child = 2 * i + 1;
+
+		if (child >= queue->ntimed) {
+			break;
+		}
+		if ((child + 1 < queue->ntimed) &&
+		    (_ramdisk_deadline(heap[child + 1]) < _ramdisk_deadline(heap[child]))) {
+			child += 1;
+		}
+		if (_ramdisk_deadline(heap[child]) >= _ramdisk_deadline(last)) {
+			break;
+		}
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = last;
+
+	return ctx;
+}
+
+static int
+_ramdisk_tfd_init(void)
+{
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+	int tfd;
+
+	tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if (tfd < 0) {
+		XNVME_DEBUG("FAILED: timerfd_create(), errno: %d", errno);
+		return -errno;
+	}
+
+	return tfd;
+#else
+	XNVME_DEBUG("FAILED: not implemented(possibly intentional)");
+	return -ENOSYS;
+#endif
+}
+
+/**
+ * Set the timer fd to expire at the given deadline, or disarm it when the deadline is zero;
+ * setting it discards the expirations not yet read
+ */
+static void
+_ramdisk_tfd_settime(int tfd, uint64_t deadline)
+{
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+	struct itimerspec its = {
+		.it_value =
+			{
+				.tv_sec = deadline / 1000000000ULL,
+				.tv_nsec = deadline % 1000000000ULL,
+			},
+	};
+
+	if (timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL)) {
+		XNVME_DEBUG("FAILED: timerfd_settime(), errno: %d", errno);
+	}
+#else
+	(void)tfd;
+	(void)deadline;
+#endif
+}
+
+/**
+ * With a performance model, the completion fd is a timer fd, armed at the earliest deadline of
+ * the commands carried out, such that it is signaled when a command completes by the model; the
+ * offload workers arm it as well, thus, once they are started, it is serialized by their mutex
+ */
+static inline void
+_ramdisk_efd_lock(struct ramdisk_queue *queue)
+{
+	if (queue->offload) {
+		pthread_mutex_lock(&queue->offload->mutex);
+	}
+}
+
+static inline void
+_ramdisk_efd_unlock(struct ramdisk_queue *queue)
+{
+	if (queue->offload) {
+		pthread_mutex_unlock(&queue->offload->mutex);
+	}
+}
+
+/**
+ * Arm the timer fd to expire no later than the given deadline, a deadline of zero, as given to
+ * admin commands, expires at once
+ */
+static void
+_ramdisk_efd_arm(struct ramdisk_queue *queue, uint64_t deadline)
+{
+	int efd = atomic_load_explicit(&queue->efd, memory_order_relaxed);
+
+	deadline = deadline ? deadline : 1;
+	if ((efd < 0) || (queue->efd_deadline && (queue->efd_deadline <= deadline))) {
+		return;
+	}
+
+	_ramdisk_tfd_settime(efd, deadline);
+	queue->efd_deadline = deadline;
+}
+
+/**
+ * Move the commands carried out, at submission or by the offload workers, to the min-heap
+ */
+static void
+_ramdisk_timed_fill(struct ramdisk_queue *queue)
+{
+	struct ramdisk_offload *offload = queue->offload;
+	struct xnvme_cmd_ctx *ctx;
+
+	while (queue->cq_head != queue->cq_tail) {
+		_ramdisk_timed_push(queue, queue->cq[queue->cq_head++ & queue->cq_mask]);
+	}
+	while (offload && (ctx = xnvme_queue_ring_pop(offload->cq))) {
+		_ramdisk_timed_push(queue, ctx);
+	}
+}
+
+/**
+ * Re-arm the timer fd at the earliest deadline in the min-heap, or disarm it when the heap is
+ * empty; the completions of the offload workers are moved to the heap first, as the lock keeps
+ * the workers from arming the timer in between
+ */
+static void
+_ramdisk_efd_rearm(struct ramdisk_queue *queue, uint64_t now)
+{
+	uint64_t deadline = 0;
+
+	if (queue->efd < 0) {
+		return;
+	}
+
+	_ramdisk_efd_lock(queue);
+	_ramdisk_timed_fill(queue);
+	if (queue->ntimed) {
+		deadline = _ramdisk_deadline(queue->timed[0]);
+		deadline = deadline ? deadline : 1;
+	}
+	// An expired timer is set again, as its expiration may have been read already
+	if ((deadline != queue->efd_deadline) || (deadline && (deadline <= now))) {
+		_ramdisk_tfd_settime(queue->efd, deadline);
+		queue->efd_deadline = deadline;
+	}
+	_ramdisk_efd_unlock(queue);
+}
+
+static void
+_ramdisk_exec(struct xnvme_cmd_ctx *ctx, struct ramdisk_request *req)
+{
+	int err;
+
+	memset(&ctx->cpl, 0, sizeof(ctx->cpl));
+
+	if (req->is_vectored) {
+		err = xnvme_be_ramdisk_sync_cmd_iov(ctx, req->data, req->data_vec_cnt,
+						    req->data_nbytes, req->meta, req->meta_nbytes);
+	} else {
+		err = xnvme_be_ramdisk_sync_cmd_io(ctx, req->data, req->data_nbytes, req->meta,
+						   req->meta_nbytes);
+	}
+	///< A zoned ramdisk fills in the status of rejected commands, keep it when set
+	if (err) {
+		XNVME_DEBUG("FAILED: ramdisk_sync_cmd_io{v}(), err: %d", err);
+		if (!ctx->cpl.status.sc) {
+			ctx->cpl.status.sc = -err;
+			ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_VENDOR;
+		}
+	}
+}
+
+static void *
+_ramdisk_offload_worker(void *arg)
+{
+	struct ramdisk_queue *queue = arg;
+	struct ramdisk_offload *offload = queue->offload;
+
+	for (;;) {
+		struct ramdisk_request req;
+		uint64_t deadline;
+
+		pthread_mutex_lock(&offload->mutex);
+		while (!offload->stop && (offload->head == offload->tail)) {
+			pthread_cond_wait(&offload->cond, &offload->mutex);
+		}
+		if (offload->head == offload->tail) {
+			pthread_mutex_unlock(&offload->mutex);
+			break;
+		}
+		req = offload->reqs[offload->head++ & offload->mask];
+		pthread_mutex_unlock(&offload->mutex);
+
+		_ramdisk_exec(req.ctx, &req);
+
+		// The command-context may be completed, and reused, as soon as it is pushed
+		deadline = _ramdisk_deadline(req.ctx);
+
+		// NOTE: cannot fail, as 'cq' has room for all the requests of the queue
+		xnvme_queue_ring_push(offload->cq, req.ctx);
+		atomic_thread_fence(memory_order_seq_cst);
+
+		if (queue->timed) {
+			pthread_mutex_lock(&offload->mutex);
+			_ramdisk_efd_arm(queue, deadline);
+			pthread_mutex_unlock(&offload->mutex);
+		} else {
+			xnvme_be_cbi_async_efd_signal(
+				atomic_load_explicit(&queue->efd, memory_order_relaxed));
+		}
+
+		atomic_fetch_sub_explicit(&offload->ninflight, 1, memory_order_release);
+	}
+
+	return NULL;
+}
+
+static void
+_ramdisk_offload_term(struct ramdisk_queue *queue)
+{
+	struct ramdisk_offload *offload = queue->offload;
+
+	if (!offload) {
+		return;
+	}
+
+	pthread_mutex_lock(&offload->mutex);
+	offload->stop = true;
+	pthread_cond_broadcast(&offload->cond);
+	pthread_mutex_unlock(&offload->mutex);
+
+	for (int i = 0; i < offload->nstarted; ++i) {
+		pthread_join(offload->threads[i], NULL);
+	}
+
+	pthread_mutex_destroy(&offload->mutex);
+	pthread_cond_destroy(&offload->cond);
+	free(offload->cq);
+	free(offload->reqs);
+	free(offload);
+
+	queue->offload = NULL;
+}
+
+static int
+_ramdisk_offload_init(struct ramdisk_queue *queue, int nthreads)
+{
+	struct ramdisk_offload *offload;
+	int err;
+
+	offload = calloc(1, sizeof(*offload) + nthreads * sizeof(*offload->threads));
+	if (!offload) {
+		XNVME_DEBUG("FAILED: calloc(offload)");
+		return -ENOMEM;
+	}
+	queue->offload = offload;
+
+	pthread_mutex_init(&offload->mutex, NULL);
+	pthread_cond_init(&offload->cond, NULL);
+	atomic_init(&offload->ninflight, 0);
+	offload->nthreads = nthreads;
+	offload->mask = queue->cq_mask;
+
+	offload->reqs = calloc(offload->mask + 1, sizeof(*offload->reqs));
+	offload->cq = xnvme_queue_ring_alloc(offload->mask + 1);
+	if (!(offload->reqs && offload->cq)) {
+		XNVME_DEBUG("FAILED: calloc(reqs) / xnvme_queue_ring_alloc()");
+		_ramdisk_offload_term(queue);
+		return -ENOMEM;
+	}
+
+	for (int i = 0; i < nthreads; ++i) {
+		err = pthread_create(&offload->threads[i], NULL, _ramdisk_offload_worker, queue);
+		if (err) {
+			XNVME_DEBUG("FAILED: pthread_create(), err: %d", err);
+			_ramdisk_offload_term(queue);
+			return -err;
+		}
+		offload->nstarted += 1;
+	}
+
+	return 0;
+}
+
+static int
+ramdisk_async_term(struct xnvme_queue *q)
+{
+	struct ramdisk_queue *queue = (void *)q;
+	int efd = queue->efd;
+
+	// Requests still held by the workers refer to the queue; wait for them to complete
+	while (queue->offload &&
+	       atomic_load_explicit(&queue->offload->ninflight, memory_order_acquire)) {
+		xnvme_queue_yield();
+	}
+	_ramdisk_offload_term(queue);
+
+	xnvme_be_cbi_async_efd_term(&efd);
+	queue->efd = -1;
+
+	free(queue->timed);
+	queue->timed = NULL;
+	free(queue->cq);
+	queue->cq = NULL;
+
+	return 0;
+}
+
+static int
+ramdisk_async_init(struct xnvme_queue *q, int XNVME_UNUSED(opts))
+{
+	struct ramdisk_queue *queue = (void *)q;
+	uint32_t nslots = 1;
+	const char *env;
+
+	atomic_init(&queue->efd, -1);
+
+	queue->offload_nbytes = g_offload_nbytes_def;
+	queue->offload_nthreads = g_offload_nthreads_def;
+	if ((env = getenv(g_offload_nthreads_env))) {
+		queue->offload_nthreads = atoi(env);
+	}
+	if ((env = getenv(g_offload_nbytes_env))) {
+		queue->offload_nbytes = strtoull(env, NULL, 10);
+	}
+	if ((queue->offload_nthreads <= 0) || (queue->offload_nthreads >= 1024)) {
+		queue->offload_nbytes = SIZE_MAX;
+	}
+
+	while (nslots < queue->base.capacity) {
+		nslots <<= 1;
+	}
+	queue->cq = calloc(nslots, sizeof(*queue->cq));
+	if (!queue->cq) {
+		XNVME_DEBUG("FAILED: calloc(cq)");
+		return -ENOMEM;
+	}
+	queue->cq_mask = nslots - 1;
+
+	if (((struct xnvme_be_ramdisk_state *)q->base.dev->be.state)->model) {
+		queue->timed = calloc(nslots, sizeof(*queue->timed));
+		if (!queue->timed) {
+			XNVME_DEBUG("FAILED: calloc(timed)");
+			free(queue->cq);
+			queue->cq = NULL;
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Store the command-context, carried out at submission, in the completion ring; the completion
+ * event fd is signaled when the ring goes from empty to non-empty, and by a poke leaving
+ * completions behind. With a performance model, the timer fd is armed at its deadline instead.
+ */
+static inline void
+_ramdisk_cq_push(struct ramdisk_queue *queue, struct xnvme_cmd_ctx *ctx)
+{
+	bool signal = queue->cq_head == queue->cq_tail;
+
+	queue->cq[queue->cq_tail++ & queue->cq_mask] = ctx;
+
+	if (queue->timed) {
+		if (queue->efd >= 0) {
+			_ramdisk_efd_lock(queue);
+			_ramdisk_efd_arm(queue, _ramdisk_deadline(ctx));
+			_ramdisk_efd_unlock(queue);
+		}
+	} else if (signal) {
+		xnvme_be_cbi_async_efd_signal(queue->efd);
+	}
+}
+
+/**
+ * Hand the request to the worker threads, starting them with the first request; on error, the
+ * request is carried out by the caller
+ */
+static int
+_ramdisk_offload(struct ramdisk_queue *queue, struct ramdisk_request *req)
+{
+	struct ramdisk_offload *offload = queue->offload;
+
+	if (req->data_nbytes < queue->offload_nbytes) {
+		return -ENOTSUP;
+	}
+	if (!offload) {
+		int err;
+
+		err = _ramdisk_offload_init(queue, queue->offload_nthreads);
+		if (err) {
+			XNVME_DEBUG("FAILED: _ramdisk_offload_init(), err: %d", err);
+			queue->offload_nbytes = SIZE_MAX;
+			return err;
+		}
+		offload = queue->offload;
+	}
+
+	atomic_fetch_add_explicit(&offload->ninflight, 1, memory_order_relaxed);
+
+	pthread_mutex_lock(&offload->mutex);
+	offload->reqs[offload->tail++ & offload->mask] = *req;
+	pthread_cond_signal(&offload->cond);
+	pthread_mutex_unlock(&offload->mutex);
+
+	return 0;
+}
+
+static int
+_ramdisk_submit(struct ramdisk_queue *queue, struct ramdisk_request *req)
+{
+	struct xnvme_cmd_ctx *ctx = req->ctx;
+	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
+
+	queue->base.outstanding += 1;
+
+	if (queue->timed) {
+		_ramdisk_deadline_set(ctx, xnvme_be_ramdisk_model_deadline(state->model, ctx,
+									    req->data_nbytes));
+	}
+
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_NVM_OPC_READ:
+	case XNVME_SPEC_NVM_OPC_WRITE:
+	case XNVME_SPEC_FS_OPC_READ:
+	case XNVME_SPEC_FS_OPC_WRITE:
+		if (!_ramdisk_offload(queue, req)) {
+			return 0;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	_ramdisk_exec(ctx, req);
+	_ramdisk_cq_push(queue, ctx);
+
+	return 0;
+}
+
+static inline int
+ramdisk_async_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+		     size_t mbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
+	struct ramdisk_request req = {
+		.ctx = ctx,
+		.data = dbuf,
+		.data_nbytes = dbuf_nbytes,
+		.meta = mbuf,
+		.meta_nbytes = mbuf_nbytes,
+	};
+
+	if ((mbuf || mbuf_nbytes) && !state->meta) {
+		XNVME_DEBUG("FAILED: mbuf or mbuf_nbytes provided");
+		return -ENOTSUP;
+	}
+
+	return _ramdisk_submit((void *)ctx->async.queue, &req);
+}
+
+static inline int
+ramdisk_async_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+		      size_t dvec_nbytes, void *mbuf, size_t mbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
+	struct ramdisk_request req = {
+		.ctx = ctx,
+		.data = dvec,
+		.data_nbytes = dvec_nbytes,
+		.data_vec_cnt = dvec_cnt,
+		.is_vectored = true,
+		.meta = mbuf,
+		.meta_nbytes = mbuf_nbytes,
+	};
+
+	if ((mbuf || mbuf_nbytes) && !state->meta) {
+		XNVME_DEBUG("FAILED: mbuf or mbuf_nbytes provided");
+		return -ENOTSUP;
+	}
+
+	return _ramdisk_submit((void *)ctx->async.queue, &req);
+}
+
+static inline int
+ramdisk_async_cmd_admin(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+			size_t mbuf_nbytes)
+{
+	struct ramdisk_queue *queue = (void *)ctx->async.queue;
+	int err;
+
+	memset(&ctx->cpl, 0, sizeof(ctx->cpl));
+
+	err = ctx->dev->be.admin.cmd_admin(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+	if (err) {
+		XNVME_DEBUG("FAILED: admin.cmd_admin(), err: %d", err);
+		ctx->cpl.status.sc = ctx->cpl.status.sc ? ctx->cpl.status.sc : -err;
+		ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_VENDOR;
+	}
+
+	queue->base.outstanding += 1;
+	_ramdisk_deadline_set(ctx, 0);
+	_ramdisk_cq_push(queue, ctx);
+
+	return 0;
+}
+
+/**
+ * Process up to 'max' completions; with 'ctxs' given, the completed command-contexts are stored
+ * in it, otherwise their callbacks are invoked
+ */
+static inline int
+ramdisk_async_complete(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
+{
+	struct ramdisk_queue *queue = (void *)q;
+	struct ramdisk_offload *offload = queue->offload;
+	unsigned completed = 0;
+	uint64_t now = 0;
+
+	max = max ? max : queue->base.outstanding;
+	max = max > queue->base.outstanding ? queue->base.outstanding : max;
+
+	// With a performance model, everything carried out waits for its deadline in the heap
+	if (queue->timed) {
+		_ramdisk_timed_fill(queue);
+		now = _xnvme_timer_clock_sample();
+	}
+
+	while (completed < max) {
+		struct xnvme_cmd_ctx *ctx = NULL;
+
+		if (queue->timed) {
+			ctx = _ramdisk_timed_pop(queue, now);
+		} else if (queue->cq_head != queue->cq_tail) {
+			ctx = queue->cq[queue->cq_head++ & queue->cq_mask];
+		} else if (offload) {
+			ctx = xnvme_queue_ring_pop(offload->cq);
+		}
+		if (!ctx) {
+			break;
+		}
+
+		if (ctxs) {
+			ctxs[completed] = ctx;
+		} else {
+			ctx->async.cb(ctx, ctx->async.cb_arg);
+		}
+		completed++;
+	}
+
+	queue->base.outstanding -= completed;
+
+	// The timer fd of the model expires at the next deadline, completions left behind included
+	if (queue->timed) {
+		_ramdisk_efd_rearm(queue, now);
+		return completed;
+	}
+
+	// Stopped by 'max', the signals of the completions left behind are already consumed
+	if ((completed == max) && ((queue->cq_head != queue->cq_tail) ||
+				   (offload && xnvme_queue_ring_count(offload->cq)))) {
+		xnvme_be_cbi_async_efd_signal(queue->efd);
+	}
+
+	return completed;
+}
+
+static int
+ramdisk_async_poke(struct xnvme_queue *q, uint32_t max)
+{
+	return ramdisk_async_complete(q, NULL, max);
+}
+
+static int
+ramdisk_async_reap(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
+{
+	return ramdisk_async_complete(q, ctxs, max);
+}
+
+/**
+ * Poke the queue until at least 'min' commands are completed, or until 'timeout_ns' has passed;
+ * in between, the thread sleeps until the earliest deadline of the performance model, and yields
+ * while transfers are carried out by the offload workers, as their deadlines are not yet known
+ */
+static int
+ramdisk_async_wait(struct xnvme_queue *q, uint32_t min, uint64_t timeout_ns)
+{
+	struct ramdisk_queue *queue = (void *)q;
+	uint64_t deadline = 0;
+	uint32_t completed = 0;
+
+	min = min > queue->base.outstanding ? queue->base.outstanding : min;
+	if (timeout_ns) {
+		deadline = _xnvme_timer_clock_sample() + timeout_ns;
+	}
+
+	for (;;) {
+		struct ramdisk_offload *offload = queue->offload;
+		uint64_t next;
+
+		completed += ramdisk_async_complete(q, NULL, 0);
+		if ((completed >= min) || !queue->base.outstanding) {
+			break;
+		}
+		if (deadline && (_xnvme_timer_clock_sample() >= deadline)) {
+			break;
+		}
+
+		if (!queue->ntimed ||
+		    (offload && atomic_load_explicit(&offload->ninflight, memory_order_acquire))) {
+			xnvme_queue_yield();
+			continue;
+		}
+
+		next = _ramdisk_deadline(queue->timed[0]);
+		xnvme_be_ramdisk_model_wait(deadline && (deadline < next) ? deadline : next);
+	}
+
+	return completed;
+}
+
+/**
+ * The workers signal the event fd once they see it, thus, completions pushed before that are
+ * covered by signaling it on creation; likewise, the timer fd of a performance model expires at
+ * once on creation, and is then re-armed at the next deadline by the poke
+ */
+static int
+ramdisk_async_get_completion_fd(struct xnvme_queue *q)
+{
+	struct ramdisk_queue *queue = (void *)q;
+	int efd = queue->efd;
+
+	if (efd >= 0) {
+		return efd;
+	}
+
+	if (queue->timed) {
+		efd = _ramdisk_tfd_init();
+		if (efd < 0) {
+			return efd;
+		}
+
+		_ramdisk_efd_lock(queue);
+		atomic_store_explicit(&queue->efd, efd, memory_order_relaxed);
+		queue->efd_deadline = 0;
+		if (queue->base.outstanding) {
+			_ramdisk_efd_arm(queue, 0);
+		}
+		_ramdisk_efd_unlock(queue);
+
+		return efd;
+	}
+
+	efd = xnvme_be_cbi_async_efd_init(&efd);
+	if (efd < 0) {
+		return efd;
+	}
+	atomic_store_explicit(&queue->efd, efd, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if (queue->base.outstanding) {
+		xnvme_be_cbi_async_efd_signal(efd);
+	}
+
+	return efd;
+}
+#endif
+
+struct xnvme_be_async g_xnvme_be_ramdisk_async = {
+	.id = "ramdisk",
+#ifdef XNVME_BE_RAMDISK_ENABLED
+	.cmd_io = ramdisk_async_cmd_io,
+	.cmd_iov = ramdisk_async_cmd_iov,
+	.cmd_admin = ramdisk_async_cmd_admin,
+	.poke = ramdisk_async_poke,
+	.reap = ramdisk_async_reap,
+	.wait = ramdisk_async_wait,
+	.init = ramdisk_async_init,
+	.term = ramdisk_async_term,
+	.get_completion_fd = ramdisk_async_get_completion_fd,
+#else
+	.cmd_io = xnvme_be_nosys_queue_cmd_io,
+	.cmd_iov = xnvme_be_nosys_queue_cmd_iov,
+	.poke = xnvme_be_nosys_queue_poke,
+	.wait = xnvme_be_nosys_queue_wait,
+	.init = xnvme_be_nosys_queue_init,
+	.term = xnvme_be_nosys_queue_term,
+	.get_completion_fd = xnvme_be_nosys_queue_get_completion_fd,
+#endif
+};
@@ -2,33 +2,503 @@
 //
 // SPDX-License-Identifier: BSD-3-Clause
 
-#ifndef _XOPEN_SOURCE
-#define _XOPEN_SOURCE 700
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
 #endif
 #include <libxnvme.h>
 #include <xnvme_be.h>
 #include <xnvme_be_nosys.h>
-#ifdef XNVME_BE_RAMDISK_ENABLED
 #include <errno.h>
+#include <xnvme_be_ramdisk.h>
+
+/**
+ * The multipliers are binary regardless of the 'i', as the ramdisk has always read "1GB" as 1GiB
+ */
+static const struct {
+	const char *unit;
+	size_t multiplier;
+} g_units[] = {
+	{"", 1ULL},
+	{"B", 1ULL},
+	{"K", 1ULL << 10},
+	{"KB", 1ULL << 10},
+	{"KiB", 1ULL << 10},
+	{"M", 1ULL << 20},
+	{"MB", 1ULL << 20},
+	{"MiB", 1ULL << 20},
+	{"G", 1ULL << 30},
+	{"GB", 1ULL << 30},
+	{"GiB", 1ULL << 30},
+	{"T", 1ULL << 40},
+	{"TB", 1ULL << 40},
+	{"TiB", 1ULL << 40},
+};
+
+/**
+ * Parse the 'len' characters at 'str' as "<count>[<unit>]", a non-zero number of bytes
+ */
+static int
+_ramdisk_parse_size(const char *str, size_t len, size_t *nbytes)
+{
+	unsigned long long count;
+	size_t multiplier = 0;
+	const char *unit;
+	size_t unit_len;
+
+	if (!len || (str[0] < '0') || (str[0] > '9')) {
+		return -EINVAL;
+	}
+
+	errno = 0;
+	count = strtoull(str, (char **)&unit, 10);
+	if (errno || (unit > str + len)) {
+		return -EINVAL;
+	}
+	unit_len = len - (unit - str);
+
+	for (size_t i = 0; i < sizeof(g_units) / sizeof(*g_units); ++i) {
+		if ((strlen(g_units[i].unit) == unit_len) &&
+		    !strncmp(unit, g_units[i].unit, unit_len)) {
+			multiplier = g_units[i].multiplier;
+			break;
+		}
+	}
+	if (!multiplier || (count > SIZE_MAX / multiplier)) {
+		return -EINVAL;
+	}
+	*nbytes = count * multiplier;
+
+	return *nbytes ? 0 : -EINVAL;
+}
+
+static int
+_ramdisk_parse_count(const char *str, size_t len, uint32_t *count)
+{
+	unsigned long val;
+	char *end;
+
+	if (!len || (str[0] < '0') || (str[0] > '9')) {
+		return -EINVAL;
+	}
+
+	errno = 0;
+	val = strtoul(str, &end, 10);
+	if (errno || (end != str + len) || (val > UINT32_MAX)) {
+		return -EINVAL;
+	}
+	*count = val;
+
+	return 0;
+}
+
+static int
+_ramdisk_parse_opt(const char *opt, size_t len, struct xnvme_be_ramdisk_params *params)
+{
+	if ((len == 6) && !strncmp(opt, "sparse", len)) {
+		params->flags |= XNVME_BE_RAMDISK_SPARSE;
+	} else if ((len == 8) && !strncmp(opt, "hugepage", len)) {
+		params->flags |= XNVME_BE_RAMDISK_HUGEPAGE;
+	} else if ((len > 5) && (len - 5 < sizeof(params->path)) && !strncmp(opt, "file=", 5)) {
+		params->flags |= XNVME_BE_RAMDISK_FILE;
+		memcpy(params->path, opt + 5, len - 5);
+		params->path[len - 5] = '\0';
+	} else if ((len == 5) && !strncmp(opt, "zoned", len)) {
+		params->flags |= XNVME_BE_RAMDISK_ZONED;
+	} else if ((len > 5) && !strncmp(opt, "zsze=", 5)) {
+		return _ramdisk_parse_size(opt + 5, len - 5, &params->zsze);
+	} else if ((len > 5) && !strncmp(opt, "zcap=", 5)) {
+		return _ramdisk_parse_size(opt + 5, len - 5, &params->zcap);
+	} else if ((len > 4) && !strncmp(opt, "mor=", 4)) {
+		return _ramdisk_parse_count(opt + 4, len - 4, &params->mor);
+	} else if ((len > 4) && !strncmp(opt, "mar=", 4)) {
+		return _ramdisk_parse_count(opt + 4, len - 4, &params->mar);
+	} else if ((len > 5) && !strncmp(opt, "rlat=", 5)) {
+		params->flags |= XNVME_BE_RAMDISK_MODEL;
+		return _ramdisk_parse_count(opt + 5, len - 5, &params->rlat);
+	} else if ((len > 5) && !strncmp(opt, "wlat=", 5)) {
+		params->flags |= XNVME_BE_RAMDISK_MODEL;
+		return _ramdisk_parse_count(opt + 5, len - 5, &params->wlat);
+	} else if ((len > 5) && !strncmp(opt, "olat=", 5)) {
+		params->flags |= XNVME_BE_RAMDISK_MODEL;
+		return _ramdisk_parse_count(opt + 5, len - 5, &params->olat);
+	} else if ((len > 3) && !strncmp(opt, "bw=", 3)) {
+		params->flags |= XNVME_BE_RAMDISK_MODEL;
+		return _ramdisk_parse_size(opt + 3, len - 3, &params->bw);
+	} else if ((len > 4) && !strncmp(opt, "nch=", 4)) {
+		params->flags |= XNVME_BE_RAMDISK_MODEL;
+		return _ramdisk_parse_count(opt + 4, len - 4, &params->nch);
+	} else if ((len > 4) && !strncmp(opt, "waf=", 4)) {
+		params->flags |= XNVME_BE_RAMDISK_MODEL;
+		return _ramdisk_parse_count(opt + 4, len - 4, &params->waf);
+	} else if ((len > 6) && !strncmp(opt, "lbads=", 6)) {
+		return _ramdisk_parse_size(opt + 6, len - 6, &params->lbads);
+	} else if ((len > 3) && !strncmp(opt, "ms=", 3)) {
+		return _ramdisk_parse_count(opt + 3, len - 3, &params->ms);
+	} else if ((len == 8) && !strncmp(opt, "extended", len)) {
+		params->flags |= XNVME_BE_RAMDISK_EXTENDED;
+	} else if ((len > 3) && !strncmp(opt, "pi=", 3)) {
+		return _ramdisk_parse_count(opt + 3, len - 3, &params->pit);
+	} else if ((len == 6) && !strncmp(opt, "pif=16", len)) {
+		params->pif = XNVME_SPEC_NVM_NS_16B_GUARD;
+	} else if ((len == 6) && !strncmp(opt, "pif=64", len)) {
+		params->pif = XNVME_SPEC_NVM_NS_64B_GUARD;
+	} else if ((len == 7) && !strncmp(opt, "pifirst", len)) {
+		params->flags |= XNVME_BE_RAMDISK_PI_FIRST;
+	} else if ((len == 3) && !strncmp(opt, "fdp", len)) {
+		params->flags |= XNVME_BE_RAMDISK_FDP;
+	} else if ((len > 4) && !strncmp(opt, "nrg=", 4)) {
+		return _ramdisk_parse_count(opt + 4, len - 4, &params->nrg);
+	} else if ((len > 5) && !strncmp(opt, "nruh=", 5)) {
+		return _ramdisk_parse_count(opt + 5, len - 5, &params->nruh);
+	} else if ((len > 5) && !strncmp(opt, "runs=", 5)) {
+		return _ramdisk_parse_size(opt + 5, len - 5, &params->runs);
+	} else if ((len > 3) && !strncmp(opt, "op=", 3)) {
+		return _ramdisk_parse_count(opt + 3, len - 3, &params->op);
+	} else if ((len == 2) && !strncmp(opt, "kv", len)) {
+		params->flags |= XNVME_BE_RAMDISK_KV;
+	} else if ((len > 6) && !strncmp(opt, "nkeys=", 6)) {
+		return _ramdisk_parse_count(opt + 6, len - 6, &params->nkeys);
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * The LBA data size is a power of two of at least 512 bytes, dividing the capacity; the metadata
+ * options are only taken along with metadata, and protection information must fit in it
+ */
+static int
+_ramdisk_check_format(struct xnvme_be_ramdisk_params *params)
+{
+	if (!params->lbads) {
+		params->lbads = XNVME_BE_RAMDISK_LBA_NBYTES;
+	}
+	if ((params->lbads < XNVME_BE_RAMDISK_LBA_NBYTES) || (params->lbads > (64ULL << 10)) ||
+	    (params->lbads & (params->lbads - 1)) || (params->nbytes % params->lbads)) {
+		return -EINVAL;
+	}
+
+	if (!params->ms) {
+		return ((params->flags & XNVME_BE_RAMDISK_EXTENDED) || params->pit) ? -EINVAL : 0;
+	}
+	if (params->ms > UINT16_MAX) {
+		return -EINVAL;
+	}
+
+	if (!params->pit) {
+		return (params->pif || (params->flags & XNVME_BE_RAMDISK_PI_FIRST)) ? -EINVAL : 0;
+	}
+	if ((params->pit > 3) || (params->ms < xnvme_pi_size(params->pif))) {
+		return -EINVAL;
+	}
+
+	// The geometry of a zoned namespace does not carry protection information
+	return (params->flags & XNVME_BE_RAMDISK_ZONED) ? -EINVAL : 0;
+}
+
+/**
+ * Zone options are only taken along with 'zoned'; the zone size defaults to 16MiB, the capacity
+ * to the size, and the ramdisk must hold at least one zone
+ */
+static int
+_ramdisk_check_zoned(struct xnvme_be_ramdisk_params *params)
+{
+	if (!(params->flags & XNVME_BE_RAMDISK_ZONED)) {
+		return (params->zsze || params->zcap || params->mor || params->mar) ? -EINVAL : 0;
+	}
+
+	if (!params->zsze) {
+		params->zsze = XNVME_BE_RAMDISK_ZSZE_NBYTES;
+	}
+	if (!params->zcap) {
+		params->zcap = params->zsze;
+	}
+	if ((params->zsze % params->lbads) || (params->zcap % params->lbads) ||
+	    (params->zcap > params->zsze) || (params->zsze > params->nbytes)) {
+		return -EINVAL;
+	}
+	if (params->mar && (params->mor > params->mar)) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * FDP options are only taken along with 'fdp'; a reclaim group holds at least one reclaim unit,
+ * and the reclaim group and placement handle must fit in the 16 bits of a placement identifier
+ */
+static int
+_ramdisk_check_fdp(struct xnvme_be_ramdisk_params *params)
+{
+	if (!(params->flags & XNVME_BE_RAMDISK_FDP)) {
+		if (params->nrg || params->nruh || params->runs || (params->op != UINT32_MAX)) {
+			return -EINVAL;
+		}
+		return 0;
+	}
+
+	if (!params->nrg) {
+		params->nrg = 1;
+	}
+	if (!params->nruh) {
+		params->nruh = XNVME_BE_RAMDISK_NRUH;
+	}
+	if (!params->runs) {
+		params->runs = XNVME_BE_RAMDISK_RUNS_NBYTES;
+	}
+	if (params->op == UINT32_MAX) {
+		params->op = XNVME_BE_RAMDISK_OP;
+	}
+	if ((params->op > 100) || (params->nrg > XNVME_BE_RAMDISK_NRG_MAX) ||
+	    (params->nruh > XNVME_BE_RAMDISK_NRUH_MAX) || (params->runs % params->lbads) ||
+	    (params->runs > params->nbytes / params->nrg)) {
+		return -EINVAL;
+	}
+
+	// Reclaim units are not zones, the two do not combine
+	return (params->flags & XNVME_BE_RAMDISK_ZONED) ? -EINVAL : 0;
+}
+
+/**
+ * The 'nkeys' option is only taken along with 'kv', which defaults it to one per 4KiB of capacity;
+ * a Key-Value namespace has no LBAs, thus, none of the LBA options, nor a memory backing, apply
+ */
+static int
+_ramdisk_check_kv(struct xnvme_be_ramdisk_params *params)
+{
+	const uint32_t excluded = XNVME_BE_RAMDISK_MEM_FLAGS | XNVME_BE_RAMDISK_ZONED |
+				  XNVME_BE_RAMDISK_FDP;
+
+	if (!(params->flags & XNVME_BE_RAMDISK_KV)) {
+		return params->nkeys ? -EINVAL : 0;
+	}
+
+	if (!params->nkeys) {
+		params->nkeys = XNVME_MIN_U64(params->nbytes / XNVME_BE_RAMDISK_KV_NBYTES,
+					      XNVME_BE_RAMDISK_KV_NKEYS_MAX);
+		params->nkeys = params->nkeys ? params->nkeys : 1;
+	}
+	if ((params->nkeys > XNVME_BE_RAMDISK_KV_NKEYS_MAX) || (params->flags & excluded) ||
+	    params->ms || (params->lbads != XNVME_BE_RAMDISK_LBA_NBYTES)) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int
+xnvme_be_ramdisk_parse_uri(const char *uri, struct xnvme_be_ramdisk_params *params)
+{
+	const char *opt;
+
+	memset(params, 0, sizeof(*params));
+	// Zero is a valid over-provisioning, thus, unset is all bits set
+	params->op = UINT32_MAX;
+
+	opt = strchr(uri, ',');
+	if (_ramdisk_parse_size(uri, opt ? (size_t)(opt - uri) : strlen(uri), &params->nbytes)) {
+		return -EINVAL;
+	}
+
+	while (opt) {
+		const char *next = strchr(++opt, ',');
+		size_t len = next ? (size_t)(next - opt) : strlen(opt);
+
+		if (_ramdisk_parse_opt(opt, len, params)) {
+			return -EINVAL;
+		}
+		opt = next;
+	}
+
+	if ((params->flags & XNVME_BE_RAMDISK_HUGEPAGE) &&
+	    (params->flags & XNVME_BE_RAMDISK_FILE)) {
+		return -EINVAL;
+	}
+	if ((params->flags & XNVME_BE_RAMDISK_MODEL) && !params->nch) {
+		params->nch = 1;
+	}
+	if (_ramdisk_check_format(params) || _ramdisk_check_fdp(params) ||
+	    _ramdisk_check_kv(params)) {
+		return -EINVAL;
+	}
+
+	return _ramdisk_check_zoned(params);
+}
+
+bool
+xnvme_be_ramdisk_classify_uri(const char *uri)
+{
+	struct xnvme_be_ramdisk_params params;
+	const char *opt = strchr(uri, ',');
+	size_t len = opt ? (size_t)(opt - uri) : strlen(uri);
+
+	// A bare number of bytes might as well name e.g. a file, thus, it is not classified
+	if (!len || (uri[len - 1] >= '0' && uri[len - 1] <= '9')) {
+		return false;
+	}
+
+	return !xnvme_be_ramdisk_parse_uri(uri, &params);
+}
+
+#ifdef XNVME_BE_RAMDISK_ENABLED
 #include <unistd.h>
 #include <fcntl.h>
-#include <xnvme_be_ramdisk.h>
 #include <xnvme_dev.h>
 #include <xnvme_be_cbi.h>
+#ifndef XNVME_PLATFORM_WINDOWS_ENABLED
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+#endif
 
-void
-xnvme_be_ramdisk_dev_close(struct xnvme_dev *dev)
+/**
+ * The metadata of the LBAs is kept in the memory backing the ramdisk, following their data
+ */
+static size_t
+_ramdisk_map_nbytes(const struct xnvme_be_ramdisk_params *params)
+{
+	return params->nbytes + (params->nbytes / params->lbads) * params->ms;
+}
+
+#ifdef XNVME_PLATFORM_WINDOWS_ENABLED
+static int
+_ramdisk_map(struct xnvme_be_ramdisk_state *state, const struct xnvme_be_ramdisk_params *params)
 {
-	struct xnvme_be_ramdisk_state *state;
+	if (params->flags & XNVME_BE_RAMDISK_MEM_FLAGS) {
+		XNVME_DEBUG("FAILED: ramdisk memory options are not supported on this platform");
+		return -ENOTSUP;
+	}
 
-	if (!dev) {
-		return;
+	state->ramdisk = malloc(_ramdisk_map_nbytes(params));
+	if (!state->ramdisk) {
+		XNVME_DEBUG("FAILED: malloc(ramdisk), errno: %d", errno);
+		return -errno;
+	}
+
+	return 0;
+}
+#else
+/**
+ * Open the file, or the hugetlb memfd, backing the ramdisk and grow it to hold the data and
+ * metadata of the LBAs; files are grown by ftruncate(), thus sparse, and content beyond that is
+ * left untouched
+ */
+static int
+_ramdisk_open_fd(struct xnvme_be_ramdisk_state *state,
+		 const struct xnvme_be_ramdisk_params *params, size_t *mapped)
+{
+	struct stat st;
+
+	if (params->flags & XNVME_BE_RAMDISK_HUGEPAGE) {
+#if defined(XNVME_PLATFORM_LINUX_ENABLED) && defined(MFD_HUGETLB)
+		state->fd = memfd_create("xnvme_ramdisk", MFD_CLOEXEC | MFD_HUGETLB);
+#else
+		XNVME_DEBUG("FAILED: 'hugepage' is not supported on this platform");
+		return -ENOTSUP;
+#endif
+	} else {
+		state->fd = open(params->path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	}
+	if (state->fd < 0) {
+		XNVME_DEBUG("FAILED: open()/memfd_create(), errno: %d", errno);
+		return -errno;
 	}
 
-	state = (void *)dev->be.state;
+	if (fstat(state->fd, &st)) {
+		XNVME_DEBUG("FAILED: fstat(), errno: %d", errno);
+		return -errno;
+	}
+
+	// hugetlbfs reports the hugepage size as block size, and only takes lengths aligned to it
+	*mapped = _ramdisk_map_nbytes(params);
+	if (params->flags & XNVME_BE_RAMDISK_HUGEPAGE) {
+		*mapped = ((*mapped + st.st_blksize - 1) / st.st_blksize) * st.st_blksize;
+	}
+
+	if ((size_t)st.st_size < *mapped && ftruncate(state->fd, *mapped)) {
+		XNVME_DEBUG("FAILED: ftruncate(%zu), errno: %d", *mapped, errno);
+		return -errno;
+	}
+
+	return 0;
+}
+
+static int
+_ramdisk_map(struct xnvme_be_ramdisk_state *state, const struct xnvme_be_ramdisk_params *params)
+{
+	int flags = (params->flags & XNVME_BE_RAMDISK_SPARSE) ? MAP_NORESERVE : 0;
+	size_t mapped = _ramdisk_map_nbytes(params);
+	void *ramdisk;
+	int err;
+
+	if (params->flags & (XNVME_BE_RAMDISK_HUGEPAGE | XNVME_BE_RAMDISK_FILE)) {
+		err = _ramdisk_open_fd(state, params, &mapped);
+		if (err) {
+			XNVME_DEBUG("FAILED: _ramdisk_open_fd(), err: %d", err);
+			return err;
+		}
+		flags |= MAP_SHARED;
+	} else {
+		flags |= MAP_PRIVATE | MAP_ANON;
+	}
+
+	ramdisk = mmap(NULL, mapped, PROT_READ | PROT_WRITE, flags, state->fd, 0);
+	if (ramdisk == MAP_FAILED) {
+		XNVME_DEBUG("FAILED: mmap(%zu), errno: %d", mapped, errno);
+		return -errno;
+	}
+	state->ramdisk = ramdisk;
+	state->mapped = mapped;
+
+#if defined(XNVME_PLATFORM_LINUX_ENABLED) && defined(MADV_HUGEPAGE)
+	// Fault in 2MiB at a time; not when sparse, as that would inflate the footprint
+	if (!(params->flags & XNVME_BE_RAMDISK_MEM_FLAGS) &&
+	    madvise(ramdisk, mapped, MADV_HUGEPAGE)) {
+		XNVME_DEBUG("INFO: madvise(MADV_HUGEPAGE), errno: %d", errno);
+	}
+#endif
+
+	return 0;
+}
+#endif
+
+static void
+_ramdisk_unmap(struct xnvme_be_ramdisk_state *state)
+{
+#ifndef XNVME_PLATFORM_WINDOWS_ENABLED
+	if (state->mapped) {
+		munmap(state->ramdisk, state->mapped);
+		state->ramdisk = NULL;
+		state->mapped = 0;
+	}
+	if (state->fd >= 0) {
+		close(state->fd);
+		state->fd = -1;
+	}
+#endif
 	if (state->ramdisk) {
 		free(state->ramdisk);
+		state->ramdisk = NULL;
 	}
+}
+
+void
+xnvme_be_ramdisk_dev_close(struct xnvme_dev *dev)
+{
+	if (!dev) {
+		return;
+	}
+
+	xnvme_be_ramdisk_model_term((void *)dev->be.state);
+	xnvme_be_ramdisk_kv_term((void *)dev->be.state);
+	xnvme_be_ramdisk_fdp_term((void *)dev->be.state);
+	xnvme_be_ramdisk_znd_term((void *)dev->be.state);
+	_ramdisk_unmap((void *)dev->be.state);
 
 	memset(&dev->be, 0, sizeof(dev->be));
 }
@@ -36,37 +506,80 @@ xnvme_be_ramdisk_dev_close(struct xnvme_dev *dev)
 size_t
 xnvme_be_ramdisk_dev_get_size(struct xnvme_dev *dev)
 {
-	const struct xnvme_ident *ident = &dev->ident;
-	char *gb_marker;
-
-	gb_marker = strrchr(ident->uri, 'G');
-	if (!gb_marker || (gb_marker && strcmp(gb_marker, "GB"))) {
-		XNVME_DEBUG("FAILED: Invalid URI. Only postfix of 'GB' allowed: %s", ident->uri);
-		return 0;
-	}
+	struct xnvme_be_ramdisk_state *state = (void *)dev->be.state;
 
-	return (size_t)atoi(ident->uri) * 1024 * 1024 * 1024;
+	return state->nbytes;
 }
 
 int
 xnvme_be_ramdisk_dev_open(struct xnvme_dev *dev)
 {
 	struct xnvme_be_ramdisk_state *state = (void *)dev->be.state;
+	struct xnvme_be_ramdisk_params params;
+	int err;
 
-	size_t ramdisk_size = xnvme_be_ramdisk_dev_get_size(dev);
-	if (!ramdisk_size) {
-		return -EINVAL;
+	err = xnvme_be_ramdisk_parse_uri(dev->ident.uri, &params);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_be_ramdisk_parse_uri(%s), err: %d", dev->ident.uri,
+			    err);
+		return err;
 	}
 
-	state->ramdisk = malloc(ramdisk_size);
-	if (!state->ramdisk) {
-		XNVME_DEBUG("FAILED: Unable to allocate ramdisk: uri=%s, state->ramdisk=%p",
-			    dev->ident.uri, state->ramdisk);
-		return -errno;
+	state->fd = -1;
+	state->flags = params.flags;
+
+	// The keys and values of a Key-Value namespace are allocated as they are stored
+	err = (params.flags & XNVME_BE_RAMDISK_KV) ? xnvme_be_ramdisk_kv_init(state, &params)
+						   : _ramdisk_map(state, &params);
+	if (err) {
+		XNVME_DEBUG("FAILED: Unable to allocate ramdisk: uri=%s, err: %d", dev->ident.uri,
+			    err);
+		_ramdisk_unmap(state);
+		return err;
+	}
+	state->nbytes = params.nbytes;
+	state->lbads = params.lbads;
+	state->ms = params.ms;
+	state->pit = params.pit;
+	state->pif = params.pif;
+	state->meta = params.ms ? (uint8_t *)state->ramdisk + params.nbytes : NULL;
+
+	if (params.flags & XNVME_BE_RAMDISK_ZONED) {
+		err = xnvme_be_ramdisk_znd_init(state, &params);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_be_ramdisk_znd_init(), err: %d", err);
+			_ramdisk_unmap(state);
+			return err;
+		}
+	}
+
+	if (params.flags & XNVME_BE_RAMDISK_FDP) {
+		err = xnvme_be_ramdisk_fdp_init(state, &params);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_be_ramdisk_fdp_init(), err: %d", err);
+			_ramdisk_unmap(state);
+			return err;
+		}
+	}
+
+	if (params.flags & XNVME_BE_RAMDISK_MODEL) {
+		err = xnvme_be_ramdisk_model_init(state, &params);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_be_ramdisk_model_init(), err: %d", err);
+			xnvme_be_ramdisk_kv_term(state);
+			xnvme_be_ramdisk_fdp_term(state);
+			xnvme_be_ramdisk_znd_term(state);
+			_ramdisk_unmap(state);
+			return err;
+		}
 	}
 
 	dev->ident.dtype = XNVME_DEV_TYPE_RAMDISK;
-	dev->ident.csi = XNVME_SPEC_CSI_NVM;
+	if (state->kv) {
+		dev->ident.csi = XNVME_SPEC_CSI_KV;
+	} else {
+		dev->ident.csi = state->znd ? XNVME_SPEC_CSI_ZONED : XNVME_SPEC_CSI_NVM;
+	}
 	dev->ident.nsid = 1;
 
 	return 0;
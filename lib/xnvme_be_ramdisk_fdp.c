@@ -0,0 +1,909 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700
+#endif
+#include <libxnvme.h>
+#include <xnvme_be.h>
+#ifdef XNVME_BE_RAMDISK_ENABLED
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xnvme_dev.h>
+#include <xnvme_be_ramdisk.h>
+
+#define RAMDISK_FDP_DTYPE      0x2    ///< Directive type of Data Placement
+#define RAMDISK_FDP_NONE       UINT32_MAX
+#define RAMDISK_FDP_NEVENTS    63     ///< Events fitting in a 4KiB events log page
+#define RAMDISK_FDP_LOG_NBYTES 4096   ///< Each log page fits in 4KiB
+#define RAMDISK_FDP_SC_CAPEXC  0x81   ///< Generic status: Capacity Exceeded
+
+/**
+ * The event types which can be enabled, in the order they are reported by get-features
+ */
+static const uint8_t g_fdp_event_types[] = {0x0, 0x1, 0x2, 0x3, 0x80, 0x81};
+#define RAMDISK_FDP_NTYPES (sizeof(g_fdp_event_types) / sizeof(*g_fdp_event_types))
+
+enum ramdisk_ru_state {
+	RAMDISK_RU_FREE = 0,
+	RAMDISK_RU_OPEN = 1,
+	RAMDISK_RU_FULL = 2,
+};
+
+struct ramdisk_ru {
+	uint64_t nwritten; ///< LBAs written to the reclaim unit since it was erased
+	uint64_t nvalid;   ///< LBAs of those not since overwritten, relocated or deallocated
+	uint16_t ruh;      ///< Handle the unit was opened by, or the first one relocated from
+	uint8_t state;
+};
+
+/**
+ * The LBAs written by a command, and the reclaim group and handle they are placed by
+ */
+struct ramdisk_fdp_write {
+	uint64_t slba;
+	uint64_t nlb;
+	uint32_t rg;
+	uint32_t ruh;
+	uint16_t dspec;
+	bool invalid; ///< The placement identifier given by 'dspec' does not exist
+};
+
+struct ramdisk_fdp_events {
+	struct xnvme_spec_fdp_event ring[RAMDISK_FDP_NEVENTS];
+	uint32_t head; ///< Slot of the next event
+	uint32_t nevents;
+};
+
+/**
+ * The reclaim units of a ramdisk with Flexible Data Placement; each reclaim group has the physical
+ * space for its share of the capacity, the over-provisioning, and an open unit per handle along
+ * with the one garbage collection relocates into. Writes without a placement directive are spread
+ * over the groups by LBA, each taking its share. Data is not moved, the units only account where
+ * each LBA would be on media, such that the statistics log reports the media writes of a device.
+ * All of it is serialized by 'lock', as commands are executed by the threads of the thrpool and
+ * the ramdisk async interfaces.
+ */
+struct xnvme_be_ramdisk_fdp {
+	pthread_mutex_t lock;
+
+	uint64_t nlba;   ///< LBAs of the namespace
+	uint64_t ru_nlb; ///< LBAs of a reclaim unit
+	uint32_t lbab;   ///< Bytes of an LBA, including metadata
+	uint32_t nrg;    ///< Reclaim groups
+	uint32_t nruh;   ///< Reclaim unit handles, one per placement handle
+	uint32_t nru;    ///< Reclaim units of each reclaim group
+	uint32_t rgif;   ///< Bits of the reclaim group in a placement identifier
+
+	uint64_t hbmw; ///< Host bytes with metadata written
+	uint64_t mbmw; ///< Media bytes with metadata written
+	uint64_t mbe;  ///< Media bytes erased
+
+	struct ramdisk_ru *rus; ///< 'nru' reclaim units of each reclaim group
+	uint32_t *active;       ///< Open unit of each handle of each group, and of its collector
+	uint32_t *nfree;        ///< Free reclaim units of each reclaim group
+	uint32_t *lba_ru;       ///< Reclaim unit of each LBA, plus one, zero when unwritten
+	uint32_t *lba_slot;     ///< Slot of each LBA in its reclaim unit, the order it was written
+	uint64_t *ru_lbas;      ///< LBA in each slot of each reclaim unit, 'ru_nlb' per unit
+	uint64_t *rsv;          ///< LBAs reserved on each handle of each group, not yet placed
+	uint8_t ee[XNVME_BE_RAMDISK_NRUH_MAX]; ///< Enabled event types of each handle, as a bitmap
+
+	struct ramdisk_fdp_events host;
+	struct ramdisk_fdp_events ctrlr;
+};
+
+static int
+_fdp_status(struct xnvme_cmd_ctx *ctx, uint8_t sct, uint8_t sc)
+{
+	ctx->cpl.status.sct = sct;
+	ctx->cpl.status.sc = sc;
+
+	return -EIO;
+}
+
+static inline struct xnvme_be_ramdisk_fdp *
+_fdp(struct xnvme_cmd_ctx *ctx)
+{
+	return ((struct xnvme_be_ramdisk_state *)ctx->dev->be.state)->fdp;
+}
+
+static inline uint16_t
+_fdp_pid(struct xnvme_be_ramdisk_fdp *fdp, uint32_t rg, uint32_t ruh)
+{
+	return (rg << (16 - fdp->rgif)) | ruh;
+}
+
+/**
+ * Split the placement identifier 'pid' into its reclaim group and placement handle, returns
+ * false when either does not exist
+ */
+static bool
+_fdp_pid_parse(struct xnvme_be_ramdisk_fdp *fdp, uint16_t pid, uint32_t *rg, uint32_t *ruh)
+{
+	*rg = pid >> (16 - fdp->rgif);
+	*ruh = pid & ((1U << (16 - fdp->rgif)) - 1);
+
+	return (*rg < fdp->nrg) && (*ruh < fdp->nruh);
+}
+
+static inline uint32_t *
+_fdp_active(struct xnvme_be_ramdisk_fdp *fdp, uint32_t rg, uint32_t ruh)
+{
+	return &fdp->active[rg * (fdp->nruh + 1) + ruh];
+}
+
+/**
+ * Log an event of 'type' when enabled on the reclaim unit handle 'ruh' of the group 'rg'; the
+ * oldest event is dropped when the log is full
+ */
+static struct xnvme_spec_fdp_event *
+_fdp_event(struct xnvme_be_ramdisk_fdp *fdp, uint8_t type, uint32_t rg, uint32_t ruh)
+{
+	struct ramdisk_fdp_events *events = (type & 0x80) ? &fdp->ctrlr : &fdp->host;
+	struct xnvme_spec_fdp_event *event;
+	uint32_t idx;
+
+	for (idx = 0; g_fdp_event_types[idx] != type; ++idx)
+		;
+	if ((ruh < fdp->nruh) && !(fdp->ee[ruh] & (1 << idx))) {
+		return NULL;
+	}
+
+	event = &events->ring[events->head];
+	events->head = (events->head + 1) % RAMDISK_FDP_NEVENTS;
+	if (events->nevents < RAMDISK_FDP_NEVENTS) {
+		events->nevents += 1;
+	}
+
+	memset(event, 0, sizeof(*event));
+	event->type = type;
+	event->fdpef.nsidv = 1;
+	event->nsid = 1;
+	event->timestamp = (uint64_t)time(NULL) * 1000;
+	if (ruh < fdp->nruh) {
+		event->fdpef.piv = 1;
+		event->pid = _fdp_pid(fdp, rg, ruh);
+		event->fdpef.lv = 1;
+		event->rgid = rg;
+		event->ruhid = ruh;
+	}
+
+	return event;
+}
+
+static uint32_t
+_ru_take_free(struct xnvme_be_ramdisk_fdp *fdp, uint32_t rg, uint16_t ruh)
+{
+	if (!fdp->nfree[rg]) {
+		return RAMDISK_FDP_NONE;
+	}
+
+	for (uint32_t i = rg * fdp->nru; i < (rg + 1) * fdp->nru; ++i) {
+		struct ramdisk_ru *ru = &fdp->rus[i];
+
+		if (ru->state != RAMDISK_RU_FREE) {
+			continue;
+		}
+		ru->state = RAMDISK_RU_OPEN;
+		ru->ruh = ruh;
+		fdp->nfree[rg] -= 1;
+
+		return i;
+	}
+
+	return RAMDISK_FDP_NONE;
+}
+
+/**
+ * Write the LBA 'lba' to the next slot of the reclaim unit 'idx', invalidating where it was
+ * written before
+ */
+static void
+_ru_place(struct xnvme_be_ramdisk_fdp *fdp, uint32_t idx, uint64_t lba)
+{
+	const uint64_t slot = fdp->rus[idx].nwritten;
+
+	if (fdp->lba_ru[lba]) {
+		fdp->rus[fdp->lba_ru[lba] - 1].nvalid -= 1;
+	}
+	fdp->lba_ru[lba] = idx + 1;
+	fdp->lba_slot[lba] = slot;
+	fdp->ru_lbas[idx * fdp->ru_nlb + slot] = lba;
+	fdp->rus[idx].nwritten += 1;
+	fdp->rus[idx].nvalid += 1;
+}
+
+/**
+ * Reclaim the full unit of group 'rg' with the fewest valid LBAs, relocating them into the unit
+ * open for garbage collection; returns false when there is nothing to reclaim, or when no unit is
+ * free to relocate into, the LBAs relocated until then are still accounted
+ *
+ * The slots of the victim are walked, a slot is valid when its LBA was not since written
+ * elsewhere, or to a later slot of the victim
+ */
+static bool
+_ru_reclaim(struct xnvme_be_ramdisk_fdp *fdp, uint32_t rg)
+{
+	uint32_t *gc = _fdp_active(fdp, rg, fdp->nruh);
+	uint32_t victim = RAMDISK_FDP_NONE;
+	uint64_t nmoved = 0, first = 0;
+	const uint64_t *slots;
+	struct xnvme_spec_fdp_event *event;
+	bool reclaimed = true;
+
+	for (uint32_t i = rg * fdp->nru; i < (rg + 1) * fdp->nru; ++i) {
+		const struct ramdisk_ru *ru = &fdp->rus[i];
+
+		if ((ru->state == RAMDISK_RU_FULL) &&
+		    ((victim == RAMDISK_FDP_NONE) || (ru->nvalid < fdp->rus[victim].nvalid))) {
+			victim = i;
+		}
+	}
+	if ((victim == RAMDISK_FDP_NONE) || (fdp->rus[victim].nvalid == fdp->ru_nlb)) {
+		return false;
+	}
+
+	slots = &fdp->ru_lbas[victim * fdp->ru_nlb];
+	for (uint64_t slot = 0; fdp->rus[victim].nvalid && (slot < fdp->rus[victim].nwritten);
+	     ++slot) {
+		const uint64_t lba = slots[slot];
+
+		if ((fdp->lba_ru[lba] != victim + 1) || (fdp->lba_slot[lba] != slot)) {
+			continue;
+		}
+
+		if ((*gc != RAMDISK_FDP_NONE) && (fdp->rus[*gc].nwritten == fdp->ru_nlb)) {
+			fdp->rus[*gc].state = RAMDISK_RU_FULL;
+			*gc = RAMDISK_FDP_NONE;
+		}
+		if (*gc == RAMDISK_FDP_NONE) {
+			*gc = _ru_take_free(fdp, rg, fdp->rus[victim].ruh);
+			if (*gc == RAMDISK_FDP_NONE) {
+				reclaimed = false;
+				break;
+			}
+		}
+
+		first = nmoved ? first : lba;
+		nmoved += 1;
+		_ru_place(fdp, *gc, lba);
+	}
+
+	fdp->mbmw += nmoved * fdp->lbab;
+	event = nmoved ? _fdp_event(fdp, 0x80, rg, fdp->rus[victim].ruh) : NULL;
+	if (event) {
+		struct xnvme_spec_fdp_event_media_reallocated *mr = (void *)event->type_specific;
+
+		mr->sef.lbav = 1;
+		mr->nlbam = nmoved > UINT16_MAX ? UINT16_MAX : nmoved;
+		mr->lba = first;
+	}
+	if (!reclaimed) {
+		return false;
+	}
+
+	fdp->rus[victim].state = RAMDISK_RU_FREE;
+	fdp->rus[victim].nwritten = 0;
+	fdp->mbe += fdp->ru_nlb * fdp->lbab;
+	fdp->nfree[rg] += 1;
+
+	return true;
+}
+
+/**
+ * Open a new reclaim unit for the handle 'ruh' of group 'rg', reclaiming units while no more than
+ * one is free, such that garbage collection always has one to relocate into
+ */
+static uint32_t
+_ru_take(struct xnvme_be_ramdisk_fdp *fdp, uint32_t rg, uint32_t ruh)
+{
+	for (uint32_t i = 0; (fdp->nfree[rg] <= 1) && (i < fdp->nru); ++i) {
+		if (!_ru_reclaim(fdp, rg)) {
+			break;
+		}
+	}
+	if (fdp->nfree[rg] <= 1) {
+		return RAMDISK_FDP_NONE;
+	}
+
+	return _ru_take_free(fdp, rg, ruh);
+}
+
+static inline uint64_t *
+_fdp_rsv(struct xnvme_be_ramdisk_fdp *fdp, uint32_t rg, uint32_t ruh)
+{
+	return &fdp->rsv[rg * fdp->nruh + ruh];
+}
+
+/**
+ * Decode the LBAs written by the command in 'ctx'; a write without a placement directive, or with
+ * a placement identifier which does not exist, goes to the first handle of the reclaim group
+ * owning its start LBA
+ *
+ * @return true when the command writes LBAs of the namespace, otherwise false
+ */
+static bool
+_fdp_write_decode(struct xnvme_be_ramdisk_fdp *fdp, struct xnvme_cmd_ctx *ctx, const void *dbuf,
+		  struct ramdisk_fdp_write *wr)
+{
+	const struct xnvme_spec_nvm_scopy_fmt_zero *ranges = dbuf;
+	uint8_t dtype;
+
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_NVM_OPC_WRITE:
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+		dtype = ctx->cmd.nvm.dtype;
+		wr->dspec = ctx->cmd.nvm.cdw13.dspec;
+		wr->slba = ctx->cmd.nvm.slba;
+		wr->nlb = (uint64_t)ctx->cmd.nvm.nlb + 1;
+		break;
+
+	case XNVME_SPEC_NVM_OPC_SCOPY:
+		if (!dbuf) {
+			return false;
+		}
+		dtype = ctx->cmd.scopy.dtype;
+		wr->dspec = ctx->cmd.scopy.dspec;
+		wr->slba = ctx->cmd.scopy.sdlba;
+		wr->nlb = 0;
+		for (int i = 0; i <= ctx->cmd.scopy.nr; i++) {
+			wr->nlb += ranges[i].nlb + 1;
+		}
+		break;
+
+	default:
+		return false;
+	}
+	if ((wr->slba >= fdp->nlba) || (wr->nlb > fdp->nlba - wr->slba)) {
+		return false;
+	}
+
+	wr->invalid = (dtype == RAMDISK_FDP_DTYPE) &&
+		      !_fdp_pid_parse(fdp, wr->dspec, &wr->rg, &wr->ruh);
+	if ((dtype != RAMDISK_FDP_DTYPE) || wr->invalid) {
+		wr->rg = wr->slba * fdp->nrg / fdp->nlba;
+		wr->ruh = 0;
+	}
+
+	return true;
+}
+
+/**
+ * The reclaim units needed by the LBAs reserved on the handles of group 'rg', disregarding the
+ * room left in their open units, as an update of the handle might close those
+ */
+static uint64_t
+_fdp_rsv_nru(struct xnvme_be_ramdisk_fdp *fdp, uint32_t rg)
+{
+	uint64_t nru = 0;
+
+	for (uint32_t ruh = 0; ruh < fdp->nruh; ++ruh) {
+		nru += (*_fdp_rsv(fdp, rg, ruh) + fdp->ru_nlb - 1) / fdp->ru_nlb;
+	}
+
+	return nru;
+}
+
+int
+xnvme_be_ramdisk_fdp_reserve(struct xnvme_cmd_ctx *ctx, const void *dbuf)
+{
+	struct xnvme_be_ramdisk_fdp *fdp = _fdp(ctx);
+	struct ramdisk_fdp_write wr;
+	uint64_t *rsv;
+	int err = 0;
+
+	if (!_fdp_write_decode(fdp, ctx, dbuf, &wr)) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&fdp->lock);
+	rsv = _fdp_rsv(fdp, wr.rg, wr.ruh);
+	*rsv += wr.nlb;
+
+	// The units reserved must be free along with the one garbage collection relocates into
+	for (uint32_t i = 0; (_fdp_rsv_nru(fdp, wr.rg) >= fdp->nfree[wr.rg]) && (i < fdp->nru);
+	     ++i) {
+		if (!_ru_reclaim(fdp, wr.rg)) {
+			break;
+		}
+	}
+	if (_fdp_rsv_nru(fdp, wr.rg) >= fdp->nfree[wr.rg]) {
+		XNVME_DEBUG("FAILED: no room for nlb: %" PRIu64 " in group: %u", wr.nlb, wr.rg);
+		*rsv -= wr.nlb;
+		err = _fdp_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC, RAMDISK_FDP_SC_CAPEXC);
+	}
+	pthread_mutex_unlock(&fdp->lock);
+
+	return err;
+}
+
+void
+xnvme_be_ramdisk_fdp_release(struct xnvme_cmd_ctx *ctx, const void *dbuf)
+{
+	struct xnvme_be_ramdisk_fdp *fdp = _fdp(ctx);
+	struct ramdisk_fdp_write wr;
+
+	if (!_fdp_write_decode(fdp, ctx, dbuf, &wr)) {
+		return;
+	}
+
+	pthread_mutex_lock(&fdp->lock);
+	*_fdp_rsv(fdp, wr.rg, wr.ruh) -= wr.nlb;
+	pthread_mutex_unlock(&fdp->lock);
+}
+
+/**
+ * Place the LBAs of a write, for which room is reserved, thus, no reclaim unit is taken without
+ * leaving one free for garbage collection
+ */
+static int
+_fdp_write(struct xnvme_cmd_ctx *ctx, const struct ramdisk_fdp_write *wr)
+{
+	struct xnvme_be_ramdisk_fdp *fdp = _fdp(ctx);
+	const uint32_t rg = wr->rg, ruh = wr->ruh;
+	uint32_t *active;
+	int err = 0;
+
+	pthread_mutex_lock(&fdp->lock);
+	if (wr->invalid) {
+		struct xnvme_spec_fdp_event *event = _fdp_event(fdp, 0x3, 0, RAMDISK_FDP_NONE);
+
+		if (event) {
+			event->fdpef.piv = 1;
+			event->pid = wr->dspec;
+		}
+	}
+	*_fdp_rsv(fdp, rg, ruh) -= wr->nlb;
+	active = _fdp_active(fdp, rg, ruh);
+
+	for (uint64_t lba = wr->slba; lba < wr->slba + wr->nlb; ++lba) {
+		if ((*active != RAMDISK_FDP_NONE) && (fdp->rus[*active].nwritten == fdp->ru_nlb)) {
+			fdp->rus[*active].state = RAMDISK_RU_FULL;
+			*active = RAMDISK_FDP_NONE;
+		}
+		if (*active == RAMDISK_FDP_NONE) {
+			*active = _ru_take(fdp, rg, ruh);
+			if (*active == RAMDISK_FDP_NONE) {
+				XNVME_DEBUG("FAILED: no reclaim unit free in group: %u", rg);
+				err = _fdp_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+						  RAMDISK_FDP_SC_CAPEXC);
+				break;
+			}
+		}
+		_ru_place(fdp, *active, lba);
+		fdp->hbmw += fdp->lbab;
+		fdp->mbmw += fdp->lbab;
+	}
+	pthread_mutex_unlock(&fdp->lock);
+
+	return err;
+}
+
+static int
+_fdp_dealloc(struct xnvme_cmd_ctx *ctx, const struct xnvme_spec_dsm_range *ranges)
+{
+	struct xnvme_be_ramdisk_fdp *fdp = _fdp(ctx);
+
+	pthread_mutex_lock(&fdp->lock);
+	for (uint32_t i = 0; i <= ctx->cmd.dsm.nr; ++i) {
+		uint64_t slba = ranges[i].slba;
+		uint64_t elba = slba + ranges[i].llb;
+
+		elba = elba > fdp->nlba ? fdp->nlba : elba;
+		for (uint64_t lba = slba; lba < elba; ++lba) {
+			if (fdp->lba_ru[lba]) {
+				fdp->rus[fdp->lba_ru[lba] - 1].nvalid -= 1;
+				fdp->lba_ru[lba] = 0;
+			}
+		}
+	}
+	pthread_mutex_unlock(&fdp->lock);
+
+	return 0;
+}
+
+int
+xnvme_be_ramdisk_fdp_io(struct xnvme_cmd_ctx *ctx, const void *dbuf)
+{
+	struct ramdisk_fdp_write wr;
+
+	if (_fdp_write_decode(_fdp(ctx), ctx, dbuf, &wr)) {
+		return _fdp_write(ctx, &wr);
+	}
+	if (ctx->cmd.common.opcode == XNVME_SPEC_NVM_OPC_DATASET_MANAGEMENT) {
+		return (dbuf && ctx->cmd.dsm.ad) ? _fdp_dealloc(ctx, dbuf) : 0;
+	}
+
+	return 0;
+}
+
+int
+xnvme_be_ramdisk_fdp_mgmt_recv(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_fdp *fdp = _fdp(ctx);
+	const struct xnvme_spec_io_mgmt_recv_cmd *cmd = &ctx->cmd.mgmt.mgmt_recv;
+	struct xnvme_spec_ruhs *ruhs = dbuf;
+	uint64_t ndescs;
+
+	if (!fdp) {
+		XNVME_DEBUG("FAILED: ramdisk does not have FDP enabled");
+		return -ENOSYS;
+	}
+
+	if (dbuf_nbytes > ((size_t)cmd->numd + 1) * 4) {
+		dbuf_nbytes = ((size_t)cmd->numd + 1) * 4;
+	}
+	if ((cmd->mo != XNVME_SPEC_IO_MGMT_RECV_RUHS) || (dbuf_nbytes < sizeof(*ruhs))) {
+		return _fdp_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+				   XNVME_STATUS_CODE_INVALID_FIELD);
+	}
+	ndescs = (dbuf_nbytes - sizeof(*ruhs)) / sizeof(*ruhs->desc);
+
+	memset(dbuf, 0, dbuf_nbytes);
+	ruhs->nruhsd = fdp->nrg * fdp->nruh;
+
+	pthread_mutex_lock(&fdp->lock);
+	for (uint32_t i = 0; (i < ruhs->nruhsd) && (i < ndescs); ++i) {
+		const uint32_t rg = i / fdp->nruh, ruh = i % fdp->nruh;
+		const uint32_t active = *_fdp_active(fdp, rg, ruh);
+
+		ruhs->desc[i].pi = _fdp_pid(fdp, rg, ruh);
+		ruhs->desc[i].ruhi = ruh;
+		ruhs->desc[i].ruamw = fdp->ru_nlb;
+		if (active != RAMDISK_FDP_NONE) {
+			ruhs->desc[i].ruamw -= fdp->rus[active].nwritten;
+		}
+	}
+	pthread_mutex_unlock(&fdp->lock);
+
+	return 0;
+}
+
+int
+xnvme_be_ramdisk_fdp_mgmt_send(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_fdp *fdp = _fdp(ctx);
+	const struct xnvme_spec_io_mgmt_send_cmd *cmd = &ctx->cmd.mgmt.mgmt_send;
+	const uint16_t *pids = dbuf;
+	const size_t npids = (size_t)cmd->mos + 1;
+	uint32_t rg, ruh;
+
+	if (!fdp) {
+		XNVME_DEBUG("FAILED: ramdisk does not have FDP enabled");
+		return -ENOSYS;
+	}
+
+	if ((cmd->mo != XNVME_SPEC_IO_MGMT_SEND_RUHU) || (dbuf_nbytes < npids * sizeof(*pids))) {
+		return _fdp_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+				   XNVME_STATUS_CODE_INVALID_FIELD);
+	}
+	for (size_t i = 0; i < npids; ++i) {
+		if (!_fdp_pid_parse(fdp, pids[i], &rg, &ruh)) {
+			return _fdp_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+					   XNVME_STATUS_CODE_INVALID_FIELD);
+		}
+	}
+
+	// An update closes the unit of each handle unless empty, the next write opens another
+	pthread_mutex_lock(&fdp->lock);
+	for (size_t i = 0; i < npids; ++i) {
+		uint32_t *active;
+
+		_fdp_pid_parse(fdp, pids[i], &rg, &ruh);
+		active = _fdp_active(fdp, rg, ruh);
+		if ((*active == RAMDISK_FDP_NONE) || !fdp->rus[*active].nwritten) {
+			continue;
+		}
+		if (fdp->rus[*active].nwritten < fdp->ru_nlb) {
+			_fdp_event(fdp, 0x0, rg, ruh);
+		}
+		fdp->rus[*active].state = RAMDISK_RU_FULL;
+		*active = RAMDISK_FDP_NONE;
+	}
+	pthread_mutex_unlock(&fdp->lock);
+
+	return 0;
+}
+
+static void
+_fdp_log_conf(struct xnvme_be_ramdisk_fdp *fdp, void *page)
+{
+	struct xnvme_spec_log_fdp_conf *log = page;
+	struct xnvme_spec_fdp_conf_desc *desc = log->conf_desc;
+
+	desc->ds = sizeof(*desc) + fdp->nruh * sizeof(*desc->ruh_desc);
+	desc->fdpa.rgif = fdp->rgif;
+	desc->fdpa.fdpcv = 1;
+	desc->nrg = fdp->nrg;
+	desc->nruh = fdp->nruh;
+	desc->maxpids = fdp->nruh - 1;
+	desc->nns = 1;
+	desc->runs = fdp->ru_nlb * fdp->lbab;
+	for (uint32_t i = 0; i < fdp->nruh; ++i) {
+		desc->ruh_desc[i].ruht = 0x1; ///< Initially Isolated
+	}
+
+	log->ncfg = 0; ///< Zero-based, a single configuration
+	log->size = sizeof(*log) + desc->ds;
+}
+
+static void
+_fdp_log_ruhu(struct xnvme_be_ramdisk_fdp *fdp, void *page)
+{
+	struct xnvme_spec_log_ruhu *log = page;
+
+	log->nruh = fdp->nruh;
+	for (uint32_t i = 0; i < fdp->nruh; ++i) {
+		log->ruhu_desc[i].ruha = 0x1; ///< Host Specified
+	}
+}
+
+static void
+_fdp_log_events(struct ramdisk_fdp_events *events, void *page)
+{
+	struct xnvme_spec_log_fdp_events *log = page;
+	const uint32_t oldest = (events->head + RAMDISK_FDP_NEVENTS - events->nevents) %
+				RAMDISK_FDP_NEVENTS;
+
+	log->nevents = events->nevents;
+	for (uint32_t i = 0; i < events->nevents; ++i) {
+		log->event[i] = events->ring[(oldest + i) % RAMDISK_FDP_NEVENTS];
+	}
+}
+
+int
+xnvme_be_ramdisk_fdp_log(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_fdp *fdp = _fdp(ctx);
+	const struct xnvme_spec_cmd_log *cmd = &ctx->cmd.log;
+	const uint64_t lpo = ((uint64_t)cmd->lpou << 32) | cmd->lpol;
+	const size_t numd = (((size_t)cmd->numdu << 16) | cmd->numdl) + 1;
+	uint8_t page[RAMDISK_FDP_LOG_NBYTES] = {0};
+	struct xnvme_spec_log_fdp_stats *stats = (void *)page;
+	size_t nbytes;
+
+	if (!fdp) {
+		XNVME_DEBUG("FAILED: ramdisk does not have FDP enabled");
+		return -ENOSYS;
+	}
+	if (lpo > sizeof(page)) {
+		return _fdp_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+				   XNVME_STATUS_CODE_INVALID_FIELD);
+	}
+
+	pthread_mutex_lock(&fdp->lock);
+	switch (cmd->lid) {
+	case XNVME_SPEC_LOG_FDPCONF:
+		_fdp_log_conf(fdp, page);
+		break;
+
+	case XNVME_SPEC_LOG_FDPRUHU:
+		_fdp_log_ruhu(fdp, page);
+		break;
+
+	case XNVME_SPEC_LOG_FDPSTATS:
+		stats->hbmw[0] = fdp->hbmw;
+		stats->mbmw[0] = fdp->mbmw;
+		stats->mbe[0] = fdp->mbe;
+		break;
+
+	case XNVME_SPEC_LOG_FDPEVENTS:
+		_fdp_log_events((cmd->lsp & 0x1) ? &fdp->ctrlr : &fdp->host, page);
+		break;
+
+	default:
+		pthread_mutex_unlock(&fdp->lock);
+		XNVME_DEBUG("FAILED: unsupported lid: 0x%x", cmd->lid);
+		return -ENOSYS;
+	}
+	pthread_mutex_unlock(&fdp->lock);
+
+	nbytes = numd * 4 < dbuf_nbytes ? numd * 4 : dbuf_nbytes;
+	memset(dbuf, 0, dbuf_nbytes);
+	memcpy(dbuf, page + lpo, nbytes < sizeof(page) - lpo ? nbytes : sizeof(page) - lpo);
+
+	return 0;
+}
+
+int
+xnvme_be_ramdisk_fdp_gfeat(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_fdp *fdp = _fdp(ctx);
+	struct xnvme_spec_fdp_event_desc *descs = dbuf;
+	const uint32_t ruh = ctx->cmd.gfeat.cdw11 & 0xFFFF;
+	const uint32_t noet = ctx->cmd.gfeat.cdw11 >> 16;
+	struct xnvme_spec_feat feat = {0};
+	uint32_t ndescs = 0;
+
+	if (!fdp) {
+		XNVME_DEBUG("FAILED: ramdisk does not have FDP enabled");
+		return -ENOSYS;
+	}
+
+	switch (ctx->cmd.gfeat.cdw10.fid) {
+	case XNVME_SPEC_FEAT_FDP_MODE:
+		feat.fdp_mode.fdpe = 1;
+		feat.fdp_mode.fdpci = 0;
+		ctx->cpl.cdw0 = feat.val;
+		return 0;
+
+	case XNVME_SPEC_FEAT_FDP_EVENTS:
+		if (ruh >= fdp->nruh) {
+			return _fdp_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+					   XNVME_STATUS_CODE_INVALID_FIELD);
+		}
+		pthread_mutex_lock(&fdp->lock);
+		for (; (ndescs < RAMDISK_FDP_NTYPES) && (ndescs < noet) &&
+		       ((ndescs + 1) * sizeof(*descs) <= dbuf_nbytes);
+		     ++ndescs) {
+			descs[ndescs].type = g_fdp_event_types[ndescs];
+			descs[ndescs].fdpeta.val = 0;
+			descs[ndescs].fdpeta.ee = (fdp->ee[ruh] >> ndescs) & 0x1;
+		}
+		pthread_mutex_unlock(&fdp->lock);
+		ctx->cpl.cdw0 = ndescs;
+		return 0;
+
+	default:
+		XNVME_DEBUG("FAILED: unsupported fid: %d", ctx->cmd.gfeat.cdw10.fid);
+		return -ENOSYS;
+	}
+}
+
+int
+xnvme_be_ramdisk_fdp_sfeat(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_fdp *fdp = _fdp(ctx);
+	const struct xnvme_spec_feat feat = ctx->cmd.sfeat.feat;
+	const uint32_t ruh = feat.val & 0xFFFF;
+	const uint32_t noet = feat.val >> 16;
+	const uint8_t *types = dbuf;
+	uint8_t mask = 0;
+
+	if (!fdp) {
+		XNVME_DEBUG("FAILED: ramdisk does not have FDP enabled");
+		return -ENOSYS;
+	}
+
+	switch (ctx->cmd.sfeat.cdw10.fid) {
+	case XNVME_SPEC_FEAT_FDP_MODE:
+		// The configuration is given by the URI, thus, it can only be kept as is
+		if (!feat.fdp_mode.fdpe || feat.fdp_mode.fdpci) {
+			return _fdp_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+					   XNVME_STATUS_CODE_INVALID_FIELD);
+		}
+		return 0;
+
+	case XNVME_SPEC_FEAT_FDP_EVENTS:
+		if ((ruh >= fdp->nruh) || (noet > dbuf_nbytes)) {
+			return _fdp_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+					   XNVME_STATUS_CODE_INVALID_FIELD);
+		}
+		for (uint32_t i = 0; i < noet; ++i) {
+			uint32_t idx;
+
+			for (idx = 0; idx < RAMDISK_FDP_NTYPES; ++idx) {
+				if (g_fdp_event_types[idx] == types[i]) {
+					break;
+				}
+			}
+			if (idx == RAMDISK_FDP_NTYPES) {
+				return _fdp_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+						   XNVME_STATUS_CODE_INVALID_FIELD);
+			}
+			mask |= 1 << idx;
+		}
+
+		pthread_mutex_lock(&fdp->lock);
+		if (ctx->cmd.sfeat.cdw12 & 0x1) {
+			fdp->ee[ruh] |= mask;
+		} else {
+			fdp->ee[ruh] &= ~mask;
+		}
+		pthread_mutex_unlock(&fdp->lock);
+		return 0;
+
+	default:
+		XNVME_DEBUG("FAILED: unsupported fid: %d", ctx->cmd.sfeat.cdw10.fid);
+		return -ENOSYS;
+	}
+}
+
+void
+xnvme_be_ramdisk_fdp_term(struct xnvme_be_ramdisk_state *state)
+{
+	if (!state->fdp) {
+		return;
+	}
+
+	pthread_mutex_destroy(&state->fdp->lock);
+	free(state->fdp->rus);
+	free(state->fdp->active);
+	free(state->fdp->nfree);
+	free(state->fdp->lba_ru);
+	free(state->fdp->lba_slot);
+	free(state->fdp->ru_lbas);
+	free(state->fdp->rsv);
+	free(state->fdp);
+	state->fdp = NULL;
+}
+
+int
+xnvme_be_ramdisk_fdp_init(struct xnvme_be_ramdisk_state *state,
+			  const struct xnvme_be_ramdisk_params *params)
+{
+	const uint64_t nlba = params->nbytes / params->lbads;
+	const uint64_t ru_nlb = params->runs / params->lbads;
+	const uint64_t data_rus = (nlba / params->nrg + ru_nlb - 1) / ru_nlb;
+	const uint64_t op_rus = (data_rus * params->op + 99) / 100;
+	struct xnvme_be_ramdisk_fdp *fdp;
+	int err;
+
+	fdp = calloc(1, sizeof(*fdp));
+	if (!fdp) {
+		XNVME_DEBUG("FAILED: calloc(fdp), errno: %d", errno);
+		return -errno;
+	}
+	state->fdp = fdp;
+
+	fdp->nlba = nlba;
+	fdp->ru_nlb = ru_nlb;
+	fdp->lbab = params->lbads + params->ms;
+	fdp->nrg = params->nrg;
+	fdp->nruh = params->nruh;
+	fdp->nru = data_rus + op_rus + params->nruh + 2;
+	for (fdp->rgif = 0; (1U << fdp->rgif) < params->nrg; ++fdp->rgif)
+		;
+
+	fdp->rus = calloc((size_t)fdp->nrg * fdp->nru, sizeof(*fdp->rus));
+	fdp->active = calloc((size_t)fdp->nrg * (fdp->nruh + 1), sizeof(*fdp->active));
+	fdp->nfree = calloc(fdp->nrg, sizeof(*fdp->nfree));
+	fdp->lba_ru = calloc(nlba, sizeof(*fdp->lba_ru));
+	fdp->lba_slot = calloc(nlba, sizeof(*fdp->lba_slot));
+	fdp->ru_lbas = calloc((size_t)fdp->nrg * fdp->nru * ru_nlb, sizeof(*fdp->ru_lbas));
+	fdp->rsv = calloc((size_t)fdp->nrg * fdp->nruh, sizeof(*fdp->rsv));
+	if (!fdp->rus || !fdp->active || !fdp->nfree || !fdp->lba_ru || !fdp->lba_slot ||
+	    !fdp->ru_lbas || !fdp->rsv) {
+		err = -ENOMEM;
+		XNVME_DEBUG("FAILED: calloc(), err: %d", err);
+		goto failed;
+	}
+
+	err = pthread_mutex_init(&fdp->lock, NULL);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_mutex_init(), err: %d", err);
+		err = -err;
+		goto failed;
+	}
+
+	for (uint32_t i = 0; i < fdp->nrg * (fdp->nruh + 1); ++i) {
+		fdp->active[i] = RAMDISK_FDP_NONE;
+	}
+	for (uint32_t rg = 0; rg < fdp->nrg; ++rg) {
+		fdp->nfree[rg] = fdp->nru;
+	}
+
+	// Events are enabled on every handle, until disabled by set-features
+	memset(fdp->ee, (1 << RAMDISK_FDP_NTYPES) - 1, sizeof(fdp->ee));
+
+	return 0;
+
+failed:
+	free(fdp->rus);
+	free(fdp->active);
+	free(fdp->nfree);
+	free(fdp->lba_ru);
+	free(fdp->lba_slot);
+	free(fdp->ru_lbas);
+	free(fdp->rsv);
+	free(fdp);
+	state->fdp = NULL;
+
+	return err;
+}
+#endif
@@ -0,0 +1,543 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700
+#endif
+#include <libxnvme.h>
+#include <xnvme_be.h>
+#ifdef XNVME_BE_RAMDISK_ENABLED
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xnvme_dev.h>
+#include <xnvme_be_ramdisk.h>
+
+#define RAMDISK_KV_SC_INVALID_FIELD 0x2  ///< Generic status: Invalid Field in Command
+#define RAMDISK_KV_NLEVELS          16   ///< Levels of the ordered index, ample for 4^16 keys
+
+struct ramdisk_kv_val {
+	uint32_t nbytes;
+	uint8_t data[];
+};
+
+/**
+ * A slot of the index, 32 bytes on 64-bit platforms, that is, two to a cache-line; a probe
+ * compares the hash and the key length, and then the key, without leaving the slot. The key is
+ * zero-padded, and a zero key length marks an empty slot.
+ */
+struct ramdisk_kv_slot {
+	uint32_t hash;
+	uint8_t klen;
+	uint8_t rsvd[3];
+	uint8_t key[XNVME_BE_RAMDISK_KV_KML];
+	struct ramdisk_kv_val *val;
+};
+
+/**
+ * A key in the ordered index, a skip-list; the node is on the lowest 'nlevels' levels, derived
+ * from the hash of the key, such that each level holds about a quarter of the keys of the one
+ * below it
+ */
+struct ramdisk_kv_node {
+	uint8_t klen;
+	uint8_t nlevels;
+	uint8_t key[XNVME_BE_RAMDISK_KV_KML];
+	struct ramdisk_kv_node *next[];
+};
+
+/**
+ * The keys of a Key-Value ramdisk, in an open-addressing hash table with linear probing, and
+ * deletion by backward shift rather than tombstones; the table is sized for a load of at most
+ * three quarters at the max number of keys, thus, a probe always ends at an empty slot. Values
+ * are allocated on their own, and are accounted, along with the keys, against the capacity.
+ * The keys are further kept in order by a skip-list, for listing them.
+ * The index is serialized by 'lock', values and nodes are allocated ahead of taking it.
+ */
+struct xnvme_be_ramdisk_kv {
+	pthread_mutex_t lock;
+
+	struct ramdisk_kv_slot *slots;
+	uint64_t mask; ///< Slots of the table, minus one, the slots being a power of two
+
+	struct ramdisk_kv_node *head[RAMDISK_KV_NLEVELS]; ///< First node of each level of the list
+
+	uint64_t mnk;   ///< Max number of keys
+	uint64_t nkeys; ///< Keys stored
+	uint64_t nsze;  ///< Capacity in bytes
+	uint64_t nuse;  ///< Bytes of the keys and values stored
+};
+
+static int
+_kv_status(struct xnvme_cmd_ctx *ctx, uint8_t sc)
+{
+	ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_GENERIC;
+	ctx->cpl.status.sc = sc;
+
+	return -EIO;
+}
+
+static inline struct xnvme_be_ramdisk_kv *
+_kv(struct xnvme_cmd_ctx *ctx)
+{
+	return ((struct xnvme_be_ramdisk_state *)ctx->dev->be.state)->kv;
+}
+
+/**
+ * Mix the two words of the zero-padded key and its length, by the finalizer of splitmix64
+ */
+static inline uint32_t
+_kv_hash(const uint8_t *key, uint8_t klen)
+{
+	uint64_t lo, hi, h;
+
+	memcpy(&lo, key, sizeof(lo));
+	memcpy(&hi, key + sizeof(lo), sizeof(hi));
+
+	h = lo ^ (hi * 0x9e3779b97f4a7c15ULL) ^ klen;
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+
+	return (uint32_t)(h ^ (h >> 31));
+}
+
+/**
+ * Keys are ordered by their bytes, and a key before any longer key it is a prefix of
+ */
+static inline int
+_kv_cmp(const uint8_t *a, uint8_t alen, const uint8_t *b, uint8_t blen)
+{
+	int cmp = memcmp(a, b, alen < blen ? alen : blen);
+
+	return cmp ? cmp : (int)alen - (int)blen;
+}
+
+/**
+ * Find the slot of the given key, or the empty slot ending its probe, where it would be stored
+ */
+static struct ramdisk_kv_slot *
+_kv_find(struct xnvme_be_ramdisk_kv *kv, const uint8_t *key, uint8_t klen, uint32_t hash)
+{
+	for (uint64_t i = hash & kv->mask;; i = (i + 1) & kv->mask) {
+		struct ramdisk_kv_slot *slot = &kv->slots[i];
+
+		if (!slot->klen) {
+			return slot;
+		}
+		if ((slot->hash == hash) && (slot->klen == klen) &&
+		    !memcmp(slot->key, key, XNVME_BE_RAMDISK_KV_KML)) {
+			return slot;
+		}
+	}
+}
+
+/**
+ * Empty the given slot, shifting back into the hole each of the slots following it up to the next
+ * empty one, whose home slot does not lie between the hole and itself
+ */
+static void
+_kv_remove(struct xnvme_be_ramdisk_kv *kv, struct ramdisk_kv_slot *slot)
+{
+	uint64_t hole = slot - kv->slots;
+
+	for (uint64_t i = (hole + 1) & kv->mask; kv->slots[i].klen; i = (i + 1) & kv->mask) {
+		const uint64_t home = kv->slots[i].hash & kv->mask;
+
+		if (((i - home) & kv->mask) >= ((i - hole) & kv->mask)) {
+			kv->slots[hole] = kv->slots[i];
+			hole = i;
+		}
+	}
+
+	memset(&kv->slots[hole], 0, sizeof(kv->slots[hole]));
+}
+
+/**
+ * Each pair of set bits, from the top of the hash, promotes the node a level; the low bits of the
+ * hash select the slot of the table
+ */
+static inline uint8_t
+_kv_node_nlevels(uint32_t hash)
+{
+	uint8_t nlevels = 1;
+
+	while ((nlevels < RAMDISK_KV_NLEVELS) && (((hash >> (32 - 2 * nlevels)) & 0x3) == 0x3)) {
+		nlevels += 1;
+	}
+
+	return nlevels;
+}
+
+/**
+ * Find, on each level, the last node ordered before the given key, NULL when there is none
+ */
+static void
+_kv_index_seek(struct xnvme_be_ramdisk_kv *kv, const uint8_t *key, uint8_t klen,
+	       struct ramdisk_kv_node **prev)
+{
+	struct ramdisk_kv_node *node = NULL;
+
+	for (int lvl = RAMDISK_KV_NLEVELS - 1; lvl >= 0; --lvl) {
+		struct ramdisk_kv_node *next = node ? node->next[lvl] : kv->head[lvl];
+
+		while (next && (_kv_cmp(next->key, next->klen, key, klen) < 0)) {
+			node = next;
+			next = node->next[lvl];
+		}
+		prev[lvl] = node;
+	}
+}
+
+static inline struct ramdisk_kv_node **
+_kv_index_link(struct xnvme_be_ramdisk_kv *kv, struct ramdisk_kv_node *prev, int lvl)
+{
+	return prev ? &prev->next[lvl] : &kv->head[lvl];
+}
+
+static void
+_kv_index_insert(struct xnvme_be_ramdisk_kv *kv, struct ramdisk_kv_node *node)
+{
+	struct ramdisk_kv_node *prev[RAMDISK_KV_NLEVELS];
+
+	_kv_index_seek(kv, node->key, node->klen, prev);
+	for (int lvl = 0; lvl < node->nlevels; ++lvl) {
+		struct ramdisk_kv_node **link = _kv_index_link(kv, prev[lvl], lvl);
+
+		node->next[lvl] = *link;
+		*link = node;
+	}
+}
+
+/**
+ * Unlink the node of the given key, which must be in the index, and return it
+ */
+static struct ramdisk_kv_node *
+_kv_index_remove(struct xnvme_be_ramdisk_kv *kv, const uint8_t *key, uint8_t klen)
+{
+	struct ramdisk_kv_node *prev[RAMDISK_KV_NLEVELS];
+	struct ramdisk_kv_node *node;
+
+	_kv_index_seek(kv, key, klen, prev);
+	node = *_kv_index_link(kv, prev[0], 0);
+	for (int lvl = 0; lvl < node->nlevels; ++lvl) {
+		*_kv_index_link(kv, prev[lvl], lvl) = node->next[lvl];
+	}
+
+	return node;
+}
+
+static int
+_kv_store(struct xnvme_cmd_ctx *ctx, const uint8_t *key, uint8_t klen, const void *dbuf,
+	  size_t dbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_kv *kv = _kv(ctx);
+	const uint32_t hash = _kv_hash(key, klen);
+	const uint32_t vlen = ctx->cmd.kvs.cdw10;
+	const uint8_t ro = ctx->cmd.kvs.cdw11.ro;
+	const uint8_t nlevels = _kv_node_nlevels(hash);
+	struct ramdisk_kv_val *val, *old = NULL;
+	struct ramdisk_kv_node *node;
+	struct ramdisk_kv_slot *slot;
+	uint64_t nuse;
+	int err = 0;
+
+	if ((vlen > XNVME_BE_RAMDISK_KV_VML) || (vlen > dbuf_nbytes)) {
+		return _kv_status(ctx, XNVME_SPEC_KV_SC_INVALID_VAL_SIZE);
+	}
+	if ((ro & XNVME_KVS_STORE_OPT_DONT_STORE_IF_KEY_NOT_EXISTS) &&
+	    (ro & XNVME_KVS_STORE_OPT_DONT_STORE_IF_KEY_EXISTS)) {
+		return _kv_status(ctx, RAMDISK_KV_SC_INVALID_FIELD);
+	}
+
+	val = malloc(sizeof(*val) + vlen);
+	if (!val) {
+		XNVME_DEBUG("FAILED: malloc(val), errno: %d", errno);
+		return -errno;
+	}
+	val->nbytes = vlen;
+	if (vlen) {
+		memcpy(val->data, dbuf, vlen);
+	}
+
+	// Only linked into the index when the key is new, freed otherwise
+	node = malloc(sizeof(*node) + nlevels * sizeof(*node->next));
+	if (!node) {
+		XNVME_DEBUG("FAILED: malloc(node), errno: %d", errno);
+		err = -errno;
+		free(val);
+		return err;
+	}
+	node->klen = klen;
+	node->nlevels = nlevels;
+	memcpy(node->key, key, XNVME_BE_RAMDISK_KV_KML);
+
+	pthread_mutex_lock(&kv->lock);
+
+	slot = _kv_find(kv, key, klen, hash);
+	nuse = slot->klen ? kv->nuse - slot->val->nbytes + vlen : kv->nuse + klen + vlen;
+
+	if (slot->klen && (ro & XNVME_KVS_STORE_OPT_DONT_STORE_IF_KEY_EXISTS)) {
+		err = _kv_status(ctx, XNVME_SPEC_KV_SC_KEY_EXISTS);
+	} else if (!slot->klen && (ro & XNVME_KVS_STORE_OPT_DONT_STORE_IF_KEY_NOT_EXISTS)) {
+		err = _kv_status(ctx, XNVME_SPEC_KV_SC_KEY_NOT_EXISTS);
+	} else if ((nuse > kv->nsze) || (!slot->klen && (kv->nkeys == kv->mnk))) {
+		err = _kv_status(ctx, XNVME_SPEC_KV_SC_CAPACITY_EXCEEDED);
+	}
+
+	if (err) {
+		old = val;
+	} else if (slot->klen) {
+		old = slot->val;
+		slot->val = val;
+		kv->nuse = nuse;
+	} else {
+		slot->hash = hash;
+		slot->klen = klen;
+		memcpy(slot->key, key, XNVME_BE_RAMDISK_KV_KML);
+		slot->val = val;
+		kv->nkeys += 1;
+		kv->nuse = nuse;
+		_kv_index_insert(kv, node);
+		node = NULL;
+	}
+
+	pthread_mutex_unlock(&kv->lock);
+
+	free(old);
+	free(node);
+
+	return err;
+}
+
+/**
+ * Copy as much of the value as the host buffer holds; the completion carries the size of the
+ * value, as the command does not fail on a short buffer
+ */
+static int
+_kv_retrieve(struct xnvme_cmd_ctx *ctx, const uint8_t *key, uint8_t klen, void *dbuf,
+	     size_t dbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_kv *kv = _kv(ctx);
+	const size_t hbs = XNVME_MIN_U64(ctx->cmd.kvs.cdw10, dbuf_nbytes);
+	struct ramdisk_kv_slot *slot;
+	int err = 0;
+
+	pthread_mutex_lock(&kv->lock);
+
+	slot = _kv_find(kv, key, klen, _kv_hash(key, klen));
+	if (slot->klen) {
+		memcpy(dbuf, slot->val->data, XNVME_MIN_U64(slot->val->nbytes, hbs));
+		ctx->cpl.cdw0 = slot->val->nbytes;
+	} else {
+		err = _kv_status(ctx, XNVME_SPEC_KV_SC_KEY_NOT_EXISTS);
+	}
+
+	pthread_mutex_unlock(&kv->lock);
+
+	return err;
+}
+
+static int
+_kv_delete(struct xnvme_cmd_ctx *ctx, const uint8_t *key, uint8_t klen)
+{
+	struct xnvme_be_ramdisk_kv *kv = _kv(ctx);
+	struct ramdisk_kv_node *node = NULL;
+	struct ramdisk_kv_val *old = NULL;
+	struct ramdisk_kv_slot *slot;
+	int err = 0;
+
+	pthread_mutex_lock(&kv->lock);
+
+	slot = _kv_find(kv, key, klen, _kv_hash(key, klen));
+	if (slot->klen) {
+		old = slot->val;
+		kv->nuse -= klen + old->nbytes;
+		kv->nkeys -= 1;
+		_kv_remove(kv, slot);
+		node = _kv_index_remove(kv, key, klen);
+	} else {
+		err = _kv_status(ctx, XNVME_SPEC_KV_SC_KEY_NOT_EXISTS);
+	}
+
+	pthread_mutex_unlock(&kv->lock);
+
+	free(old);
+	free(node);
+
+	return err;
+}
+
+static int
+_kv_exist(struct xnvme_cmd_ctx *ctx, const uint8_t *key, uint8_t klen)
+{
+	struct xnvme_be_ramdisk_kv *kv = _kv(ctx);
+	bool exists;
+
+	pthread_mutex_lock(&kv->lock);
+	exists = _kv_find(kv, key, klen, _kv_hash(key, klen))->klen;
+	pthread_mutex_unlock(&kv->lock);
+
+	return exists ? 0 : _kv_status(ctx, XNVME_SPEC_KV_SC_KEY_NOT_EXISTS);
+}
+
+/**
+ * Fill the host buffer with the keys from the given key and on, in order, as many as fit, walking
+ * the ordered index from the first of them. The key list is the number of keys followed by, for
+ * each key, its length in two bytes and the key itself, padded to four bytes.
+ */
+static int
+_kv_list(struct xnvme_cmd_ctx *ctx, const uint8_t *key, uint8_t klen, void *dbuf,
+	 size_t dbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_kv *kv = _kv(ctx);
+	const size_t hbs = XNVME_MIN_U64(ctx->cmd.kvs.cdw10, dbuf_nbytes);
+	struct ramdisk_kv_node *prev[RAMDISK_KV_NLEVELS];
+	struct ramdisk_kv_node *node;
+	uint8_t *buf = dbuf;
+	uint32_t nkeys = 0;
+	size_t ofz = sizeof(nkeys);
+
+	if (hbs < sizeof(nkeys)) {
+		return _kv_status(ctx, RAMDISK_KV_SC_INVALID_FIELD);
+	}
+
+	pthread_mutex_lock(&kv->lock);
+
+	_kv_index_seek(kv, key, klen, prev);
+	for (node = *_kv_index_link(kv, prev[0], 0); node; node = node->next[0]) {
+		const size_t nbytes = (sizeof(uint16_t) + node->klen + 3) & ~(size_t)3;
+		const uint16_t kl = node->klen;
+
+		if (ofz + nbytes > hbs) {
+			break;
+		}
+		memset(buf + ofz, 0, nbytes);
+		memcpy(buf + ofz, &kl, sizeof(kl));
+		memcpy(buf + ofz + sizeof(kl), node->key, kl);
+		ofz += nbytes;
+		nkeys += 1;
+	}
+	memcpy(buf, &nkeys, sizeof(nkeys));
+
+	pthread_mutex_unlock(&kv->lock);
+
+	return 0;
+}
+
+int
+xnvme_be_ramdisk_kv_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes)
+{
+	const uint8_t klen = ctx->cmd.kvs.cdw11.kl;
+	uint8_t key[XNVME_BE_RAMDISK_KV_KML];
+
+	// Listing may start from the first key, by an empty one
+	if ((klen > XNVME_BE_RAMDISK_KV_KML) ||
+	    (!klen && (ctx->cmd.common.opcode != XNVME_SPEC_KV_OPC_LIST))) {
+		return _kv_status(ctx, XNVME_SPEC_KV_SC_INVALID_KEY_SIZE);
+	}
+	memcpy(key, &ctx->cmd.kvs.key, sizeof(ctx->cmd.kvs.key));
+	memcpy(key + sizeof(ctx->cmd.kvs.key), &ctx->cmd.kvs.key_hi, sizeof(ctx->cmd.kvs.key_hi));
+	memset(key + klen, 0, sizeof(key) - klen);
+
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_KV_OPC_STORE:
+		return _kv_store(ctx, key, klen, dbuf, dbuf_nbytes);
+
+	case XNVME_SPEC_KV_OPC_RETRIEVE:
+		return _kv_retrieve(ctx, key, klen, dbuf, dbuf_nbytes);
+
+	case XNVME_SPEC_KV_OPC_DELETE:
+		return _kv_delete(ctx, key, klen);
+
+	case XNVME_SPEC_KV_OPC_EXIST:
+		return _kv_exist(ctx, key, klen);
+
+	case XNVME_SPEC_KV_OPC_LIST:
+		return _kv_list(ctx, key, klen, dbuf, dbuf_nbytes);
+
+	default:
+		XNVME_DEBUG("FAILED: nosys opcode: %d", ctx->cmd.common.opcode);
+		return -ENOSYS;
+	}
+}
+
+int
+xnvme_be_ramdisk_kv_idfy_ns(struct xnvme_dev *dev, void *dbuf)
+{
+	struct xnvme_be_ramdisk_kv *kv = ((struct xnvme_be_ramdisk_state *)dev->be.state)->kv;
+	struct xnvme_spec_kvs_idfy_ns *ns = dbuf;
+
+	ns->nsze = kv->nsze;
+	pthread_mutex_lock(&kv->lock);
+	ns->nuse = kv->nuse;
+	pthread_mutex_unlock(&kv->lock);
+
+	ns->nkvf = 1;
+	ns->kvf[0].kml = XNVME_BE_RAMDISK_KV_KML;
+	ns->kvf[0].vml = XNVME_BE_RAMDISK_KV_VML;
+	ns->kvf[0].mnk = kv->mnk;
+
+	return 0;
+}
+
+void
+xnvme_be_ramdisk_kv_term(struct xnvme_be_ramdisk_state *state)
+{
+	if (!state->kv) {
+		return;
+	}
+
+	for (uint64_t i = 0; i <= state->kv->mask; ++i) {
+		free(state->kv->slots[i].val);
+	}
+	for (struct ramdisk_kv_node *node = state->kv->head[0], *next; node; node = next) {
+		next = node->next[0];
+		free(node);
+	}
+	pthread_mutex_destroy(&state->kv->lock);
+	free(state->kv->slots);
+	free(state->kv);
+	state->kv = NULL;
+}
+
+int
+xnvme_be_ramdisk_kv_init(struct xnvme_be_ramdisk_state *state,
+			 const struct xnvme_be_ramdisk_params *params)
+{
+	struct xnvme_be_ramdisk_kv *kv;
+	uint64_t nslots;
+	int err;
+
+	kv = calloc(1, sizeof(*kv));
+	if (!kv) {
+		XNVME_DEBUG("FAILED: calloc(kv), errno: %d", errno);
+		return -errno;
+	}
+
+	for (nslots = 2; nslots * 3 < (uint64_t)params->nkeys * 4; nslots <<= 1)
+		;
+
+	kv->slots = calloc(nslots, sizeof(*kv->slots));
+	if (!kv->slots) {
+		XNVME_DEBUG("FAILED: calloc(slots), errno: %d", errno);
+		free(kv);
+		return -ENOMEM;
+	}
+	kv->mask = nslots - 1;
+	kv->mnk = params->nkeys;
+	kv->nsze = params->nbytes;
+
+	err = pthread_mutex_init(&kv->lock, NULL);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_mutex_init(), err: %d", err);
+		free(kv->slots);
+		free(kv);
+		return -err;
+	}
+	state->kv = kv;
+
+	return 0;
+}
+#endif
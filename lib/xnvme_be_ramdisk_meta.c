@@ -0,0 +1,497 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700
+#endif
+#include <libxnvme.h>
+#include <xnvme_be.h>
+#ifdef XNVME_BE_RAMDISK_ENABLED
+#include <errno.h>
+#include <string.h>
+#include <xnvme_dev.h>
+#include <xnvme_crc.h>
+#include <xnvme_endian.h>
+#include <xnvme_be_ramdisk.h>
+
+/**
+ * Media and data integrity errors of the end-to-end protection information checks
+ */
+enum ramdisk_pi_sc {
+	RAMDISK_PI_SC_GUARD = 0x82,
+	RAMDISK_PI_SC_APPTAG = 0x83,
+	RAMDISK_PI_SC_REFTAG = 0x84,
+};
+
+/**
+ * The LBAs of a command, and the layout of their data and metadata in the buffers of the host.
+ * The ramdisk stores the metadata of the LBAs apart from their data, regardless of how it is
+ * transferred. With PRACT set, on a namespace where the metadata is just the protection
+ * information, the metadata is not transferred; it is inserted on write and stripped on read.
+ */
+struct ramdisk_xfer {
+	struct xnvme_be_ramdisk_state *state;
+	uint64_t slba;
+	uint64_t nlb;
+
+	uint8_t *dbuf;
+	uint8_t *mbuf;   ///< Separate metadata, NULL when interleaved or not transferred
+	size_t dstride;  ///< Bytes between the data of consecutive LBAs in 'dbuf'
+	size_t mlen;     ///< Bytes of metadata transferred per LBA, zero when none
+	uint64_t eilbrt; ///< Expected initial logical block reference tag
+	uint16_t lbat;
+	uint16_t lbatm;
+	uint8_t prchk;
+	bool pract;
+};
+
+static inline uint8_t *
+_sdata(const struct ramdisk_xfer *xfer, uint64_t i)
+{
+	return (uint8_t *)xfer->state->ramdisk + (xfer->slba + i) * xfer->state->lbads;
+}
+
+static inline uint8_t *
+_smeta(const struct ramdisk_xfer *xfer, uint64_t i)
+{
+	return xfer->state->meta + (xfer->slba + i) * xfer->state->ms;
+}
+
+static inline uint8_t *
+_hdata(const struct ramdisk_xfer *xfer, uint64_t i)
+{
+	return xfer->dbuf + i * xfer->dstride;
+}
+
+static inline uint8_t *
+_hmeta(const struct ramdisk_xfer *xfer, uint64_t i)
+{
+	if (!xfer->mlen) {
+		return NULL;
+	}
+
+	return xfer->mbuf ? xfer->mbuf + i * xfer->mlen : _hdata(xfer, i) + xfer->state->lbads;
+}
+
+static int
+_xfer_init(struct ramdisk_xfer *xfer, struct xnvme_cmd_ctx *ctx, uint64_t slba, void *dbuf,
+	   size_t dbuf_nbytes, void *mbuf, size_t mbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
+	bool stripped;
+
+	xfer->state = state;
+	xfer->slba = slba;
+	xfer->nlb = (uint64_t)ctx->cmd.nvm.nlb + 1;
+	xfer->dbuf = dbuf;
+
+	xfer->pract = state->pit && (ctx->cmd.nvm.prinfo & 0x8);
+	xfer->prchk = state->pit ? (ctx->cmd.nvm.prinfo & 0x7) : 0;
+	xfer->eilbrt = ctx->cmd.nvm.ilbrt;
+	if (state->pif == XNVME_SPEC_NVM_NS_64B_GUARD) {
+		xfer->eilbrt |= (uint64_t)(ctx->cmd.common.cdw03 & 0xFFFF) << 32;
+	}
+	xfer->lbat = ctx->cmd.nvm.lbat;
+	xfer->lbatm = ctx->cmd.nvm.lbatm;
+
+	stripped = xfer->pract && (state->ms == xnvme_pi_size(state->pif));
+	if (state->flags & XNVME_BE_RAMDISK_EXTENDED) {
+		xfer->mbuf = NULL;
+		xfer->mlen = stripped ? 0 : state->ms;
+		xfer->dstride = state->lbads + xfer->mlen;
+	} else {
+		xfer->mbuf = stripped ? NULL : mbuf;
+		xfer->mlen = xfer->mbuf ? state->ms : 0;
+		xfer->dstride = state->lbads;
+	}
+
+	if ((slba + xfer->nlb) * state->lbads > state->nbytes) {
+		XNVME_DEBUG("FAILED: slba: 0x%" PRIx64 ", nlb: %" PRIu64 " out of range", slba,
+			    xfer->nlb);
+		return -EINVAL;
+	}
+	if ((dbuf && (dbuf_nbytes < xfer->nlb * xfer->dstride)) ||
+	    (xfer->mbuf && (mbuf_nbytes < xfer->nlb * xfer->mlen))) {
+		XNVME_DEBUG("FAILED: dbuf_nbytes: %zu, mbuf_nbytes: %zu < nlb: %" PRIu64,
+			    dbuf_nbytes, mbuf_nbytes, xfer->nlb);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static inline size_t
+_pi_nbytes(const struct xnvme_be_ramdisk_state *state)
+{
+	return xnvme_pi_size(state->pif);
+}
+
+/**
+ * The protection information is either the first or the last bytes of the metadata
+ */
+static inline struct xnvme_pif *
+_pi_field(const struct xnvme_be_ramdisk_state *state, uint8_t *md)
+{
+	if (state->flags & XNVME_BE_RAMDISK_PI_FIRST) {
+		return (void *)md;
+	}
+
+	return (void *)(md + state->ms - _pi_nbytes(state));
+}
+
+/**
+ * The guard covers the data, and when the protection information is last, the metadata before it
+ */
+static uint64_t
+_pi_guard(const struct xnvme_be_ramdisk_state *state, const uint8_t *data, const uint8_t *md)
+{
+	size_t md_nbytes = 0;
+	uint64_t guard;
+
+	if (!(state->flags & XNVME_BE_RAMDISK_PI_FIRST)) {
+		md_nbytes = state->ms - _pi_nbytes(state);
+	}
+
+	if (state->pif == XNVME_SPEC_NVM_NS_16B_GUARD) {
+		guard = xnvme_crc16_t10dif(0, data, state->lbads);
+		return md_nbytes ? xnvme_crc16_t10dif(guard, md, md_nbytes) : guard;
+	}
+
+	guard = xnvme_crc64_nvme(data, state->lbads, 0);
+	return md_nbytes ? xnvme_crc64_nvme(md, md_nbytes, guard) : guard;
+}
+
+/**
+ * Reference tags are incremented per LBA, except for type 3, and span 32 bits with the 16b guard
+ * format and 48 bits with the 64b guard format
+ */
+static inline uint64_t
+_pi_reftag(const struct ramdisk_xfer *xfer, uint64_t i)
+{
+	const uint64_t mask = (xfer->state->pif == XNVME_SPEC_NVM_NS_16B_GUARD) ? UINT32_MAX
+										: 0xFFFFFFFFFFFFULL;
+
+	return (xfer->eilbrt + ((xfer->state->pit == XNVME_PI_TYPE3) ? 0 : i)) & mask;
+}
+
+static void
+_pi_generate(const struct ramdisk_xfer *xfer, uint64_t i)
+{
+	const struct xnvme_be_ramdisk_state *state = xfer->state;
+	const uint8_t *data = _sdata(xfer, i);
+	uint8_t *md = _smeta(xfer, i);
+	struct xnvme_pif *pif = _pi_field(state, md);
+	const uint64_t reftag = _pi_reftag(xfer, i);
+
+	if (state->pif == XNVME_SPEC_NVM_NS_16B_GUARD) {
+		xnvme_to_be16(&pif->g16.app_tag, xfer->lbat);
+		xnvme_to_be32(&pif->g16.stor_ref_space, (uint32_t)reftag);
+		xnvme_to_be16(&pif->g16.guard, (uint16_t)_pi_guard(state, data, md));
+	} else {
+		xnvme_to_be16(&pif->g64.app_tag, xfer->lbat);
+		xnvme_to_be16(&pif->g64.stor_ref_space_p1, (uint16_t)(reftag >> 32));
+		xnvme_to_be32(&pif->g64.stor_ref_space_p2, (uint32_t)reftag);
+		xnvme_to_be64(&pif->g64.guard, _pi_guard(state, data, md));
+	}
+}
+
+/**
+ * Check the protection information of the i'th LBA as given by PRCHK; all checks are disabled by
+ * an application tag of all ones, and for type 3, by a reference tag of all ones along with it
+ *
+ * @return 0 when the checks pass, otherwise the status code of the failed check
+ */
+static int
+_pi_check(const struct ramdisk_xfer *xfer, const uint8_t *data, uint8_t *md, uint64_t i)
+{
+	const struct xnvme_be_ramdisk_state *state = xfer->state;
+	struct xnvme_pif *pif = _pi_field(state, md);
+	uint64_t guard, reftag, reftag_ones;
+	uint16_t apptag;
+
+	if (state->pif == XNVME_SPEC_NVM_NS_16B_GUARD) {
+		guard = xnvme_from_be16(&pif->g16.guard);
+		apptag = xnvme_from_be16(&pif->g16.app_tag);
+		reftag = xnvme_from_be32(&pif->g16.stor_ref_space);
+		reftag_ones = UINT32_MAX;
+	} else {
+		guard = xnvme_from_be64(&pif->g64.guard);
+		apptag = xnvme_from_be16(&pif->g64.app_tag);
+		reftag = ((uint64_t)xnvme_from_be16(&pif->g64.stor_ref_space_p1) << 32) |
+			 xnvme_from_be32(&pif->g64.stor_ref_space_p2);
+		reftag_ones = 0xFFFFFFFFFFFFULL;
+	}
+
+	if ((apptag == XNVME_APPTAG_IGNORE) &&
+	    ((state->pit != XNVME_PI_TYPE3) || (reftag == reftag_ones))) {
+		return 0;
+	}
+
+	if ((xfer->prchk & XNVME_PI_FLAGS_GUARD_CHECK) && (guard != _pi_guard(state, data, md))) {
+		return RAMDISK_PI_SC_GUARD;
+	}
+	if ((xfer->prchk & XNVME_PI_FLAGS_APPTAG_CHECK) && ((apptag ^ xfer->lbat) & xfer->lbatm)) {
+		return RAMDISK_PI_SC_APPTAG;
+	}
+	if ((xfer->prchk & XNVME_PI_FLAGS_REFTAG_CHECK) && (state->pit != XNVME_PI_TYPE3) &&
+	    (reftag != _pi_reftag(xfer, i))) {
+		return RAMDISK_PI_SC_REFTAG;
+	}
+
+	return 0;
+}
+
+/**
+ * Check the LBAs of the transfer in the buffers of the host when 'host', otherwise as stored
+ */
+static int
+_pi_check_all(struct xnvme_cmd_ctx *ctx, const struct ramdisk_xfer *xfer, bool host)
+{
+	if (!xfer->prchk || (host && !xfer->mlen)) {
+		return 0;
+	}
+
+	for (uint64_t i = 0; i < xfer->nlb; ++i) {
+		int sc = host ? _pi_check(xfer, _hdata(xfer, i), _hmeta(xfer, i), i)
+			      : _pi_check(xfer, _sdata(xfer, i), _smeta(xfer, i), i);
+
+		if (sc) {
+			XNVME_DEBUG("FAILED: pi check, lba: 0x%" PRIx64 ", sc: 0x%x", xfer->slba + i,
+				    sc);
+			ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_MEDIA;
+			ctx->cpl.status.sc = sc;
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+static void
+_xfer_store(const struct ramdisk_xfer *xfer)
+{
+	const struct xnvme_be_ramdisk_state *state = xfer->state;
+
+	if (xfer->dstride == state->lbads) {
+		memcpy(_sdata(xfer, 0), xfer->dbuf, xfer->nlb * state->lbads);
+		if (xfer->mlen) {
+			memcpy(_smeta(xfer, 0), xfer->mbuf, xfer->nlb * state->ms);
+		}
+	} else {
+		for (uint64_t i = 0; i < xfer->nlb; ++i) {
+			memcpy(_sdata(xfer, i), _hdata(xfer, i), state->lbads);
+			memcpy(_smeta(xfer, i), _hmeta(xfer, i), state->ms);
+		}
+	}
+
+	if (xfer->pract) {
+		for (uint64_t i = 0; i < xfer->nlb; ++i) {
+			_pi_generate(xfer, i);
+		}
+	}
+}
+
+static void
+_xfer_load(const struct ramdisk_xfer *xfer)
+{
+	const struct xnvme_be_ramdisk_state *state = xfer->state;
+
+	if (xfer->dstride == state->lbads) {
+		memcpy(xfer->dbuf, _sdata(xfer, 0), xfer->nlb * state->lbads);
+		if (xfer->mlen) {
+			memcpy(xfer->mbuf, _smeta(xfer, 0), xfer->nlb * state->ms);
+		}
+		return;
+	}
+
+	for (uint64_t i = 0; i < xfer->nlb; ++i) {
+		memcpy(_hdata(xfer, i), _sdata(xfer, i), state->lbads);
+		memcpy(_hmeta(xfer, i), _smeta(xfer, i), state->ms);
+	}
+}
+
+static int
+_xfer_compare(const struct ramdisk_xfer *xfer)
+{
+	const struct xnvme_be_ramdisk_state *state = xfer->state;
+
+	for (uint64_t i = 0; i < xfer->nlb; ++i) {
+		if (memcmp(_hdata(xfer, i), _sdata(xfer, i), state->lbads) ||
+		    (xfer->mlen && memcmp(_hmeta(xfer, i), _smeta(xfer, i), state->ms))) {
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Write the LBAs of the transfer; protection information passed by the host is checked before
+ * anything is stored, and with PRACT, protection information is generated and replaces it
+ */
+static int
+_ramdisk_meta_write(struct xnvme_cmd_ctx *ctx, struct ramdisk_xfer *xfer)
+{
+	int err;
+
+	if (!xfer->pract) {
+		err = _pi_check_all(ctx, xfer, true);
+		if (err) {
+			return err;
+		}
+	}
+
+	if (xfer->state->znd) {
+		err = xnvme_be_ramdisk_znd_write(ctx, xfer->slba, xfer->nlb);
+		if (err) {
+			return err;
+		}
+	}
+
+	_xfer_store(xfer);
+
+	return 0;
+}
+
+static int
+_ramdisk_meta_write_zeroes(struct xnvme_cmd_ctx *ctx, struct ramdisk_xfer *xfer)
+{
+	const struct xnvme_be_ramdisk_state *state = xfer->state;
+	int err;
+
+	if (state->znd) {
+		err = xnvme_be_ramdisk_znd_write(ctx, xfer->slba, xfer->nlb);
+		if (err) {
+			return err;
+		}
+	}
+
+	memset(_sdata(xfer, 0), 0, xfer->nlb * state->lbads);
+	memset(_smeta(xfer, 0), 0, xfer->nlb * state->ms);
+	if (xfer->pract) {
+		for (uint64_t i = 0; i < xfer->nlb; ++i) {
+			_pi_generate(xfer, i);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Copy the source ranges, data and metadata, to the destination; the protection information is
+ * copied as is, PRINFOR and PRINFOW are not carried out
+ */
+static int
+_ramdisk_meta_scopy(struct xnvme_cmd_ctx *ctx, struct xnvme_spec_nvm_scopy_fmt_zero *ranges)
+{
+	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
+	const uint64_t nlbas = state->nbytes / state->lbads;
+	uint64_t sdlba = ctx->cmd.scopy.sdlba;
+	uint64_t nlb = 0;
+	int err;
+
+	for (int i = 0; i <= ctx->cmd.scopy.nr; i++) {
+		const uint64_t rnlb = (uint64_t)ranges[i].nlb + 1;
+
+		if ((ranges[i].slba >= nlbas) || (rnlb > nlbas - ranges[i].slba)) {
+			XNVME_DEBUG("FAILED: range: %d, slba: 0x%" PRIx64 ", nlb: %" PRIu64
+				    " out of range",
+				    i, ranges[i].slba, rnlb);
+			return -EINVAL;
+		}
+		nlb += rnlb;
+	}
+	if ((sdlba + nlb) * state->lbads > state->nbytes) {
+		XNVME_DEBUG("FAILED: sdlba: 0x%" PRIx64 ", nlb: %" PRIu64 " out of range", sdlba,
+			    nlb);
+		return -EINVAL;
+	}
+
+	if (state->znd) {
+		err = xnvme_be_ramdisk_znd_write(ctx, sdlba, nlb);
+		if (err) {
+			return err;
+		}
+	}
+
+	for (int i = 0; i <= ctx->cmd.scopy.nr; i++) {
+		const uint64_t rnlb = (uint64_t)ranges[i].nlb + 1;
+
+		memmove((uint8_t *)state->ramdisk + sdlba * state->lbads,
+			(uint8_t *)state->ramdisk + ranges[i].slba * state->lbads,
+			rnlb * state->lbads);
+		memmove(state->meta + sdlba * state->ms, state->meta + ranges[i].slba * state->ms,
+			rnlb * state->ms);
+		sdlba += rnlb;
+	}
+
+	return 0;
+}
+
+int
+xnvme_be_ramdisk_meta_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+			 size_t mbuf_nbytes)
+{
+	struct ramdisk_xfer xfer = {0};
+	int err;
+
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_NVM_OPC_WRITE:
+		err = _xfer_init(&xfer, ctx, ctx->cmd.nvm.slba, dbuf, dbuf_nbytes, mbuf,
+				 mbuf_nbytes);
+		return err ? err : _ramdisk_meta_write(ctx, &xfer);
+
+	case XNVME_SPEC_NVM_OPC_READ:
+		err = _xfer_init(&xfer, ctx, ctx->cmd.nvm.slba, dbuf, dbuf_nbytes, mbuf,
+				 mbuf_nbytes);
+		if (err) {
+			return err;
+		}
+		err = _pi_check_all(ctx, &xfer, false);
+		if (err) {
+			return err;
+		}
+		_xfer_load(&xfer);
+		return 0;
+
+	case XNVME_SPEC_NVM_OPC_COMPARE:
+		err = _xfer_init(&xfer, ctx, ctx->cmd.nvm.slba, dbuf, dbuf_nbytes, mbuf,
+				 mbuf_nbytes);
+		return err ? err : _xfer_compare(&xfer);
+
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+		err = _xfer_init(&xfer, ctx, ctx->cmd.nvm.slba, NULL, 0, NULL, 0);
+		return err ? err : _ramdisk_meta_write_zeroes(ctx, &xfer);
+
+	case XNVME_SPEC_NVM_OPC_SCOPY:
+		return _ramdisk_meta_scopy(ctx, dbuf);
+
+	case XNVME_SPEC_ZND_OPC_APPEND:
+		// The transfer is checked against the start of the zone, as the write pointer is
+		// only advanced, reserving the LBAs, once the transfer is known to succeed
+		err = _xfer_init(&xfer, ctx, ctx->cmd.znd.append.zslba, dbuf, dbuf_nbytes, mbuf,
+				 mbuf_nbytes);
+		if (err) {
+			return err;
+		}
+		if (!xfer.pract) {
+			err = _pi_check_all(ctx, &xfer, true);
+			if (err) {
+				return err;
+			}
+		}
+		err = xnvme_be_ramdisk_znd_append(ctx);
+		if (err) {
+			return err;
+		}
+		xfer.slba = ctx->cpl.result;
+		_xfer_store(&xfer);
+		return 0;
+
+	default:
+		XNVME_DEBUG("FAILED: nosys opcode: %d", ctx->cmd.common.opcode);
+		return -ENOSYS;
+	}
+}
+#endif
@@ -0,0 +1,186 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700
+#endif
+#include <libxnvme.h>
+#include <xnvme_be.h>
+#ifdef XNVME_BE_RAMDISK_ENABLED
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <xnvme_queue.h>
+#include <xnvme_dev.h>
+#include <xnvme_be_ramdisk.h>
+
+/**
+ * The tail of a wait which is spun instead of slept, as a sleep overshoots by the timer slack of
+ * the thread, 50usec by default on Linux; this trades a core spinning for the accuracy of the
+ * model at latencies of tens of usec
+ */
+#define RAMDISK_MODEL_SPIN_NS 50000ULL
+
+/**
+ * A performance model of a device with 'nch' channels; a read or a write occupies the channel
+ * which frees up first, for its latency plus the time it takes to transfer its data at the
+ * bandwidth of the channel. Commands queue up behind the channels once all of them are busy,
+ * thus, the throughput saturates at 'nch' commands in flight and the latency grows beyond it.
+ *
+ * Once the capacity has been written, the device is considered filled up, and writes are slowed
+ * down by the write amplification of garbage collection.
+ */
+struct xnvme_be_ramdisk_model {
+	pthread_mutex_t lock;
+
+	uint64_t rlat;          ///< Latency of reads in nsec
+	uint64_t wlat;          ///< Latency of writes in nsec
+	uint64_t olat;          ///< Latency of other commands in nsec
+	uint64_t bw;            ///< Bytes per second of a channel, zero means no transfer cost
+	uint64_t waf;           ///< Write amplification in percent
+	uint64_t nbytes_filled; ///< Bytes written before write amplification applies
+	uint64_t nbytes_written;
+
+	uint32_t nch;
+	uint64_t busy[]; ///< Time at which each channel is free, in nsec
+};
+
+uint64_t
+xnvme_be_ramdisk_model_deadline(struct xnvme_be_ramdisk_model *model,
+				const struct xnvme_cmd_ctx *ctx, size_t nbytes)
+{
+	const uint64_t now = _xnvme_timer_clock_sample();
+	uint64_t service, deadline;
+	uint32_t ch = 0;
+	bool write = false;
+
+	switch (ctx->cmd.common.opcode) {
+	case XNVME_SPEC_NVM_OPC_READ:
+	case XNVME_SPEC_NVM_OPC_COMPARE:
+	case XNVME_SPEC_FS_OPC_READ:
+		service = model->rlat;
+		break;
+
+	case XNVME_SPEC_NVM_OPC_WRITE:
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+	case XNVME_SPEC_NVM_OPC_SCOPY:
+	case XNVME_SPEC_ZND_OPC_APPEND:
+	case XNVME_SPEC_FS_OPC_WRITE:
+		service = model->wlat;
+		write = true;
+		break;
+
+	case XNVME_SPEC_NVM_OPC_FLUSH:
+	case XNVME_SPEC_FS_OPC_FLUSH:
+		// A flush completes once everything queued before it has
+		deadline = now;
+		pthread_mutex_lock(&model->lock);
+		for (uint32_t i = 0; i < model->nch; ++i) {
+			deadline = model->busy[i] > deadline ? model->busy[i] : deadline;
+		}
+		pthread_mutex_unlock(&model->lock);
+		return deadline + model->olat;
+
+	default:
+		return now + model->olat;
+	}
+
+	if (model->bw) {
+		service += (nbytes * 1000000000ULL) / model->bw;
+	}
+
+	pthread_mutex_lock(&model->lock);
+	if (write) {
+		if (model->nbytes_written >= model->nbytes_filled) {
+			service = (service * model->waf) / 100;
+		} else {
+			model->nbytes_written += nbytes;
+		}
+	}
+	for (uint32_t i = 1; i < model->nch; ++i) {
+		ch = model->busy[i] < model->busy[ch] ? i : ch;
+	}
+	deadline = (model->busy[ch] > now ? model->busy[ch] : now) + service;
+	model->busy[ch] = deadline;
+	pthread_mutex_unlock(&model->lock);
+
+	return deadline;
+}
+
+void
+xnvme_be_ramdisk_model_wait(uint64_t deadline)
+{
+	for (uint64_t now = _xnvme_timer_clock_sample(); now < deadline;
+	     now = _xnvme_timer_clock_sample()) {
+		uint64_t remaining = deadline - now;
+
+		if (remaining > RAMDISK_MODEL_SPIN_NS) {
+#if defined(XNVME_PLATFORM_LINUX_ENABLED) || defined(XNVME_PLATFORM_FREEBSD_ENABLED)
+			// Sleeping until an absolute time does not drift on interruption
+			struct timespec ts = {
+				.tv_sec = (deadline - RAMDISK_MODEL_SPIN_NS) / 1000000000ULL,
+				.tv_nsec = (deadline - RAMDISK_MODEL_SPIN_NS) % 1000000000ULL,
+			};
+
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+#else
+			struct timespec ts = {
+				.tv_sec = (remaining - RAMDISK_MODEL_SPIN_NS) / 1000000000ULL,
+				.tv_nsec = (remaining - RAMDISK_MODEL_SPIN_NS) % 1000000000ULL,
+			};
+
+			nanosleep(&ts, NULL);
+#endif
+		} else {
+			xnvme_queue_yield();
+		}
+	}
+}
+
+void
+xnvme_be_ramdisk_model_term(struct xnvme_be_ramdisk_state *state)
+{
+	if (!state->model) {
+		return;
+	}
+
+	pthread_mutex_destroy(&state->model->lock);
+	free(state->model);
+	state->model = NULL;
+}
+
+int
+xnvme_be_ramdisk_model_init(struct xnvme_be_ramdisk_state *state,
+			    const struct xnvme_be_ramdisk_params *params)
+{
+	struct xnvme_be_ramdisk_model *model;
+	int err;
+
+	model = calloc(1, sizeof(*model) + params->nch * sizeof(*model->busy));
+	if (!model) {
+		XNVME_DEBUG("FAILED: calloc(model), errno: %d", errno);
+		return -errno;
+	}
+
+	err = pthread_mutex_init(&model->lock, NULL);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_mutex_init(), err: %d", err);
+		free(model);
+		return -err;
+	}
+
+	model->rlat = params->rlat * 1000ULL;
+	model->wlat = params->wlat * 1000ULL;
+	model->olat = params->olat * 1000ULL;
+	model->bw = params->bw;
+	model->waf = params->waf ? params->waf : 100;
+	model->nbytes_filled = state->nbytes;
+	model->nch = params->nch;
+
+	state->model = model;
+
+	return 0;
+}
+#endif
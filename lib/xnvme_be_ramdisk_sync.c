@@ -10,13 +10,63 @@
 #include <xnvme_be_nosys.h>
 #ifdef XNVME_BE_RAMDISK_ENABLED
 #include <errno.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <xnvme_dev.h>
 #include <xnvme_be_ramdisk.h>
+#ifndef XNVME_PLATFORM_WINDOWS_ENABLED
+#include <sys/mman.h>
+#endif
 
-int
-xnvme_be_ramdisk_sync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
-			     size_t mbuf_nbytes)
+/**
+ * Write back the content of a file-backed ramdisk; for the others there is nothing to flush
+ */
+static int
+_ramdisk_flush(struct xnvme_be_ramdisk_state *state)
+{
+#ifndef XNVME_PLATFORM_WINDOWS_ENABLED
+	if ((state->flags & XNVME_BE_RAMDISK_FILE) &&
+	    msync(state->ramdisk, state->mapped, MS_SYNC)) {
+		XNVME_DEBUG("FAILED: msync(), errno: %d", errno);
+		return -errno;
+	}
+#endif
+	return 0;
+}
+
+/**
+ * The LBA commands of a ramdisk with metadata move the metadata along with the data
+ */
+static inline bool
+_ramdisk_meta_opc(uint8_t opc)
+{
+	switch (opc) {
+	case XNVME_SPEC_NVM_OPC_WRITE:
+	case XNVME_SPEC_NVM_OPC_READ:
+	case XNVME_SPEC_NVM_OPC_COMPARE:
+	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+	case XNVME_SPEC_NVM_OPC_SCOPY:
+	case XNVME_SPEC_ZND_OPC_APPEND:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * On a zoned ramdisk, writes must land at the write pointer of their zone, which they advance
+ */
+static inline int
+_ramdisk_zone_write(struct xnvme_be_ramdisk_state *state, struct xnvme_cmd_ctx *ctx,
+		    uint64_t slba, uint64_t nlb)
+{
+	return state->znd ? xnvme_be_ramdisk_znd_write(ctx, slba, nlb) : 0;
+}
+
+static int
+_ramdisk_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+		size_t mbuf_nbytes)
 {
 	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
 	struct xnvme_spec_nvm_scopy_fmt_zero *ranges = dbuf;
@@ -25,13 +75,24 @@ xnvme_be_ramdisk_sync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_
 	char *offset = state->ramdisk;
 	int err = 0;
 
+	if (state->meta && _ramdisk_meta_opc(ctx->cmd.common.opcode)) {
+		return xnvme_be_ramdisk_meta_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+	}
 	if (mbuf || mbuf_nbytes) {
 		XNVME_DEBUG("FAILED: mbuf or mbuf_nbytes provided");
 		return -ENOTSUP;
 	}
+	// The opcodes of the Key-Value command set overlap those of the NVM command set
+	if (state->kv) {
+		return xnvme_be_ramdisk_kv_io(ctx, dbuf, dbuf_nbytes);
+	}
 
 	switch (ctx->cmd.common.opcode) {
 	case XNVME_SPEC_NVM_OPC_WRITE:
+		err = _ramdisk_zone_write(state, ctx, ctx->cmd.nvm.slba, ctx->cmd.nvm.nlb + 1);
+		if (err) {
+			return err;
+		}
 		memcpy(offset + (ctx->cmd.nvm.slba << ssw), dbuf, dbuf_nbytes);
 		break;
 
@@ -40,6 +101,10 @@ xnvme_be_ramdisk_sync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_
 		break;
 
 	case XNVME_SPEC_NVM_OPC_WRITE_ZEROES:
+		err = _ramdisk_zone_write(state, ctx, ctx->cmd.nvm.slba, ctx->cmd.nvm.nlb + 1);
+		if (err) {
+			return err;
+		}
 		memset(offset + (ctx->cmd.nvm.slba << ssw), 0,
 		       (ctx->cmd.nvm.nlb + 1) * ctx->dev->geo.lba_nbytes);
 		break;
@@ -53,6 +118,17 @@ xnvme_be_ramdisk_sync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_
 		break;
 
 	case XNVME_SPEC_NVM_OPC_SCOPY:
+		if (state->znd) {
+			uint64_t nlb = 0;
+
+			for (int i = 0; i <= ctx->cmd.scopy.nr; i++) {
+				nlb += ranges[i].nlb + 1;
+			}
+			err = xnvme_be_ramdisk_znd_write(ctx, ctx->cmd.scopy.sdlba, nlb);
+			if (err) {
+				return err;
+			}
+		}
 
 		for (int i = 0; i <= ctx->cmd.scopy.nr; i++) {
 			char *dest = offset + sdlba_offset + (ctx->cmd.scopy.sdlba << ssw);
@@ -65,7 +141,7 @@ xnvme_be_ramdisk_sync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_
 
 	case XNVME_SPEC_NVM_OPC_FLUSH:
 	case XNVME_SPEC_FS_OPC_FLUSH:
-		break;
+		return _ramdisk_flush(state);
 
 	case XNVME_SPEC_NVM_OPC_DATASET_MANAGEMENT:
 		// Just pass on the command, as it is just a hint to the controller.
@@ -78,6 +154,26 @@ xnvme_be_ramdisk_sync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_
 		}
 		break;
 
+	case XNVME_SPEC_ZND_OPC_APPEND:
+		err = xnvme_be_ramdisk_znd_append(ctx);
+		if (err) {
+			return err;
+		}
+		memcpy(offset + (ctx->cpl.result << ssw), dbuf, dbuf_nbytes);
+		break;
+
+	case XNVME_SPEC_ZND_OPC_MGMT_SEND:
+		return xnvme_be_ramdisk_znd_mgmt_send(ctx);
+
+	case XNVME_SPEC_ZND_OPC_MGMT_RECV:
+		return xnvme_be_ramdisk_znd_mgmt_recv(ctx, dbuf, dbuf_nbytes);
+
+	case XNVME_SPEC_NVM_OPC_IO_MGMT_RECV:
+		return xnvme_be_ramdisk_fdp_mgmt_recv(ctx, dbuf, dbuf_nbytes);
+
+	case XNVME_SPEC_NVM_OPC_IO_MGMT_SEND:
+		return xnvme_be_ramdisk_fdp_mgmt_send(ctx, dbuf, dbuf_nbytes);
+
 	default:
 		XNVME_DEBUG("FAILED: nosys opcode: %d", ctx->cmd.common.opcode);
 		return -ENOSYS;
@@ -86,21 +182,106 @@ xnvme_be_ramdisk_sync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_
 	return err;
 }
 
+/**
+ * On a ramdisk with FDP, room for writes and copies is reserved before their data is moved, such
+ * that a reclaim group out of room fails the command without changing the media. They are placed,
+ * as are deallocations, once carried out, such that a command failing, e.g. on its protection
+ * information, does not count as written.
+ */
 int
-xnvme_be_ramdisk_sync_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
-			      size_t XNVME_UNUSED(dvec_nbytes), void *mbuf, size_t mbuf_nbytes)
+xnvme_be_ramdisk_sync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+			     size_t mbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
+	int err;
+
+	if (!state->fdp) {
+		return _ramdisk_cmd_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+	}
+
+	err = xnvme_be_ramdisk_fdp_reserve(ctx, dbuf);
+	if (err) {
+		return err;
+	}
+	err = _ramdisk_cmd_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+	if (err) {
+		xnvme_be_ramdisk_fdp_release(ctx, dbuf);
+		return err;
+	}
+
+	return xnvme_be_ramdisk_fdp_io(ctx, dbuf);
+}
+
+/**
+ * Vectored commands on a ramdisk with metadata go through a contiguous buffer, as interleaved
+ * metadata, and protection information, is laid out per LBA regardless of the vectors
+ */
+static int
+_ramdisk_sync_cmd_iov_meta(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+			   size_t dvec_nbytes, void *mbuf, size_t mbuf_nbytes)
+{
+	const bool is_read = ctx->cmd.common.opcode == XNVME_SPEC_NVM_OPC_READ;
+	uint8_t *buf;
+	size_t ofz = 0;
+	int err;
+
+	if (dvec_cnt == 1) {
+		return xnvme_be_ramdisk_meta_io(ctx, dvec[0].iov_base, dvec[0].iov_len, mbuf,
+						mbuf_nbytes);
+	}
+
+	buf = malloc(dvec_nbytes);
+	if (!buf) {
+		XNVME_DEBUG("FAILED: malloc(%zu), errno: %d", dvec_nbytes, errno);
+		return -errno;
+	}
+	for (size_t i = 0; !is_read && (i < dvec_cnt); ofz += dvec[i].iov_len, ++i) {
+		memcpy(buf + ofz, dvec[i].iov_base, dvec[i].iov_len);
+	}
+
+	err = xnvme_be_ramdisk_meta_io(ctx, buf, dvec_nbytes, mbuf, mbuf_nbytes);
+
+	for (size_t i = 0; !err && is_read && (i < dvec_cnt); ofz += dvec[i].iov_len, ++i) {
+		memcpy(dvec[i].iov_base, buf + ofz, dvec[i].iov_len);
+	}
+	free(buf);
+
+	return err;
+}
+
+static int
+_ramdisk_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+		 size_t dvec_nbytes, void *mbuf, size_t mbuf_nbytes)
 {
 	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
 	const uint64_t ssw = ctx->dev->geo.ssw;
 	char *offset = state->ramdisk;
+	int err;
 
+	if (state->meta && _ramdisk_meta_opc(ctx->cmd.common.opcode)) {
+		return _ramdisk_sync_cmd_iov_meta(ctx, dvec, dvec_cnt, dvec_nbytes, mbuf,
+						  mbuf_nbytes);
+	}
 	if (mbuf || mbuf_nbytes) {
 		XNVME_DEBUG("FAILED: mbuf or mbuf_nbytes provided");
 		return -ENOTSUP;
 	}
+	if (state->kv) {
+		if (dvec_cnt > 1) {
+			XNVME_DEBUG("FAILED: KV commands take a single vector, dvec_cnt: %zu",
+				    dvec_cnt);
+			return -ENOTSUP;
+		}
+		return xnvme_be_ramdisk_kv_io(ctx, dvec_cnt ? dvec[0].iov_base : NULL,
+					      dvec_nbytes);
+	}
 
 	switch (ctx->cmd.common.opcode) {
 	case XNVME_SPEC_NVM_OPC_WRITE:
+		err = _ramdisk_zone_write(state, ctx, ctx->cmd.nvm.slba, ctx->cmd.nvm.nlb + 1);
+		if (err) {
+			return err;
+		}
 		for (size_t i = 0; i < dvec_cnt; ++i) {
 			memcpy(offset + (ctx->cmd.nvm.slba << ssw), dvec[i].iov_base,
 			       dvec[i].iov_len);
@@ -130,9 +311,21 @@ xnvme_be_ramdisk_sync_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, siz
 		}
 		break;
 
+	case XNVME_SPEC_ZND_OPC_APPEND:
+		err = xnvme_be_ramdisk_znd_append(ctx);
+		if (err) {
+			return err;
+		}
+		for (size_t i = 0; i < dvec_cnt; ++i) {
+			memcpy(offset + (ctx->cpl.result << ssw), dvec[i].iov_base,
+			       dvec[i].iov_len);
+			offset += dvec[i].iov_len;
+		}
+		break;
+
 	case XNVME_SPEC_NVM_OPC_FLUSH:
 	case XNVME_SPEC_FS_OPC_FLUSH:
-		break;
+		return _ramdisk_flush(state);
 
 	default:
 		XNVME_DEBUG("FAILED: nosys opcode: %d", ctx->cmd.common.opcode);
@@ -141,13 +334,81 @@ xnvme_be_ramdisk_sync_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, siz
 
 	return 0;
 }
+
+int
+xnvme_be_ramdisk_sync_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+			      size_t dvec_nbytes, void *mbuf, size_t mbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
+	int err;
+
+	if (!state->fdp) {
+		return _ramdisk_cmd_iov(ctx, dvec, dvec_cnt, dvec_nbytes, mbuf, mbuf_nbytes);
+	}
+
+	// The vectors do not hold copy or deallocate ranges, only writes are placed
+	err = xnvme_be_ramdisk_fdp_reserve(ctx, NULL);
+	if (err) {
+		return err;
+	}
+	err = _ramdisk_cmd_iov(ctx, dvec, dvec_cnt, dvec_nbytes, mbuf, mbuf_nbytes);
+	if (err) {
+		xnvme_be_ramdisk_fdp_release(ctx, NULL);
+		return err;
+	}
+
+	return xnvme_be_ramdisk_fdp_io(ctx, NULL);
+}
+
+/**
+ * With a performance model, the calling thread is held until the command completes by the model;
+ * the ramdisk async interface calls the functions above directly, and holds the completion instead
+ */
+static int
+_ramdisk_sync_cmd_io(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *mbuf,
+		     size_t mbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
+	uint64_t deadline;
+	int err;
+
+	if (!state->model) {
+		return xnvme_be_ramdisk_sync_cmd_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+	}
+
+	deadline = xnvme_be_ramdisk_model_deadline(state->model, ctx, dbuf_nbytes);
+	err = xnvme_be_ramdisk_sync_cmd_io(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+	xnvme_be_ramdisk_model_wait(deadline);
+
+	return err;
+}
+
+static int
+_ramdisk_sync_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cnt,
+		      size_t dvec_nbytes, void *mbuf, size_t mbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_state *state = (void *)ctx->dev->be.state;
+	uint64_t deadline;
+	int err;
+
+	if (!state->model) {
+		return xnvme_be_ramdisk_sync_cmd_iov(ctx, dvec, dvec_cnt, dvec_nbytes, mbuf,
+						     mbuf_nbytes);
+	}
+
+	deadline = xnvme_be_ramdisk_model_deadline(state->model, ctx, dvec_nbytes);
+	err = xnvme_be_ramdisk_sync_cmd_iov(ctx, dvec, dvec_cnt, dvec_nbytes, mbuf, mbuf_nbytes);
+	xnvme_be_ramdisk_model_wait(deadline);
+
+	return err;
+}
 #endif
 
 struct xnvme_be_sync g_xnvme_be_ramdisk_sync = {
 	.id = "ramdisk",
 #ifdef XNVME_BE_RAMDISK_ENABLED
-	.cmd_io = xnvme_be_ramdisk_sync_cmd_io,
-	.cmd_iov = xnvme_be_ramdisk_sync_cmd_iov,
+	.cmd_io = _ramdisk_sync_cmd_io,
+	.cmd_iov = _ramdisk_sync_cmd_iov,
 #else
 	.cmd_io = xnvme_be_nosys_sync_cmd_io,
 	.cmd_iov = xnvme_be_nosys_sync_cmd_iov,
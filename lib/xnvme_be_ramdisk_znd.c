@@ -0,0 +1,574 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 700
+#endif
+#include <libxnvme.h>
+#include <xnvme_be.h>
+#ifdef XNVME_BE_RAMDISK_ENABLED
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <xnvme_dev.h>
+#include <xnvme_be_ramdisk.h>
+
+/**
+ * The zone state machine of a zoned ramdisk; all zones are sequential write required and the
+ * write pointers, states and resource counters are serialized by 'lock', as commands are executed
+ * by the threads of the thrpool and the ramdisk async interfaces. Data is copied outside of the
+ * lock, into the LBAs reserved by advancing the write pointer.
+ */
+struct ramdisk_zone {
+	uint64_t wp;
+	uint8_t state;
+};
+
+struct xnvme_be_ramdisk_znd {
+	pthread_mutex_t lock;
+
+	uint64_t zsze;    ///< Zone size, in LBAs
+	uint64_t zcap;    ///< Zone capacity, in LBAs
+	uint64_t nzones;  ///< Number of zones
+	uint32_t mor;     ///< Maximum open zones, zero means no limit
+	uint32_t mar;     ///< Maximum active zones, zero means no limit
+	uint32_t nopen;   ///< Zones in the implicitly or explicitly opened state
+	uint32_t nactive; ///< Zones in an opened or the closed state
+
+	struct ramdisk_zone zones[];
+};
+
+static int
+_znd_status(struct xnvme_cmd_ctx *ctx, uint8_t sct, uint8_t sc)
+{
+	ctx->cpl.status.sct = sct;
+	ctx->cpl.status.sc = sc;
+
+	return -EIO;
+}
+
+static inline struct xnvme_be_ramdisk_znd *
+_znd(struct xnvme_cmd_ctx *ctx)
+{
+	return ((struct xnvme_be_ramdisk_state *)ctx->dev->be.state)->znd;
+}
+
+static inline uint64_t
+_zslba(struct xnvme_be_ramdisk_znd *znd, struct ramdisk_zone *zone)
+{
+	return (zone - znd->zones) * znd->zsze;
+}
+
+/**
+ * Release the open and active resources held by 'zone' and transition it to 'state'
+ */
+static void
+_zone_release(struct xnvme_be_ramdisk_znd *znd, struct ramdisk_zone *zone, uint8_t state)
+{
+	switch (zone->state) {
+	case XNVME_SPEC_ZND_STATE_IOPEN:
+	case XNVME_SPEC_ZND_STATE_EOPEN:
+		znd->nopen -= 1;
+		znd->nactive -= 1;
+		break;
+
+	case XNVME_SPEC_ZND_STATE_CLOSED:
+		znd->nactive -= 1;
+		break;
+
+	default:
+		break;
+	}
+
+	zone->state = state;
+}
+
+static void
+_zone_close(struct xnvme_be_ramdisk_znd *znd, struct ramdisk_zone *zone)
+{
+	znd->nopen -= 1;
+	zone->state = XNVME_SPEC_ZND_STATE_CLOSED;
+}
+
+static void
+_zone_finish(struct xnvme_be_ramdisk_znd *znd, struct ramdisk_zone *zone)
+{
+	_zone_release(znd, zone, XNVME_SPEC_ZND_STATE_FULL);
+	zone->wp = _zslba(znd, zone) + znd->zcap;
+}
+
+static void
+_zone_reset(struct xnvme_be_ramdisk_znd *znd, struct ramdisk_zone *zone)
+{
+	_zone_release(znd, zone, XNVME_SPEC_ZND_STATE_EMPTY);
+	zone->wp = _zslba(znd, zone);
+}
+
+/**
+ * Transition an empty, closed or opened zone to 'state', an opened state, taking the resources
+ * it needs; when all open resources are taken, an implicitly opened zone is closed to free one
+ *
+ * @return On success, 0 is returned. On error, the zoned status-code is returned.
+ */
+static int
+_zone_open(struct xnvme_be_ramdisk_znd *znd, struct ramdisk_zone *zone, uint8_t state)
+{
+	switch (zone->state) {
+	case XNVME_SPEC_ZND_STATE_IOPEN:
+	case XNVME_SPEC_ZND_STATE_EOPEN:
+		if (state == XNVME_SPEC_ZND_STATE_EOPEN) {
+			zone->state = state;
+		}
+		return 0;
+
+	case XNVME_SPEC_ZND_STATE_EMPTY:
+		if (znd->mar && (znd->nactive == znd->mar)) {
+			return XNVME_SPEC_ZND_SC_TOO_MANY_ACTIVE;
+		}
+		break;
+
+	case XNVME_SPEC_ZND_STATE_CLOSED:
+		break;
+
+	default:
+		return XNVME_SPEC_ZND_SC_INVALID_TRANS;
+	}
+
+	if (znd->mor && (znd->nopen == znd->mor)) {
+		struct ramdisk_zone *victim = NULL;
+
+		for (uint64_t i = 0; i < znd->nzones; ++i) {
+			if (znd->zones[i].state == XNVME_SPEC_ZND_STATE_IOPEN) {
+				victim = &znd->zones[i];
+				break;
+			}
+		}
+		if (!victim) {
+			return XNVME_SPEC_ZND_SC_TOO_MANY_OPEN;
+		}
+		_zone_close(znd, victim);
+	}
+
+	if (zone->state == XNVME_SPEC_ZND_STATE_EMPTY) {
+		znd->nactive += 1;
+	}
+	znd->nopen += 1;
+	zone->state = state;
+
+	return 0;
+}
+
+/**
+ * Advance the write pointer of 'zone', at 'slba', by 'nlb', opening the zone implicitly and
+ * transitioning it to full when its capacity is reached
+ *
+ * @return On success, 0 is returned. On error, the zoned status-code is returned.
+ */
+static int
+_zone_write(struct xnvme_be_ramdisk_znd *znd, struct ramdisk_zone *zone, uint64_t slba,
+	    uint64_t nlb)
+{
+	int sc;
+
+	switch (zone->state) {
+	case XNVME_SPEC_ZND_STATE_FULL:
+		return XNVME_SPEC_ZND_SC_IS_FULL;
+	case XNVME_SPEC_ZND_STATE_RONLY:
+		return XNVME_SPEC_ZND_SC_IS_READONLY;
+	case XNVME_SPEC_ZND_STATE_OFFLINE:
+		return XNVME_SPEC_ZND_SC_IS_OFFLINE;
+	default:
+		break;
+	}
+
+	if (slba != zone->wp) {
+		return XNVME_SPEC_ZND_SC_INVALID_WRITE;
+	}
+	if (zone->wp + nlb > _zslba(znd, zone) + znd->zcap) {
+		return XNVME_SPEC_ZND_SC_BOUNDARY_ERROR;
+	}
+
+	sc = _zone_open(znd, zone, XNVME_SPEC_ZND_STATE_IOPEN);
+	if (sc) {
+		return sc;
+	}
+
+	zone->wp += nlb;
+	if (zone->wp == _zslba(znd, zone) + znd->zcap) {
+		_zone_release(znd, zone, XNVME_SPEC_ZND_STATE_FULL);
+	}
+
+	return 0;
+}
+
+int
+xnvme_be_ramdisk_znd_write(struct xnvme_cmd_ctx *ctx, uint64_t slba, uint64_t nlb)
+{
+	struct xnvme_be_ramdisk_znd *znd = _znd(ctx);
+	struct ramdisk_zone *zone;
+	int sc;
+
+	if (slba / znd->zsze >= znd->nzones) {
+		return _znd_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+				   XNVME_STATUS_CODE_INVALID_FIELD);
+	}
+	zone = &znd->zones[slba / znd->zsze];
+
+	pthread_mutex_lock(&znd->lock);
+	sc = _zone_write(znd, zone, slba, nlb);
+	pthread_mutex_unlock(&znd->lock);
+
+	return sc ? _znd_status(ctx, XNVME_STATUS_CODE_TYPE_CMDSPEC, sc) : 0;
+}
+
+int
+xnvme_be_ramdisk_znd_append(struct xnvme_cmd_ctx *ctx)
+{
+	struct xnvme_be_ramdisk_znd *znd = _znd(ctx);
+	const uint64_t zslba = ctx->cmd.znd.append.zslba;
+	struct ramdisk_zone *zone;
+	uint64_t wp;
+	int sc;
+
+	if (!znd) {
+		XNVME_DEBUG("FAILED: ramdisk is not zoned");
+		return -ENOSYS;
+	}
+	if ((zslba % znd->zsze) || (zslba / znd->zsze >= znd->nzones)) {
+		return _znd_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+				   XNVME_STATUS_CODE_INVALID_FIELD);
+	}
+	zone = &znd->zones[zslba / znd->zsze];
+
+	pthread_mutex_lock(&znd->lock);
+	wp = zone->wp;
+	sc = _zone_write(znd, zone, wp, ctx->cmd.znd.append.nlb + 1);
+	pthread_mutex_unlock(&znd->lock);
+
+	if (sc) {
+		return _znd_status(ctx, XNVME_STATUS_CODE_TYPE_CMDSPEC, sc);
+	}
+	ctx->cpl.result = wp;
+
+	return 0;
+}
+
+/**
+ * Apply the action to a single zone; actions which leave the zone in its current state succeed
+ *
+ * @return On success, 0 is returned. On error, the zoned status-code is returned.
+ */
+static int
+_zone_send(struct xnvme_be_ramdisk_znd *znd, struct ramdisk_zone *zone, uint8_t zsa)
+{
+	switch (zsa) {
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_CLOSE:
+		switch (zone->state) {
+		case XNVME_SPEC_ZND_STATE_IOPEN:
+		case XNVME_SPEC_ZND_STATE_EOPEN:
+			_zone_close(znd, zone);
+			return 0;
+		case XNVME_SPEC_ZND_STATE_CLOSED:
+			return 0;
+		default:
+			return XNVME_SPEC_ZND_SC_INVALID_TRANS;
+		}
+
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_FINISH:
+		switch (zone->state) {
+		case XNVME_SPEC_ZND_STATE_EMPTY:
+		case XNVME_SPEC_ZND_STATE_IOPEN:
+		case XNVME_SPEC_ZND_STATE_EOPEN:
+		case XNVME_SPEC_ZND_STATE_CLOSED:
+			_zone_finish(znd, zone);
+			return 0;
+		case XNVME_SPEC_ZND_STATE_FULL:
+			return 0;
+		default:
+			return XNVME_SPEC_ZND_SC_INVALID_TRANS;
+		}
+
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_OPEN:
+		return _zone_open(znd, zone, XNVME_SPEC_ZND_STATE_EOPEN);
+
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_RESET:
+		switch (zone->state) {
+		case XNVME_SPEC_ZND_STATE_RONLY:
+		case XNVME_SPEC_ZND_STATE_OFFLINE:
+			return XNVME_SPEC_ZND_SC_INVALID_TRANS;
+		default:
+			_zone_reset(znd, zone);
+			return 0;
+		}
+
+	case XNVME_SPEC_ZND_CMD_MGMT_SEND_OFFLINE:
+		switch (zone->state) {
+		case XNVME_SPEC_ZND_STATE_RONLY:
+			zone->state = XNVME_SPEC_ZND_STATE_OFFLINE;
+			return 0;
+		case XNVME_SPEC_ZND_STATE_OFFLINE:
+			return 0;
+		default:
+			return XNVME_SPEC_ZND_SC_INVALID_TRANS;
+		}
+	}
+
+	return XNVME_SPEC_ZND_SC_INVALID_ZONE_OP;
+}
+
+/**
+ * With 'select_all' the action applies to the zones in the states it transitions from, e.g. open
+ * applies to closed zones only; the open and active resources are checked up-front, such that
+ * either all or none of the zones are transitioned
+ */
+static int
+_zone_send_all(struct xnvme_be_ramdisk_znd *znd, uint8_t zsa)
+{
+	uint32_t nclosed = 0;
+
+	for (uint64_t i = 0; i < znd->nzones; ++i) {
+		nclosed += znd->zones[i].state == XNVME_SPEC_ZND_STATE_CLOSED;
+	}
+	if ((zsa == XNVME_SPEC_ZND_CMD_MGMT_SEND_OPEN) && znd->mor &&
+	    (znd->nopen + nclosed > znd->mor)) {
+		return XNVME_SPEC_ZND_SC_TOO_MANY_OPEN;
+	}
+
+	for (uint64_t i = 0; i < znd->nzones; ++i) {
+		struct ramdisk_zone *zone = &znd->zones[i];
+		bool eligible;
+
+		switch (zsa) {
+		case XNVME_SPEC_ZND_CMD_MGMT_SEND_CLOSE:
+			eligible = (zone->state == XNVME_SPEC_ZND_STATE_IOPEN) ||
+				   (zone->state == XNVME_SPEC_ZND_STATE_EOPEN);
+			break;
+		case XNVME_SPEC_ZND_CMD_MGMT_SEND_FINISH:
+			eligible = (zone->state == XNVME_SPEC_ZND_STATE_IOPEN) ||
+				   (zone->state == XNVME_SPEC_ZND_STATE_EOPEN) ||
+				   (zone->state == XNVME_SPEC_ZND_STATE_CLOSED);
+			break;
+		case XNVME_SPEC_ZND_CMD_MGMT_SEND_OPEN:
+			eligible = zone->state == XNVME_SPEC_ZND_STATE_CLOSED;
+			break;
+		case XNVME_SPEC_ZND_CMD_MGMT_SEND_RESET:
+			eligible = (zone->state != XNVME_SPEC_ZND_STATE_EMPTY) &&
+				   (zone->state != XNVME_SPEC_ZND_STATE_RONLY) &&
+				   (zone->state != XNVME_SPEC_ZND_STATE_OFFLINE);
+			break;
+		case XNVME_SPEC_ZND_CMD_MGMT_SEND_OFFLINE:
+			eligible = zone->state == XNVME_SPEC_ZND_STATE_RONLY;
+			break;
+		default:
+			return XNVME_SPEC_ZND_SC_INVALID_ZONE_OP;
+		}
+
+		if (eligible) {
+			_zone_send(znd, zone, zsa);
+		}
+	}
+
+	return 0;
+}
+
+int
+xnvme_be_ramdisk_znd_mgmt_send(struct xnvme_cmd_ctx *ctx)
+{
+	struct xnvme_be_ramdisk_znd *znd = _znd(ctx);
+	const struct xnvme_spec_znd_cmd_mgmt_send *cmd = &ctx->cmd.znd.mgmt_send;
+	int sc;
+
+	if (!znd) {
+		XNVME_DEBUG("FAILED: ramdisk is not zoned");
+		return -ENOSYS;
+	}
+
+	// Zone descriptor extensions and ZRWAs are not supported
+	if ((cmd->zsa == XNVME_SPEC_ZND_CMD_MGMT_SEND_DESCRIPTOR) ||
+	    (cmd->zsa == XNVME_SPEC_ZND_CMD_MGMT_SEND_FLUSH) || cmd->zsaso ||
+	    (!cmd->select_all &&
+	     ((cmd->slba % znd->zsze) || (cmd->slba / znd->zsze >= znd->nzones)))) {
+		return _znd_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+				   XNVME_STATUS_CODE_INVALID_FIELD);
+	}
+
+	pthread_mutex_lock(&znd->lock);
+	sc = cmd->select_all ? _zone_send_all(znd, cmd->zsa)
+			     : _zone_send(znd, &znd->zones[cmd->slba / znd->zsze], cmd->zsa);
+	pthread_mutex_unlock(&znd->lock);
+
+	return sc ? _znd_status(ctx, XNVME_STATUS_CODE_TYPE_CMDSPEC, sc) : 0;
+}
+
+static bool
+_zone_matches(const struct ramdisk_zone *zone, uint8_t zrasf)
+{
+	switch (zrasf) {
+	case XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_ALL:
+		return true;
+	case XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_EMPTY:
+		return zone->state == XNVME_SPEC_ZND_STATE_EMPTY;
+	case XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_IOPEN:
+		return zone->state == XNVME_SPEC_ZND_STATE_IOPEN;
+	case XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_EOPEN:
+		return zone->state == XNVME_SPEC_ZND_STATE_EOPEN;
+	case XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_CLOSED:
+		return zone->state == XNVME_SPEC_ZND_STATE_CLOSED;
+	case XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_FULL:
+		return zone->state == XNVME_SPEC_ZND_STATE_FULL;
+	case XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_RONLY:
+		return zone->state == XNVME_SPEC_ZND_STATE_RONLY;
+	case XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_OFFLINE:
+		return zone->state == XNVME_SPEC_ZND_STATE_OFFLINE;
+	}
+
+	return false;
+}
+
+int
+xnvme_be_ramdisk_znd_mgmt_recv(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes)
+{
+	struct xnvme_be_ramdisk_znd *znd = _znd(ctx);
+	const struct xnvme_spec_znd_cmd_mgmt_recv *cmd = &ctx->cmd.znd.mgmt_recv;
+	struct xnvme_spec_znd_report_hdr *hdr = dbuf;
+	struct xnvme_spec_znd_descr *descrs = (void *)(hdr + 1);
+	uint64_t nmatched = 0, nreported = 0, ndescrs;
+
+	if (!znd) {
+		XNVME_DEBUG("FAILED: ramdisk is not zoned");
+		return -ENOSYS;
+	}
+
+	if (dbuf_nbytes > ((size_t)cmd->ndwords + 1) * 4) {
+		dbuf_nbytes = ((size_t)cmd->ndwords + 1) * 4;
+	}
+	if ((cmd->zra != XNVME_SPEC_ZND_CMD_MGMT_RECV_ACTION_REPORT) ||
+	    (cmd->zrasf > XNVME_SPEC_ZND_CMD_MGMT_RECV_SF_OFFLINE) ||
+	    (cmd->slba / znd->zsze >= znd->nzones) || (dbuf_nbytes < sizeof(*hdr))) {
+		return _znd_status(ctx, XNVME_STATUS_CODE_TYPE_GENERIC,
+				   XNVME_STATUS_CODE_INVALID_FIELD);
+	}
+	ndescrs = (dbuf_nbytes - sizeof(*hdr)) / sizeof(*descrs);
+
+	memset(hdr, 0, sizeof(*hdr));
+
+	pthread_mutex_lock(&znd->lock);
+	for (uint64_t i = cmd->slba / znd->zsze; i < znd->nzones; ++i) {
+		struct ramdisk_zone *zone = &znd->zones[i];
+		struct xnvme_spec_znd_descr *descr = &descrs[nreported];
+
+		if (!_zone_matches(zone, cmd->zrasf)) {
+			continue;
+		}
+		nmatched += 1;
+
+		if (nreported == ndescrs) {
+			if (cmd->partial) {
+				break;
+			}
+			continue;
+		}
+		nreported += 1;
+
+		memset(descr, 0, sizeof(*descr));
+		descr->zt = XNVME_SPEC_ZND_TYPE_SEQWR;
+		descr->zs = zone->state;
+		descr->zcap = znd->zcap;
+		descr->zslba = _zslba(znd, zone);
+		descr->wp = zone->wp;
+	}
+	pthread_mutex_unlock(&znd->lock);
+
+	hdr->nzones = cmd->partial ? nreported : nmatched;
+
+	return 0;
+}
+
+int
+xnvme_be_ramdisk_znd_idfy_ctrlr(struct xnvme_dev *dev, void *dbuf)
+{
+	struct xnvme_spec_znd_idfy_ctrlr *ctrlr = dbuf;
+
+	if (!((struct xnvme_be_ramdisk_state *)dev->be.state)->znd) {
+		return 1;
+	}
+
+	ctrlr->zasl = 0; ///< Zone Append is limited by MDTS only
+
+	return 0;
+}
+
+int
+xnvme_be_ramdisk_znd_idfy_ns(struct xnvme_dev *dev, void *dbuf)
+{
+	struct xnvme_be_ramdisk_znd *znd = ((struct xnvme_be_ramdisk_state *)dev->be.state)->znd;
+	struct xnvme_spec_znd_idfy_ns *ns = dbuf;
+
+	if (!znd) {
+		return 1;
+	}
+
+	ns->ozcs.bits.razb = 1;
+
+	// Both limits are zero-based, with all bits set meaning no limit
+	ns->mar = znd->mar ? znd->mar - 1 : UINT32_MAX;
+	ns->mor = znd->mor ? znd->mor - 1 : UINT32_MAX;
+
+	ns->lbafe[0].zsze = znd->zsze;
+	ns->lbafe[0].zdes = 0;
+
+	return 0;
+}
+
+void
+xnvme_be_ramdisk_znd_term(struct xnvme_be_ramdisk_state *state)
+{
+	if (!state->znd) {
+		return;
+	}
+
+	pthread_mutex_destroy(&state->znd->lock);
+	free(state->znd);
+	state->znd = NULL;
+}
+
+int
+xnvme_be_ramdisk_znd_init(struct xnvme_be_ramdisk_state *state,
+			  const struct xnvme_be_ramdisk_params *params)
+{
+	const uint64_t nzones = params->nbytes / params->zsze;
+	struct xnvme_be_ramdisk_znd *znd;
+	int err;
+
+	znd = calloc(1, sizeof(*znd) + nzones * sizeof(*znd->zones));
+	if (!znd) {
+		XNVME_DEBUG("FAILED: calloc(znd), errno: %d", errno);
+		return -errno;
+	}
+
+	err = pthread_mutex_init(&znd->lock, NULL);
+	if (err) {
+		XNVME_DEBUG("FAILED: pthread_mutex_init(), err: %d", err);
+		free(znd);
+		return -err;
+	}
+
+	znd->zsze = params->zsze / params->lbads;
+	znd->zcap = params->zcap / params->lbads;
+	znd->nzones = nzones;
+	znd->mor = params->mor;
+	znd->mar = params->mar;
+
+	for (uint64_t i = 0; i < nzones; ++i) {
+		znd->zones[i].wp = i * znd->zsze;
+		znd->zones[i].state = XNVME_SPEC_ZND_STATE_EMPTY;
+	}
+
+	// Capacity beyond the last whole zone is not exposed
+	state->nbytes = nzones * params->zsze;
+	state->znd = znd;
+
+	return 0;
+}
+#endif
@@ -7,6 +7,7 @@
 #include <xnvme_be_nosys.h>
 #ifdef XNVME_BE_SPDK_ENABLED
 #include <errno.h>
+#include <stdatomic.h>
 #include <spdk/env.h>
 #include <xnvme_dev.h>
 #include <xnvme_queue.h>
@@ -88,28 +89,119 @@ xnvme_be_spdk_queue_term(struct xnvme_queue *q)
 	return err;
 }
 
+static inline void
+cmd_async_complete(struct xnvme_cmd_ctx *ctx)
+{
+	struct xnvme_queue_spdk *queue = (void *)ctx->async.queue;
+
+	ctx->async.queue->base.outstanding -= 1;
+
+	if (queue->reaped) {
+		queue->reaped[queue->nreaped++] = ctx;
+		return;
+	}
+
+	ctx->async.cb(ctx, ctx->async.cb_arg);
+}
+
+static void
+cmd_async_cb(void *cb_arg, const struct spdk_nvme_cpl *cpl)
+{
+	struct xnvme_cmd_ctx *ctx = cb_arg;
+
+	ctx->cpl = *(const struct xnvme_spec_cpl *)cpl;
+
+	cmd_async_complete(ctx);
+}
+
+static void
+cmd_admin_async_cb(void *cb_arg, const struct spdk_nvme_cpl *cpl)
+{
+	struct xnvme_be_spdk_admin_slot *slot = cb_arg;
+
+	slot->ctx->cpl = *(const struct xnvme_spec_cpl *)cpl;
+	atomic_store_explicit(&slot->done, 1, memory_order_release);
+}
+
+/**
+ * Process the admin completions of the controller and complete up to 'max' of the admin-commands
+ * submitted via the given queue
+ */
+static uint32_t
+admin_complete(struct xnvme_queue_spdk *queue, uint32_t max)
+{
+	struct xnvme_be_spdk_state *state = (void *)queue->base.dev->be.state;
+	uint32_t completed = 0;
+
+	spdk_nvme_ctrlr_process_admin_completions(state->ctrlr);
+
+	for (uint32_t i = 0; (i < XNVME_BE_SPDK_QUEUE_NADMIN) && queue->nadmin; ++i) {
+		struct xnvme_be_spdk_admin_slot *slot = &queue->admin[i];
+		struct xnvme_cmd_ctx *ctx = slot->ctx;
+
+		if (max && (completed == max)) {
+			break;
+		}
+		if (!ctx || !atomic_load_explicit(&slot->done, memory_order_acquire)) {
+			continue;
+		}
+
+		slot->ctx = NULL;
+		queue->nadmin -= 1;
+		completed += 1;
+
+		cmd_async_complete(ctx);
+	}
+
+	return completed;
+}
+
 int
 xnvme_be_spdk_queue_poke(struct xnvme_queue *q, uint32_t max)
 {
 	struct xnvme_queue_spdk *queue = (void *)q;
+	uint32_t nadmin = 0;
 	int err;
 
-	err = spdk_nvme_qpair_process_completions(queue->qpair, max);
+	if (queue->nadmin) {
+		nadmin = admin_complete(queue, max);
+		if (max && (nadmin == max)) {
+			return nadmin;
+		}
+	}
+
+	err = spdk_nvme_qpair_process_completions(queue->qpair, max ? max - nadmin : 0);
 	if (err < 0) {
 		XNVME_DEBUG("FAILED: spdk_nvme_qpair_process_completion(), err: %d", err);
+		return err;
 	}
 
-	return err;
+	return err + nadmin;
 }
 
-static void
-cmd_async_cb(void *cb_arg, const struct spdk_nvme_cpl *cpl)
+int
+xnvme_be_spdk_queue_reap(struct xnvme_queue *q, struct xnvme_cmd_ctx **ctxs, uint32_t max)
 {
-	struct xnvme_cmd_ctx *ctx = cb_arg;
+	struct xnvme_queue_spdk *queue = (void *)q;
+	int err = 0;
 
-	ctx->async.queue->base.outstanding -= 1;
-	ctx->cpl = *(const struct xnvme_spec_cpl *)cpl;
-	ctx->async.cb(ctx, ctx->async.cb_arg);
+	queue->reaped = ctxs;
+	queue->nreaped = 0;
+
+	if (queue->nadmin) {
+		admin_complete(queue, max);
+	}
+	if (!max || (queue->nreaped < max)) {
+		err = spdk_nvme_qpair_process_completions(queue->qpair,
+							  max ? max - queue->nreaped : 0);
+	}
+	queue->reaped = NULL;
+	if (err < 0) {
+		XNVME_DEBUG("FAILED: spdk_nvme_qpair_process_completion(), err: %d", err);
+		return err;
+	}
+
+	return queue->nreaped;
 }
 
 static inline int
@@ -233,6 +325,47 @@ xnvme_be_spdk_async_cmd_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_
 
 	return err;
 }
+
+int
+xnvme_be_spdk_async_cmd_admin(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes,
+			      void *mbuf, size_t mbuf_nbytes)
+{
+	struct xnvme_queue_spdk *queue = (void *)ctx->async.queue;
+	struct xnvme_be_spdk_state *state = (void *)queue->base.dev->be.state;
+	struct xnvme_be_spdk_admin_slot *slot = NULL;
+	int err;
+
+	for (uint32_t i = 0; i < XNVME_BE_SPDK_QUEUE_NADMIN; ++i) {
+		if (!queue->admin[i].ctx) {
+			slot = &queue->admin[i];
+			break;
+		}
+	}
+	if (!slot) {
+		XNVME_DEBUG("FAILED: all %d admin-slots in use", XNVME_BE_SPDK_QUEUE_NADMIN);
+		return -EBUSY;
+	}
+	slot->ctx = ctx;
+	atomic_store_explicit(&slot->done, 0, memory_order_relaxed);
+
+	ctx->cmd.common.mptr = (uint64_t)mbuf ? (uint64_t)mbuf : ctx->cmd.common.mptr;
+	if (mbuf_nbytes && mbuf) {
+		ctx->cmd.common.ndm = mbuf_nbytes / 4;
+	}
+
+	err = spdk_nvme_ctrlr_cmd_admin_raw(state->ctrlr, (struct spdk_nvme_cmd *)&ctx->cmd, dbuf,
+					    dbuf_nbytes, cmd_admin_async_cb, slot);
+	if (err) {
+		slot->ctx = NULL;
+		XNVME_DEBUG("FAILED: spdk_nvme_ctrlr_cmd_admin_raw(), err: %d", err);
+		return err;
+	}
+
+	queue->nadmin += 1;
+	queue->base.outstanding += 1;
+
+	return 0;
+}
 #endif
 
 struct xnvme_be_async g_xnvme_be_spdk_async = {
@@ -240,7 +373,9 @@ struct xnvme_be_async g_xnvme_be_spdk_async = {
 #ifdef XNVME_BE_SPDK_ENABLED
 	.cmd_io = xnvme_be_spdk_async_cmd_io,
 	.cmd_iov = xnvme_be_spdk_async_cmd_iov,
+	.cmd_admin = xnvme_be_spdk_async_cmd_admin,
 	.poke = xnvme_be_spdk_queue_poke,
+	.reap = xnvme_be_spdk_queue_reap,
 	.wait = xnvme_be_nosys_queue_wait,
 	.init = xnvme_be_spdk_queue_init,
 	.term = xnvme_be_spdk_queue_term,
@@ -111,6 +111,7 @@ const struct xnvme_be_config g_xnvme_be_windows_emu_nvme = {
 			.name = "emu",
 			.descr = "Emulated async with NVMe ioctl",
 			.caps = XNVME_BE_CAP_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -125,6 +126,7 @@ const struct xnvme_be_config g_xnvme_be_windows_thrpool_nvme = {
 			.name = "thrpool",
 			.descr = "Thread pool with NVMe ioctl",
 			.caps = XNVME_BE_CAP_BDEV,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 
@@ -210,6 +212,7 @@ const struct xnvme_be_config g_xnvme_be_windows_thrpool_fs = {
 			.name = "thrpool_file",
 			.descr = "Thread pool with file system APIs",
 			.caps = XNVME_BE_CAP_FILE,
+			.qdepth_max = XNVME_BE_QUEUE_QDEPTH_MAX,
 		},
 };
 #endif
@@ -695,6 +695,24 @@ static struct xnvme_cli_opt_attr xnvme_cli_opts[] = {
 		.name = "register_buffers",
 		.descr = "For async=io_uring, register buffers",
 	},
+	{
+		.opt = XNVME_CLI_OPT_SQPOLL_POOL,
+		.vtype = XNVME_CLI_OPT_VTYPE_NUM,
+		.name = "sqpoll_pool",
+		.descr = "For async=io_uring, sqthread sharing: 0=process,1=numa,2=device,3=none",
+	},
+	{
+		.opt = XNVME_CLI_OPT_SQPOLL_CPUS,
+		.vtype = XNVME_CLI_OPT_VTYPE_STR,
+		.name = "sqpoll_cpus",
+		.descr = "For async=io_uring, list of CPUs to pin sqthreads to (e.g. 0-3,8)",
+	},
+	{
+		.opt = XNVME_CLI_OPT_SQPOLL_IDLE,
+		.vtype = XNVME_CLI_OPT_VTYPE_NUM,
+		.name = "sqpoll_idle",
+		.descr = "For async=io_uring, sqthread idle-time in msec",
+	},
 	{
 		.opt = XNVME_CLI_OPT_TRUNCATE,
 		.vtype = XNVME_CLI_OPT_VTYPE_NUM,
@@ -1662,6 +1680,15 @@ xnvme_cli_assign_arg(struct xnvme_cli *cli, struct xnvme_cli_opt_attr *opt_attr,
 	case XNVME_CLI_OPT_REGISTER_BUFFERS:
 		args->register_buffers = arg ? num : 0;
 		break;
+	case XNVME_CLI_OPT_SQPOLL_POOL:
+		args->sqpoll_pool = arg ? num : 0;
+		break;
+	case XNVME_CLI_OPT_SQPOLL_CPUS:
+		args->sqpoll_cpus = arg;
+		break;
+	case XNVME_CLI_OPT_SQPOLL_IDLE:
+		args->sqpoll_idle = arg ? num : 0;
+		break;
 	case XNVME_CLI_OPT_TRUNCATE:
 		args->truncate = arg ? num : 0;
 		break;
@@ -2248,6 +2275,12 @@ xnvme_cli_to_opts(const struct xnvme_cli *cli, struct xnvme_opts *opts)
 	opts->register_buffers = cli->given[XNVME_CLI_OPT_REGISTER_BUFFERS]
 					 ? cli->args.register_buffers
 					 : opts->register_buffers;
+	opts->sqpoll_pool =
+		cli->given[XNVME_CLI_OPT_SQPOLL_POOL] ? cli->args.sqpoll_pool : opts->sqpoll_pool;
+	opts->sqpoll_cpus =
+		cli->given[XNVME_CLI_OPT_SQPOLL_CPUS] ? cli->args.sqpoll_cpus : opts->sqpoll_cpus;
+	opts->sqpoll_idle =
+		cli->given[XNVME_CLI_OPT_SQPOLL_IDLE] ? cli->args.sqpoll_idle : opts->sqpoll_idle;
 
 	opts->css.value = cli->given[XNVME_CLI_OPT_CSS] ? cli->args.css.value : opts->css.value;
 	opts->css.given = cli->given[XNVME_CLI_OPT_CSS] ? cli->args.css.given : opts->css.given;
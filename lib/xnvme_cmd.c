@@ -51,6 +51,10 @@ xnvme_cmd_pass(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes, void *
 
 	switch (cmd_opts & XNVME_CMD_MASK_IOMD) {
 	case XNVME_CMD_ASYNC:
+		if (ctx->async.queue->mpsc) {
+			return xnvme_queue_mpsc_stage(ctx, dbuf, NULL, 0, dbuf_nbytes, mbuf,
+						      mbuf_nbytes);
+		}
 		if (ctx->async.queue->base.outstanding == ctx->async.queue->base.capacity) {
 			XNVME_DEBUG("FAILED: queue is full; returning -EBUSY");
 			return -EBUSY;
@@ -94,6 +98,10 @@ xnvme_cmd_pass_iov(struct xnvme_cmd_ctx *ctx, struct iovec *dvec, size_t dvec_cn
 
 	switch (cmd_opts & XNVME_CMD_MASK_IOMD) {
 	case XNVME_CMD_ASYNC:
+		if (ctx->async.queue->mpsc) {
+			return xnvme_queue_mpsc_stage(ctx, NULL, dvec, dvec_cnt, dvec_nbytes, mbuf,
+						      mbuf_nbytes);
+		}
 		if (ctx->async.queue->base.outstanding == ctx->async.queue->base.capacity) {
 			XNVME_DEBUG("FAILED: queue is full; returning -EBUSY");
 			return -EBUSY;
@@ -114,8 +122,19 @@ xnvme_cmd_pass_admin(struct xnvme_cmd_ctx *ctx, void *dbuf, size_t dbuf_nbytes,
 		     size_t mbuf_nbytes)
 {
 	if (ctx->opts & XNVME_CMD_ASYNC) {
-		XNVME_DEBUG("FAILED: Admin commands are always sync.");
-		return -EINVAL;
+		if (!ctx->dev->be.async.cmd_admin) {
+			XNVME_DEBUG("FAILED: async admin-commands not supported by backend");
+			return -ENOSYS;
+		}
+		if (ctx->async.queue->mpsc) {
+			XNVME_DEBUG("FAILED: async admin-commands not supported on MPSC queues");
+			return -ENOTSUP;
+		}
+		if (ctx->async.queue->base.outstanding == ctx->async.queue->base.capacity) {
+			XNVME_DEBUG("FAILED: queue is full; returning -EBUSY");
+			return -EBUSY;
+		}
+		return ctx->dev->be.async.cmd_admin(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
 	}
 
 	return ctx->dev->be.admin.cmd_admin(ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
@@ -71,6 +71,12 @@ xnvme_opts_yaml(FILE *stream, const struct xnvme_opts *opts, int indent, const c
 			opts->register_files, sep);
 	wrtn += fprintf(stream, "%*sregister_buffers: %" PRIu8 "%s", indent, "",
 			opts->register_buffers, sep);
+	wrtn += fprintf(stream, "%*ssqpoll_pool: %" PRIu32 "%s", indent, "", opts->sqpoll_pool,
+			sep);
+	wrtn += fprintf(stream, "%*ssqpoll_cpus: '%s'%s", indent, "",
+			opts->sqpoll_cpus ? opts->sqpoll_cpus : "", sep);
+	wrtn += fprintf(stream, "%*ssqpoll_idle: %" PRIu32 "%s", indent, "", opts->sqpoll_idle,
+			sep);
 
 	wrtn += fprintf(stream, "%*scss.given: %" PRIu32 "%s", indent, "", opts->css.given, sep);
 	wrtn += fprintf(stream, "%*scss.value: 0x%" PRIx32 "%s", indent, "", opts->css.value, sep);
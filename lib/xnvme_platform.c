@@ -184,6 +184,26 @@ _dev_open_try_config(struct xnvme_dev *dev, const struct xnvme_be_config *cfg,
 	return 0;
 }
 
+/**
+ * Whether any config of the named backend supports one of the given capabilities
+ */
+static bool
+_be_supports_caps(const char *name, uint32_t caps)
+{
+	for (int i = 0; g_xnvme_platform->backends[i]; ++i) {
+		const struct xnvme_be_config *cfg = g_xnvme_platform->backends[i];
+
+		if (strcmp(name, cfg->attr.name)) {
+			continue;
+		}
+		if (!cfg->attr.caps || (cfg->attr.caps & caps)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /**
  * Open a device by iterating platform backend configs until one succeeds.
  *
@@ -207,6 +227,12 @@ xnvme_platform_dev_open(struct xnvme_dev *dev, struct xnvme_opts *opts)
 	if (!has_backend_opts && g_xnvme_platform->classify) {
 		uri_cap = g_xnvme_platform->classify(dev->ident.uri);
 	}
+	// An explicitly selected backend takes the URI on its own terms, e.g. a ramdisk of "512"
+	// bytes, which is classified as a file
+	if (uri_cap && opts && opts->be && strcmp(opts->be, g_xnvme_platform->name) &&
+	    !_be_supports_caps(opts->be, uri_cap)) {
+		uri_cap = 0;
+	}
 
 	XNVME_DEBUG("INFO: uri='%s' classified cap=0x%x has_backend_opts=%d", dev->ident.uri,
 		    uri_cap, has_backend_opts);
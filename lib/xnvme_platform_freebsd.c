@@ -19,6 +19,7 @@
 #include <sys/stat.h>
 #include <xnvme_be.h>
 #include <xnvme_dev.h>
+#include <xnvme_be_ramdisk.h>
 
 static uint32_t
 xnvme_platform_freebsd_classify(const char *uri)
@@ -41,12 +42,8 @@ xnvme_platform_freebsd_classify(const char *uri)
 		return 0;
 	}
 
-	{
-		size_t len = strlen(uri);
-
-		if (len >= 2 && !strcmp(uri + len - 2, "GB")) {
-			return XNVME_BE_CAP_RAMDISK;
-		}
+	if (xnvme_be_ramdisk_classify_uri(uri)) {
+		return XNVME_BE_CAP_RAMDISK;
 	}
 
 	/* PCI BDF pattern: DDDD:DD:DD.D */
@@ -274,6 +271,7 @@ struct xnvme_platform g_xnvme_platform_freebsd = {
 			&g_xnvme_be_freebsd_nil_nvme,
 #ifdef XNVME_BE_RAMDISK_ENABLED
 			&g_xnvme_be_ramdisk_nil,
+			&g_xnvme_be_ramdisk_native,
 			&g_xnvme_be_ramdisk_thrpool,
 			&g_xnvme_be_ramdisk_emu,
 #endif
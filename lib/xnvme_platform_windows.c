@@ -15,6 +15,7 @@
 #include <Setupapi.h>
 #include <xnvme_be.h>
 #include <xnvme_dev.h>
+#include <xnvme_be_ramdisk.h>
 
 static uint32_t
 xnvme_platform_windows_classify(const char *uri)
@@ -29,7 +30,7 @@ xnvme_platform_windows_classify(const char *uri)
 	}
 
 	len = strlen(uri);
-	if (len >= 2 && !strcmp(uri + len - 2, "GB")) {
+	if (xnvme_be_ramdisk_classify_uri(uri)) {
 		return XNVME_BE_CAP_RAMDISK;
 	}
 
@@ -140,6 +141,7 @@ struct xnvme_platform g_xnvme_platform_windows = {
 #endif
 #ifdef XNVME_BE_RAMDISK_ENABLED
 			&g_xnvme_be_ramdisk_nil,
+			&g_xnvme_be_ramdisk_native,
 			&g_xnvme_be_ramdisk_thrpool,
 			&g_xnvme_be_ramdisk_emu,
 #endif
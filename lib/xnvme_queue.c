@@ -4,12 +4,70 @@
 
 #include <stdio.h>
 #include <errno.h>
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+#include <sys/mman.h>
+#endif
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
 #include <libxnvme.h>
 #include <xnvme_be.h>
 #include <xnvme_cmd.h>
 #include <xnvme_dev.h>
 #include <xnvme_queue.h>
 
+static uint32_t
+_pool_nchunks(uint32_t capacity)
+{
+	const uint32_t nentries = capacity + 1;
+
+	return (nentries + XNVME_QUEUE_POOL_CHUNK_NENTRIES - 1) >>
+	       XNVME_QUEUE_POOL_CHUNK_NENTRIES_LOG2;
+}
+
+static void
+_pool_free(struct xnvme_queue *queue)
+{
+	for (uint32_t i = 0; i < _pool_nchunks(queue->base.capacity); ++i) {
+		xnvme_buf_virt_free(queue->pool_chunks[i]);
+	}
+}
+
+/**
+ * Allocate the 'capacity + 1' command-context entries of the pool in cache-line aligned chunks,
+ * full chunks are aligned to, and on Linux advised to be backed by, a 2MB hugepage
+ */
+static int
+_pool_alloc(struct xnvme_queue *queue)
+{
+	uint32_t nentries = queue->base.capacity + 1;
+
+	for (uint32_t i = 0; i < _pool_nchunks(queue->base.capacity); ++i) {
+		uint32_t chunk_nentries = XNVME_MIN(nentries, XNVME_QUEUE_POOL_CHUNK_NENTRIES);
+		size_t nbytes = chunk_nentries * sizeof(struct xnvme_cmd_ctx_entry);
+		size_t alignment = (nbytes == XNVME_QUEUE_POOL_CHUNK_NBYTES)
+					   ? XNVME_QUEUE_POOL_CHUNK_NBYTES
+					   : XNVME_QUEUE_CACHELINE_NBYTES;
+
+		queue->pool_chunks[i] = xnvme_buf_virt_alloc(alignment, nbytes);
+		if (!queue->pool_chunks[i]) {
+			XNVME_DEBUG("FAILED: xnvme_buf_virt_alloc(), err: %s", strerror(errno));
+			return -ENOMEM;
+		}
+		memset(queue->pool_chunks[i], 0, nbytes);
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+		if (alignment == XNVME_QUEUE_POOL_CHUNK_NBYTES) {
+			madvise(queue->pool_chunks[i], nbytes, MADV_HUGEPAGE);
+		}
+#endif
+		nentries -= chunk_nentries;
+	}
+
+	return 0;
+}
+
 int
 xnvme_queue_term(struct xnvme_queue *queue)
 {
@@ -25,6 +83,8 @@ xnvme_queue_term(struct xnvme_queue *queue)
 		XNVME_DEBUG("FAILED: backend queue-termination failed with err: %d", err);
 	}
 
+	xnvme_queue_mpsc_term(queue);
+	_pool_free(queue);
 	free(queue);
 
 	return err;
@@ -39,6 +99,7 @@ callback_noop(struct xnvme_cmd_ctx *XNVME_UNUSED(ctx), void *XNVME_UNUSED(cb_arg
 int
 xnvme_queue_init(struct xnvme_dev *dev, uint16_t capacity, int opts, struct xnvme_queue **queue)
 {
+	uint32_t qdepth_max;
 	size_t queue_nbytes;
 	int err;
 
@@ -46,12 +107,15 @@ xnvme_queue_init(struct xnvme_dev *dev, uint16_t capacity, int opts, struct xnvm
 		XNVME_DEBUG("FAILED: !dev");
 		return -EINVAL;
 	}
-	if (!(xnvme_is_pow2(capacity) && (capacity < 4096))) {
-		XNVME_DEBUG("EINVAL: capacity: %u", capacity);
+
+	qdepth_max = dev->be.attr.qdepth_max ? dev->be.attr.qdepth_max
+					     : XNVME_BE_QUEUE_QDEPTH_MAX_DEFAULT;
+	if (!(xnvme_is_pow2(capacity) && (capacity <= qdepth_max))) {
+		XNVME_DEBUG("EINVAL: capacity: %u, qdepth_max: %u", capacity, qdepth_max);
 		return -EINVAL;
 	}
 
-	queue_nbytes = sizeof(**queue) + (capacity + 1) * sizeof(*((*queue)->pool_storage));
+	queue_nbytes = sizeof(**queue) + _pool_nchunks(capacity) * sizeof(*(*queue)->pool_chunks);
 
 	*queue = calloc(1, queue_nbytes);
 	if (!*queue) {
@@ -61,22 +125,46 @@ xnvme_queue_init(struct xnvme_dev *dev, uint16_t capacity, int opts, struct xnvm
 	(*queue)->base.capacity = capacity;
 	(*queue)->base.dev = dev;
 
+	err = _pool_alloc(*queue);
+	if (err) {
+		XNVME_DEBUG("FAILED: _pool_alloc(), err: %d", err);
+		_pool_free(*queue);
+		free(*queue);
+		*queue = NULL;
+		return err;
+	}
+
 	SLIST_INIT(&(*queue)->base.pool);
 
 	for (uint32_t i = 0; i <= (*queue)->base.capacity; ++i) {
-		(*queue)->pool_storage[i].dev = dev;
-		(*queue)->pool_storage[i].async.queue = *queue;
-		(*queue)->pool_storage[i].async.cb = callback_noop;
-		(*queue)->pool_storage[i].async.cb_arg = NULL;
-		(*queue)->pool_storage[i].opts = XNVME_CMD_ASYNC;
-		(*queue)->pool_storage[i].id = i;
+		struct xnvme_cmd_ctx_entry *entry = xnvme_queue_entry(*queue, i);
+
+		entry->dev = dev;
+		entry->async.queue = *queue;
+		entry->async.cb = callback_noop;
+		entry->async.cb_arg = NULL;
+		entry->opts = XNVME_CMD_ASYNC;
+		entry->id = i;
 
-		SLIST_INSERT_HEAD(&(*queue)->base.pool, &((*queue)->pool_storage[i]), link);
+		SLIST_INSERT_HEAD(&(*queue)->base.pool, entry, link);
+	}
+
+	if (opts & XNVME_QUEUE_MPSC) {
+		err = xnvme_queue_mpsc_init(*queue);
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_queue_mpsc_init(), err: %d", err);
+			_pool_free(*queue);
+			free(*queue);
+			*queue = NULL;
+			return err;
+		}
 	}
 
 	err = dev->be.async.init(*queue, opts);
 	if (err) {
 		XNVME_DEBUG("FAILED: backend-queue initialization with err: %d", err);
+		xnvme_queue_mpsc_term(*queue);
+		_pool_free(*queue);
 		free(*queue);
 		*queue = NULL;
 		return err;
@@ -89,16 +177,45 @@ int
 xnvme_queue_set_cb(struct xnvme_queue *queue, xnvme_queue_cb cb, void *cb_arg)
 {
 	for (uint32_t i = 0; i <= queue->base.capacity; ++i) {
-		queue->pool_storage[i].async.cb = cb;
-		queue->pool_storage[i].async.cb_arg = cb_arg;
+		xnvme_queue_entry(queue, i)->async.cb = cb;
+		xnvme_queue_entry(queue, i)->async.cb_arg = cb_arg;
 	}
 
 	return 0;
 }
 
+/**
+ * Pass the staged commands of a multi-producer queue on to the backend, then process up to 'max'
+ * completions, including those of commands rejected by the backend
+ */
+static int
+_queue_mpsc_process(struct xnvme_queue *queue, struct xnvme_cmd_ctx **ctxs, uint32_t max)
+{
+	int nfailed, ret;
+
+	ret = xnvme_queue_mpsc_flush(queue);
+	if (ret) {
+		XNVME_DEBUG("FAILED: xnvme_queue_mpsc_flush(), err: %d", ret);
+		return ret;
+	}
+
+	nfailed = xnvme_queue_mpsc_complete_failed(queue, ctxs, max);
+	if ((max && ((uint32_t)nfailed == max)) || !queue->base.outstanding) {
+		return nfailed;
+	}
+
+	ret = ctxs ? queue->base.dev->be.async.reap(queue, &ctxs[nfailed], max - nfailed)
+		   : queue->base.dev->be.async.poke(queue, max ? max - nfailed : 0);
+
+	return ret < 0 ? ret : ret + nfailed;
+}
+
 int
 xnvme_queue_poke(struct xnvme_queue *queue, uint32_t max)
 {
+	if (queue->mpsc) {
+		return _queue_mpsc_process(queue, NULL, max);
+	}
 	if (!queue->base.outstanding) {
 		return 0;
 	}
@@ -106,6 +223,86 @@ xnvme_queue_poke(struct xnvme_queue *queue, uint32_t max)
 	return queue->base.dev->be.async.poke(queue, max);
 }
 
+int
+xnvme_queue_reap(struct xnvme_queue *queue, struct xnvme_cmd_ctx **ctxs, uint32_t max)
+{
+	if (!(ctxs && max)) {
+		XNVME_DEBUG("FAILED: !ctxs or !max");
+		return -EINVAL;
+	}
+	if (!queue->base.dev->be.async.reap) {
+		XNVME_DEBUG("FAILED: backend does not support reaping");
+		return -ENOSYS;
+	}
+	if (queue->mpsc) {
+		return _queue_mpsc_process(queue, ctxs, max);
+	}
+	if (!queue->base.outstanding) {
+		return 0;
+	}
+
+	return queue->base.dev->be.async.reap(queue, ctxs, max);
+}
+
+int
+xnvme_queue_submit(struct xnvme_queue *queue)
+{
+	if (queue->mpsc || !queue->base.dev->be.async.submit) {
+		return 0;
+	}
+
+	return queue->base.dev->be.async.submit(queue);
+}
+
+int
+xnvme_cmd_pass_batch(struct xnvme_cmd_ctx **ctxs, void **dbufs, size_t *dbufs_nbytes,
+		     void **mbufs, size_t *mbufs_nbytes, uint32_t nctxs)
+{
+	struct xnvme_queue *queue;
+	uint32_t npassed;
+	int err = 0;
+
+	if (!(ctxs && nctxs && ctxs[0])) {
+		XNVME_DEBUG("FAILED: empty batch");
+		return -EINVAL;
+	}
+	queue = ctxs[0]->async.queue;
+
+	for (npassed = 0; npassed < nctxs; ++npassed) {
+		struct xnvme_cmd_ctx *ctx = ctxs[npassed];
+
+		if (!(ctx->opts & XNVME_CMD_ASYNC) || (ctx->async.queue != queue)) {
+			XNVME_DEBUG("FAILED: ctxs[%" PRIu32 "] is not async. on the batch queue",
+				    npassed);
+			err = -EINVAL;
+			break;
+		}
+
+		ctx->opts |= XNVME_CMD_DEFER;
+		err = xnvme_cmd_pass(ctx, dbufs ? dbufs[npassed] : NULL,
+				     dbufs_nbytes ? dbufs_nbytes[npassed] : 0,
+				     mbufs ? mbufs[npassed] : NULL,
+				     mbufs_nbytes ? mbufs_nbytes[npassed] : 0);
+		ctx->opts &= ~XNVME_CMD_DEFER;
+		if (err) {
+			XNVME_DEBUG("FAILED: xnvme_cmd_pass(ctxs[%" PRIu32 "]), err: %d", npassed,
+				    err);
+			break;
+		}
+	}
+	if (!npassed) {
+		return err;
+	}
+
+	err = xnvme_queue_submit(queue);
+	if (err) {
+		XNVME_DEBUG("FAILED: xnvme_queue_submit(), err: %d", err);
+		return err;
+	}
+
+	return npassed;
+}
+
 int
 xnvme_queue_wait(struct xnvme_queue *queue)
 {
@@ -114,17 +311,102 @@ xnvme_queue_wait(struct xnvme_queue *queue)
 	return xnvme_queue_drain(queue);
 }
 
+/**
+ * Number of consecutive pokes without completions, after which the CPU is yielded, when waiting
+ * on a backend without a blocking wait
+ */
+#define XNVME_QUEUE_WAIT_SPIN_NPOKES 64
+
+void
+xnvme_queue_yield(void)
+{
+#ifdef WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+int
+xnvme_queue_wait_timeout(struct xnvme_queue *queue, uint32_t min_completions,
+			 uint64_t timeout_ns)
+{
+	const uint32_t outstanding = xnvme_queue_get_outstanding(queue);
+	uint64_t deadline = 0;
+	uint32_t nidle = 0;
+	uint32_t acc = 0;
+	bool spin = false;
+
+	if (!min_completions || (min_completions > outstanding)) {
+		min_completions = outstanding;
+	}
+	if (timeout_ns) {
+		deadline = _xnvme_timer_clock_sample() + timeout_ns;
+	}
+
+	while (acc < min_completions) {
+		uint64_t remaining = 0;
+		int ret;
+
+		if (queue->mpsc) {
+			ret = _queue_mpsc_process(queue, NULL, 0);
+			if (ret < 0) {
+				return ret;
+			}
+			acc += ret;
+
+			if (acc >= min_completions) {
+				break;
+			}
+		}
+		if (!queue->base.outstanding) {
+			break;
+		}
+
+		if (deadline) {
+			uint64_t now = _xnvme_timer_clock_sample();
+
+			if (now >= deadline) {
+				break;
+			}
+			remaining = deadline - now;
+		}
+
+		if (spin) {
+			ret = queue->base.dev->be.async.poke(queue, 0);
+			if (!ret && !(++nidle % XNVME_QUEUE_WAIT_SPIN_NPOKES)) {
+				xnvme_queue_yield();
+			}
+		} else {
+			ret = queue->base.dev->be.async.wait(queue, min_completions - acc,
+							     remaining);
+			if (ret == -ENOSYS) {
+				spin = true;
+				continue;
+			}
+		}
+		if (ret < 0) {
+			XNVME_DEBUG("FAILED: be.async.{wait,poke}(), err: %d", ret);
+			return ret;
+		}
+
+		acc += ret;
+	}
+
+	return acc;
+}
+
 int
 xnvme_queue_drain(struct xnvme_queue *queue)
 {
 	int acc = 0;
 
-	while (queue->base.outstanding) {
+	while (xnvme_queue_get_outstanding(queue)) {
 		int err;
 
-		err = xnvme_queue_poke(queue, 0);
+		err = xnvme_queue_wait_timeout(queue, 0, 0);
 		if (err < 0) {
-			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", err);
+			XNVME_DEBUG("FAILED: xnvme_queue_wait_timeout(), err: %d", err);
 			return err;
 		}
 
@@ -143,13 +425,23 @@ xnvme_queue_get_capacity(struct xnvme_queue *queue)
 uint32_t
 xnvme_queue_get_outstanding(struct xnvme_queue *queue)
 {
+	if (queue->mpsc) {
+		return queue->base.outstanding + xnvme_queue_mpsc_nstaged(queue);
+	}
+
 	return queue->base.outstanding;
 }
 
 struct xnvme_cmd_ctx *
 xnvme_queue_get_cmd_ctx(struct xnvme_queue *queue)
 {
-	struct xnvme_cmd_ctx *ctx = (struct xnvme_cmd_ctx *)SLIST_FIRST(&queue->base.pool);
+	struct xnvme_cmd_ctx *ctx;
+
+	if (queue->mpsc) {
+		return xnvme_queue_mpsc_get_cmd_ctx(queue);
+	}
+
+	ctx = (struct xnvme_cmd_ctx *)SLIST_FIRST(&queue->base.pool);
 
 	if (!ctx) {
 		errno = ENOMEM;
@@ -164,6 +456,10 @@ xnvme_queue_get_cmd_ctx(struct xnvme_queue *queue)
 int
 xnvme_queue_put_cmd_ctx(struct xnvme_queue *queue, struct xnvme_cmd_ctx *ctx)
 {
+	if (queue->mpsc) {
+		return xnvme_queue_mpsc_put_cmd_ctx(queue, ctx);
+	}
+
 	SLIST_INSERT_HEAD(&queue->base.pool, (struct xnvme_cmd_ctx_entry *)ctx, link);
 
 	return 0;
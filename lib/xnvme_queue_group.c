@@ -0,0 +1,345 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <errno.h>
+#include <limits.h>
+#include <libxnvme.h>
+#include <xnvme_be.h>
+#include <xnvme_queue.h>
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#define XNVME_QUEUE_GROUP_NENTRIES_MIN 8
+#define XNVME_QUEUE_GROUP_NEVENTS_MAX  64
+
+/**
+ * Number of consecutive pokes of the group without completions, after which the CPU is yielded
+ */
+#define XNVME_QUEUE_GROUP_SPIN_NPOKES 64
+
+struct xnvme_queue_group_entry {
+	struct xnvme_queue *queue;
+	int fd; ///< Completion event fd of the queue, negative when not provided by the backend
+};
+
+struct xnvme_queue_group {
+	struct xnvme_queue_group_entry **entries;
+	uint32_t nentries;
+	uint32_t capacity;
+
+	uint32_t cursor; ///< Index of the entry which the next poke starts with
+	int epfd;        ///< epoll instance of the completion event fds, negative when unavailable
+};
+
+int
+xnvme_queue_group_init(struct xnvme_queue_group **group)
+{
+	if (!group) {
+		XNVME_DEBUG("FAILED: !group");
+		return -EINVAL;
+	}
+
+	*group = calloc(1, sizeof(**group));
+	if (!*group) {
+		XNVME_DEBUG("FAILED: calloc(group), err: %s", strerror(errno));
+		return -errno;
+	}
+	(*group)->epfd = -1;
+
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+	(*group)->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if ((*group)->epfd < 0) {
+		int err = -errno;
+
+		XNVME_DEBUG("FAILED: epoll_create1(), err: %d", err);
+		free(*group);
+		*group = NULL;
+		return err;
+	}
+#endif
+
+	return 0;
+}
+
+void
+xnvme_queue_group_term(struct xnvme_queue_group *group)
+{
+	if (!group) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < group->nentries; ++i) {
+		free(group->entries[i]);
+	}
+	free(group->entries);
+
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+	if (group->epfd >= 0) {
+		close(group->epfd);
+	}
+#endif
+
+	free(group);
+}
+
+static int
+_group_find(struct xnvme_queue_group *group, struct xnvme_queue *queue)
+{
+	for (uint32_t i = 0; i < group->nentries; ++i) {
+		if (group->entries[i]->queue == queue) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+int
+xnvme_queue_group_add(struct xnvme_queue_group *group, struct xnvme_queue *queue)
+{
+	struct xnvme_queue_group_entry *entry;
+
+	if (!(group && queue)) {
+		XNVME_DEBUG("FAILED: !group or !queue");
+		return -EINVAL;
+	}
+	if (_group_find(group, queue) >= 0) {
+		XNVME_DEBUG("FAILED: queue is already in the group");
+		return -EEXIST;
+	}
+
+	if (group->nentries == group->capacity) {
+		uint32_t capacity = group->capacity ? group->capacity * 2
+						    : XNVME_QUEUE_GROUP_NENTRIES_MIN;
+		void *entries;
+
+		entries = realloc(group->entries, capacity * sizeof(*group->entries));
+		if (!entries) {
+			XNVME_DEBUG("FAILED: realloc(entries), err: %s", strerror(errno));
+			return -ENOMEM;
+		}
+		group->entries = entries;
+		group->capacity = capacity;
+	}
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry) {
+		XNVME_DEBUG("FAILED: calloc(entry), err: %s", strerror(errno));
+		return -ENOMEM;
+	}
+	entry->queue = queue;
+	entry->fd = -1;
+
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+	entry->fd = xnvme_queue_get_completion_fd(queue);
+	if (entry->fd >= 0) {
+		struct epoll_event event = {.events = EPOLLIN, .data.ptr = entry};
+
+		if (epoll_ctl(group->epfd, EPOLL_CTL_ADD, entry->fd, &event)) {
+			int err = -errno;
+
+			XNVME_DEBUG("FAILED: epoll_ctl(EPOLL_CTL_ADD), err: %d", err);
+			free(entry);
+			return err;
+		}
+	}
+#endif
+
+	group->entries[group->nentries++] = entry;
+
+	return 0;
+}
+
+int
+xnvme_queue_group_remove(struct xnvme_queue_group *group, struct xnvme_queue *queue)
+{
+	struct xnvme_queue_group_entry *entry;
+	int idx;
+
+	if (!(group && queue)) {
+		XNVME_DEBUG("FAILED: !group or !queue");
+		return -EINVAL;
+	}
+
+	idx = _group_find(group, queue);
+	if (idx < 0) {
+		XNVME_DEBUG("FAILED: queue is not in the group");
+		return -ENOENT;
+	}
+	entry = group->entries[idx];
+
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+	if ((entry->fd >= 0) && epoll_ctl(group->epfd, EPOLL_CTL_DEL, entry->fd, NULL)) {
+		XNVME_DEBUG("FAILED: epoll_ctl(EPOLL_CTL_DEL), errno: %d", errno);
+	}
+#endif
+
+	group->entries[idx] = group->entries[--group->nentries];
+	free(entry);
+
+	return 0;
+}
+
+uint32_t
+xnvme_queue_group_get_outstanding(struct xnvme_queue_group *group)
+{
+	uint32_t outstanding = 0;
+
+	for (uint32_t i = 0; i < group->nentries; ++i) {
+		outstanding += xnvme_queue_get_outstanding(group->entries[i]->queue);
+	}
+
+	return outstanding;
+}
+
+int
+xnvme_queue_group_poke(struct xnvme_queue_group *group, uint32_t max)
+{
+	uint32_t start, acc = 0;
+
+	if (!group->nentries) {
+		return 0;
+	}
+
+	start = group->cursor % group->nentries;
+	group->cursor = start + 1;
+
+	for (uint32_t i = 0; (i < group->nentries) && (!max || (acc < max)); ++i) {
+		struct xnvme_queue *queue = group->entries[(start + i) % group->nentries]->queue;
+		int ret;
+
+		if (!xnvme_queue_get_outstanding(queue)) {
+			continue;
+		}
+
+		ret = xnvme_queue_poke(queue, max ? max - acc : 0);
+		if (ret < 0) {
+			XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", ret);
+			return ret;
+		}
+		acc += ret;
+	}
+
+	return acc;
+}
+
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+/**
+ * Block on the epoll set until completion event fds are signaled, then poke the queues of the
+ * signaled fds only; stale signals, of completions already processed, are consumed and waited past
+ */
+static int
+_group_wait_epoll(struct xnvme_queue_group *group, uint64_t deadline)
+{
+	struct epoll_event events[XNVME_QUEUE_GROUP_NEVENTS_MAX];
+
+	for (;;) {
+		int timeout_ms = -1;
+		int nevents, acc = 0;
+
+		if (deadline) {
+			uint64_t now = _xnvme_timer_clock_sample();
+			uint64_t remaining_ms;
+
+			if (now >= deadline) {
+				return 0;
+			}
+			remaining_ms = (deadline - now + 999999) / 1000000;
+			timeout_ms = remaining_ms > INT_MAX ? INT_MAX : (int)remaining_ms;
+		}
+
+		nevents = epoll_wait(group->epfd, events, XNVME_QUEUE_GROUP_NEVENTS_MAX, timeout_ms);
+		if (nevents < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			XNVME_DEBUG("FAILED: epoll_wait(), errno: %d", errno);
+			return -errno;
+		}
+
+		for (int i = 0; i < nevents; ++i) {
+			struct xnvme_queue_group_entry *entry = events[i].data.ptr;
+			uint64_t nsignals;
+			int ret;
+
+			if (read(entry->fd, &nsignals, sizeof(nsignals)) < 0) {
+				XNVME_DEBUG("FAILED: read(completion_fd), errno: %d", errno);
+			}
+
+			ret = xnvme_queue_poke(entry->queue, 0);
+			if (ret < 0) {
+				XNVME_DEBUG("FAILED: xnvme_queue_poke(), err: %d", ret);
+				return ret;
+			}
+			acc += ret;
+		}
+		if (acc) {
+			return acc;
+		}
+	}
+}
+#endif
+
+static int
+_group_wait_spin(struct xnvme_queue_group *group, uint64_t deadline)
+{
+	uint32_t nidle = 0;
+
+	while (!deadline || (_xnvme_timer_clock_sample() < deadline)) {
+		int ret;
+
+		ret = xnvme_queue_group_poke(group, 0);
+		if (ret) {
+			return ret;
+		}
+		if (!(++nidle % XNVME_QUEUE_GROUP_SPIN_NPOKES)) {
+			xnvme_queue_yield();
+		}
+	}
+
+	return 0;
+}
+
+int
+xnvme_queue_group_wait(struct xnvme_queue_group *group, uint64_t timeout_ns)
+{
+	struct xnvme_queue_group_entry *active = NULL;
+	uint32_t nactive = 0, nactive_fd = 0;
+	uint64_t deadline = 0;
+	int ret;
+
+	if (timeout_ns) {
+		deadline = _xnvme_timer_clock_sample() + timeout_ns;
+	}
+
+	ret = xnvme_queue_group_poke(group, 0);
+	if (ret) {
+		return ret;
+	}
+
+	for (uint32_t i = 0; i < group->nentries; ++i) {
+		if (!xnvme_queue_get_outstanding(group->entries[i]->queue)) {
+			continue;
+		}
+		active = group->entries[i];
+		nactive += 1;
+		nactive_fd += active->fd >= 0;
+	}
+
+	if (!nactive) {
+		return 0;
+	}
+	if (nactive == 1) {
+		return xnvme_queue_wait_timeout(active->queue, 1, timeout_ns);
+	}
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+	if (nactive_fd == nactive) {
+		return _group_wait_epoll(group, deadline);
+	}
+#endif
+
+	return _group_wait_spin(group, deadline);
+}
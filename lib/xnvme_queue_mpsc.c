@@ -0,0 +1,328 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <libxnvme.h>
+#include <xnvme_be.h>
+#include <xnvme_cmd.h>
+#include <xnvme_dev.h>
+#include <xnvme_queue.h>
+
+/**
+ * Each slot carries a sequence number which tells whether the slot is ready for a producer or a
+ * consumer at the given ring position, thus, head and tail are the only contended words and the
+ * ring is free of the ABA problem of a linked freelist.
+ */
+struct xnvme_queue_ring_slot {
+	_Atomic uint64_t seq;
+	void *ptr;
+};
+
+struct xnvme_queue_ring {
+	uint64_t mask;
+	uint8_t _pad0[XNVME_QUEUE_CACHELINE_NBYTES - sizeof(uint64_t)];
+
+	_Atomic uint64_t head; ///< Consumer position
+	uint8_t _pad1[XNVME_QUEUE_CACHELINE_NBYTES - sizeof(uint64_t)];
+
+	_Atomic uint64_t tail; ///< Producer position
+	uint8_t _pad2[XNVME_QUEUE_CACHELINE_NBYTES - sizeof(uint64_t)];
+
+	struct xnvme_queue_ring_slot slots[];
+};
+
+/**
+ * Arguments of a staged command, one per command-context of the queue, indexed by its id
+ */
+struct xnvme_queue_mpsc_req {
+	void *dbuf;
+	struct iovec *dvec;
+	size_t dvec_cnt;
+	size_t dbuf_nbytes;
+	void *mbuf;
+	size_t mbuf_nbytes;
+};
+
+struct xnvme_queue_mpsc {
+	struct xnvme_queue_ring *freelist; ///< Command-contexts available for use
+	struct xnvme_queue_ring *staged;   ///< Command-contexts waiting to be passed to the backend
+
+	struct xnvme_cmd_ctx *pending; ///< Popped from 'staged' and rejected by a full backend
+	SLIST_HEAD(, xnvme_cmd_ctx_entry) failed; ///< Rejected by the backend, awaiting completion
+	uint32_t nfailed;
+
+	struct xnvme_queue_mpsc_req reqs[];
+};
+
+struct xnvme_queue_ring *
+xnvme_queue_ring_alloc(uint32_t nslots)
+{
+	struct xnvme_queue_ring *ring;
+
+	ring = calloc(1, sizeof(*ring) + nslots * sizeof(*ring->slots));
+	if (!ring) {
+		return NULL;
+	}
+	ring->mask = nslots - 1;
+
+	for (uint32_t i = 0; i < nslots; ++i) {
+		atomic_init(&ring->slots[i].seq, i);
+	}
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+
+	return ring;
+}
+
+int
+xnvme_queue_ring_push(struct xnvme_queue_ring *ring, void *ptr)
+{
+	struct xnvme_queue_ring_slot *slot;
+	uint64_t pos;
+
+	pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	for (;;) {
+		int64_t dif;
+
+		slot = &ring->slots[pos & ring->mask];
+		dif = (int64_t)atomic_load_explicit(&slot->seq, memory_order_acquire) -
+		      (int64_t)pos;
+		if (!dif) {
+			if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1,
+								  memory_order_relaxed,
+								  memory_order_relaxed)) {
+				break;
+			}
+		} else if (dif < 0) {
+			return -EBUSY;
+		} else {
+			pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+		}
+	}
+
+	slot->ptr = ptr;
+	atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+	return 0;
+}
+
+void *
+xnvme_queue_ring_pop(struct xnvme_queue_ring *ring)
+{
+	struct xnvme_queue_ring_slot *slot;
+	uint64_t pos;
+	void *ptr;
+
+	pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	for (;;) {
+		int64_t dif;
+
+		slot = &ring->slots[pos & ring->mask];
+		dif = (int64_t)atomic_load_explicit(&slot->seq, memory_order_acquire) -
+		      (int64_t)(pos + 1);
+		if (!dif) {
+			if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1,
+								  memory_order_relaxed,
+								  memory_order_relaxed)) {
+				break;
+			}
+		} else if (dif < 0) {
+			return NULL;
+		} else {
+			pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+		}
+	}
+
+	ptr = slot->ptr;
+	atomic_store_explicit(&slot->seq, pos + ring->mask + 1, memory_order_release);
+
+	return ptr;
+}
+
+uint32_t
+xnvme_queue_ring_count(struct xnvme_queue_ring *ring)
+{
+	uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+	return tail > head ? tail - head : 0;
+}
+
+void
+xnvme_queue_mpsc_term(struct xnvme_queue *queue)
+{
+	if (!queue->mpsc) {
+		return;
+	}
+
+	free(queue->mpsc->freelist);
+	free(queue->mpsc->staged);
+	free(queue->mpsc);
+	queue->mpsc = NULL;
+}
+
+int
+xnvme_queue_mpsc_init(struct xnvme_queue *queue)
+{
+	const uint32_t nctxs = queue->base.capacity + 1;
+	struct xnvme_queue_mpsc *mpsc;
+	uint32_t nslots = 1;
+
+	while (nslots < nctxs) {
+		nslots <<= 1;
+	}
+
+	mpsc = calloc(1, sizeof(*mpsc) + nctxs * sizeof(*mpsc->reqs));
+	if (!mpsc) {
+		XNVME_DEBUG("FAILED: calloc(mpsc), err: %s", strerror(errno));
+		return -ENOMEM;
+	}
+	queue->mpsc = mpsc;
+
+	SLIST_INIT(&mpsc->failed);
+
+	mpsc->freelist = xnvme_queue_ring_alloc(nslots);
+	mpsc->staged = xnvme_queue_ring_alloc(nslots);
+	if (!(mpsc->freelist && mpsc->staged)) {
+		XNVME_DEBUG("FAILED: xnvme_queue_ring_alloc(nslots: %" PRIu32 ")", nslots);
+		xnvme_queue_mpsc_term(queue);
+		return -ENOMEM;
+	}
+
+	for (uint32_t i = 0; i < nctxs; ++i) {
+		xnvme_queue_ring_push(mpsc->freelist, xnvme_queue_entry(queue, i));
+	}
+
+	return 0;
+}
+
+struct xnvme_cmd_ctx *
+xnvme_queue_mpsc_get_cmd_ctx(struct xnvme_queue *queue)
+{
+	struct xnvme_cmd_ctx *ctx = xnvme_queue_ring_pop(queue->mpsc->freelist);
+
+	if (!ctx) {
+		errno = ENOMEM;
+	}
+
+	return ctx;
+}
+
+int
+xnvme_queue_mpsc_put_cmd_ctx(struct xnvme_queue *queue, struct xnvme_cmd_ctx *ctx)
+{
+	return xnvme_queue_ring_push(queue->mpsc->freelist, ctx);
+}
+
+int
+xnvme_queue_mpsc_stage(struct xnvme_cmd_ctx *ctx, void *dbuf, struct iovec *dvec, size_t dvec_cnt,
+		       size_t dbuf_nbytes, void *mbuf, size_t mbuf_nbytes)
+{
+	struct xnvme_queue *queue = ctx->async.queue;
+	struct xnvme_cmd_ctx_entry *entry = (void *)ctx;
+	struct xnvme_queue_mpsc_req *req;
+
+	if ((entry->id > queue->base.capacity) || (xnvme_queue_entry(queue, entry->id) != entry)) {
+		XNVME_DEBUG("FAILED: ctx not retrieved via xnvme_queue_get_cmd_ctx()");
+		return -EINVAL;
+	}
+
+	req = &queue->mpsc->reqs[entry->id];
+	req->dbuf = dbuf;
+	req->dvec = dvec;
+	req->dvec_cnt = dvec_cnt;
+	req->dbuf_nbytes = dbuf_nbytes;
+	req->mbuf = mbuf;
+	req->mbuf_nbytes = mbuf_nbytes;
+
+	return xnvme_queue_ring_push(queue->mpsc->staged, ctx);
+}
+
+int
+xnvme_queue_mpsc_flush(struct xnvme_queue *queue)
+{
+	struct xnvme_queue_mpsc *mpsc = queue->mpsc;
+	uint32_t npassed = 0;
+
+	while (queue->base.outstanding < queue->base.capacity) {
+		struct xnvme_queue_mpsc_req *req;
+		struct xnvme_cmd_ctx *ctx;
+		int err;
+
+		ctx = mpsc->pending ? mpsc->pending : xnvme_queue_ring_pop(mpsc->staged);
+		if (!ctx) {
+			break;
+		}
+		mpsc->pending = NULL;
+
+		req = &mpsc->reqs[((struct xnvme_cmd_ctx_entry *)ctx)->id];
+
+		ctx->opts |= XNVME_CMD_DEFER;
+		err = req->dvec ? queue->base.dev->be.async.cmd_iov(ctx, req->dvec, req->dvec_cnt,
+								    req->dbuf_nbytes, req->mbuf,
+								    req->mbuf_nbytes)
+				: queue->base.dev->be.async.cmd_io(ctx, req->dbuf, req->dbuf_nbytes,
+								   req->mbuf, req->mbuf_nbytes);
+		ctx->opts &= ~XNVME_CMD_DEFER;
+
+		switch (err) {
+		case 0:
+			npassed += 1;
+			continue;
+
+		case -EBUSY:
+		case -EAGAIN:
+			mpsc->pending = ctx;
+			break;
+
+		default:
+			XNVME_DEBUG("FAILED: be.async.cmd_io{v}(), err: %d", err);
+			ctx->cpl.status.sc = -err;
+			ctx->cpl.status.sct = XNVME_STATUS_CODE_TYPE_VENDOR;
+			SLIST_INSERT_HEAD(&mpsc->failed, (struct xnvme_cmd_ctx_entry *)ctx, link);
+			mpsc->nfailed += 1;
+			continue;
+		}
+		break;
+	}
+
+	if (!npassed || !queue->base.dev->be.async.submit) {
+		return 0;
+	}
+
+	return queue->base.dev->be.async.submit(queue);
+}
+
+int
+xnvme_queue_mpsc_complete_failed(struct xnvme_queue *queue, struct xnvme_cmd_ctx **ctxs,
+				 uint32_t max)
+{
+	struct xnvme_queue_mpsc *mpsc = queue->mpsc;
+	uint32_t completed = 0;
+
+	while (mpsc->nfailed && (!max || completed < max)) {
+		struct xnvme_cmd_ctx *ctx = (void *)SLIST_FIRST(&mpsc->failed);
+
+		SLIST_REMOVE_HEAD(&mpsc->failed, link);
+		mpsc->nfailed -= 1;
+
+		if (ctxs) {
+			ctxs[completed] = ctx;
+		} else {
+			ctx->async.cb(ctx, ctx->async.cb_arg);
+		}
+		completed += 1;
+	}
+
+	return completed;
+}
+
+uint32_t
+xnvme_queue_mpsc_nstaged(struct xnvme_queue *queue)
+{
+	struct xnvme_queue_mpsc *mpsc = queue->mpsc;
+
+	return xnvme_queue_ring_count(mpsc->staged) + (mpsc->pending ? 1 : 0) + mpsc->nfailed;
+}
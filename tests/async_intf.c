@@ -3,10 +3,19 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <libxnvme.h>
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 #define XNVME_TESTS_QDEPTH_MAX 512
 #define XNVME_TESTS_NQUEUE_MAX 1024
+#define XNVME_TESTS_NTHREADS 4
+#define XNVME_TESTS_GROUP_NQUEUES 4
 
 static int
 test_init_term(struct xnvme_cli *cli)
@@ -94,6 +103,1133 @@ exit:
 	return err;
 }
 
+/**
+ * Write and read back 'qdepth' LBAs, each direction passed as a single batch via
+ * xnvme_cmd_pass_batch(), verifying that the batch is fully submitted and completed
+ */
+static int
+test_submit_batch(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint64_t qd = cli->args.qdepth;
+	struct xnvme_cmd_ctx *ctxs[XNVME_TESTS_QDEPTH_MAX] = {0};
+	void *dbufs[XNVME_TESTS_QDEPTH_MAX] = {0};
+	size_t dbufs_nbytes[XNVME_TESTS_QDEPTH_MAX] = {0};
+	struct xnvme_queue *queue = NULL;
+	char *wbuf = NULL, *rbuf = NULL;
+	size_t buf_nbytes, diff = 0;
+	int err;
+
+	if (!qd || qd > XNVME_TESTS_QDEPTH_MAX) {
+		XNVME_DEBUG("FAILED: qd(%zu) out-of-bounds for test", qd);
+		return -EINVAL;
+	}
+
+	xnvme_cli_pinf("qdepth: %zu", qd);
+
+	buf_nbytes = qd * geo->lba_nbytes;
+
+	wbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	rbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	if (!(wbuf && rbuf)) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvme_buf_fill(wbuf, buf_nbytes, "anum");
+	xnvme_buf_clear(rbuf, buf_nbytes);
+
+	err = xnvme_queue_init(dev, qd, 0, &queue);
+	if (err) {
+		xnvme_cli_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+
+	for (int rnd = 0; rnd < 2; ++rnd) {
+		uint8_t opc = rnd ? XNVME_SPEC_NVM_OPC_READ : XNVME_SPEC_NVM_OPC_WRITE;
+		char *buf = rnd ? rbuf : wbuf;
+		int ret;
+
+		for (uint64_t i = 0; i < qd; ++i) {
+			ctxs[i] = xnvme_queue_get_cmd_ctx(queue);
+			if (!ctxs[i]) {
+				err = -ENOMEM;
+				xnvme_cli_perr("xnvme_queue_get_cmd_ctx()", err);
+				goto exit;
+			}
+			xnvme_prep_nvm(ctxs[i], opc, nsid, i, 0);
+
+			dbufs[i] = buf + i * geo->lba_nbytes;
+			dbufs_nbytes[i] = geo->lba_nbytes;
+		}
+
+		ret = xnvme_cmd_pass_batch(ctxs, dbufs, dbufs_nbytes, NULL, NULL, qd);
+		if (ret != (int)qd) {
+			err = ret < 0 ? ret : -EIO;
+			xnvme_cli_perr("xnvme_cmd_pass_batch()", err);
+			goto exit;
+		}
+
+		ret = xnvme_queue_drain(queue);
+		if (ret < 0) {
+			err = ret;
+			xnvme_cli_perr("xnvme_queue_drain()", err);
+			goto exit;
+		}
+
+		for (uint64_t i = 0; i < qd; ++i) {
+			if (xnvme_cmd_ctx_cpl_status(ctxs[i])) {
+				xnvme_cmd_ctx_pr(ctxs[i], XNVME_PR_DEF);
+				err = -EIO;
+			}
+			xnvme_queue_put_cmd_ctx(queue, ctxs[i]);
+		}
+		if (err) {
+			xnvme_cli_perr("completion-status", err);
+			goto exit;
+		}
+	}
+
+	err = xnvme_buf_diff(wbuf, rbuf, buf_nbytes, &diff);
+	if (err || diff) {
+		xnvme_cli_pinf("diff: %zu", diff);
+		err = err ? err : -EIO;
+		xnvme_cli_perr("xnvme_buf_diff()", err);
+	}
+
+exit:
+	if (queue) {
+		xnvme_queue_term(queue);
+	}
+	if (wbuf) {
+		xnvme_buf_free(dev, wbuf);
+	}
+	if (rbuf) {
+		xnvme_buf_free(dev, rbuf);
+	}
+
+	return err;
+}
+
+/**
+ * Write and read back 'qdepth' commands of one and two LBAs, LBA-contiguous except for a gap
+ * after every fifth command, and with every third command vectored; such that the interfaces
+ * merging LBA-contiguous commands form groups of mixed commands, split at the gaps
+ */
+static int
+test_merge(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint64_t qd = cli->args.qdepth;
+	struct xnvme_cmd_ctx *ctxs[XNVME_TESTS_QDEPTH_MAX] = {0};
+	struct iovec dvecs[XNVME_TESTS_QDEPTH_MAX][2] = {0};
+	uint64_t slbas[XNVME_TESTS_QDEPTH_MAX] = {0};
+	struct xnvme_queue *queue = NULL;
+	char *wbuf = NULL, *rbuf = NULL;
+	size_t buf_nbytes, diff = 0;
+	uint64_t nlbas = 0;
+	int err;
+
+	if (!qd || qd > XNVME_TESTS_QDEPTH_MAX) {
+		XNVME_DEBUG("FAILED: qd(%zu) out-of-bounds for test", qd);
+		return -EINVAL;
+	}
+
+	xnvme_cli_pinf("qdepth: %zu", qd);
+
+	for (uint64_t i = 0; i < qd; ++i) {
+		slbas[i] = nlbas;
+		nlbas += (i % 2) + 1 + ((i % 5) == 4);
+	}
+	buf_nbytes = nlbas * geo->lba_nbytes;
+
+	wbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	rbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	if (!(wbuf && rbuf)) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvme_buf_fill(wbuf, buf_nbytes, "anum");
+	xnvme_buf_clear(rbuf, buf_nbytes);
+
+	err = xnvme_queue_init(dev, qd, 0, &queue);
+	if (err) {
+		xnvme_cli_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+
+	for (int rnd = 0; rnd < 2; ++rnd) {
+		uint8_t opc = rnd ? XNVME_SPEC_NVM_OPC_READ : XNVME_SPEC_NVM_OPC_WRITE;
+		char *buf = rnd ? rbuf : wbuf;
+		int ret;
+
+		for (uint64_t i = 0; i < qd; ++i) {
+			size_t nbytes = ((i % 2) + 1) * geo->lba_nbytes;
+			char *dbuf = buf + slbas[i] * geo->lba_nbytes;
+
+			ctxs[i] = xnvme_queue_get_cmd_ctx(queue);
+			if (!ctxs[i]) {
+				err = -ENOMEM;
+				xnvme_cli_perr("xnvme_queue_get_cmd_ctx()", err);
+				goto exit;
+			}
+			xnvme_prep_nvm(ctxs[i], opc, nsid, slbas[i], i % 2);
+
+			if ((i % 3) == 1) {
+				dvecs[i][0].iov_base = dbuf;
+				dvecs[i][0].iov_len = nbytes / 2;
+				dvecs[i][1].iov_base = dbuf + nbytes / 2;
+				dvecs[i][1].iov_len = nbytes / 2;
+
+				err = xnvme_cmd_passv(ctxs[i], dvecs[i], 2, nbytes, NULL, 0, 0);
+			} else {
+				err = xnvme_cmd_pass(ctxs[i], dbuf, nbytes, NULL, 0);
+			}
+			if (err) {
+				xnvme_cli_perr("xnvme_cmd_pass{v}()", err);
+				goto exit;
+			}
+		}
+
+		ret = xnvme_queue_drain(queue);
+		if (ret < 0) {
+			err = ret;
+			xnvme_cli_perr("xnvme_queue_drain()", err);
+			goto exit;
+		}
+
+		for (uint64_t i = 0; i < qd; ++i) {
+			if (xnvme_cmd_ctx_cpl_status(ctxs[i])) {
+				xnvme_cmd_ctx_pr(ctxs[i], XNVME_PR_DEF);
+				err = -EIO;
+			}
+			xnvme_queue_put_cmd_ctx(queue, ctxs[i]);
+		}
+		if (err) {
+			xnvme_cli_perr("completion-status", err);
+			goto exit;
+		}
+	}
+
+	for (uint64_t i = 0; i < qd; ++i) {
+		size_t ofs = slbas[i] * geo->lba_nbytes;
+
+		size_t nbytes = ((i % 2) + 1) * geo->lba_nbytes;
+
+		err = xnvme_buf_diff(wbuf + ofs, rbuf + ofs, nbytes, &diff);
+		if (err || diff) {
+			xnvme_cli_pinf("slba: %zu, diff: %zu", slbas[i], diff);
+			err = err ? err : -EIO;
+			xnvme_cli_perr("xnvme_buf_diff()", err);
+			goto exit;
+		}
+	}
+
+exit:
+	if (queue) {
+		xnvme_queue_term(queue);
+	}
+	if (wbuf) {
+		xnvme_buf_free(dev, wbuf);
+	}
+	if (rbuf) {
+		xnvme_buf_free(dev, rbuf);
+	}
+
+	return err;
+}
+
+/**
+ * Write and read back 'qdepth' commands alternating between transfers of 'mdts' bytes, at most 1
+ * MiB, and of a single LBA, with every fourth command vectored; such that interfaces handing
+ * large transfers to other threads complete the commands out of submission order
+ */
+static int
+test_large(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint64_t qd = cli->args.qdepth;
+	struct xnvme_cmd_ctx *ctxs[XNVME_TESTS_QDEPTH_MAX] = {0};
+	struct iovec dvecs[XNVME_TESTS_QDEPTH_MAX][2] = {0};
+	size_t ofs[XNVME_TESTS_QDEPTH_MAX] = {0};
+	size_t nbytes[XNVME_TESTS_QDEPTH_MAX] = {0};
+	struct xnvme_queue *queue = NULL;
+	char *wbuf = NULL, *rbuf = NULL;
+	size_t large_nbytes, buf_nbytes = 0, diff = 0;
+	int err;
+
+	if (!qd || qd > XNVME_TESTS_QDEPTH_MAX) {
+		XNVME_DEBUG("FAILED: qd(%zu) out-of-bounds for test", qd);
+		return -EINVAL;
+	}
+
+	large_nbytes = 1024 * 1024;
+	if (geo->mdts_nbytes && (geo->mdts_nbytes < large_nbytes)) {
+		large_nbytes = geo->mdts_nbytes;
+	}
+	large_nbytes -= large_nbytes % (2 * geo->lba_nbytes);
+
+	xnvme_cli_pinf("qdepth: %zu, large_nbytes: %zu", qd, large_nbytes);
+
+	for (uint64_t i = 0; i < qd; ++i) {
+		ofs[i] = buf_nbytes;
+		nbytes[i] = (i % 2) ? geo->lba_nbytes : large_nbytes;
+		buf_nbytes += nbytes[i];
+	}
+
+	wbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	rbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	if (!(wbuf && rbuf)) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvme_buf_fill(wbuf, buf_nbytes, "anum");
+	xnvme_buf_clear(rbuf, buf_nbytes);
+
+	err = xnvme_queue_init(dev, qd, 0, &queue);
+	if (err) {
+		xnvme_cli_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+
+	for (int rnd = 0; rnd < 2; ++rnd) {
+		uint8_t opc = rnd ? XNVME_SPEC_NVM_OPC_READ : XNVME_SPEC_NVM_OPC_WRITE;
+		char *buf = rnd ? rbuf : wbuf;
+		int ret;
+
+		for (uint64_t i = 0; i < qd; ++i) {
+			uint64_t slba = ofs[i] / geo->lba_nbytes;
+			uint16_t nlb = nbytes[i] / geo->lba_nbytes - 1;
+			char *dbuf = buf + ofs[i];
+
+			ctxs[i] = xnvme_queue_get_cmd_ctx(queue);
+			if (!ctxs[i]) {
+				err = -ENOMEM;
+				xnvme_cli_perr("xnvme_queue_get_cmd_ctx()", err);
+				goto exit;
+			}
+			xnvme_prep_nvm(ctxs[i], opc, nsid, slba, nlb);
+
+			if ((i % 4) == 2) {
+				dvecs[i][0].iov_base = dbuf;
+				dvecs[i][0].iov_len = nbytes[i] / 2;
+				dvecs[i][1].iov_base = dbuf + nbytes[i] / 2;
+				dvecs[i][1].iov_len = nbytes[i] / 2;
+
+				err = xnvme_cmd_passv(ctxs[i], dvecs[i], 2, nbytes[i], NULL, 0, 0);
+			} else {
+				err = xnvme_cmd_pass(ctxs[i], dbuf, nbytes[i], NULL, 0);
+			}
+			if (err) {
+				xnvme_cli_perr("xnvme_cmd_pass{v}()", err);
+				goto exit;
+			}
+		}
+
+		ret = xnvme_queue_drain(queue);
+		if (ret < 0) {
+			err = ret;
+			xnvme_cli_perr("xnvme_queue_drain()", err);
+			goto exit;
+		}
+
+		for (uint64_t i = 0; i < qd; ++i) {
+			if (xnvme_cmd_ctx_cpl_status(ctxs[i])) {
+				xnvme_cmd_ctx_pr(ctxs[i], XNVME_PR_DEF);
+				err = -EIO;
+			}
+			xnvme_queue_put_cmd_ctx(queue, ctxs[i]);
+		}
+		if (err) {
+			xnvme_cli_perr("completion-status", err);
+			goto exit;
+		}
+	}
+
+	err = xnvme_buf_diff(wbuf, rbuf, buf_nbytes, &diff);
+	if (err || diff) {
+		xnvme_cli_pinf("diff: %zu", diff);
+		err = err ? err : -EIO;
+		xnvme_cli_perr("xnvme_buf_diff()", err);
+		goto exit;
+	}
+
+exit:
+	if (queue) {
+		xnvme_queue_term(queue);
+	}
+	if (wbuf) {
+		xnvme_buf_free(dev, wbuf);
+	}
+	if (rbuf) {
+		xnvme_buf_free(dev, rbuf);
+	}
+
+	return err;
+}
+
+static void
+cb_count(struct xnvme_cmd_ctx *XNVME_UNUSED(ctx), void *cb_arg)
+{
+	uint64_t *ncallbacks = cb_arg;
+
+	*ncallbacks += 1;
+}
+
+/**
+ * Write 'qdepth' LBAs and collect the completions via xnvme_queue_reap(), verifying that every
+ * command is reaped exactly once and that no callbacks are invoked
+ */
+static int
+test_reap(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint64_t qd = cli->args.qdepth;
+	struct xnvme_cmd_ctx *ctxs[XNVME_TESTS_QDEPTH_MAX] = {0};
+	uint8_t seen[XNVME_TESTS_QDEPTH_MAX] = {0};
+	uint64_t ncallbacks = 0, nreaped = 0;
+	struct xnvme_queue *queue = NULL;
+	char *buf = NULL;
+	int err;
+
+	if (!qd || qd > XNVME_TESTS_QDEPTH_MAX) {
+		XNVME_DEBUG("FAILED: qd(%zu) out-of-bounds for test", qd);
+		return -EINVAL;
+	}
+
+	xnvme_cli_pinf("qdepth: %zu", qd);
+
+	buf = xnvme_buf_alloc(dev, qd * geo->lba_nbytes);
+	if (!buf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvme_buf_fill(buf, qd * geo->lba_nbytes, "anum");
+
+	err = xnvme_queue_init(dev, qd, 0, &queue);
+	if (err) {
+		xnvme_cli_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+	xnvme_queue_set_cb(queue, cb_count, &ncallbacks);
+
+	for (uint64_t i = 0; i < qd; ++i) {
+		struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(queue);
+
+		xnvme_prep_nvm(ctx, XNVME_SPEC_NVM_OPC_WRITE, nsid, i, 0);
+
+		err = xnvme_cmd_pass(ctx, buf + i * geo->lba_nbytes, geo->lba_nbytes, NULL, 0);
+		if (err) {
+			xnvme_cli_perr("xnvme_cmd_pass()", err);
+			goto exit;
+		}
+	}
+
+	while (nreaped < qd) {
+		int ret;
+
+		ret = xnvme_queue_reap(queue, ctxs, (qd + 3) / 4);
+		if (ret < 0) {
+			err = ret;
+			xnvme_cli_perr("xnvme_queue_reap()", err);
+			goto exit;
+		}
+
+		for (int i = 0; i < ret; ++i) {
+			uint64_t slba = ctxs[i]->cmd.nvm.slba;
+
+			if ((slba >= qd) || seen[slba]) {
+				xnvme_cli_pinf("unexpected completion of slba: %zu", slba);
+				err = -EIO;
+			}
+			if (xnvme_cmd_ctx_cpl_status(ctxs[i])) {
+				xnvme_cmd_ctx_pr(ctxs[i], XNVME_PR_DEF);
+				err = -EIO;
+			}
+			seen[slba < qd ? slba : 0] = 1;
+
+			xnvme_queue_put_cmd_ctx(queue, ctxs[i]);
+		}
+		if (err) {
+			xnvme_cli_perr("reaped completion", err);
+			goto exit;
+		}
+
+		nreaped += ret;
+	}
+
+	xnvme_cli_pinf("nreaped: %zu, ncallbacks: %zu", nreaped, ncallbacks);
+
+	if (ncallbacks || xnvme_queue_get_outstanding(queue)) {
+		err = -EIO;
+		xnvme_cli_perr("callbacks invoked or commands outstanding", err);
+	}
+
+exit:
+	if (queue) {
+		xnvme_queue_term(queue);
+	}
+	if (buf) {
+		xnvme_buf_free(dev, buf);
+	}
+
+	return err;
+}
+
+/**
+ * Write 'qdepth' LBAs and wait for half, then the rest, of the completions via
+ * xnvme_queue_wait_timeout(), verifying the number of completions processed by each wait
+ */
+static int
+test_wait_timeout(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint64_t qd = cli->args.qdepth;
+	const uint64_t timeout_ns = 10ULL * 1000 * 1000 * 1000;
+	struct xnvme_queue *queue = NULL;
+	uint64_t ncallbacks = 0;
+	char *buf = NULL;
+	int ret, err;
+
+	if (!qd || qd > XNVME_TESTS_QDEPTH_MAX) {
+		XNVME_DEBUG("FAILED: qd(%zu) out-of-bounds for test", qd);
+		return -EINVAL;
+	}
+
+	xnvme_cli_pinf("qdepth: %zu", qd);
+
+	buf = xnvme_buf_alloc(dev, qd * geo->lba_nbytes);
+	if (!buf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvme_buf_fill(buf, qd * geo->lba_nbytes, "anum");
+
+	err = xnvme_queue_init(dev, qd, 0, &queue);
+	if (err) {
+		xnvme_cli_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+	xnvme_queue_set_cb(queue, cb_count, &ncallbacks);
+
+	ret = xnvme_queue_wait_timeout(queue, 1, timeout_ns);
+	if (ret) {
+		err = ret < 0 ? ret : -EIO;
+		xnvme_cli_perr("xnvme_queue_wait_timeout() on empty queue", err);
+		goto exit;
+	}
+
+	for (uint64_t i = 0; i < qd; ++i) {
+		struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(queue);
+
+		xnvme_prep_nvm(ctx, XNVME_SPEC_NVM_OPC_WRITE, nsid, i, 0);
+
+		err = xnvme_cmd_pass(ctx, buf + i * geo->lba_nbytes, geo->lba_nbytes, NULL, 0);
+		if (err) {
+			xnvme_cli_perr("xnvme_cmd_pass()", err);
+			goto exit;
+		}
+	}
+
+	ret = xnvme_queue_wait_timeout(queue, qd / 2, timeout_ns);
+	xnvme_cli_pinf("wait(min: %zu), ret: %d", qd / 2, ret);
+	if ((ret < 0) || ((uint64_t)ret < qd / 2)) {
+		err = ret < 0 ? ret : -ETIMEDOUT;
+		xnvme_cli_perr("xnvme_queue_wait_timeout(qdepth / 2)", err);
+		goto exit;
+	}
+
+	ret = xnvme_queue_wait_timeout(queue, 0, 0);
+	xnvme_cli_pinf("wait(min: 0), ret: %d", ret);
+	if (ret < 0) {
+		err = ret;
+		xnvme_cli_perr("xnvme_queue_wait_timeout(0)", err);
+		goto exit;
+	}
+
+	xnvme_cli_pinf("ncallbacks: %zu", ncallbacks);
+
+	if ((ncallbacks != qd) || xnvme_queue_get_outstanding(queue)) {
+		err = -EIO;
+		xnvme_cli_perr("callbacks missing or commands outstanding", err);
+	}
+
+exit:
+	if (queue) {
+		xnvme_queue_term(queue);
+	}
+	if (buf) {
+		xnvme_buf_free(dev, buf);
+	}
+
+	return err;
+}
+
+/**
+ * Write 'qdepth' LBAs on each of XNVME_TESTS_GROUP_NQUEUES queues in a ::xnvme_queue_group and
+ * process the completions via xnvme_queue_group_wait(), verifying that all queues are serviced
+ */
+static int
+test_group(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint64_t qd = cli->args.qdepth;
+	const uint64_t timeout_ns = 10ULL * 1000 * 1000 * 1000;
+	struct xnvme_queue *queues[XNVME_TESTS_GROUP_NQUEUES] = {0};
+	uint64_t ncallbacks[XNVME_TESTS_GROUP_NQUEUES] = {0};
+	struct xnvme_queue_group *group = NULL;
+	uint64_t nlbas = qd * XNVME_TESTS_GROUP_NQUEUES;
+	char *buf = NULL;
+	int err;
+
+	if (!qd || qd > XNVME_TESTS_QDEPTH_MAX) {
+		XNVME_DEBUG("FAILED: qd(%zu) out-of-bounds for test", qd);
+		return -EINVAL;
+	}
+
+	xnvme_cli_pinf("qdepth: %zu, nqueues: %d", qd, XNVME_TESTS_GROUP_NQUEUES);
+
+	buf = xnvme_buf_alloc(dev, nlbas * geo->lba_nbytes);
+	if (!buf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvme_buf_fill(buf, nlbas * geo->lba_nbytes, "anum");
+
+	err = xnvme_queue_group_init(&group);
+	if (err) {
+		xnvme_cli_perr("xnvme_queue_group_init()", err);
+		goto exit;
+	}
+
+	for (int qn = 0; qn < XNVME_TESTS_GROUP_NQUEUES; ++qn) {
+		err = xnvme_queue_init(dev, qd, 0, &queues[qn]);
+		if (err) {
+			xnvme_cli_perr("xnvme_queue_init()", err);
+			goto exit;
+		}
+		xnvme_queue_set_cb(queues[qn], cb_count, &ncallbacks[qn]);
+
+		err = xnvme_queue_group_add(group, queues[qn]);
+		if (err) {
+			xnvme_cli_perr("xnvme_queue_group_add()", err);
+			goto exit;
+		}
+	}
+
+	if (xnvme_queue_group_add(group, queues[0]) != -EEXIST) {
+		err = -EIO;
+		xnvme_cli_perr("xnvme_queue_group_add() of duplicate", err);
+		goto exit;
+	}
+
+	for (uint64_t slba = 0; slba < nlbas; ++slba) {
+		struct xnvme_queue *queue = queues[slba % XNVME_TESTS_GROUP_NQUEUES];
+		struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(queue);
+
+		xnvme_prep_nvm(ctx, XNVME_SPEC_NVM_OPC_WRITE, nsid, slba, 0);
+
+		err = xnvme_cmd_pass(ctx, buf + slba * geo->lba_nbytes, geo->lba_nbytes, NULL, 0);
+		if (err) {
+			xnvme_cli_perr("xnvme_cmd_pass()", err);
+			goto exit;
+		}
+	}
+
+	while (xnvme_queue_group_get_outstanding(group)) {
+		int ret = xnvme_queue_group_wait(group, timeout_ns);
+
+		if (ret <= 0) {
+			err = ret ? ret : -ETIMEDOUT;
+			xnvme_cli_perr("xnvme_queue_group_wait()", err);
+			goto exit;
+		}
+	}
+
+	for (int qn = 0; qn < XNVME_TESTS_GROUP_NQUEUES; ++qn) {
+		xnvme_cli_pinf("queue: %d, ncallbacks: %zu", qn, ncallbacks[qn]);
+		if (ncallbacks[qn] != qd) {
+			err = -EIO;
+		}
+	}
+	if (err) {
+		xnvme_cli_perr("ncallbacks != qdepth", err);
+		goto exit;
+	}
+
+	err = xnvme_queue_group_remove(group, queues[0]);
+	if (err || (xnvme_queue_group_remove(group, queues[0]) != -ENOENT)) {
+		err = err ? err : -EIO;
+		xnvme_cli_perr("xnvme_queue_group_remove()", err);
+	}
+
+exit:
+	xnvme_queue_group_term(group);
+	for (int qn = 0; qn < XNVME_TESTS_GROUP_NQUEUES; ++qn) {
+		if (queues[qn]) {
+			xnvme_queue_term(queues[qn]);
+		}
+	}
+	if (buf) {
+		xnvme_buf_free(dev, buf);
+	}
+
+	return err;
+}
+
+/**
+ * Fill a queue of capacity 'qdepth', e.g. beyond the legacy limit of 2048, with writes and drain
+ * it, verifying that every command completes
+ */
+static int
+test_deep(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint64_t qd = cli->args.qdepth;
+	struct xnvme_queue *queue = NULL;
+	uint64_t ncallbacks = 0;
+	char *buf = NULL;
+	int err;
+
+	xnvme_cli_pinf("qdepth: %zu", qd);
+
+	buf = xnvme_buf_alloc(dev, qd * geo->lba_nbytes);
+	if (!buf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvme_buf_fill(buf, qd * geo->lba_nbytes, "anum");
+
+	err = xnvme_queue_init(dev, qd, 0, &queue);
+	if (err) {
+		xnvme_cli_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+	xnvme_queue_set_cb(queue, cb_count, &ncallbacks);
+
+	for (uint64_t i = 0; i < qd; ++i) {
+		struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(queue);
+
+		if (!ctx) {
+			err = -ENOMEM;
+			xnvme_cli_perr("xnvme_queue_get_cmd_ctx()", err);
+			goto exit;
+		}
+		xnvme_prep_nvm(ctx, XNVME_SPEC_NVM_OPC_WRITE, nsid, i, 0);
+
+		err = xnvme_cmd_pass(ctx, buf + i * geo->lba_nbytes, geo->lba_nbytes, NULL, 0);
+		if (err) {
+			xnvme_cli_perr("xnvme_cmd_pass()", err);
+			goto exit;
+		}
+	}
+
+	if (xnvme_queue_get_outstanding(queue) != qd) {
+		err = -EIO;
+		xnvme_cli_perr("xnvme_queue_get_outstanding() != qdepth", err);
+		goto exit;
+	}
+
+	err = xnvme_queue_drain(queue);
+	if (err < 0) {
+		xnvme_cli_perr("xnvme_queue_drain()", err);
+		goto exit;
+	}
+	err = 0;
+
+	xnvme_cli_pinf("ncallbacks: %zu", ncallbacks);
+
+	if (ncallbacks != qd) {
+		err = -EIO;
+		xnvme_cli_perr("ncallbacks != qdepth", err);
+	}
+
+exit:
+	if (queue) {
+		xnvme_queue_term(queue);
+	}
+	if (buf) {
+		xnvme_buf_free(dev, buf);
+	}
+
+	return err;
+}
+
+struct mpsc_state {
+	struct xnvme_dev *dev;
+	struct xnvme_queue *queue;
+	char *buf;
+	uint64_t nlbas; ///< Number of LBAs written by each producer
+	_Atomic uint64_t ncompleted;
+	_Atomic uint64_t nerrors;
+};
+
+struct mpsc_producer {
+	struct mpsc_state *state;
+	uint64_t slba;
+	int err;
+};
+
+static void
+cb_mpsc(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct mpsc_state *state = cb_arg;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		xnvme_cmd_ctx_pr(ctx, XNVME_PR_DEF);
+		atomic_fetch_add(&state->nerrors, 1);
+	}
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+
+	atomic_fetch_add(&state->ncompleted, 1);
+}
+
+static void *
+mpsc_producer(void *arg)
+{
+	struct mpsc_producer *producer = arg;
+	struct mpsc_state *state = producer->state;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(state->dev);
+	uint32_t nsid = xnvme_dev_get_nsid(state->dev);
+
+	for (uint64_t i = 0; i < state->nlbas; ++i) {
+		uint64_t slba = producer->slba + i;
+		struct xnvme_cmd_ctx *ctx;
+		int err;
+
+		while (!(ctx = xnvme_queue_get_cmd_ctx(state->queue))) {
+			sched_yield();
+		}
+		xnvme_prep_nvm(ctx, XNVME_SPEC_NVM_OPC_WRITE, nsid, slba, 0);
+
+		err = xnvme_cmd_pass(ctx, state->buf + slba * geo->lba_nbytes, geo->lba_nbytes,
+				     NULL, 0);
+		if (err) {
+			xnvme_cli_perr("xnvme_cmd_pass()", err);
+			xnvme_queue_put_cmd_ctx(state->queue, ctx);
+			producer->err = err;
+			atomic_fetch_add(&state->ncompleted, state->nlbas - i);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Write LBAs from XNVME_TESTS_NTHREADS producer threads passing commands concurrently to a queue
+ * initialized with XNVME_QUEUE_MPSC, while the main thread pokes it for completions
+ */
+static int
+test_mpsc(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	uint64_t qd = cli->args.qdepth;
+	struct mpsc_producer producers[XNVME_TESTS_NTHREADS] = {0};
+	pthread_t threads[XNVME_TESTS_NTHREADS];
+	struct mpsc_state state = {0};
+	uint64_t total;
+	int nthreads = 0;
+	int err;
+
+	if (!qd || qd > XNVME_TESTS_QDEPTH_MAX) {
+		XNVME_DEBUG("FAILED: qd(%zu) out-of-bounds for test", qd);
+		return -EINVAL;
+	}
+
+	state.dev = dev;
+	state.nlbas = qd * 4;
+	total = state.nlbas * XNVME_TESTS_NTHREADS;
+	atomic_init(&state.ncompleted, 0);
+	atomic_init(&state.nerrors, 0);
+
+	xnvme_cli_pinf("qdepth: %zu, nthreads: %d, total: %zu", qd, XNVME_TESTS_NTHREADS, total);
+
+	state.buf = xnvme_buf_alloc(dev, total * geo->lba_nbytes);
+	if (!state.buf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvme_buf_fill(state.buf, total * geo->lba_nbytes, "anum");
+
+	err = xnvme_queue_init(dev, qd, XNVME_QUEUE_MPSC, &state.queue);
+	if (err) {
+		xnvme_cli_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+	xnvme_queue_set_cb(state.queue, cb_mpsc, &state);
+
+	for (; nthreads < XNVME_TESTS_NTHREADS; ++nthreads) {
+		producers[nthreads].state = &state;
+		producers[nthreads].slba = nthreads * state.nlbas;
+
+		err = -pthread_create(&threads[nthreads], NULL, mpsc_producer,
+				      &producers[nthreads]);
+		if (err) {
+			xnvme_cli_perr("pthread_create()", err);
+			atomic_fetch_add(&state.ncompleted,
+					 (XNVME_TESTS_NTHREADS - nthreads) * state.nlbas);
+			break;
+		}
+	}
+
+	while (atomic_load(&state.ncompleted) < total) {
+		int ret = xnvme_queue_poke(state.queue, 0);
+
+		if (ret < 0) {
+			xnvme_cli_perr("xnvme_queue_poke()", ret);
+			err = err ? err : ret;
+			break;
+		}
+	}
+
+	for (int i = 0; i < nthreads; ++i) {
+		pthread_join(threads[i], NULL);
+		err = err ? err : producers[i].err;
+	}
+
+	err = err ? err : xnvme_queue_drain(state.queue);
+	if (err < 0) {
+		goto exit;
+	}
+	err = 0;
+
+	xnvme_cli_pinf("ncompleted: %zu, nerrors: %zu", atomic_load(&state.ncompleted),
+		       atomic_load(&state.nerrors));
+
+	if (atomic_load(&state.nerrors) || xnvme_queue_get_outstanding(state.queue)) {
+		err = -EIO;
+		xnvme_cli_perr("completion errors or commands outstanding", err);
+	}
+
+exit:
+	if (state.queue) {
+		xnvme_queue_term(state.queue);
+	}
+	if (state.buf) {
+		xnvme_buf_free(dev, state.buf);
+	}
+
+	return err;
+}
+
+/**
+ * Submit 'qdepth' Identify Controller admin-commands via the queue and collect the completions via
+ * xnvme_queue_reap(), verifying each payload against the controller-identify of the device
+ */
+static int
+test_admin(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_spec_idfy_ctrlr *ctrlr = xnvme_dev_get_ctrlr(dev);
+	const size_t nbytes = sizeof(struct xnvme_spec_idfy);
+	uint64_t qd = cli->args.qdepth;
+	struct xnvme_cmd_ctx *ctxs[XNVME_TESTS_QDEPTH_MAX] = {0};
+	struct xnvme_queue *queue = NULL;
+	uint64_t nreaped = 0;
+	char *buf = NULL;
+	int err;
+
+	if (!qd || qd > XNVME_TESTS_QDEPTH_MAX) {
+		XNVME_DEBUG("FAILED: qd(%zu) out-of-bounds for test", qd);
+		return -EINVAL;
+	}
+
+	xnvme_cli_pinf("qdepth: %zu", qd);
+
+	buf = xnvme_buf_alloc(dev, qd * nbytes);
+	if (!buf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	memset(buf, 0, qd * nbytes);
+
+	err = xnvme_queue_init(dev, qd, 0, &queue);
+	if (err) {
+		xnvme_cli_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+
+	for (uint64_t i = 0; i < qd; ++i) {
+		struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(queue);
+
+		err = xnvme_adm_idfy_ctrlr(ctx, (struct xnvme_spec_idfy *)(buf + i * nbytes));
+		if (err) {
+			xnvme_cli_perr("xnvme_adm_idfy_ctrlr()", err);
+			goto exit;
+		}
+	}
+
+	while (nreaped < qd) {
+		int ret;
+
+		ret = xnvme_queue_reap(queue, ctxs, qd);
+		if (ret < 0) {
+			err = ret;
+			xnvme_cli_perr("xnvme_queue_reap()", err);
+			goto exit;
+		}
+
+		for (int i = 0; i < ret; ++i) {
+			if (xnvme_cmd_ctx_cpl_status(ctxs[i])) {
+				xnvme_cmd_ctx_pr(ctxs[i], XNVME_PR_DEF);
+				err = -EIO;
+			}
+			xnvme_queue_put_cmd_ctx(queue, ctxs[i]);
+		}
+		if (err) {
+			xnvme_cli_perr("reaped completion", err);
+			goto exit;
+		}
+
+		nreaped += ret;
+	}
+
+	for (uint64_t i = 0; i < qd; ++i) {
+		if (memcmp(buf + i * nbytes, ctrlr, sizeof(*ctrlr))) {
+			err = -EIO;
+			xnvme_cli_perr("payload mismatch", err);
+			goto exit;
+		}
+	}
+
+	xnvme_cli_pinf("nreaped: %zu", nreaped);
+
+exit:
+	if (queue) {
+		xnvme_queue_term(queue);
+	}
+	if (buf) {
+		xnvme_buf_free(dev, buf);
+	}
+
+	return err;
+}
+
+/**
+ * Write 'qdepth' LBAs and process them by poking one command at a time, only when the completion
+ * event fd of the queue is signaled; verifying that a poke leaving commands behind re-signals it
+ */
+static int
+test_completion_fd(struct xnvme_cli *cli)
+{
+#ifdef XNVME_PLATFORM_LINUX_ENABLED
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	uint32_t nsid = xnvme_dev_get_nsid(dev);
+	uint64_t qd = cli->args.qdepth;
+	struct xnvme_queue *queue = NULL;
+	uint64_t ncallbacks = 0;
+	char *buf = NULL;
+	struct pollfd pfd = {.events = POLLIN};
+	int err;
+
+	if (!qd || qd > XNVME_TESTS_QDEPTH_MAX) {
+		XNVME_DEBUG("FAILED: qd(%zu) out-of-bounds for test", qd);
+		return -EINVAL;
+	}
+
+	xnvme_cli_pinf("qdepth: %zu", qd);
+
+	buf = xnvme_buf_alloc(dev, qd * geo->lba_nbytes);
+	if (!buf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvme_buf_fill(buf, qd * geo->lba_nbytes, "anum");
+
+	err = xnvme_queue_init(dev, qd, 0, &queue);
+	if (err) {
+		xnvme_cli_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+	xnvme_queue_set_cb(queue, cb_count, &ncallbacks);
+
+	pfd.fd = xnvme_queue_get_completion_fd(queue);
+	if (pfd.fd < 0) {
+		err = pfd.fd;
+		xnvme_cli_perr("xnvme_queue_get_completion_fd()", err);
+		goto exit;
+	}
+
+	for (uint64_t slba = 0; slba < qd; ++slba) {
+		struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(queue);
+
+		xnvme_prep_nvm(ctx, XNVME_SPEC_NVM_OPC_WRITE, nsid, slba, 0);
+
+		err = xnvme_cmd_pass(ctx, buf + slba * geo->lba_nbytes, geo->lba_nbytes, NULL, 0);
+		if (err) {
+			xnvme_cli_perr("xnvme_cmd_pass()", err);
+			goto exit;
+		}
+	}
+
+	while (ncallbacks < qd) {
+		uint64_t nsignals;
+		int ret;
+
+		ret = poll(&pfd, 1, 10 * 1000);
+		if (ret <= 0) {
+			err = ret ? -errno : -ETIMEDOUT;
+			xnvme_cli_perr("poll(completion_fd)", err);
+			goto exit;
+		}
+		if (read(pfd.fd, &nsignals, sizeof(nsignals)) != sizeof(nsignals)) {
+			err = -errno;
+			xnvme_cli_perr("read(completion_fd)", err);
+			goto exit;
+		}
+
+		ret = xnvme_queue_poke(queue, 1);
+		if (ret < 0) {
+			err = ret;
+			xnvme_cli_perr("xnvme_queue_poke()", err);
+			goto exit;
+		}
+	}
+
+	xnvme_cli_pinf("ncallbacks: %zu", ncallbacks);
+
+exit:
+	if (queue) {
+		xnvme_queue_term(queue);
+	}
+	if (buf) {
+		xnvme_buf_free(dev, buf);
+	}
+
+	return err;
+#else
+	xnvme_cli_pinf("completion event fd is only available on Linux; skipping");
+
+	return 0;
+#endif
+}
+
 //
 // Command-Line Interface (CLI) definition
 //
@@ -112,6 +1248,156 @@ static struct xnvme_cli_sub g_subs[] = {
 			{XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LREQ},
 			{XNVME_CLI_OPT_CLEAR, XNVME_CLI_LFLG},
 
+			XNVME_CLI_ASYNC_OPTS,
+		},
+	},
+	{
+		"deep",
+		"Fill and drain a single queue of capacity 'qdepth'",
+		"Fill and drain a single queue of capacity 'qdepth'",
+		test_deep,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LREQ},
+
+			XNVME_CLI_ASYNC_OPTS,
+		},
+	},
+	{
+		"group",
+		"Write 'qdepth' LBAs on each of multiple queues serviced as a group",
+		"Write 'qdepth' LBAs on each of multiple queues serviced as a group",
+		test_group,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LREQ},
+
+			XNVME_CLI_ASYNC_OPTS,
+		},
+	},
+	{
+		"mpsc",
+		"Write LBAs from multiple threads sharing one XNVME_QUEUE_MPSC queue",
+		"Write LBAs from multiple threads sharing one XNVME_QUEUE_MPSC queue",
+		test_mpsc,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LREQ},
+
+			XNVME_CLI_ASYNC_OPTS,
+		},
+	},
+	{
+		"reap",
+		"Write 'qdepth' LBAs and collect completions via xnvme_queue_reap()",
+		"Write 'qdepth' LBAs and collect completions via xnvme_queue_reap()",
+		test_reap,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LREQ},
+
+			XNVME_CLI_ASYNC_OPTS,
+		},
+	},
+	{
+		"wait_timeout",
+		"Write 'qdepth' LBAs and wait for completions via xnvme_queue_wait_timeout()",
+		"Write 'qdepth' LBAs and wait for completions via xnvme_queue_wait_timeout()",
+		test_wait_timeout,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LREQ},
+
+			XNVME_CLI_ASYNC_OPTS,
+		},
+	},
+	{
+		"merge",
+		"Write and read 'qdepth' mostly LBA-contiguous commands",
+		"Write and read 'qdepth' mostly LBA-contiguous commands, some vectored",
+		test_merge,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LREQ},
+
+			XNVME_CLI_ASYNC_OPTS,
+		},
+	},
+	{
+		"large",
+		"Write and read 'qdepth' commands alternating between large and small",
+		"Write and read 'qdepth' commands alternating between 'mdts' and one LBA",
+		test_large,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LREQ},
+
+			XNVME_CLI_ASYNC_OPTS,
+		},
+	},
+	{
+		"submit_batch",
+		"Write and read 'qdepth' LBAs passed as one batch per direction",
+		"Write and read 'qdepth' LBAs passed as one batch per direction",
+		test_submit_batch,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LREQ},
+
+			XNVME_CLI_ASYNC_OPTS,
+		},
+	},
+	{
+		"admin",
+		"Identify the controller via 'qdepth' async admin-commands",
+		"Identify the controller via 'qdepth' async admin-commands",
+		test_admin,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LREQ},
+
+			XNVME_CLI_ASYNC_OPTS,
+		},
+	},
+	{
+		"completion_fd",
+		"Process 'qdepth' writes as signaled by the completion event fd",
+		"Process 'qdepth' writes as signaled by the completion event fd",
+		test_completion_fd,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LREQ},
+
 			XNVME_CLI_ASYNC_OPTS,
 		},
 	},
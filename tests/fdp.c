@@ -0,0 +1,315 @@
+// SPDX-FileCopyrightText: Samsung Electronics Co., Ltd
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <libxnvme.h>
+
+#define FDP_DTYPE 0x2
+
+static int
+_write(struct xnvme_dev *dev, uint32_t nsid, uint64_t slba, uint16_t nlb, uint16_t pid, void *dbuf)
+{
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	int err;
+
+	xnvme_prep_nvm(&ctx, XNVME_SPEC_NVM_OPC_WRITE, nsid, slba, nlb);
+	ctx.cmd.nvm.dtype = FDP_DTYPE;
+	ctx.cmd.nvm.cdw13.dspec = pid;
+
+	err = xnvme_cmd_pass(&ctx, dbuf, (nlb + 1) * xnvme_dev_get_geo(dev)->lba_nbytes, NULL, 0);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvme_cli_perr("xnvme_cmd_pass()", err);
+		xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+		return err ? err : -EIO;
+	}
+
+	return 0;
+}
+
+static int
+_ruhs(struct xnvme_dev *dev, uint32_t nsid, struct xnvme_spec_ruhs *ruhs, uint32_t nbytes)
+{
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	int err;
+
+	err = xnvme_nvm_mgmt_recv(&ctx, nsid, XNVME_SPEC_IO_MGMT_RECV_RUHS, 0, ruhs, nbytes);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvme_cli_perr("xnvme_nvm_mgmt_recv()", err);
+		xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+		return err ? err : -EIO;
+	}
+
+	return 0;
+}
+
+static int
+_log(struct xnvme_dev *dev, uint32_t nsid, uint8_t lid, uint8_t lsp, void *dbuf, uint32_t nbytes)
+{
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	int err;
+
+	err = xnvme_adm_log(&ctx, lid, lsp, 0, nsid, 0, dbuf, nbytes);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvme_cli_perr("xnvme_adm_log()", err);
+		xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+		return err ? err : -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * Write a different number of LBAs via each placement handle, and check that the reclaim unit
+ * of each handle shrinks by exactly that; then update the first handle, which must reset it,
+ * report the reclaim unit it left not fully written, and write via an invalid placement
+ * identifier, which must be reported as well
+ */
+static int
+cmd_placement(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	const uint32_t nsid = xnvme_dev_get_nsid(dev);
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	struct xnvme_spec_ruhs *before = NULL, *after = NULL;
+	struct xnvme_spec_log_fdp_stats *stats = NULL;
+	struct xnvme_spec_log_fdp_events *events = NULL;
+	const uint32_t nbytes = 4096;
+	uint64_t nwritten = 0;
+	uint16_t *pid = NULL;
+	void *dbuf = NULL;
+	int err;
+
+	before = xnvme_buf_alloc(dev, nbytes);
+	after = xnvme_buf_alloc(dev, nbytes);
+	stats = xnvme_buf_alloc(dev, nbytes);
+	events = xnvme_buf_alloc(dev, nbytes);
+	pid = xnvme_buf_alloc(dev, nbytes);
+	dbuf = xnvme_buf_alloc(dev, 64 * geo->lba_nbytes);
+	if (!before || !after || !stats || !events || !pid || !dbuf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvme_buf_fill(dbuf, 64 * geo->lba_nbytes, "anum");
+
+	err = _ruhs(dev, nsid, before, nbytes);
+	if (err) {
+		goto exit;
+	}
+	if (!before->nruhsd || (before->nruhsd > 8)) {
+		xnvme_cli_pinf("ERR: expected 1 to 8 handles, got: %u", before->nruhsd);
+		err = -EINVAL;
+		goto exit;
+	}
+
+	for (uint16_t i = 0; i < before->nruhsd; ++i) {
+		err = _write(dev, nsid, i * 1024, (i + 1) * 8 - 1, before->desc[i].pi, dbuf);
+		if (err) {
+			goto exit;
+		}
+		nwritten += (i + 1) * 8;
+	}
+
+	err = _ruhs(dev, nsid, after, nbytes);
+	if (err) {
+		goto exit;
+	}
+	for (uint16_t i = 0; i < before->nruhsd; ++i) {
+		if (after->desc[i].ruamw != before->desc[i].ruamw - (i + 1) * 8) {
+			xnvme_cli_pinf("ERR: pid: 0x%x, ruamw: %" PRIu64 ", expected: %" PRIu64,
+				       before->desc[i].pi, after->desc[i].ruamw,
+				       before->desc[i].ruamw - (i + 1) * 8);
+			err = -EIO;
+			goto exit;
+		}
+	}
+
+	pid[0] = before->desc[0].pi;
+	err = xnvme_nvm_mgmt_send(&ctx, nsid, XNVME_SPEC_IO_MGMT_SEND_RUHU, 0, pid, sizeof(*pid));
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvme_cli_perr("xnvme_nvm_mgmt_send()", err);
+		xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+		err = err ? err : -EIO;
+		goto exit;
+	}
+	err = _ruhs(dev, nsid, after, nbytes);
+	if (err) {
+		goto exit;
+	}
+	if (after->desc[0].ruamw != before->desc[0].ruamw) {
+		xnvme_cli_pinf("ERR: ruamw: %" PRIu64 ", expected a new reclaim unit of: %" PRIu64,
+			       after->desc[0].ruamw, before->desc[0].ruamw);
+		err = -EIO;
+		goto exit;
+	}
+
+	err = _write(dev, nsid, 0, 7, 0xFFFF, dbuf);
+	if (err) {
+		goto exit;
+	}
+	nwritten += 8;
+
+	err = _log(dev, nsid, XNVME_SPEC_LOG_FDPSTATS, 0, stats, sizeof(*stats));
+	if (err) {
+		goto exit;
+	}
+	xnvme_spec_log_fdp_stats_pr(stats, XNVME_PR_DEF);
+	if ((stats->hbmw[0] != nwritten * geo->lba_nbytes) || (stats->mbmw[0] != stats->hbmw[0])) {
+		xnvme_cli_pinf("ERR: expected hbmw and mbmw: %" PRIu64,
+			       nwritten * geo->lba_nbytes);
+		err = -EIO;
+		goto exit;
+	}
+
+	err = _log(dev, nsid, XNVME_SPEC_LOG_FDPEVENTS, 0, events, nbytes);
+	if (err) {
+		goto exit;
+	}
+	xnvme_spec_log_fdp_events_pr(events, events->nevents, XNVME_PR_DEF);
+	if ((events->nevents != 2) || (events->event[0].type != 0x0) ||
+	    (events->event[0].pid != pid[0]) || (events->event[1].type != 0x3) ||
+	    (events->event[1].pid != 0xFFFF)) {
+		xnvme_cli_pinf("ERR: expected RU not fully written, then invalid PID events");
+		err = -EIO;
+		goto exit;
+	}
+
+	xnvme_cli_pinf("LGTM");
+
+exit:
+	xnvme_buf_free(dev, before);
+	xnvme_buf_free(dev, after);
+	xnvme_buf_free(dev, stats);
+	xnvme_buf_free(dev, events);
+	xnvme_buf_free(dev, pid);
+	xnvme_buf_free(dev, dbuf);
+
+	return err;
+}
+
+/**
+ * Overwrite the namespace at random, via two placement handles, '--count' times over; garbage
+ * collection must then have relocated data, thus, the media writes exceed the host writes, units
+ * have been erased, and media reallocated events reported
+ */
+static int
+cmd_gc(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	const uint32_t nsid = xnvme_dev_get_nsid(dev);
+	const uint32_t count = cli->given[XNVME_CLI_OPT_COUNT] ? cli->args.count : 3;
+	const uint64_t nlb = 64;
+	struct xnvme_spec_ruhs *ruhs = NULL;
+	struct xnvme_spec_log_fdp_stats *stats = NULL;
+	struct xnvme_spec_log_fdp_events *events = NULL;
+	const uint32_t nbytes = 4096;
+	void *dbuf = NULL;
+	int err;
+
+	ruhs = xnvme_buf_alloc(dev, nbytes);
+	stats = xnvme_buf_alloc(dev, nbytes);
+	events = xnvme_buf_alloc(dev, nbytes);
+	dbuf = xnvme_buf_alloc(dev, nlb * geo->lba_nbytes);
+	if (!ruhs || !stats || !events || !dbuf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	xnvme_buf_fill(dbuf, nlb * geo->lba_nbytes, "anum");
+
+	err = _ruhs(dev, nsid, ruhs, nbytes);
+	if (err) {
+		goto exit;
+	}
+
+	srand(cli->given[XNVME_CLI_OPT_SEED] ? cli->args.seed : 42);
+	for (uint64_t i = 0; i < count * (geo->nsect / nlb); ++i) {
+		const uint64_t slba = (rand() % (geo->nsect / nlb)) * nlb;
+
+		err = _write(dev, nsid, slba, nlb - 1, ruhs->desc[i % 2 % ruhs->nruhsd].pi, dbuf);
+		if (err) {
+			goto exit;
+		}
+	}
+
+	err = _log(dev, nsid, XNVME_SPEC_LOG_FDPSTATS, 0, stats, sizeof(*stats));
+	if (err) {
+		goto exit;
+	}
+	xnvme_spec_log_fdp_stats_pr(stats, XNVME_PR_DEF);
+	xnvme_cli_pinf("waf: %.2f", (double)stats->mbmw[0] / stats->hbmw[0]);
+	if ((stats->mbmw[0] <= stats->hbmw[0]) || !stats->mbe[0]) {
+		xnvme_cli_pinf("ERR: expected media writes beyond host writes, and erases");
+		err = -EIO;
+		goto exit;
+	}
+
+	err = _log(dev, nsid, XNVME_SPEC_LOG_FDPEVENTS, 0x1, events, nbytes);
+	if (err) {
+		goto exit;
+	}
+	if (!events->nevents || (events->event[0].type != 0x80)) {
+		xnvme_cli_pinf("ERR: expected media reallocated events");
+		err = -EIO;
+		goto exit;
+	}
+
+	xnvme_cli_pinf("LGTM");
+
+exit:
+	xnvme_buf_free(dev, ruhs);
+	xnvme_buf_free(dev, stats);
+	xnvme_buf_free(dev, events);
+	xnvme_buf_free(dev, dbuf);
+
+	return err;
+}
+
+//
+// Command-Line Interface (CLI) definition
+//
+static struct xnvme_cli_sub g_subs[] = {
+	{
+		"placement",
+		"Check placement via each handle, reclaim unit handle update and events",
+		"Check placement via each handle, reclaim unit handle update and events",
+		cmd_placement,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+			XNVME_CLI_SYNC_OPTS,
+		},
+	},
+	{
+		"gc",
+		"Overwrite at random and check that garbage collection amplifies writes",
+		"Overwrite at random and check that garbage collection amplifies writes",
+		cmd_gc,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_COUNT, XNVME_CLI_LOPT},
+			{XNVME_CLI_OPT_SEED, XNVME_CLI_LOPT},
+			XNVME_CLI_SYNC_OPTS,
+		},
+	},
+};
+
+static struct xnvme_cli g_cli = {
+	.title = "Tests for Flexible Data Placement",
+	.descr_short = "Tests for Flexible Data Placement",
+	.subs = g_subs,
+	.nsubs = sizeof g_subs / sizeof(*g_subs),
+};
+
+int
+main(int argc, char **argv)
+{
+	return xnvme_cli_run(&g_cli, argc, argv, XNVME_CLI_INIT_DEV_OPEN);
+}
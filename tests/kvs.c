@@ -3,8 +3,104 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
 #include <libxnvme.h>
 
+#define KEY_NBYTES 16
+
+struct cb_args {
+	uint32_t vnbytes;
+	uint32_t ecount;
+	uint32_t completed;
+	uint32_t submitted;
+};
+
+/**
+ * Check that the command completed with the given status-code, zero being success
+ */
+static int
+_expect(struct xnvme_cmd_ctx *ctx, int err, uint8_t sc, const char *func)
+{
+	if (sc ? (ctx->cpl.status.sc == sc) : (!err && !xnvme_cmd_ctx_cpl_status(ctx))) {
+		return 0;
+	}
+
+	xnvme_cli_pinf("%s: expected sc: 0x%x, got err: %d", func, sc, err);
+	xnvme_cmd_ctx_pr(ctx, XNVME_PR_DEF);
+
+	return -EIO;
+}
+
+static int
+_store(struct xnvme_dev *dev, const char *key, void *dbuf, uint32_t nbytes, uint8_t opt,
+       uint8_t sc)
+{
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	int err;
+
+	err = xnvme_kvs_store(&ctx, xnvme_dev_get_nsid(dev), key, strlen(key), dbuf, nbytes, opt);
+
+	return _expect(&ctx, err, sc, "xnvme_kvs_store()");
+}
+
+static int
+_retrieve(struct xnvme_dev *dev, const char *key, void *dbuf, uint32_t nbytes, uint32_t *vnbytes,
+	  uint8_t sc)
+{
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	int err;
+
+	err = xnvme_kvs_retrieve(&ctx, xnvme_dev_get_nsid(dev), key, strlen(key), dbuf, nbytes, 0);
+	if (vnbytes) {
+		*vnbytes = ctx.cpl.cdw0;
+	}
+
+	return _expect(&ctx, err, sc, "xnvme_kvs_retrieve()");
+}
+
+static int
+_delete(struct xnvme_dev *dev, const char *key, uint8_t sc)
+{
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	int err;
+
+	err = xnvme_kvs_delete(&ctx, xnvme_dev_get_nsid(dev), key, strlen(key));
+
+	return _expect(&ctx, err, sc, "xnvme_kvs_delete()");
+}
+
+static int
+_exist(struct xnvme_dev *dev, const char *key, uint8_t sc)
+{
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	int err;
+
+	err = xnvme_kvs_exist(&ctx, xnvme_dev_get_nsid(dev), key, strlen(key));
+
+	return _expect(&ctx, err, sc, "xnvme_kvs_exist()");
+}
+
+static int
+_list(struct xnvme_dev *dev, const char *key, void *dbuf, uint32_t nbytes)
+{
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	int err;
+
+	err = xnvme_kvs_list(&ctx, xnvme_dev_get_nsid(dev), key, strlen(key), dbuf, nbytes);
+
+	return _expect(&ctx, err, 0, "xnvme_kvs_list()");
+}
+
+/**
+ * The key of the given index, of eight digits, that is, keys repeat every 10^8 indices
+ */
+static void
+_key(char *key, uint64_t idx)
+{
+	snprintf(key, KEY_NBYTES + 1, "key%08" PRIu64, idx % 100000000);
+}
+
 static int
 kvs_io(struct xnvme_cli *cli)
 {
@@ -110,6 +206,381 @@ exit:
 	return err;
 }
 
+/**
+ * Store, retrieve, delete and exist, along with the store options and their status-codes
+ */
+static int
+kvs_opts(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const char *key = "marco";
+	uint32_t vnbytes = 0;
+	char *dbuf = NULL;
+	int err;
+
+	dbuf = xnvme_buf_alloc(dev, 64);
+	if (!dbuf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		return err;
+	}
+
+	xnvme_cli_pinf("Update and exist of a key which does not exist");
+	strcpy(dbuf, "polo");
+	err = _store(dev, key, dbuf, 5, XNVME_KVS_STORE_OPT_DONT_STORE_IF_KEY_NOT_EXISTS,
+		     XNVME_SPEC_KV_SC_KEY_NOT_EXISTS);
+	err = err ? err : _exist(dev, key, XNVME_SPEC_KV_SC_KEY_NOT_EXISTS);
+	if (err) {
+		goto exit;
+	}
+
+	xnvme_cli_pinf("Store, then add, of the same key");
+	err = _store(dev, key, dbuf, 5, 0, 0);
+	err = err ? err : _store(dev, key, dbuf, 5, XNVME_KVS_STORE_OPT_DONT_STORE_IF_KEY_EXISTS,
+				 XNVME_SPEC_KV_SC_KEY_EXISTS);
+	err = err ? err : _exist(dev, key, 0);
+	if (err) {
+		goto exit;
+	}
+
+	xnvme_cli_pinf("Update with a longer value, and retrieve a part of it");
+	strcpy(dbuf, "polo polo polo");
+	err = _store(dev, key, dbuf, 15, XNVME_KVS_STORE_OPT_DONT_STORE_IF_KEY_NOT_EXISTS, 0);
+	if (err) {
+		goto exit;
+	}
+	memset(dbuf, 0, 64);
+	err = _retrieve(dev, key, dbuf, 4, &vnbytes, 0);
+	if (err) {
+		goto exit;
+	}
+	if ((vnbytes != 15) || strcmp(dbuf, "polo")) {
+		err = -EIO;
+		xnvme_cli_perr("retrieved value or its size does not match", err);
+		goto exit;
+	}
+
+	xnvme_cli_pinf("Delete, and then every command on the deleted key");
+	err = _delete(dev, key, 0);
+	err = err ? err : _exist(dev, key, XNVME_SPEC_KV_SC_KEY_NOT_EXISTS);
+	err = err ? err : _retrieve(dev, key, dbuf, 64, NULL, XNVME_SPEC_KV_SC_KEY_NOT_EXISTS);
+	err = err ? err : _delete(dev, key, XNVME_SPEC_KV_SC_KEY_NOT_EXISTS);
+	if (err) {
+		goto exit;
+	}
+
+	xnvme_cli_pinf("Store with a key exceeding the max key length");
+	err = _store(dev, "marco polo marco polo", dbuf, 5, 0, XNVME_SPEC_KV_SC_INVALID_KEY_SIZE);
+
+exit:
+	xnvme_buf_free(dev, dbuf);
+
+	return err;
+}
+
+/**
+ * Store keys, delete every tenth of them, and list those from a quarter on; the list must hold
+ * the keys remaining in order, as many as fit in the buffer
+ */
+static int
+kvs_list(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const uint64_t count = cli->given[XNVME_CLI_OPT_COUNT] ? cli->args.count : 1024;
+	const uint32_t nbytes = 4096;
+	char key[KEY_NBYTES + 1];
+	uint8_t *dbuf = NULL;
+	uint32_t nkeys;
+	uint64_t idx;
+	size_t ofz;
+	int err;
+
+	dbuf = xnvme_buf_alloc(dev, nbytes);
+	if (!dbuf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		return err;
+	}
+
+	xnvme_cli_pinf("Storing %" PRIu64 " keys, deleting every tenth", count);
+	for (uint64_t i = count; i-- > 0;) {
+		_key(key, i);
+		err = _store(dev, key, key, strlen(key), 0, 0);
+		if (err) {
+			goto exit;
+		}
+	}
+	for (uint64_t i = 0; i < count; i += 10) {
+		_key(key, i);
+		err = _delete(dev, key, 0);
+		if (err) {
+			goto exit;
+		}
+	}
+	for (uint64_t i = 0; i < count; ++i) {
+		_key(key, i);
+		err = _exist(dev, key, (i % 10) ? 0 : XNVME_SPEC_KV_SC_KEY_NOT_EXISTS);
+		if (err) {
+			goto exit;
+		}
+	}
+
+	idx = count / 4;
+	_key(key, idx);
+	err = _list(dev, key, dbuf, nbytes);
+	if (err) {
+		goto exit;
+	}
+
+	memcpy(&nkeys, dbuf, sizeof(nkeys));
+	xnvme_cli_pinf("Listed %u keys from '%s'", nkeys, key);
+	ofz = sizeof(nkeys);
+	for (uint32_t i = 0; i < nkeys; ++i, ++idx) {
+		uint16_t kl;
+
+		idx += (idx % 10) ? 0 : 1;
+		_key(key, idx);
+
+		memcpy(&kl, dbuf + ofz, sizeof(kl));
+		if ((kl != strlen(key)) || memcmp(dbuf + ofz + sizeof(kl), key, kl)) {
+			err = -EIO;
+			xnvme_cli_pinf("key: %u, expected: '%s'", i, key);
+			goto exit;
+		}
+		ofz += (sizeof(kl) + kl + 3) & ~3;
+	}
+	// The list ends when the keys are exhausted, or when the next one does not fit
+	if ((idx < count) && (ofz + ((sizeof(uint16_t) + strlen(key) + 3) & ~3) <= nbytes)) {
+		err = -EIO;
+		xnvme_cli_perr("the list is short", err);
+		goto exit;
+	}
+
+	xnvme_cli_pinf("Listing from beyond the last key");
+	err = _list(dev, "kez", dbuf, nbytes);
+	if (err) {
+		goto exit;
+	}
+	memcpy(&nkeys, dbuf, sizeof(nkeys));
+	if (nkeys) {
+		err = -EIO;
+		xnvme_cli_perr("listed keys beyond the last key", err);
+		goto exit;
+	}
+
+exit:
+	xnvme_buf_free(dev, dbuf);
+
+	return err;
+}
+
+/**
+ * Store keys up to the max number of keys, and a value beyond the capacity of the namespace
+ */
+static int
+kvs_capacity(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	struct xnvme_spec_kvs_idfy *idfy = NULL;
+	char key[KEY_NBYTES + 1];
+	uint8_t *dbuf = NULL;
+	uint64_t nbytes;
+	uint32_t mnk;
+	int err;
+
+	idfy = xnvme_buf_alloc(dev, sizeof(*idfy));
+	if (!idfy) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		return err;
+	}
+	err = xnvme_buf_clear(idfy, sizeof(*idfy));
+	if (err) {
+		xnvme_cli_perr("xnvme_buf_clear()", err);
+		goto exit;
+	}
+	err = xnvme_adm_idfy_ns_csi(&ctx, xnvme_dev_get_nsid(dev), XNVME_SPEC_CSI_KV, &idfy->base);
+	err = _expect(&ctx, err, 0, "xnvme_adm_idfy_ns_csi()");
+	if (err) {
+		goto exit;
+	}
+	xnvme_spec_kvs_idfy_ns_pr(&idfy->ns, XNVME_PR_DEF);
+
+	mnk = idfy->ns.kvf[0].mnk;
+	xnvme_cli_pinf("Storing mnk: %u keys, and one more", mnk);
+	for (uint64_t i = 0; i <= mnk; ++i) {
+		_key(key, i);
+		err = _store(dev, key, key, strlen(key), 0,
+			     (i < mnk) ? 0 : XNVME_SPEC_KV_SC_CAPACITY_EXCEEDED);
+		if (err) {
+			goto exit;
+		}
+	}
+
+	xnvme_cli_pinf("Deleting a key, and storing a value exceeding the capacity left");
+	_key(key, 0);
+	err = _delete(dev, key, 0);
+	if (err) {
+		goto exit;
+	}
+	nbytes = idfy->ns.nsze - (mnk - 1) * 2 * strlen(key) - strlen(key) + 1;
+	if (nbytes > idfy->ns.kvf[0].vml) {
+		xnvme_cli_pinf("SKIPPED: the capacity exceeds the max value length");
+		goto exit;
+	}
+	dbuf = xnvme_buf_alloc(dev, nbytes);
+	if (!dbuf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	err = _store(dev, key, dbuf, nbytes, 0, XNVME_SPEC_KV_SC_CAPACITY_EXCEEDED);
+	err = err ? err : _store(dev, key, dbuf, nbytes - 1, 0, 0);
+
+exit:
+	xnvme_buf_free(dev, dbuf);
+	xnvme_buf_free(dev, idfy);
+
+	return err;
+}
+
+static void
+cb_batch(struct xnvme_cmd_ctx *ctx, void *cb_arg)
+{
+	struct cb_args *cb_args = cb_arg;
+
+	cb_args->completed += 1;
+
+	if (xnvme_cmd_ctx_cpl_status(ctx)) {
+		xnvme_cmd_ctx_pr(ctx, XNVME_PR_DEF);
+		cb_args->ecount += 1;
+	} else if ((ctx->cmd.common.opcode == XNVME_SPEC_KV_OPC_RETRIEVE) &&
+		   (ctx->cpl.cdw0 != cb_args->vnbytes)) {
+		xnvme_cli_pinf("ERR: cpl.cdw0: %u != %u", ctx->cpl.cdw0, cb_args->vnbytes);
+		cb_args->ecount += 1;
+	}
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
+}
+
+/**
+ * Store a batch of values via a queue, retrieve them via the queue, and compare them
+ */
+static int
+kvs_batch(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const uint64_t count = cli->given[XNVME_CLI_OPT_COUNT] ? cli->args.count : 4096;
+	const uint32_t qd = cli->given[XNVME_CLI_OPT_QDEPTH] ? cli->args.qdepth : 64;
+	const uint32_t nsid = xnvme_dev_get_nsid(dev);
+	const uint32_t vnbytes = 512;
+	const size_t buf_nbytes = count * vnbytes;
+	struct cb_args cb_args = {.vnbytes = vnbytes};
+	struct xnvme_queue *queue = NULL;
+	char key[KEY_NBYTES + 1];
+	uint8_t *dbuf = NULL, *vbuf = NULL;
+	size_t diff = 0;
+	int err;
+
+	dbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	vbuf = xnvme_buf_alloc(dev, buf_nbytes);
+	if (!dbuf || !vbuf) {
+		err = -errno;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+	err = xnvme_buf_fill(dbuf, buf_nbytes, "anum");
+	err = err ? err : xnvme_buf_clear(vbuf, buf_nbytes);
+	if (err) {
+		xnvme_cli_perr("xnvme_buf_fill()", err);
+		goto exit;
+	}
+
+	err = xnvme_queue_init(dev, qd, 0, &queue);
+	if (err) {
+		xnvme_cli_perr("xnvme_queue_init()", err);
+		goto exit;
+	}
+	xnvme_queue_set_cb(queue, cb_batch, &cb_args);
+
+	xnvme_cli_pinf("Storing, then retrieving, %" PRIu64 " values, qd: %u", count, qd);
+	xnvme_cli_timer_start(cli);
+
+	for (uint64_t i = 0; (i < 2 * count) && !cb_args.ecount; ++i) {
+		uint8_t *payload = ((i < count) ? dbuf : vbuf) + (i % count) * vnbytes;
+		struct xnvme_cmd_ctx *ctx;
+
+		while (!(ctx = xnvme_queue_get_cmd_ctx(queue))) {
+			xnvme_queue_poke(queue, 0);
+		}
+		_key(key, i % count);
+
+submit:
+		if (i < count) {
+			err = xnvme_kvs_store(ctx, nsid, key, strlen(key), payload, vnbytes, 0);
+		} else {
+			err = xnvme_kvs_retrieve(ctx, nsid, key, strlen(key), payload, vnbytes, 0);
+		}
+		switch (err) {
+		case 0:
+			cb_args.submitted += 1;
+			break;
+
+		case -EBUSY:
+		case -EAGAIN:
+			xnvme_queue_poke(queue, 0);
+			goto submit;
+
+		default:
+			xnvme_cli_perr("submission-error", err);
+			xnvme_queue_put_cmd_ctx(queue, ctx);
+			goto exit;
+		}
+
+		// Every value is stored before any is retrieved
+		if ((i + 1 == count) && (xnvme_queue_drain(queue) < 0)) {
+			err = -EIO;
+			xnvme_cli_perr("xnvme_queue_drain()", err);
+			goto exit;
+		}
+	}
+
+	err = xnvme_queue_drain(queue);
+	if (err < 0) {
+		xnvme_cli_perr("xnvme_queue_drain()", err);
+		goto exit;
+	}
+
+	xnvme_cli_timer_stop(cli);
+	xnvme_cli_timer_bw_pr(cli, "Wall-clock", 2 * buf_nbytes);
+
+	if (cb_args.ecount) {
+		err = -EIO;
+		xnvme_cli_perr("got completion errors", err);
+		goto exit;
+	}
+
+	err = xnvme_buf_diff(dbuf, vbuf, buf_nbytes, &diff);
+	if (err || diff) {
+		err = err ? err : -EIO;
+		xnvme_cli_perr("verification failed", err);
+		goto exit;
+	}
+
+exit:
+	xnvme_cli_pinf("cb_args: {submitted: %u, completed: %u, ecount: %u}", cb_args.submitted,
+		       cb_args.completed, cb_args.ecount);
+
+	if (queue) {
+		xnvme_queue_term(queue);
+	}
+	xnvme_buf_free(dev, dbuf);
+	xnvme_buf_free(dev, vbuf);
+
+	return err < 0 ? err : 0;
+}
+
 //
 // Command-Line Interface (CLI) definition
 //
@@ -125,6 +596,47 @@ static struct xnvme_cli_sub g_subs[] = {
 		 {XNVME_CLI_OPT_KV_VAL, XNVME_CLI_LOPT},
 		 XNVME_CLI_SYNC_OPTS,
 	 }},
+	{"opts",
+	 "Verify the store options, and the status of commands on keys which do (not) exist",
+	 "Verify the store options, and the status of commands on keys which do (not) exist",
+	 kvs_opts,
+	 {
+		 {XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+		 {XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+		 XNVME_CLI_SYNC_OPTS,
+	 }},
+	{"list",
+	 "Verify that list returns the keys from the given key and on, in order",
+	 "Verify that list returns the keys from the given key and on, in order",
+	 kvs_list,
+	 {
+		 {XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+		 {XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+		 {XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+		 {XNVME_CLI_OPT_COUNT, XNVME_CLI_LOPT},
+		 XNVME_CLI_SYNC_OPTS,
+	 }},
+	{"capacity",
+	 "Verify that stores beyond the max number of keys, or the capacity, are rejected",
+	 "Verify that stores beyond the max number of keys, or the capacity, are rejected",
+	 kvs_capacity,
+	 {
+		 {XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+		 {XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+		 XNVME_CLI_SYNC_OPTS,
+	 }},
+	{"batch",
+	 "Store and retrieve a batch of values via a queue, and compare them",
+	 "Store and retrieve a batch of values via a queue, and compare them",
+	 kvs_batch,
+	 {
+		 {XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+		 {XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+		 {XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+		 {XNVME_CLI_OPT_COUNT, XNVME_CLI_LOPT},
+		 {XNVME_CLI_OPT_QDEPTH, XNVME_CLI_LOPT},
+		 XNVME_CLI_ASYNC_OPTS,
+	 }},
 };
 
 static struct xnvme_cli g_cli = {
@@ -4,6 +4,7 @@
 
 #include <errno.h>
 #include <libxnvme.h>
+#include <libxnvme_pi.h>
 
 /**
  * Constructs an LBA range if --slba and --elba are not provided by CLI
@@ -119,10 +120,11 @@ exit:
 }
 
 static int
-fill_lba_range_and_write_buffer_with_pattern(uint8_t *wbuf, size_t buf_nbytes, uint64_t rng_slba,
-					     uint64_t rng_elba, uint64_t mdts_naddr,
-					     struct xnvme_dev *dev, const struct xnvme_geo *geo,
-					     uint32_t nsid, char *pattern, uint64_t *written_bytes)
+fill_lba_range_and_write_buffer_with_pattern(uint8_t *wbuf, void *mbuf, size_t buf_nbytes,
+					     uint64_t rng_slba, uint64_t rng_elba,
+					     uint64_t mdts_naddr, struct xnvme_dev *dev,
+					     const struct xnvme_geo *geo, uint32_t nsid,
+					     char *pattern, uint64_t *written_bytes)
 {
 	int err;
 
@@ -138,7 +140,7 @@ fill_lba_range_and_write_buffer_with_pattern(uint8_t *wbuf, size_t buf_nbytes, u
 		uint64_t nlb = XNVME_MIN(rng_elba - slba, mdts_naddr - 1);
 		*written_bytes += (1 + nlb) * geo->lba_nbytes;
 
-		err = xnvme_nvm_write(&ctx, nsid, slba, nlb, wbuf, NULL);
+		err = xnvme_nvm_write(&ctx, nsid, slba, nlb, wbuf, mbuf);
 		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
 			xnvme_cli_pinf("xnvme_nvm_write(): {err: 0x%x, slba: 0x%016lx}", err,
 				       slba);
@@ -161,6 +163,8 @@ exit:
  * 3) Scatter the content of wbuf within [slba,elba]
  * 4) Read, with exponential stride, within [slba,elba] using rbuf
  * 5) Verify that the content of rbuf is the same as wbuf
+ *
+ * With metadata in a separate buffer, it is written and verified alongside the data
  */
 static int
 sub_io(struct xnvme_cli *cli)
@@ -169,8 +173,8 @@ sub_io(struct xnvme_cli *cli)
 	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
 	uint32_t nsid;
 	uint64_t rng_slba, rng_elba, mdts_naddr;
-	size_t buf_nbytes;
-	uint8_t *wbuf = NULL, *rbuf = NULL;
+	size_t buf_nbytes, mbuf_nbytes = 0;
+	uint8_t *wbuf = NULL, *rbuf = NULL, *wmbuf = NULL, *rmbuf = NULL;
 	int err;
 	uint64_t written_bytes = 0;
 	size_t diff = 0;
@@ -189,11 +193,26 @@ sub_io(struct xnvme_cli *cli)
 		xnvme_cli_perr("boilerplate()", err);
 		goto exit;
 	}
+	if (geo->nbytes_oob && !geo->lba_extended) {
+		mbuf_nbytes = mdts_naddr * geo->nbytes_oob;
+		wmbuf = xnvme_buf_alloc(dev, mbuf_nbytes);
+		rmbuf = xnvme_buf_alloc(dev, mbuf_nbytes);
+		if (!wmbuf || !rmbuf) {
+			err = -ENOMEM;
+			xnvme_cli_perr("xnvme_buf_alloc()", err);
+			goto exit;
+		}
+		err = xnvme_buf_fill(wmbuf, mbuf_nbytes, "!");
+		if (err) {
+			xnvme_cli_perr("xnvme_buf_fill()", err);
+			goto exit;
+		}
+	}
 
 	xnvme_cli_pinf("Writing '!' to LBA range [slba,elba]");
-	err = fill_lba_range_and_write_buffer_with_pattern(wbuf, buf_nbytes, rng_slba, rng_elba,
-							   mdts_naddr, dev, geo, nsid, "!",
-							   &written_bytes);
+	err = fill_lba_range_and_write_buffer_with_pattern(wbuf, wmbuf, buf_nbytes, rng_slba,
+							   rng_elba, mdts_naddr, dev, geo, nsid,
+							   "!", &written_bytes);
 	if (err) {
 		xnvme_cli_perr("fill_lba_range_and_write_buffer_with_pattern()", err);
 		goto exit;
@@ -201,6 +220,9 @@ sub_io(struct xnvme_cli *cli)
 
 	xnvme_cli_pinf("Writing payload scattered within LBA range [slba,elba]");
 	err = xnvme_buf_fill(wbuf, buf_nbytes, "anum");
+	if (!err && mbuf_nbytes) {
+		err = xnvme_buf_fill(wmbuf, mbuf_nbytes, "anum");
+	}
 	if (err) {
 		xnvme_cli_perr("xnvme_buf_fill()", err);
 		goto exit;
@@ -209,9 +231,10 @@ sub_io(struct xnvme_cli *cli)
 	for (uint64_t count = 0; count < mdts_naddr; ++count) {
 		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
 		size_t wbuf_ofz = count * geo->lba_nbytes;
+		uint8_t *mbuf = wmbuf ? wmbuf + count * geo->nbytes_oob : NULL;
 		uint64_t slba = rng_slba + count * 4;
 
-		err = xnvme_nvm_write(&ctx, nsid, slba, 0, wbuf + wbuf_ofz, NULL);
+		err = xnvme_nvm_write(&ctx, nsid, slba, 0, wbuf + wbuf_ofz, mbuf);
 		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
 			xnvme_cli_pinf("xnvme_nvm_write(): "
 				       "{err: 0x%x, slba: 0x%016lx}",
@@ -224,6 +247,9 @@ sub_io(struct xnvme_cli *cli)
 	xnvme_cli_pinf("Read scattered payload within LBA range [slba,elba]");
 
 	err = xnvme_buf_clear(rbuf, buf_nbytes);
+	if (!err && mbuf_nbytes) {
+		err = xnvme_buf_clear(rmbuf, mbuf_nbytes);
+	}
 	if (err) {
 		xnvme_cli_perr("xnvme_buf_clear()", err);
 		goto exit;
@@ -232,9 +258,10 @@ sub_io(struct xnvme_cli *cli)
 	for (uint64_t count = 0; count < mdts_naddr; ++count) {
 		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
 		size_t rbuf_ofz = count * geo->lba_nbytes;
+		uint8_t *mbuf = rmbuf ? rmbuf + count * geo->nbytes_oob : NULL;
 		uint64_t slba = rng_slba + count * 4;
 
-		err = xnvme_nvm_read(&ctx, nsid, slba, 0, rbuf + rbuf_ofz, NULL);
+		err = xnvme_nvm_read(&ctx, nsid, slba, 0, rbuf + rbuf_ofz, mbuf);
 		if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
 			xnvme_cli_pinf("xnvme_nvm_read(): "
 				       "{err: 0x%x, slba: 0x%016lx}",
@@ -260,9 +287,29 @@ sub_io(struct xnvme_cli *cli)
 		goto exit;
 	}
 
+	if (mbuf_nbytes) {
+		xnvme_cli_pinf("Comparing wmbuf and rmbuf");
+		err = xnvme_buf_diff(wmbuf, rmbuf, mbuf_nbytes, &diff);
+		if (err) {
+			xnvme_cli_perr("xnvme_buf_diff()", err);
+			goto exit;
+		}
+		if (diff) {
+			err = xnvme_buf_diff_pr(wmbuf, rmbuf, mbuf_nbytes, XNVME_PR_DEF);
+			if (err) {
+				xnvme_cli_perr("xnvme_buf_diff_pr()", err);
+				goto exit;
+			}
+			err = -EIO;
+			goto exit;
+		}
+	}
+
 exit:
 	xnvme_buf_free(dev, wbuf);
 	xnvme_buf_free(dev, rbuf);
+	xnvme_buf_free(dev, wmbuf);
+	xnvme_buf_free(dev, rmbuf);
 
 	return err;
 }
@@ -305,9 +352,9 @@ test_write_zeroes(struct xnvme_cli *cli)
 		goto exit;
 	}
 
-	err = fill_lba_range_and_write_buffer_with_pattern(wbuf, buf_nbytes, rng_slba, rng_elba,
-							   mdts_naddr, dev, geo, nsid, "!",
-							   &written_bytes);
+	err = fill_lba_range_and_write_buffer_with_pattern(wbuf, NULL, buf_nbytes, rng_slba,
+							   rng_elba, mdts_naddr, dev, geo, nsid,
+							   "!", &written_bytes);
 	if (err) {
 		xnvme_cli_perr("fill_lba_range_and_write_buffer_with_pattern()", err);
 		goto exit;
@@ -407,9 +454,9 @@ test_write_uncorrectable(struct xnvme_cli *cli)
 	}
 
 	/* Fill lbas with '!' */
-	err = fill_lba_range_and_write_buffer_with_pattern(wbuf, buf_nbytes, rng_slba, rng_elba,
-							   mdts_naddr, dev, geo, nsid, "!",
-							   &written_bytes);
+	err = fill_lba_range_and_write_buffer_with_pattern(wbuf, NULL, buf_nbytes, rng_slba,
+							   rng_elba, mdts_naddr, dev, geo, nsid,
+							   "!", &written_bytes);
 	if (err) {
 		xnvme_cli_perr("fill_lba_range_and_write_buffer_with_pattern()", err);
 		goto exit;
@@ -465,8 +512,8 @@ exit:
 	if (entered_uncorrectable_loop) {
 		xnvme_cli_pinf("Writing zeros to lba range to reset unocrrectable bit");
 		int recover_err = fill_lba_range_and_write_buffer_with_pattern(
-			wbuf, buf_nbytes, rng_slba, rng_elba, mdts_naddr, dev, geo, nsid, "zero",
-			&written_bytes);
+			wbuf, NULL, buf_nbytes, rng_slba, rng_elba, mdts_naddr, dev, geo, nsid,
+			"zero", &written_bytes);
 		if (recover_err) {
 			xnvme_cli_perr("fill_lba_range_and_write_buffer_with_pattern()",
 				       recover_err);
@@ -479,6 +526,135 @@ exit:
 	return err;
 }
 
+static void
+prep_pi(struct xnvme_cmd_ctx *ctx, uint8_t opcode, uint32_t nsid, uint64_t slba, uint16_t nlb,
+	uint32_t prchk, uint16_t apptag)
+{
+	xnvme_prep_nvm(ctx, opcode, nsid, slba, nlb);
+	ctx->cmd.nvm.prinfo = prchk;
+	ctx->cmd.nvm.ilbrt = (uint32_t)slba;
+	ctx->cmd.common.cdw03 = (slba >> 32) & 0xffff;
+	ctx->cmd.nvm.lbat = apptag;
+	ctx->cmd.nvm.lbatm = 0xffff;
+}
+
+/**
+ * 0) Fill dbuf and mbuf with a pattern and generate protection information for it
+ * 1) Write [slba, slba + nlb] with the device checking the protection information
+ * 2) Read it back with the device checking the protection information, verify it on the host
+ *    and compare the data to what was written
+ * 3) Write with an application tag which does not match and verify that it is rejected
+ */
+static int
+test_pi(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	const uint32_t nsid = xnvme_dev_get_nsid(dev);
+	const uint64_t slba = cli->args.slba;
+	const uint16_t nlb = 7, apptag = 0x1234;
+	struct xnvme_pi_ctx pi_ctx = {0};
+	uint8_t *dbuf = NULL, *mbuf = NULL, *rbuf = NULL, *rmbuf = NULL;
+	size_t dbuf_nbytes = (nlb + 1) * geo->lba_nbytes;
+	size_t mbuf_nbytes = geo->lba_extended ? 0 : (nlb + 1) * geo->nbytes_oob;
+	uint32_t prchk = XNVME_PI_FLAGS_GUARD_CHECK | XNVME_PI_FLAGS_APPTAG_CHECK;
+	size_t diff = 0;
+	int err;
+
+	if (geo->type != XNVME_GEO_CONVENTIONAL || geo->pi_type == XNVME_PI_DISABLE) {
+		XNVME_DEBUG("FAILED: not nvm with protection information");
+		return -EINVAL;
+	}
+	if (geo->pi_type != XNVME_PI_TYPE3) {
+		prchk |= XNVME_PI_FLAGS_REFTAG_CHECK;
+	}
+
+	dbuf = xnvme_buf_alloc(dev, dbuf_nbytes);
+	rbuf = xnvme_buf_alloc(dev, dbuf_nbytes);
+	if (mbuf_nbytes) {
+		mbuf = xnvme_buf_alloc(dev, mbuf_nbytes);
+		rmbuf = xnvme_buf_alloc(dev, mbuf_nbytes);
+	}
+	if (!dbuf || !rbuf || (mbuf_nbytes && !(mbuf && rmbuf))) {
+		err = -ENOMEM;
+		xnvme_cli_perr("xnvme_buf_alloc()", err);
+		goto exit;
+	}
+
+	err = xnvme_buf_fill(dbuf, dbuf_nbytes, "anum");
+	if (!err && mbuf_nbytes) {
+		err = xnvme_buf_fill(mbuf, mbuf_nbytes, "anum");
+	}
+	if (err) {
+		xnvme_cli_perr("xnvme_buf_fill()", err);
+		goto exit;
+	}
+
+	err = xnvme_pi_ctx_init(&pi_ctx, geo->lba_nbytes, geo->nbytes_oob, geo->lba_extended,
+				geo->pi_loc, geo->pi_type, prchk, (uint32_t)slba, 0xffff, apptag,
+				geo->pi_format);
+	if (err) {
+		xnvme_cli_perr("xnvme_pi_ctx_init()", err);
+		goto exit;
+	}
+	xnvme_pi_generate(&pi_ctx, dbuf, mbuf, nlb + 1);
+
+	xnvme_cli_pinf("Writing with prchk: 0x%x", prchk);
+	prep_pi(&ctx, XNVME_SPEC_NVM_OPC_WRITE, nsid, slba, nlb, prchk, apptag);
+	err = xnvme_cmd_pass(&ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvme_cli_perr("xnvme_cmd_pass()", err);
+		xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+		err = err ? err : -EIO;
+		goto exit;
+	}
+
+	xnvme_cli_pinf("Reading with prchk: 0x%x", prchk);
+	prep_pi(&ctx, XNVME_SPEC_NVM_OPC_READ, nsid, slba, nlb, prchk, apptag);
+	err = xnvme_cmd_pass(&ctx, rbuf, dbuf_nbytes, rmbuf, mbuf_nbytes);
+	if (err || xnvme_cmd_ctx_cpl_status(&ctx)) {
+		xnvme_cli_perr("xnvme_cmd_pass()", err);
+		xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+		err = err ? err : -EIO;
+		goto exit;
+	}
+
+	err = xnvme_pi_verify(&pi_ctx, rbuf, rmbuf, nlb + 1);
+	if (err) {
+		xnvme_cli_perr("xnvme_pi_verify()", err);
+		goto exit;
+	}
+	err = xnvme_buf_diff(dbuf, rbuf, dbuf_nbytes, &diff);
+	if (!err && !diff && mbuf_nbytes) {
+		err = xnvme_buf_diff(mbuf, rmbuf, mbuf_nbytes, &diff);
+	}
+	if (err || diff) {
+		err = err ? err : -EIO;
+		xnvme_cli_perr("xnvme_buf_diff()", err);
+		goto exit;
+	}
+
+	xnvme_cli_pinf("Writing with a mismatching application tag");
+	prep_pi(&ctx, XNVME_SPEC_NVM_OPC_WRITE, nsid, slba, nlb, prchk, (uint16_t)~apptag);
+	xnvme_cmd_pass(&ctx, dbuf, dbuf_nbytes, mbuf, mbuf_nbytes);
+	if (!xnvme_cmd_ctx_cpl_status(&ctx)) {
+		err = -EIO;
+		xnvme_cli_perr("expected the write to fail", err);
+		goto exit;
+	}
+	xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
+	err = 0;
+
+exit:
+	xnvme_buf_free(dev, dbuf);
+	xnvme_buf_free(dev, mbuf);
+	xnvme_buf_free(dev, rbuf);
+	xnvme_buf_free(dev, rmbuf);
+
+	return err;
+}
+
 //
 // Command-Line Interface (CLI) definition
 //
@@ -528,6 +704,21 @@ static struct xnvme_cli_sub g_subs[] = {
 			{XNVME_CLI_OPT_SLBA, XNVME_CLI_LOPT},
 			{XNVME_CLI_OPT_ELBA, XNVME_CLI_LOPT},
 
+			XNVME_CLI_SYNC_OPTS,
+		},
+	},
+	{
+		"pi",
+		"Write and read with end-to-end protection information",
+		"Write and read with end-to-end protection information",
+		test_pi,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_SLBA, XNVME_CLI_LOPT},
+
 			XNVME_CLI_SYNC_OPTS,
 		},
 	}};
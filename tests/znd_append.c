@@ -30,6 +30,8 @@ cb_lbacheck(struct xnvme_cmd_ctx *ctx, void *cb_arg)
 		xnvme_cli_pinf("ERR: cpl.result: 0x%016lx != 0x%016lx", ctx->cpl.result, expected);
 		cb_args->ecount_offset += 1;
 	}
+
+	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
 }
 
 static int
@@ -110,18 +112,16 @@ cmd_verify(struct xnvme_cli *cli)
 		goto exit;
 	}
 
+	xnvme_queue_set_cb(queue, cb_lbacheck, &cb_args);
+
 	xnvme_cli_timer_start(cli);
 
 	cb_args.zslba = zone.zslba;
 
 	for (uint64_t sect = 0; (sect < zone.zcap) && !cb_args.ecount; ++sect) {
-		struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
-
-		ctx.async.queue = queue;
-		ctx.async.cb = cb_lbacheck;
-		ctx.async.cb_arg = &cb_args;
+		struct xnvme_cmd_ctx *ctx = xnvme_queue_get_cmd_ctx(queue);
 
-		err = xnvme_znd_append(&ctx, nsid, zone.zslba, 0, dbuf + sect * geo->lba_nbytes,
+		err = xnvme_znd_append(ctx, nsid, zone.zslba, 0, dbuf + sect * geo->lba_nbytes,
 				       NULL);
 		switch (err) {
 		case 0:
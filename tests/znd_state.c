@@ -53,7 +53,7 @@ cmd_transition(struct xnvme_cli *cli)
 
 		if (zone.zs != actions[i].state) {
 			xnvme_cli_perr("zone.zs: %u != expected: %u", actions[i].state);
-			err = EIO;
+			err = -EIO;
 			goto exit;
 		}
 	}
@@ -95,6 +95,102 @@ exit:
 	return err;
 }
 
+static int
+_mgmt_send(struct xnvme_dev *dev, uint32_t nsid, uint64_t zslba, bool select_all,
+	   enum xnvme_spec_znd_cmd_mgmt_send_action action, struct xnvme_spec_status *status)
+{
+	struct xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(dev);
+	int err;
+
+	err = xnvme_znd_mgmt_send(&ctx, nsid, zslba, select_all, action, 0x0, NULL);
+	*status = ctx.cpl.status;
+
+	return (err || xnvme_cmd_ctx_cpl_status(&ctx)) ? -EIO : 0;
+}
+
+/**
+ * Explicitly open zones until the Maximum Open Resources are taken, check that opening one more
+ * zone is rejected, and that closing one of them makes room for it
+ */
+static int
+cmd_resources(struct xnvme_cli *cli)
+{
+	struct xnvme_dev *dev = cli->args.dev;
+	const struct xnvme_geo *geo = xnvme_dev_get_geo(dev);
+	const struct xnvme_spec_znd_idfy_ns *zns = (void *)xnvme_dev_get_ns_css(dev);
+	struct xnvme_spec_status status;
+	uint64_t nopen;
+	uint32_t nsid;
+	int err;
+
+	nsid = cli->given[XNVME_CLI_OPT_NSID] ? cli->args.nsid : xnvme_dev_get_nsid(cli->args.dev);
+
+	if (geo->type != XNVME_GEO_ZONED) {
+		xnvme_cli_perr("!XNVME_GEO_ZONED", EINVAL);
+		return -EINVAL;
+	}
+	if ((zns->mor == UINT32_MAX) || ((uint64_t)zns->mor + 1 >= geo->nzone)) {
+		XNVME_DEBUG("INFO: skipping; mor: %" PRIu32 ", nzone: %" PRIu32, zns->mor,
+			    geo->nzone);
+		xnvme_cli_pinf("LGTM");
+		return 0;
+	}
+	nopen = (uint64_t)zns->mor + 1;
+
+	err = _mgmt_send(dev, nsid, 0x0, true, XNVME_SPEC_ZND_CMD_MGMT_SEND_RESET, &status);
+	if (err) {
+		xnvme_cli_perr("_mgmt_send(RESET, select_all)", err);
+		return err;
+	}
+
+	for (uint64_t zidx = 0; zidx < nopen; ++zidx) {
+		err = _mgmt_send(dev, nsid, zidx * geo->nsect, false,
+				 XNVME_SPEC_ZND_CMD_MGMT_SEND_OPEN, &status);
+		if (err) {
+			xnvme_cli_perr("_mgmt_send(OPEN)", err);
+			goto exit;
+		}
+	}
+
+	err = _mgmt_send(dev, nsid, nopen * geo->nsect, false, XNVME_SPEC_ZND_CMD_MGMT_SEND_OPEN,
+			 &status);
+	if (!err || (status.sct != XNVME_STATUS_CODE_TYPE_CMDSPEC) ||
+	    (status.sc != XNVME_SPEC_ZND_SC_TOO_MANY_OPEN)) {
+		xnvme_cli_pinf("ERR: expected TOO_MANY_OPEN, got sct: 0x%x, sc: 0x%x", status.sct,
+			       status.sc);
+		err = -EIO;
+		goto exit;
+	}
+
+	err = _mgmt_send(dev, nsid, 0x0, false, XNVME_SPEC_ZND_CMD_MGMT_SEND_CLOSE, &status);
+	if (err) {
+		xnvme_cli_perr("_mgmt_send(CLOSE)", err);
+		goto exit;
+	}
+	err = _mgmt_send(dev, nsid, nopen * geo->nsect, false, XNVME_SPEC_ZND_CMD_MGMT_SEND_OPEN,
+			 &status);
+	if (err) {
+		xnvme_cli_perr("_mgmt_send(OPEN)", err);
+		goto exit;
+	}
+
+	xnvme_cli_pinf("LGTM");
+
+exit:
+	{
+		int err_exit;
+
+		err_exit = _mgmt_send(dev, nsid, 0x0, true, XNVME_SPEC_ZND_CMD_MGMT_SEND_RESET,
+				      &status);
+		if (err_exit) {
+			xnvme_cli_perr("_mgmt_send(RESET, select_all)", err_exit);
+			err = err ? err : err_exit;
+		}
+	}
+
+	return err;
+}
+
 //
 // Command-Line Interface (CLI) definition
 //
@@ -116,6 +212,22 @@ static struct xnvme_cli_sub g_subs[] = {
 		},
 	},
 
+	{
+		"resources",
+		"Check that the Maximum Open Resources are enforced",
+		"Check that the Maximum Open Resources are enforced",
+		cmd_resources,
+		{
+			{XNVME_CLI_OPT_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_URI, XNVME_CLI_POSA},
+
+			{XNVME_CLI_OPT_NON_POSA_TITLE, XNVME_CLI_SKIP},
+			{XNVME_CLI_OPT_NSID, XNVME_CLI_LOPT},
+
+			XNVME_CLI_SYNC_OPTS,
+		},
+	},
+
 	{
 		"changes",
 		"Retrieve the Changed Zone List log page",
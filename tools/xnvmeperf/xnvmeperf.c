@@ -1331,6 +1331,9 @@ static struct xnvme_cli_sub g_subs[] = {
 			{XNVME_CLI_OPT_DIRECT, XNVME_CLI_LFLG},
 			{XNVME_CLI_OPT_POLL_IO, XNVME_CLI_LOPT},
 			{XNVME_CLI_OPT_POLL_SQ, XNVME_CLI_LOPT},
+			{XNVME_CLI_OPT_SQPOLL_POOL, XNVME_CLI_LOPT},
+			{XNVME_CLI_OPT_SQPOLL_CPUS, XNVME_CLI_LOPT},
+			{XNVME_CLI_OPT_SQPOLL_IDLE, XNVME_CLI_LOPT},
 			{XNVME_CLI_OPT_GPU_ID, XNVME_CLI_LOPT},
 			{XNVME_CLI_OPT_SHM_ID, XNVME_CLI_LOPT},
 		},
@@ -1353,6 +1356,9 @@ static struct xnvme_cli_sub g_subs[] = {
 			{XNVME_CLI_OPT_DIRECT, XNVME_CLI_LFLG},
 			{XNVME_CLI_OPT_POLL_IO, XNVME_CLI_LOPT},
 			{XNVME_CLI_OPT_POLL_SQ, XNVME_CLI_LOPT},
+			{XNVME_CLI_OPT_SQPOLL_POOL, XNVME_CLI_LOPT},
+			{XNVME_CLI_OPT_SQPOLL_CPUS, XNVME_CLI_LOPT},
+			{XNVME_CLI_OPT_SQPOLL_IDLE, XNVME_CLI_LOPT},
 			{XNVME_CLI_OPT_GPU_ID, XNVME_CLI_LOPT},
 			{XNVME_CLI_OPT_SHM_ID, XNVME_CLI_LOPT},
 		},